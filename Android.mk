@@ -27,8 +27,10 @@ SPVTOOLS_SRC_FILES := \
 		source/table.cpp \
 		source/text.cpp \
 		source/text_handler.cpp \
+		source/util/allocator.cpp \
 		source/util/bit_vector.cpp \
 		source/util/parse_number.cpp \
+		source/util/sparse_bit_vector.cpp \
 		source/util/string_utils.cpp \
 		source/util/timer.cpp \
 		source/val/basic_block.cpp \
@@ -124,6 +126,7 @@ SPVTOOLS_OPT_SRC_FILES := \
 		source/opt/instrument_pass.cpp \
 		source/opt/interp_fixup_pass.cpp \
 		source/opt/ir_context.cpp \
+		source/opt/ir_journal.cpp \
 		source/opt/ir_loader.cpp \
 		source/opt/licm_pass.cpp \
 		source/opt/local_access_chain_convert_pass.cpp \
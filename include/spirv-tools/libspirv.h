@@ -44,6 +44,37 @@ extern "C" {
 #define SPIRV_TOOLS_EXPORT
 #endif
 
+// Thread safety
+//
+// The library's functions may be called concurrently from any number of
+// threads, provided that no object passed to one call is modified by another
+// call at the same time.  The library keeps only the following process-wide
+// state, all of which is safe to use from several threads:
+// * One context for each target environment, which the library uses
+//   internally.  They are created together on first use and are never
+//   modified afterwards.
+// * The code growth threshold of loop peeling, set through the
+//   --loop-peeling-threshold flag (see optimizer.hpp).  It is read and written
+//   atomically, but setting it affects the loop peeling passes of every
+//   optimizer in the process, including those running at the time.
+// * The trace that the command line tools write when the
+//   SPIRV_TOOLS_TRACE_FILE environment variable is set.  Events from several
+//   threads are written to it one at a time.
+// Apart from that:
+// * A context may be shared by concurrent calls, such as spvTextToBinary,
+//   spvBinaryToText, spvBinaryParse and spvValidate, which only read it.  Its
+//   message consumer is then called from several threads, and must cope with
+//   that.  Setting the message consumer of a context that is in use, or
+//   destroying it, is not safe.
+// * Likewise, options objects and input binaries and texts may be shared by
+//   calls that only read them, but not while they are being set or destroyed.
+// * Everything a call returns through its parameters, such as a binary, a
+//   text or a diagnostic, belongs to the caller.
+// * Numbers in assembly text are parsed the same way whatever the locale of
+//   the process.
+// The C++ interfaces in libspirv.hpp, optimizer.hpp and linker.hpp follow
+// the same rules.
+
 // Helpers
 
 #define SPV_BIT(shift) (1 << (shift))
@@ -428,6 +459,21 @@ typedef struct spv_diagnostic_t {
   bool isTextSource;
 } spv_diagnostic_t;
 
+// An allocator, supplied by a client, to which the library can route some of
+// its allocations, for instance to place them in an arena that the client
+// frees all at once.  |allocate| must return at least |size| bytes of memory,
+// aligned for any object; it must not return null.  |deallocate| is given
+// the memory and size of an earlier allocation; it may be null if the client
+// reclaims the memory some other way.  Both are passed |user_data|, and may be
+// called from any thread that uses the allocator.  Memory is always freed
+// through the allocator that allocated it, so the allocator must keep working
+// for as long as objects it allocated are alive.
+typedef struct spv_allocator_t {
+  void* (*allocate)(void* user_data, size_t size);
+  void (*deallocate)(void* user_data, void* ptr, size_t size);
+  void* user_data;
+} spv_allocator_t;
+
 // Opaque struct containing the context used to operate on a SPIR-V module.
 // Its object is used by various translation API functions.
 typedef struct spv_context_t spv_context_t;
@@ -440,6 +486,11 @@ typedef struct spv_reducer_options_t spv_reducer_options_t;
 
 typedef struct spv_fuzzer_options_t spv_fuzzer_options_t;
 
+// Opaque struct holding a SPIR-V module in the optimizer's in-memory
+// representation.  The functions operating on it are provided by the
+// SPIRV-Tools-opt library.
+typedef struct spv_ir_module_t spv_ir_module_t;
+
 // Type Definitions
 
 typedef spv_const_binary_t* spv_const_binary;
@@ -457,6 +508,8 @@ typedef spv_reducer_options_t* spv_reducer_options;
 typedef const spv_reducer_options_t* spv_const_reducer_options;
 typedef spv_fuzzer_options_t* spv_fuzzer_options;
 typedef const spv_fuzzer_options_t* spv_const_fuzzer_options;
+typedef spv_ir_module_t* spv_ir_module;
+typedef const spv_ir_module_t* spv_const_ir_module;
 
 // Platform API
 
@@ -515,6 +568,8 @@ typedef enum {
 
   SPV_ENV_UNIVERSAL_1_5,  // SPIR-V 1.5 latest revision, no other restrictions.
   SPV_ENV_VULKAN_1_2,     // Vulkan 1.2 latest revision.
+
+  SPV_ENV_MAX  // Keep this as the last enum value.
 } spv_target_env;
 
 // SPIR-V Validator can be parameterized with the following Universal Limits.
@@ -560,6 +615,21 @@ SPIRV_TOOLS_EXPORT spv_context spvContextCreate(spv_target_env env);
 // Destroys the given context object.
 SPIRV_TOOLS_EXPORT void spvContextDestroy(spv_context context);
 
+// Routes some of the allocations of the calls made with |context| to
+// |allocator|, or back to the global operator new if |allocator| is null:
+// * The binaries, texts and diagnostics that the calls return.  They are
+//   freed through the allocator that allocated them by spvBinaryDestroy,
+//   spvTextDestroy and spvDiagnosticDestroy.
+// * The instruction objects of the in-memory modules that spvIRModuleCreate
+//   builds.  A module keeps the allocator it was created with, and uses it
+//   for the instructions it gains in spvIRModuleOptimize, whatever the
+//   allocator of the context of that call, and to free them all.
+// All other memory of the library is still allocated with operator new,
+// including the validator's data, and the modules' functions, basic blocks
+// and instruction operands.
+SPIRV_TOOLS_EXPORT void spvContextSetAllocator(
+    spv_context context, const spv_allocator_t* allocator);
+
 // Creates a Validator options object with default options. Returns a valid
 // options object. The object remains valid until it is passed into
 // spvValidatorOptionsDestroy.
@@ -746,6 +816,13 @@ SPIRV_TOOLS_EXPORT void spvFuzzerOptionsSetReplayRange(
 SPIRV_TOOLS_EXPORT void spvFuzzerOptionsSetShrinkerStepLimit(
     spv_fuzzer_options options, uint32_t shrinker_step_limit);
 
+// Sets the number of threads that the shrinker should use.  With more than one
+// thread, several candidate removals are replayed and checked for
+// interestingness concurrently, so the interestingness function must be safe
+// to call from multiple threads.  0 and 1 both mean that shrinking is serial.
+SPIRV_TOOLS_EXPORT void spvFuzzerOptionsSetShrinkerNumThreads(
+    spv_fuzzer_options options, uint32_t shrinker_num_threads);
+
 // Enables running the validator after every pass is applied during a fuzzing
 // run.
 SPIRV_TOOLS_EXPORT void spvFuzzerOptionsEnableFuzzerPassValidation(
@@ -884,6 +961,53 @@ SPIRV_TOOLS_EXPORT spv_result_t spvBinaryParse(
     const size_t num_words, spv_parsed_header_fn_t parse_header,
     spv_parsed_instruction_fn_t parse_instruction, spv_diagnostic* diagnostic);
 
+// In-memory module API
+//
+// These functions let a module be optimized, validated and so on in turn
+// while it stays in memory, rather than being serialized to a binary and
+// parsed again by each tool.  They are provided by the SPIRV-Tools-opt
+// library.  As elsewhere, if |diagnostic| is non-null it receives any error,
+// and otherwise errors are sent to the message consumer of |context|.
+
+// Builds an in-memory module for the target environment of |context| from
+// the SPIR-V binary |words|.  If |options| is non-null, the binary is also
+// validated according to |options|, from the same parse of the binary.  On
+// success, |*module| is set to the new module, which remains valid until it
+// is passed into |spvIRModuleDestroy|.
+SPIRV_TOOLS_EXPORT spv_result_t spvIRModuleCreate(
+    const spv_const_context context, const uint32_t* words,
+    const size_t num_words, spv_const_validator_options options,
+    spv_ir_module* module, spv_diagnostic* diagnostic);
+
+// Destroys the given in-memory module.
+SPIRV_TOOLS_EXPORT void spvIRModuleDestroy(spv_ir_module module);
+
+// Optimizes |module| in place, running the passes given by the |num_flags|
+// command line flags in |flags|, in the form accepted by spirv-opt.  New
+// instructions come from the allocator |module| was created with.  The
+// module is not validated before it is optimized, whatever |options| says;
+// the other options apply.  |options| may be null, in which case the default
+// options are used.  If optimization fails, |module| may be left invalid.
+// The passes set up from |flags| are kept with |module|, so calling this
+// again with the same flags does not parse them again.
+SPIRV_TOOLS_EXPORT spv_result_t spvIRModuleOptimize(
+    const spv_const_context context, spv_ir_module module,
+    const char* const* flags, const size_t num_flags,
+    spv_optimizer_options options, spv_diagnostic* diagnostic);
+
+// Validates |module| according to |options|, or the default validator
+// options if |options| is null.  The validator works on the binary form of
+// the module, which is produced for it without being parsed back.
+SPIRV_TOOLS_EXPORT spv_result_t spvIRModuleValidate(
+    const spv_const_context context, spv_const_ir_module module,
+    spv_const_validator_options options, spv_diagnostic* diagnostic);
+
+// Writes the binary form of |module| into |*binary|, which remains valid
+// until it is passed into |spvBinaryDestroy|.  The binary comes from the
+// allocator |module| was created with.
+SPIRV_TOOLS_EXPORT spv_result_t spvIRModuleToBinary(spv_const_ir_module module,
+                                                    spv_binary* binary);
+
 #ifdef __cplusplus
 }
 #endif
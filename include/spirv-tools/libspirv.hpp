@@ -250,6 +250,11 @@ class FuzzerOptions {
     spvFuzzerOptionsSetShrinkerStepLimit(options_, shrinker_step_limit);
   }
 
+  // See spvFuzzerOptionsSetShrinkerNumThreads.
+  void set_shrinker_num_threads(uint32_t shrinker_num_threads) {
+    spvFuzzerOptionsSetShrinkerNumThreads(options_, shrinker_num_threads);
+  }
+
   // See spvFuzzerOptionsEnableFuzzerPassValidation.
   void enable_fuzzer_pass_validation() {
     spvFuzzerOptionsEnableFuzzerPassValidation(options_);
@@ -266,7 +271,10 @@ class FuzzerOptions {
 // (including target environment and the corresponding SPIR-V grammar) and
 // provides methods for assembling, disassembling, and validating.
 //
-// Instances of this class provide basic thread-safety guarantee.
+// Instances of this class provide basic thread-safety guarantee.  Its const
+// methods may be called concurrently on the same instance, provided that the
+// message consumer can be called from several threads at once;
+// SetMessageConsumer() must not be called while another method is running.
 class SpirvTools {
  public:
   enum {
@@ -83,6 +83,10 @@ class LinkerOptions {
 // * Some entry points were defined multiple times;
 // * Some imported symbols did not have an exported counterpart;
 // * Possibly other reasons.
+//
+// Several modules may be linked concurrently, also with the same |context|,
+// provided that its message consumer can be called from several threads at
+// once.
 spv_result_t Link(const Context& context,
                   const std::vector<std::vector<uint32_t>>& binaries,
                   std::vector<uint32_t>* linked_binary,
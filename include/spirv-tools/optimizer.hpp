@@ -26,6 +26,7 @@
 namespace spvtools {
 
 namespace opt {
+class IRContext;
 class Pass;
 }
 
@@ -48,7 +49,9 @@ class Optimizer {
     // Tokens for built-in passes should be created using Create*Pass functions
     // below; for out-of-tree passes, use this constructor instead.
     // Note that this API isn't guaranteed to be stable and may change without
-    // preserving source or binary compatibility in the future.
+    // preserving source or binary compatibility in the future.  As the pass
+    // cannot be instantiated again, an optimizer with such a pass registered
+    // can only be run once.
     PassToken(std::unique_ptr<opt::Pass>&& pass);
 
     // Tokens can only be moved. Copying is disabled.
@@ -89,6 +92,11 @@ class Optimizer {
   // Registers the given |pass| to this optimizer. Passes will be run in the
   // exact order of registration. The token passed in will be consumed by this
   // method.
+  //
+  // Registered passes stay registered across calls to Run(): each call runs
+  // fresh instances of them, so that an optimizer can be set up once and then
+  // run on any number of modules, including concurrently from several threads
+  // as long as the optimizer is not being modified at the same time.
   Optimizer& RegisterPass(PassToken&& pass);
 
   // Registers passes that attempt to improve performance of generated code.
@@ -119,6 +127,10 @@ class Optimizer {
   // Optimizer::SetMessageConsumer to define a message consumer, if needed).
   //
   // If all the passes are registered successfully, it returns true.
+  //
+  // Note that --loop-peeling-threshold does not register a pass: it sets the
+  // threshold of all loop peeling passes in the process, including those of
+  // other optimizers, which may be running at the time.
   bool RegisterPassesFromFlags(const std::vector<std::string>& flags);
 
   // Registers the optimization pass associated with |flag|.  This only accepts
@@ -170,6 +182,11 @@ class Optimizer {
   // that it is verifiable from data in the binary itself.
   //
   // It's allowed to alias |original_binary| to the start of |optimized_binary|.
+  //
+  // Each call uses its own instances of the registered passes, and may be made
+  // concurrently with other calls, provided that the message consumer and any
+  // streams given to SetPrintAll() or SetTimeReport() can be used from several
+  // threads.
   bool Run(const uint32_t* original_binary, size_t original_binary_size,
            std::vector<uint32_t>* optimized_binary) const;
 
@@ -196,6 +213,22 @@ class Optimizer {
            std::vector<uint32_t>* optimized_binary,
            const spv_optimizer_options opt_options) const;
 
+  // Optimizes, in place, the module held by |context|, which stays owned by
+  // the caller.  This lets a caller that keeps the module in memory, such as
+  // one using the spv_ir_module C API, chain the optimizer with other tools
+  // without serializing and re-parsing the module between them.
+  //
+  // The module is not validated before the transforms are performed, whatever
+  // |opt_options| says: it is up to the caller to validate it when it is
+  // built.  The other options, including validation after each transform,
+  // apply as for the Run() methods above.  The allocator set with
+  // SetAllocator() is not used: the instructions added to the module are
+  // allocated in the same way as those it already holds.  Returns false if
+  // errors occur when processing the module using any of the registered
+  // passes, in which case the module held by |context| may be invalid.
+  bool Run(opt::IRContext* context,
+           const spv_optimizer_options opt_options) const;
+
   // Returns a vector of strings with all the pass names added to this
   // optimizer's pass manager. These strings are valid until the associated
   // pass manager is destroyed.
@@ -214,6 +247,13 @@ class Optimizer {
   // Sets the option to validate the module after each pass.
   Optimizer& SetValidateAfterAll(bool validate);
 
+  // Sets the allocator of the instructions of the modules that the Run()
+  // methods taking a binary build; each such module is destroyed before the
+  // call returns.  The functions of |allocator| are copied, and may be called
+  // from the thread of any Run() call.  If |allocator| is null, the global
+  // operator new is used.
+  Optimizer& SetAllocator(const spv_allocator_t* allocator);
+
  private:
   struct Impl;                  // Opaque struct for holding internal data.
   std::unique_ptr<Impl> impl_;  // Unique pointer to internal data.
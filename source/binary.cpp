@@ -21,6 +21,7 @@
 #include <cstring>
 #include <iterator>
 #include <limits>
+#include <new>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -33,6 +34,7 @@
 #include "source/operand.h"
 #include "source/spirv_constant.h"
 #include "source/spirv_endian.h"
+#include "source/util/allocator.h"
 
 spv_result_t spvBinaryHeaderGet(const spv_const_binary binary,
                                 const spv_endianness_t endian,
@@ -819,12 +821,17 @@ spv_result_t spvBinaryParse(const spv_const_context context, void* user_data,
   return parser.parse(code, num_words, diagnostic);
 }
 
-// TODO(dneto): This probably belongs in text.cpp since that's the only place
-// that a spv_binary_t value is created.
+spv_binary spvBinaryCreate(size_t word_count) {
+  uint32_t* code = static_cast<uint32_t*>(
+      spvtools::utils::AllocateTagged(word_count * sizeof(uint32_t)));
+  return new (spvtools::utils::AllocateTagged(sizeof(spv_binary_t)))
+      spv_binary_t{code, word_count};
+}
+
 void spvBinaryDestroy(spv_binary binary) {
   if (binary) {
-    if (binary->code) delete[] binary->code;
-    delete binary;
+    spvtools::utils::DeallocateTagged(binary->code);
+    spvtools::utils::DeallocateTagged(binary);
   }
 }
 
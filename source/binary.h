@@ -27,6 +27,12 @@ spv_result_t spvBinaryHeaderGet(const spv_const_binary binary,
                                 const spv_endianness_t endian,
                                 spv_header_t* header);
 
+// Creates a binary object with room for |word_count| words, which are left for
+// the caller to fill in.  The object comes from the client allocator in
+// scope, if any (see utils::AllocateTagged), and is freed by
+// spvBinaryDestroy.
+spv_binary spvBinaryCreate(size_t word_count);
+
 // Returns the number of non-null characters in str before the first null
 // character, or strsz if there is no null character.  Examines at most the
 // first strsz characters in str.  Returns 0 if str is nullptr.  This is a
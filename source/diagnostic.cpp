@@ -17,34 +17,28 @@
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <utility>
 
 #include "source/table.h"
+#include "source/util/allocator.h"
 
 // Diagnostic API
 
 spv_diagnostic spvDiagnosticCreate(const spv_position position,
                                    const char* message) {
-  spv_diagnostic diagnostic = new spv_diagnostic_t;
-  if (!diagnostic) return nullptr;
   size_t length = strlen(message) + 1;
-  diagnostic->error = new char[length];
-  if (!diagnostic->error) {
-    delete diagnostic;
-    return nullptr;
-  }
-  diagnostic->position = *position;
-  diagnostic->isTextSource = false;
-  memset(diagnostic->error, 0, length);
-  strcpy(diagnostic->error, message);
-  return diagnostic;
+  char* error = static_cast<char*>(spvtools::utils::AllocateTagged(length));
+  memcpy(error, message, length);
+  return new (spvtools::utils::AllocateTagged(sizeof(spv_diagnostic_t)))
+      spv_diagnostic_t{*position, error, false};
 }
 
 void spvDiagnosticDestroy(spv_diagnostic diagnostic) {
   if (!diagnostic) return;
-  delete[] diagnostic->error;
-  delete diagnostic;
+  spvtools::utils::DeallocateTagged(diagnostic->error);
+  spvtools::utils::DeallocateTagged(diagnostic);
 }
 
 spv_result_t spvDiagnosticPrint(const spv_diagnostic diagnostic) {
@@ -117,11 +111,15 @@ void UseDiagnosticAsMessageConsumer(spv_context context,
                                     spv_diagnostic* diagnostic) {
   assert(diagnostic && *diagnostic == nullptr);
 
-  auto create_diagnostic = [diagnostic](spv_message_level_t, const char*,
-                                        const spv_position_t& position,
-                                        const char* message) {
+  // The diagnostic comes from the allocator of |context| as it is now.
+  const spv_allocator_t allocator = context->allocator;
+  auto create_diagnostic = [diagnostic, allocator](
+                               spv_message_level_t, const char*,
+                               const spv_position_t& position,
+                               const char* message) {
     auto p = position;
     spvDiagnosticDestroy(*diagnostic);  // Avoid memory leak.
+    utils::ScopedAllocator scoped_allocator(&allocator);
     *diagnostic = spvDiagnosticCreate(&p, message);
   };
   SetContextMessageConsumer(context, std::move(create_diagnostic));
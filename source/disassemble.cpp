@@ -21,7 +21,9 @@
 #include <cassert>
 #include <cstring>
 #include <iomanip>
+#include <locale>
 #include <memory>
+#include <new>
 #include <unordered_map>
 #include <utility>
 
@@ -36,8 +38,11 @@
 #include "source/print.h"
 #include "source/spirv_constant.h"
 #include "source/spirv_endian.h"
+#include "source/table.h"
+#include "source/util/allocator.h"
 #include "source/util/hex_float.h"
 #include "source/util/make_unique.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.h"
 
 namespace {
@@ -62,7 +67,10 @@ class Disassembler {
         show_byte_offset_(spvIsInBitfield(
             SPV_BINARY_TO_TEXT_OPTION_SHOW_BYTE_OFFSET, options)),
         byte_offset_(0),
-        name_mapper_(std::move(name_mapper)) {}
+        name_mapper_(std::move(name_mapper)) {
+    // Numbers in SPIR-V assembly do not depend on the locale of the process.
+    text_.imbue(std::locale::classic());
+  }
 
   // Emits the assembly header for the module, and sets up internal state
   // so subsequent callbacks can handle the cases where the entire module
@@ -392,17 +400,10 @@ void Disassembler::EmitMaskOperand(const spv_operand_type_t type,
 spv_result_t Disassembler::SaveTextResult(spv_text* text_result) const {
   if (!print_) {
     size_t length = text_.str().size();
-    char* str = new char[length + 1];
-    if (!str) return SPV_ERROR_OUT_OF_MEMORY;
+    char* str = static_cast<char*>(spvtools::utils::AllocateTagged(length + 1));
     strncpy(str, text_.str().c_str(), length + 1);
-    spv_text text = new spv_text_t();
-    if (!text) {
-      delete[] str;
-      return SPV_ERROR_OUT_OF_MEMORY;
-    }
-    text->str = str;
-    text->length = length;
-    *text_result = text;
+    *text_result = new (spvtools::utils::AllocateTagged(sizeof(spv_text_t)))
+        spv_text_t{str, length};
   }
   return SPV_SUCCESS;
 }
@@ -476,6 +477,8 @@ spv_result_t spvBinaryToText(const spv_const_context context,
                              const uint32_t* code, const size_t wordCount,
                              const uint32_t options, spv_text* pText,
                              spv_diagnostic* pDiagnostic) {
+  SPIRV_TRACE_SCOPE("Disassemble");
+  spvtools::utils::ScopedAllocator scoped_allocator(&context->allocator);
   spv_context_t hijack_context = *context;
   if (pDiagnostic) {
     *pDiagnostic = nullptr;
@@ -511,12 +514,10 @@ std::string spvtools::spvInstructionBinaryToText(const spv_target_env env,
                                                  const uint32_t* code,
                                                  const size_t wordCount,
                                                  const uint32_t options) {
-  spv_context context = spvContextCreate(env);
+  spv_const_context context = spvtools::GetSharedContext(env);
+  if (!context) return "";
   const spvtools::AssemblyGrammar grammar(context);
-  if (!grammar.isValid()) {
-    spvContextDestroy(context);
-    return "";
-  }
+  if (!grammar.isValid()) return "";
 
   // Generate friendly names for Ids if requested.
   std::unique_ptr<spvtools::FriendlyNameMapper> friendly_mapper;
@@ -541,7 +542,6 @@ std::string spvtools::spvInstructionBinaryToText(const spv_target_env env,
     while (!output.empty() && output.back() == '\n') output.pop_back();
   }
   spvTextDestroy(text);
-  spvContextDestroy(context);
 
   return output;
 }
@@ -278,9 +278,12 @@ void AddedFunctionReducer::ReplayAdaptedTransformations(
       transformation_sequence_in_.transformation_size() ==
           modified_transformations.transformation_size() &&
       "The original and modified transformations should have the same size.");
+  const auto num_modified_transformations =
+      static_cast<uint32_t>(modified_transformations.transformation_size());
   auto replay_result = Replayer(target_env_, consumer_, binary_in_,
-                                initial_facts_, modified_transformations,
-                                modified_transformations.transformation_size(),
+                                initial_facts_,
+                                std::move(modified_transformations),
+                                num_modified_transformations,
                                 validate_during_replay_, validator_options_)
                            .Run();
   assert(replay_result.status == Replayer::ReplayerResultStatus::kComplete &&
@@ -13,35 +13,65 @@
 // limitations under the License.
 
 #include "source/fuzz/available_instructions.h"
+
+#include <algorithm>
+
 #include "source/fuzz/fuzzer_util.h"
+#include "source/util/make_unique.h"
 
 namespace spvtools {
 namespace fuzz {
 
+struct AvailableInstructions::Index {
+  // The global instructions.
+  std::vector<opt::Instruction*> globals;
+
+  // Per function, the parameters.
+  std::unordered_map<opt::Function*, std::vector<opt::Instruction*>> params;
+
+  // Per reachable block, the instructions of the block, in the order in which
+  // they appear in the block.
+  std::unordered_map<opt::BasicBlock*, std::vector<opt::Instruction*>>
+      generated_by_block;
+};
+
 AvailableInstructions::AvailableInstructions(
     opt::IRContext* ir_context,
     const std::function<bool(opt::IRContext*, opt::Instruction*)>& predicate)
-    : ir_context_(ir_context) {
+    : AvailableInstructions(ir_context, predicate, nullptr) {}
+
+AvailableInstructions::AvailableInstructions(
+    opt::IRContext* ir_context,
+    const std::function<bool(opt::IRContext*, opt::Instruction*)>& predicate,
+    const std::function<uint32_t(opt::IRContext*, opt::Instruction*)>& key)
+    : ir_context_(ir_context),
+      predicate_(predicate),
+      key_(key),
+      all_(MakeUnique<Index>()) {
   // Consider all global declarations
   for (auto& global : ir_context->module()->types_values()) {
-    if (predicate(ir_context, &global)) {
-      available_globals_.push_back(&global);
+    if (predicate_(ir_context, &global)) {
+      ForEachIndexFor(&global, [&global](Index* index) {
+        index->globals.push_back(&global);
+      });
     }
   }
 
   // Consider every function
   for (auto& function : *ir_context->module()) {
     // Identify those function parameters that satisfy the predicate.
-    std::vector<opt::Instruction*> available_params_for_function;
-    function.ForEachParam(
-        [&predicate, ir_context,
-         &available_params_for_function](opt::Instruction* param) {
-          if (predicate(ir_context, param)) {
-            available_params_for_function.push_back(param);
-          }
+    function.ForEachParam([this, &function](opt::Instruction* param) {
+      if (predicate_(ir_context_, param)) {
+        ForEachIndexFor(param, [&function, param](Index* index) {
+          index->params[&function].push_back(param);
         });
+      }
+    });
 
-    // Consider every reachable block in the function.
+    // Consider every reachable block in the function.  Blocks are visited in
+    // an order in which a block comes after its dominators, but this is not
+    // required: only the immediate dominator of each block is recorded, and
+    // the dominator tree is walked on demand by queries.
     auto dominator_analysis = ir_context->GetDominatorAnalysis(&function);
     for (auto& block : function) {
       if (!ir_context->IsReachable(block)) {
@@ -51,68 +81,164 @@ AvailableInstructions::AvailableInstructions(
       if (&block == &*function.begin()) {
         // The function entry block is special: only the relevant globals and
         // function parameters are available at its entry point.
-        num_available_at_block_entry_.insert(
-            {&block,
-             static_cast<uint32_t>(available_params_for_function.size() +
-                                   available_globals_.size())});
+        immediate_dominator_.insert({&block, nullptr});
       } else {
         // |block| is not the entry block and is reachable, so it must have an
-        // immediate dominator. The number of instructions available on entry to
-        // |block| is thus the number of instructions available on entry to the
-        // immediate dominator + the number of instructions generated_by_block
-        // by the immediate dominator.
+        // immediate dominator.
         auto immediate_dominator =
             dominator_analysis->ImmediateDominator(&block);
         assert(immediate_dominator != nullptr &&
                "The block is reachable so should have an immediate dominator.");
-        assert(generated_by_block_.count(immediate_dominator) != 0 &&
-               "Immediate dominator should have already been processed.");
-        assert(num_available_at_block_entry_.count(immediate_dominator) != 0 &&
-               "Immediate dominator should have already been processed.");
-        num_available_at_block_entry_.insert(
-            {&block,
-             static_cast<uint32_t>(
-                 generated_by_block_.at(immediate_dominator).size()) +
-                 num_available_at_block_entry_.at(immediate_dominator)});
+        immediate_dominator_.insert({&block, immediate_dominator});
       }
+      ComputePositions(&block);
       // Now consider each instruction in the block.
-      std::vector<opt::Instruction*> generated_by_block;
       for (auto& inst : block) {
-        assert(num_available_at_block_entry_.count(&block) != 0 &&
-               "Block should have already been processed.");
-        // The number of available instructions before |inst| is the number
-        // available at the start of the block + the number of relevant
-        // instructions generated by the block so far.
-        num_available_before_instruction_.insert(
-            {&inst, num_available_at_block_entry_.at(&block) +
-                        static_cast<uint32_t>(generated_by_block.size())});
-        if (predicate(ir_context, &inst)) {
+        if (predicate_(ir_context, &inst)) {
           // This instruction satisfies the predicate, so note that it is
           // generated by |block|.
-          generated_by_block.push_back(&inst);
+          ForEachIndexFor(&inst, [&block, &inst](Index* index) {
+            index->generated_by_block[&block].push_back(&inst);
+          });
         }
       }
-      generated_by_block_.emplace(&block, std::move(generated_by_block));
     }
-    available_params_.emplace(&function,
-                              std::move(available_params_for_function));
   }
 }
 
+AvailableInstructions::~AvailableInstructions() = default;
+
 AvailableInstructions::AvailableBeforeInstruction
 AvailableInstructions::GetAvailableBeforeInstruction(
     opt::Instruction* inst) const {
-  assert(num_available_before_instruction_.count(inst) != 0 &&
+  return GetAvailableBeforeInstruction(inst, all_.get());
+}
+
+AvailableInstructions::AvailableBeforeInstruction
+AvailableInstructions::GetAvailableBeforeInstruction(opt::Instruction* inst,
+                                                     uint32_t key) const {
+  assert(key_ && "Keys were not provided on construction.");
+  auto keyed_index = by_key_.find(key);
+  return GetAvailableBeforeInstruction(
+      inst, keyed_index == by_key_.end() ? nullptr : keyed_index->second.get());
+}
+
+AvailableInstructions::AvailableBeforeInstruction
+AvailableInstructions::GetAvailableBeforeInstruction(opt::Instruction* inst,
+                                                     const Index* index) const {
+  assert(position_in_block_.count(inst) != 0 &&
+         "Availability can only be queried for reachable instructions.");
+  AvailableBeforeInstruction result;
+  if (index == nullptr) {
+    // No instruction has the requested key.
+    return result;
+  }
+
+  auto block = ir_context_->get_instr_block(inst);
+  assert(immediate_dominator_.count(block) != 0 &&
          "Availability can only be queried for reachable instructions.");
-  return {*this, inst};
+
+  // Globals come first, followed by the parameters of the enclosing function.
+  result.globals_ = &index->globals;
+  result.size_ = static_cast<uint32_t>(index->globals.size());
+  auto params = index->params.find(block->GetParent());
+  if (params != index->params.end()) {
+    result.params_ = &params->second;
+    result.size_ += static_cast<uint32_t>(params->second.size());
+  }
+
+  // Then come the instructions generated by the blocks that dominate |block|,
+  // starting from the function entry block, followed by the instructions of
+  // |block| that precede |inst|.
+  std::vector<opt::BasicBlock*> dominators;
+  for (auto* dominator = block; dominator != nullptr;
+       dominator = immediate_dominator_.at(dominator)) {
+    dominators.push_back(dominator);
+  }
+  for (auto dominator = dominators.rbegin(); dominator != dominators.rend();
+       ++dominator) {
+    auto generated = index->generated_by_block.find(*dominator);
+    if (generated == index->generated_by_block.end()) {
+      continue;
+    }
+    auto num_generated = static_cast<uint32_t>(generated->second.size());
+    if (*dominator == block) {
+      num_generated = static_cast<uint32_t>(
+          std::lower_bound(generated->second.begin(), generated->second.end(),
+                           position_in_block_.at(inst),
+                           [this](const opt::Instruction* generated_inst,
+                                  uint32_t position) {
+                             return position_in_block_.at(generated_inst) <
+                                    position;
+                           }) -
+          generated->second.begin());
+    }
+    if (num_generated == 0) {
+      continue;
+    }
+    result.blocks_.push_back(&generated->second);
+    result.num_available_before_block_.push_back(result.size_);
+    result.size_ += num_generated;
+  }
+  return result;
 }
 
-AvailableInstructions::AvailableBeforeInstruction::AvailableBeforeInstruction(
-    const AvailableInstructions& available_instructions, opt::Instruction* inst)
-    : available_instructions_(available_instructions), inst_(inst) {}
+void AvailableInstructions::AddInstruction(opt::Instruction* inst) {
+  auto block = ir_context_->get_instr_block(inst);
+  if (block == nullptr) {
+    assert(inst->opcode() != SpvOpFunctionParameter &&
+           "Function parameters cannot be added.");
+    if (predicate_(ir_context_, inst)) {
+      ForEachIndexFor(
+          inst, [inst](Index* index) { index->globals.push_back(inst); });
+    }
+    return;
+  }
+
+  assert(immediate_dominator_.count(block) != 0 &&
+         "The block must have been reachable on construction.");
+  // The positions of the instructions that follow |inst| in the block have
+  // changed, but their relative order has not, so the per-block instruction
+  // lists remain sorted.
+  ComputePositions(block);
+  if (!predicate_(ir_context_, inst)) {
+    return;
+  }
+  const uint32_t position = position_in_block_.at(inst);
+  ForEachIndexFor(inst, [this, block, inst, position](Index* index) {
+    auto& generated = index->generated_by_block[block];
+    generated.insert(
+        std::lower_bound(generated.begin(), generated.end(), position,
+                         [this](const opt::Instruction* generated_inst,
+                                uint32_t other_position) {
+                           return position_in_block_.at(generated_inst) <
+                                  other_position;
+                         }),
+        inst);
+  });
+}
+
+void AvailableInstructions::ForEachIndexFor(
+    opt::Instruction* inst, const std::function<void(Index*)>& f) {
+  f(all_.get());
+  if (key_) {
+    auto& keyed_index = by_key_[key_(ir_context_, inst)];
+    if (!keyed_index) {
+      keyed_index = MakeUnique<Index>();
+    }
+    f(keyed_index.get());
+  }
+}
+
+void AvailableInstructions::ComputePositions(opt::BasicBlock* block) {
+  uint32_t position = 0;
+  for (auto& inst : *block) {
+    position_in_block_[&inst] = position++;
+  }
+}
 
 uint32_t AvailableInstructions::AvailableBeforeInstruction::size() const {
-  return available_instructions_.num_available_before_instruction_.at(inst_);
+  return size_;
 }
 
 bool AvailableInstructions::AvailableBeforeInstruction::empty() const {
@@ -123,68 +249,30 @@ opt::Instruction* AvailableInstructions::AvailableBeforeInstruction::operator[](
     uint32_t index) const {
   assert(index < size() && "Index out of bounds.");
 
-  // First, check the cache to see whether we can return the available
-  // instruction in constant time.
-  auto cached_result = index_cache.find(index);
-  if (cached_result != index_cache.end()) {
-    return cached_result->second;
-  }
-
-  // Next check whether the index falls into the global region.
-  if (index < available_instructions_.available_globals_.size()) {
-    auto result = available_instructions_.available_globals_[index];
-    index_cache.insert({index, result});
-    return result;
+  // First check whether the index falls into the global region.
+  uint32_t index_after_globals = index;
+  if (globals_ != nullptr) {
+    if (index < globals_->size()) {
+      return (*globals_)[index];
+    }
+    index_after_globals -= static_cast<uint32_t>(globals_->size());
   }
 
-  auto block = available_instructions_.ir_context_->get_instr_block(inst_);
-  auto function = block->GetParent();
-
   // Next check whether the index falls into the available instructions that
   // correspond to function parameters.
-  if (index <
-      available_instructions_.available_globals_.size() +
-          available_instructions_.available_params_.at(function).size()) {
-    auto result = available_instructions_.available_params_.at(
-        function)[index - available_instructions_.available_globals_.size()];
-    index_cache.insert({index, result});
-    return result;
-  }
-
-  auto dominator_analysis =
-      available_instructions_.ir_context_->GetDominatorAnalysis(function);
-
-  // Now the expensive part (which is why we have the cache): walk the dominator
-  // tree backwards starting from the block containing |inst_| until we get to
-  // the block in which the instruction corresponding to |index| exists.
-  for (auto* ancestor = block; true;
-       ancestor = dominator_analysis->ImmediateDominator(ancestor)) {
-    uint32_t num_available_at_ancestor_entry =
-        available_instructions_.num_available_at_block_entry_.at(ancestor);
-    if (index_cache.count(num_available_at_ancestor_entry) == 0) {
-      // This is the first time we have traversed this block, so we populate the
-      // cache with the index of each instruction, so that if a future index
-      // query relates to indices associated with this block we can return the
-      // result in constant time.
-      auto& generated_by_ancestor =
-          available_instructions_.generated_by_block_.at(ancestor);
-      for (uint32_t local_index = 0; local_index < generated_by_ancestor.size();
-           local_index++) {
-        index_cache.insert({num_available_at_ancestor_entry + local_index,
-                            generated_by_ancestor[local_index]});
-      }
-    }
-    if (index >= num_available_at_ancestor_entry) {
-      // This block contains the instruction we want, so by now it will be in
-      // the cache.
-      return index_cache.at(index);
-    }
-    assert(ancestor != &*function->begin() &&
-           "By construction we should find a block associated with the index.");
+  if (params_ != nullptr && index_after_globals < params_->size()) {
+    return (*params_)[index_after_globals];
   }
 
-  assert(false && "Unreachable.");
-  return nullptr;
+  // Otherwise find the last block whose instructions start at or before
+  // |index|, via a binary search over the blocks of the dominator tree path.
+  auto block = std::upper_bound(num_available_before_block_.begin(),
+                                num_available_before_block_.end(), index);
+  assert(block != num_available_before_block_.begin() &&
+         "By construction we should find a block associated with the index.");
+  auto block_index = (block - num_available_before_block_.begin()) - 1;
+  return (*blocks_[block_index])[index -
+                                 num_available_before_block_[block_index]];
 }
 
 }  // namespace fuzz
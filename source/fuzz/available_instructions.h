@@ -15,6 +15,8 @@
 #ifndef SOURCE_FUZZ_AVAILABLE_INSTRUCTIONS_H_
 #define SOURCE_FUZZ_AVAILABLE_INSTRUCTIONS_H_
 
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -28,17 +30,26 @@ namespace fuzz {
 // particular predicate that are available before a given instruction.
 // Availability information is only computed for instructions in *reachable*
 // basic blocks.
+//
+// The instructions that satisfy the predicate can optionally be partitioned
+// according to a key, e.g. their type, in which case queries can be restricted
+// to the instructions with a given key.  The available instructions are
+// recorded per block, and a query walks the dominator tree from the block of
+// the queried instruction to the entry block, so that the cost of a query
+// depends on the depth of the dominator tree rather than on the number of
+// available instructions.
+//
+// Instructions that are added to the module after construction can be made
+// available via AddInstruction.  Instructions must not be removed from the
+// module while an instance of this class is in use.
 class AvailableInstructions {
  public:
   // The outer class captures availability information for a whole module, and
   // each instance of this inner class captures availability for a particular
-  // instruction.
+  // instruction.  An instance must not be used after the outer class has been
+  // updated via AddInstruction.
   class AvailableBeforeInstruction {
    public:
-    AvailableBeforeInstruction(
-        const AvailableInstructions& available_instructions,
-        opt::Instruction* inst);
-
     // Returns the number of instructions that are available before the
     // instruction associated with this class.
     uint32_t size() const;
@@ -50,19 +61,26 @@ class AvailableInstructions {
     opt::Instruction* operator[](uint32_t index) const;
 
    private:
-    // A references to an instance of the outer class.
-    const AvailableInstructions& available_instructions_;
-
-    // The instruction for which availability information is captured.
-    opt::Instruction* inst_;
-
-    // A cache to improve the efficiency of the [] operator. The [] operator
-    // requires walking the instruction's dominator tree to find an instruction
-    // at a particular index, which is a linear time operation. By inserting all
-    // instructions that are traversed during this search into a cache, future
-    // lookups will take constant time unless they require traversing the
-    // dominator tree more deeply.
-    mutable std::unordered_map<uint32_t, opt::Instruction*> index_cache;
+    friend class AvailableInstructions;
+
+    AvailableBeforeInstruction() = default;
+
+    // The available global instructions and function parameters, or null if
+    // there are none.
+    const std::vector<opt::Instruction*>* globals_ = nullptr;
+    const std::vector<opt::Instruction*>* params_ = nullptr;
+
+    // The instructions generated by the blocks that dominate the instruction,
+    // and by the block containing the instruction, ordered from the function
+    // entry block downwards; blocks that generate no relevant instructions are
+    // omitted.
+    std::vector<const std::vector<opt::Instruction*>*> blocks_;
+
+    // Element i is the number of available instructions that precede those of
+    // |blocks_[i]|.
+    std::vector<uint32_t> num_available_before_block_;
+
+    uint32_t size_ = 0;
   };
 
   // Constructs availability instructions for |ir_context|, where instructions
@@ -71,38 +89,70 @@ class AvailableInstructions {
       opt::IRContext* ir_context,
       const std::function<bool(opt::IRContext*, opt::Instruction*)>& predicate);
 
+  // As above, where the instructions that satisfy |predicate| are additionally
+  // partitioned according to |key|, so that GetAvailableBeforeInstruction can
+  // be restricted to a single key.
+  AvailableInstructions(
+      opt::IRContext* ir_context,
+      const std::function<bool(opt::IRContext*, opt::Instruction*)>& predicate,
+      const std::function<uint32_t(opt::IRContext*, opt::Instruction*)>& key);
+
+  ~AvailableInstructions();
+
   // Yields instruction availability for |inst|.
   AvailableBeforeInstruction GetAvailableBeforeInstruction(
       opt::Instruction* inst) const;
 
+  // Yields availability for |inst| of the instructions whose key is |key|.
+  // Requires that keys were provided on construction.
+  AvailableBeforeInstruction GetAvailableBeforeInstruction(
+      opt::Instruction* inst, uint32_t key) const;
+
+  // Makes |inst|, which has been added to the module since construction,
+  // available if it satisfies the predicate.  |inst| must either be a global
+  // declaration, or belong to a block that was reachable on construction.
+  // The cost is linear in the size of the block containing |inst|.
+  void AddInstruction(opt::Instruction* inst);
+
  private:
+  // The instructions that satisfy the predicate, and that have a given key if
+  // keys are used, recorded per global, function and block.
+  struct Index;
+
+  // Applies |f| to the index of all instructions that satisfy the predicate,
+  // and to the index of the instructions with the key of |inst| if keys are
+  // used.
+  void ForEachIndexFor(opt::Instruction* inst,
+                       const std::function<void(Index*)>& f);
+
+  // Computes the positions of the instructions in |block|.
+  void ComputePositions(opt::BasicBlock* block);
+
+  // Yields availability for |inst| of the instructions recorded in |index|,
+  // which may be null.
+  AvailableBeforeInstruction GetAvailableBeforeInstruction(
+      opt::Instruction* inst, const Index* index) const;
+
   // The module in which all instructions are contained.
   opt::IRContext* ir_context_;
 
-  // The global instructions that satisfy the predicate.
-  std::vector<opt::Instruction*> available_globals_;
-
-  // Per function, the parameters that satisfy the predicate.
-  std::unordered_map<opt::Function*, std::vector<opt::Instruction*>>
-      available_params_;
-
-  // The number of instructions that satisfy the predicate and that are
-  // available at the entry to a block. For the entry block of a function this
-  // is the number of available globals + the number of available function
-  // parameters. For any other block it is the number of available instructions
-  // for the blocks immediate dominator + the number of instructions generated
-  // by the immediate dominator.
-  std::unordered_map<opt::BasicBlock*, uint32_t> num_available_at_block_entry_;
-
-  // For each block this records those instructions in the block that satisfy
-  // the predicate.
-  std::unordered_map<opt::BasicBlock*, std::vector<opt::Instruction*>>
-      generated_by_block_;
-
-  // For each instruction this records how many instructions satisfying the
-  // predicate are available before the instruction.
-  std::unordered_map<opt::Instruction*, uint32_t>
-      num_available_before_instruction_;
+  std::function<bool(opt::IRContext*, opt::Instruction*)> predicate_;
+
+  // Null if instructions are not partitioned by key.
+  std::function<uint32_t(opt::IRContext*, opt::Instruction*)> key_;
+
+  // All instructions that satisfy the predicate.
+  std::unique_ptr<Index> all_;
+
+  // The instructions that satisfy the predicate, by key.
+  std::unordered_map<uint32_t, std::unique_ptr<Index>> by_key_;
+
+  // Maps each reachable block to its immediate dominator, or to null for the
+  // entry block of a function.
+  std::unordered_map<opt::BasicBlock*, opt::BasicBlock*> immediate_dominator_;
+
+  // Maps each instruction of a reachable block to its position in the block.
+  std::unordered_map<const opt::Instruction*, uint32_t> position_in_block_;
 };
 
 }  // namespace fuzz
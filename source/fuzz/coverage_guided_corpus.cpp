@@ -0,0 +1,107 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/coverage_guided_corpus.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace spvtools {
+namespace fuzz {
+
+namespace {
+
+// The weight of an entry that has not been chosen yet and found no new
+// coverage; see ChooseEntry.
+const uint64_t kBaseEntryWeight = 1024;
+
+}  // namespace
+
+CoverageGuidedCorpus::CoverageGuidedCorpus() : num_edges_covered_(0) {}
+
+uint32_t CoverageGuidedCorpus::RecordCoverage(
+    const std::vector<uint8_t>& coverage_bitmap) {
+  if (reached_buckets_.size() < coverage_bitmap.size()) {
+    reached_buckets_.resize(coverage_bitmap.size(), 0);
+  }
+  uint32_t result = 0;
+  for (size_t edge = 0; edge < coverage_bitmap.size(); edge++) {
+    uint8_t bucket = GetHitCountBucket(coverage_bitmap[edge]);
+    if ((bucket & ~reached_buckets_[edge]) == 0) {
+      continue;
+    }
+    if (reached_buckets_[edge] == 0) {
+      num_edges_covered_++;
+    }
+    reached_buckets_[edge] |= bucket;
+    result++;
+  }
+  return result;
+}
+
+size_t CoverageGuidedCorpus::AddEntry(
+    std::vector<uint32_t> binary,
+    protobufs::TransformationSequence transformations,
+    std::vector<std::string> pass_sequence, uint32_t new_coverage) {
+  entries_.push_back({std::move(binary), std::move(transformations),
+                      std::move(pass_sequence), new_coverage, 0});
+  return entries_.size() - 1;
+}
+
+size_t CoverageGuidedCorpus::ChooseEntry(RandomGenerator* random_generator) {
+  assert(!entries_.empty() && "The corpus is empty.");
+  std::vector<uint64_t> weights;
+  weights.reserve(entries_.size());
+  uint64_t total_weight = 0;
+  for (const auto& entry : entries_) {
+    weights.push_back(
+        std::max<uint64_t>(1, kBaseEntryWeight * (1 + entry.new_coverage) /
+                                  (1 + entry.times_chosen)));
+    total_weight += weights.back();
+  }
+  uint64_t choice = random_generator->RandomUint64(total_weight);
+  size_t result = 0;
+  while (choice >= weights[result]) {
+    choice -= weights[result];
+    result++;
+  }
+  entries_[result].times_chosen++;
+  return result;
+}
+
+uint8_t CoverageGuidedCorpus::GetHitCountBucket(uint8_t count) {
+  if (count <= 2) {
+    return count;
+  }
+  if (count == 3) {
+    return 4;
+  }
+  if (count < 8) {
+    return 8;
+  }
+  if (count < 16) {
+    return 16;
+  }
+  if (count < 32) {
+    return 32;
+  }
+  if (count < 128) {
+    return 64;
+  }
+  return 128;
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
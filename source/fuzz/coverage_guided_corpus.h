@@ -0,0 +1,104 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_COVERAGE_GUIDED_CORPUS_H_
+#define SOURCE_FUZZ_COVERAGE_GUIDED_CORPUS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+#include "source/fuzz/random_generator.h"
+
+namespace spvtools {
+namespace fuzz {
+
+// The corpus of a feedback-directed fuzzing session, in the style of AFL, but
+// where the mutations are sequences of semantics-preserving transformations.
+//
+// Each variant produced by the fuzzer is given to an instrumented target,
+// which reports a coverage bitmap: one byte per edge of the target, counting
+// how often the edge was hit.  A variant is kept if its bitmap shows behaviour
+// that no earlier bitmap showed, and the variants that are most likely to lead
+// to further new behaviour are preferred when choosing what to fuzz next.
+class CoverageGuidedCorpus {
+ public:
+  struct Entry {
+    // The binary of the variant.
+    std::vector<uint32_t> binary;
+
+    // The transformations that turn the original input into the variant.
+    protobufs::TransformationSequence transformations;
+
+    // The names of the repeated fuzzer passes that were applied, in order, by
+    // the fuzzer run that produced the variant.
+    std::vector<std::string> pass_sequence;
+
+    // The number of edges for which the variant was the first to reach its
+    // hit count bucket; see RecordCoverage.
+    uint32_t new_coverage;
+
+    // The number of times the entry has been chosen for fuzzing.
+    uint32_t times_chosen;
+  };
+
+  CoverageGuidedCorpus();
+
+  // Records the edges and hit count buckets reached according to
+  // |coverage_bitmap|, and returns the number of edges whose bucket had not
+  // been reached by any bitmap recorded before.  As in AFL, hit counts are
+  // bucketed as 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and 128+, so that a change
+  // to how often an edge is hit only counts if it is large enough.  Bitmaps
+  // may be of any size; edges past the end of a bitmap are not hit.
+  uint32_t RecordCoverage(const std::vector<uint8_t>& coverage_bitmap);
+
+  // Adds a variant to the corpus, and returns its index.
+  size_t AddEntry(std::vector<uint32_t> binary,
+                  protobufs::TransformationSequence transformations,
+                  std::vector<std::string> pass_sequence,
+                  uint32_t new_coverage);
+
+  // Chooses the index of the entry that should be fuzzed next, which requires
+  // the corpus to be non-empty.  Entries are chosen at random, with a weight
+  // that grows with the new coverage they found and shrinks with the number
+  // of times they have already been chosen.
+  size_t ChooseEntry(RandomGenerator* random_generator);
+
+  const Entry& GetEntry(size_t index) const { return entries_[index]; }
+
+  size_t size() const { return entries_.size(); }
+
+  // Returns the number of edges that have been hit by a recorded bitmap.
+  uint32_t GetNumEdgesCovered() const { return num_edges_covered_; }
+
+ private:
+  // Returns the bucket, as a single bit, of the hit count |count|, or 0 if
+  // |count| is 0.
+  static uint8_t GetHitCountBucket(uint8_t count);
+
+  // For each edge, the buckets that recorded bitmaps have reached, as a set of
+  // bits.
+  std::vector<uint8_t> reached_buckets_;
+
+  uint32_t num_edges_covered_;
+
+  std::vector<Entry> entries_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_COVERAGE_GUIDED_CORPUS_H_
@@ -0,0 +1,104 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/donor_module_cache.h"
+
+#include "source/fuzz/call_graph.h"
+
+namespace spvtools {
+namespace fuzz {
+
+DonorModuleSummary DonorModuleSummary::Summarize(
+    opt::IRContext* donor_ir_context) {
+  DonorModuleSummary result;
+  for (const auto& capability_inst : donor_ir_context->capabilities()) {
+    result.capabilities.push_back(
+        static_cast<SpvCapability>(capability_inst.GetSingleWordInOperand(0)));
+  }
+  result.functions_in_topological_order =
+      CallGraph(donor_ir_context).GetFunctionsInTopologicalOrder();
+
+  // A type or value depends on the ids it uses, which are defined before it.
+  for (const auto& type_or_value : donor_ir_context->types_values()) {
+    bool undonatable;
+    switch (type_or_value.opcode()) {
+      case SpvOpTypeImage:
+      case SpvOpTypeSampledImage:
+      case SpvOpTypeSampler:
+        undonatable = true;
+        break;
+      default:
+        undonatable =
+            result.undonatable_type_and_value_ids.count(
+                type_or_value.type_id()) ||
+            !type_or_value.WhileEachInId([&result](const uint32_t* id) {
+              return !result.undonatable_type_and_value_ids.count(*id);
+            });
+        break;
+    }
+    if (undonatable) {
+      result.undonatable_type_and_value_ids.insert(type_or_value.result_id());
+    }
+  }
+
+  uint32_t position = 0;
+  for (auto& function : *donor_ir_context->module()) {
+    result.function_positions[function.result_id()] = position++;
+    for (auto& block : function) {
+      block.ForEachInst([&result](const opt::Instruction* inst) {
+        if (inst->result_id()) {
+          result.ids_defined_in_blocks.insert(inst->result_id());
+        }
+      });
+    }
+  }
+  return result;
+}
+
+std::unique_ptr<opt::IRContext> DonorModuleCache::Donor::Clone() const {
+  return ir_context_->Clone();
+}
+
+DonorModuleCache::DonorModuleCache(
+    const std::vector<fuzzerutil::ModuleSupplier>& donor_suppliers,
+    spv_validator_options validator_options)
+    : validator_options_(validator_options) {
+  for (const auto& donor_supplier : donor_suppliers) {
+    entries_.push_back(MakeUnique<Entry>());
+    entries_.back()->supplier = donor_supplier;
+  }
+}
+
+DonorModuleCache::~DonorModuleCache() = default;
+
+const DonorModuleCache::Donor* DonorModuleCache::GetDonor(size_t index) {
+  auto* entry = entries_.at(index).get();
+  std::call_once(entry->once, [this, entry]() { Populate(entry); });
+  return entry->donor.get();
+}
+
+void DonorModuleCache::Populate(Entry* entry) const {
+  auto ir_context = entry->supplier();
+  if (!ir_context || !fuzzerutil::IsValid(ir_context.get(), validator_options_,
+                                          fuzzerutil::kSilentMessageConsumer)) {
+    return;
+  }
+  auto donor = MakeUnique<Donor>();
+  donor->summary_ = DonorModuleSummary::Summarize(ir_context.get());
+  donor->ir_context_ = std::move(ir_context);
+  entry->donor = std::move(donor);
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
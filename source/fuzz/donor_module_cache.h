@@ -0,0 +1,138 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_DONOR_MODULE_CACHE_H_
+#define SOURCE_FUZZ_DONOR_MODULE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source/fuzz/fuzzer_util.h"
+#include "source/opt/ir_context.h"
+#include "spirv-tools/libspirv.hpp"
+
+namespace spvtools {
+namespace fuzz {
+
+// The facts about a donor module that module donation needs, and that only
+// depend on the donor: its capabilities, and the dependencies between its
+// types, values and functions.  They are computed once per donor, so that each
+// donation does not walk the donor again, or build analyses on its copy.
+struct DonorModuleSummary {
+  // Computes the summary of |donor_ir_context|, which must be recursion-free.
+  static DonorModuleSummary Summarize(opt::IRContext* donor_ir_context);
+
+  // The capabilities declared by the donor; a recipient must support all of
+  // them for the donor to be donated.
+  std::vector<SpvCapability> capabilities;
+
+  // The ids of the donor's functions, topologically sorted according to the
+  // donor's call graph.
+  std::vector<uint32_t> functions_in_topological_order;
+
+  // The position of each of the donor's functions in its module, by function
+  // id, so that donation finds a function without searching the module.
+  std::unordered_map<uint32_t, uint32_t> function_positions;
+
+  // The ids of the donor's types and global values that can never be donated:
+  // image, sampled image and sampler types, and every type or value that
+  // depends on one of them, directly or indirectly.
+  std::unordered_set<uint32_t> undonatable_type_and_value_ids;
+
+  // The ids defined by instructions in the donor's basic blocks.  Any other id
+  // that a function uses is that of a function, a function parameter or a
+  // global value, and the use can only be donated if the definition was.
+  std::unordered_set<uint32_t> ids_defined_in_blocks;
+};
+
+// Provides donor modules to module donation, obtaining, validating and
+// summarizing each donor at most once.
+//
+// Donors are obtained lazily from their suppliers, the first time they are
+// requested.  Every request then hands out a fresh copy of the donor, made
+// with opt::IRContext::Clone rather than by re-parsing the donor binary, so
+// that donation is free to build analyses on, or otherwise modify, the copy.
+// A donor whose supplier fails, or that is invalid, is never handed out.
+//
+// All methods are thread-safe, so a cache can be shared by fuzzers running
+// concurrently.
+class DonorModuleCache {
+ public:
+  // A donor module that was obtained from its supplier and found to be valid.
+  class Donor {
+   public:
+    // Returns a fresh copy of the donor module.
+    std::unique_ptr<opt::IRContext> Clone() const;
+
+    const DonorModuleSummary& GetSummary() const { return summary_; }
+
+   private:
+    friend class DonorModuleCache;
+
+    // The donor module as supplied; it is never modified, and no analyses are
+    // built on it after the summary has been computed, so that it can be
+    // cloned concurrently.
+    std::unique_ptr<opt::IRContext> ir_context_;
+
+    DonorModuleSummary summary_;
+  };
+
+  // Creates a cache of the modules supplied by |donor_suppliers|, which are
+  // validated according to |validator_options|.
+  DonorModuleCache(
+      const std::vector<fuzzerutil::ModuleSupplier>& donor_suppliers,
+      spv_validator_options validator_options);
+
+  // Disables copy/move constructor/assignment operations.
+  DonorModuleCache(const DonorModuleCache&) = delete;
+  DonorModuleCache(DonorModuleCache&&) = delete;
+  DonorModuleCache& operator=(const DonorModuleCache&) = delete;
+  DonorModuleCache& operator=(DonorModuleCache&&) = delete;
+
+  ~DonorModuleCache();
+
+  // Returns the number of donors, whether or not they have been obtained yet.
+  // Named so that a cache can be passed to FuzzerContext::RandomIndex.
+  size_t size() const { return entries_.size(); }
+
+  // Returns donor |index|, obtaining it from its supplier if this is the
+  // first time it has been requested.  Returns nullptr if the supplier failed
+  // to provide a module, or if the module is invalid.  The result remains
+  // owned by the cache.
+  const Donor* GetDonor(size_t index);
+
+ private:
+  struct Entry {
+    fuzzerutil::ModuleSupplier supplier;
+    std::once_flag once;
+    std::unique_ptr<Donor> donor;
+  };
+
+  // Obtains, validates and summarizes the donor of |entry|.
+  void Populate(Entry* entry) const;
+
+  const spv_validator_options validator_options_;
+
+  std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_DONOR_MODULE_CACHE_H_
@@ -34,11 +34,13 @@ namespace fuzz {
 // of type |T|.
 //
 // A disjoint-set (a.k.a. union-find or merge-find) data structure is used to
-// represent the equivalence relation.  Path compression is used.  Union by
-// rank/size is not used.
+// represent the equivalence relation.  Path compression and union by size are
+// both used, so that a sequence of operations takes almost-linear time
+// overall, however the values are made equivalent.
 //
 // Each disjoint set is represented as a tree, rooted at the representative
-// of the set.
+// of the set.  Merging two sets makes the representative of the smaller set a
+// child of the representative of the larger one.
 //
 // Getting the representative of a value simply requires chasing parent pointers
 // from the value until you reach the root.
@@ -47,7 +49,9 @@ namespace fuzz {
 // representatives are equal.
 //
 // Traversing the tree rooted at a value's representative visits the value's
-// equivalence class.
+// equivalence class.  Path compression only shortens parent pointers; the
+// children used for this traversal are those recorded when sets are merged,
+// so that compressing a path never has to search a list of children.
 //
 // |PointerHashT| and |PointerEqualsT| are used to define *equality* between
 // values, and otherwise are *not* used to define the equivalence relation
@@ -66,10 +70,40 @@ namespace fuzz {
 // Uniqueness is ensured by storing (and checking) a set of pointers to these
 // values in |value_set_|, which uses |PointerHashT| and |PointerEqualsT|.
 //
-// |parent_| and |children_| encode the equivalence relation, i.e., the trees.
+// |parent_| and |children_| encode the equivalence relation, i.e., the trees,
+// and |class_size_| records the size of each class, keyed by representative.
 template <typename T, typename PointerHashT, typename PointerEqualsT>
 class EquivalenceRelation {
  public:
+  EquivalenceRelation() = default;
+
+  // Constructs a deep copy of |other|.  The copy owns its own values, and the
+  // structure of its trees, including the order of children, is identical to
+  // that of |other|.
+  EquivalenceRelation(const EquivalenceRelation& other) {
+    std::unordered_map<const T*, const T*> copy_of;
+    for (auto& value : other.owned_values_) {
+      auto unique_pointer_to_copy = MakeUnique<T>(*value);
+      copy_of[value.get()] = unique_pointer_to_copy.get();
+      value_set_.insert(unique_pointer_to_copy.get());
+      owned_values_.push_back(std::move(unique_pointer_to_copy));
+    }
+    for (auto& entry : other.parent_) {
+      parent_[copy_of.at(entry.first)] = copy_of.at(entry.second);
+    }
+    for (auto& entry : other.children_) {
+      auto& children = children_[copy_of.at(entry.first)];
+      for (auto child : entry.second) {
+        children.push_back(copy_of.at(child));
+      }
+    }
+    for (auto& entry : other.class_size_) {
+      class_size_[copy_of.at(entry.first)] = entry.second;
+    }
+  }
+
+  EquivalenceRelation& operator=(const EquivalenceRelation&) = delete;
+
   // Requires that |value1| and |value2| are already registered in the
   // equivalence relation.  Merges the equivalence classes associated with
   // |value1| and |value2|.
@@ -90,15 +124,23 @@ class EquivalenceRelation {
     }
 
     // Find the representative for each value's equivalence class, and if they
-    // are not already in the same class, make one the parent of the other.
+    // are not already in the same class, make the representative of the
+    // smaller class a child of the representative of the larger class.  On a
+    // tie, the representative of |value2|'s class remains the representative.
     const T* representative1 = Find(value1_ptr);
     const T* representative2 = Find(value2_ptr);
     assert(representative1 && "Representatives should never be null.");
     assert(representative2 && "Representatives should never be null.");
-    if (representative1 != representative2) {
-      parent_[representative1] = representative2;
-      children_[representative2].push_back(representative1);
+    if (representative1 == representative2) {
+      return;
     }
+    if (class_size_.at(representative1) > class_size_.at(representative2)) {
+      std::swap(representative1, representative2);
+    }
+    parent_[representative1] = representative2;
+    children_[representative2].push_back(representative1);
+    class_size_[representative2] += class_size_.at(representative1);
+    class_size_.erase(representative1);
   }
 
   // Requires that |value| is not known to the equivalence relation. Registers
@@ -118,6 +160,7 @@ class EquivalenceRelation {
     assert(pointer_to_value && "Representatives should never be null.");
     parent_[pointer_to_value] = pointer_to_value;
     children_[pointer_to_value] = std::vector<const T*>();
+    class_size_[pointer_to_value] = 1;
 
     return pointer_to_value;
   }
@@ -149,13 +192,20 @@ class EquivalenceRelation {
       const T* item = stack.back();
       result.push_back(item);
       stack.pop_back();
-      for (auto child : children_[item]) {
+      for (auto child : children_.at(item)) {
         stack.push_back(child);
       }
     }
     return result;
   }
 
+  // Returns the number of values in the equivalence class of |value|, which
+  // must already be part of the equivalence relation.  Unlike computing the
+  // class itself, this takes (almost) constant time.
+  size_t GetEquivalenceClassSize(const T& value) const {
+    return class_size_.at(Find(&value));
+  }
+
   // Returns true if and only if |value1| and |value2| are in the same
   // equivalence class.  Both values must already be known to the equivalence
   // relation.
@@ -178,6 +228,13 @@ class EquivalenceRelation {
     return value_set_.find(&value) != value_set_.end();
   }
 
+  // Returns the pointer to the copy of |value| owned by the equivalence
+  // relation.  |value| must already be known to the equivalence relation.
+  const T* GetCanonicalPointer(const T& value) const {
+    assert(Exists(value));
+    return *value_set_.find(&value);
+  }
+
   // Returns the representative of the equivalence class of |value|, which must
   // already be known to the equivalence relation.  This is the 'Find' operation
   // in a classic union-find data structure.
@@ -199,18 +256,12 @@ class EquivalenceRelation {
     // At this point, |result| is the representative of the equivalence class.
     // Now perform the 'path compression' optimization by doing another pass up
     // the parent chain, setting the parent of each node to be the
-    // representative, and rewriting children correspondingly.
+    // representative.  |children_| is left alone: it still describes a tree
+    // rooted at |result| that covers the whole class.
     const T* current = known_value;
     while (parent_[current] != result) {
       const T* next = parent_[current];
       parent_[current] = result;
-      children_[result].push_back(current);
-      auto child_iterator =
-          std::find(children_[next].begin(), children_[next].end(), current);
-      assert(child_iterator != children_[next].end() &&
-             "'next' is the parent of 'current', so 'current' should be a "
-             "child of 'next'");
-      children_[next].erase(child_iterator);
       current = next;
     }
     return result;
@@ -225,13 +276,14 @@ class EquivalenceRelation {
   // compression.
   mutable std::unordered_map<const T*, const T*> parent_;
 
-  // Stores the children of each value.  This allows the equivalence class of
-  // a value to be calculated by traversing all descendents of the class's
-  // representative.
-  //
-  // Mutable because the intuitively const method, 'Find', performs path
-  // compression.
-  mutable std::unordered_map<const T*, std::vector<const T*>> children_;
+  // Stores the children each value acquired when classes were merged.  This
+  // allows the equivalence class of a value to be calculated by traversing all
+  // descendents of the class's representative.
+  std::unordered_map<const T*, std::vector<const T*>> children_;
+
+  // Maps the representative of each equivalence class to the number of values
+  // in the class.
+  std::unordered_map<const T*, size_t> class_size_;
 
   // The values known to the equivalence relation are allocated in
   // |owned_values_|, and |value_pool_| provides (via |PointerHashT| and
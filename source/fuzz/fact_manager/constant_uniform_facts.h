@@ -30,6 +30,11 @@ class ConstantUniformFacts {
  public:
   explicit ConstantUniformFacts(opt::IRContext* ir_context);
 
+  // Constructs a copy of |other| that holds facts about |ir_context|, which
+  // must contain a module identical to that of |other|.
+  ConstantUniformFacts(const ConstantUniformFacts& other,
+                       opt::IRContext* ir_context);
+
   // See method in FactManager which delegates to this method.
   bool MaybeAddFact(const protobufs::FactConstantUniform& fact);
 
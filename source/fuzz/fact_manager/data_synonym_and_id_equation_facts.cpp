@@ -51,10 +51,60 @@ bool DataSynonymAndIdEquationFacts::OperationEquals::operator()(
   return true;
 }
 
+size_t DataSynonymAndIdEquationFacts::DataDescriptorPairHash::operator()(
+    const DataDescriptorPair& pair) const {
+  return DataDescriptorHash()(&pair.first) ^
+         DataDescriptorHash()(&pair.second);
+}
+
+bool DataSynonymAndIdEquationFacts::DataDescriptorPairEquals::operator()(
+    const DataDescriptorPair& first, const DataDescriptorPair& second) const {
+  return (DataDescriptorEquals()(&first.first, &second.first) &&
+          DataDescriptorEquals()(&first.second, &second.second)) ||
+         (DataDescriptorEquals()(&first.first, &second.second) &&
+          DataDescriptorEquals()(&first.second, &second.first));
+}
+
 DataSynonymAndIdEquationFacts::DataSynonymAndIdEquationFacts(
     opt::IRContext* ir_context)
     : ir_context_(ir_context) {}
 
+DataSynonymAndIdEquationFacts::DataSynonymAndIdEquationFacts(
+    const DataSynonymAndIdEquationFacts& other, opt::IRContext* ir_context)
+    : synonymous_(other.synonymous_),
+      candidate_composite_synonyms_(other.candidate_composite_synonyms_),
+      ir_context_(ir_context) {
+  // The worklist and equations refer to data descriptors owned by
+  // |other.synonymous_|, so they must be redirected to the corresponding
+  // copies owned by |synonymous_|.
+  for (const auto* dd : other.closure_worklist_) {
+    closure_worklist_.push_back(synonymous_.GetCanonicalPointer(*dd));
+  }
+  for (const auto& entry : other.id_equations_) {
+    auto& equations =
+        id_equations_[synonymous_.GetCanonicalPointer(*entry.first)];
+    for (const auto& equation : entry.second) {
+      Operation operation = {equation.opcode, {}};
+      for (const auto* operand : equation.operands) {
+        operation.operands.push_back(
+            synonymous_.GetCanonicalPointer(*operand));
+      }
+      equations.insert(std::move(operation));
+    }
+  }
+  for (const auto& entry : other.conversion_lhs_by_operand_) {
+    auto& lhs_by_opcode =
+        conversion_lhs_by_operand_[synonymous_.GetCanonicalPointer(
+            *entry.first)];
+    for (const auto& opcode_and_lhs : entry.second) {
+      auto& lhs = lhs_by_opcode[opcode_and_lhs.first];
+      for (const auto* dd : opcode_and_lhs.second) {
+        lhs.push_back(synonymous_.GetCanonicalPointer(*dd));
+      }
+    }
+  }
+}
+
 bool DataSynonymAndIdEquationFacts::MaybeAddFact(
     const protobufs::FactDataSynonym& fact,
     const DeadBlockFacts& dead_block_facts,
@@ -152,6 +202,11 @@ void DataSynonymAndIdEquationFacts::AddEquationFactRecursive(
     existing_equations->second.insert(new_operation);
   }
 
+  if (opcode == SpvOpConvertSToF || opcode == SpvOpConvertUToF) {
+    conversion_lhs_by_operand_[synonymous_.Find(rhs_dds[0])][opcode].push_back(
+        lhs_dd_representative);
+  }
+
   // Now try to work out corollaries implied by the new equation and existing
   // facts.
   switch (opcode) {
@@ -304,44 +359,41 @@ void DataSynonymAndIdEquationFacts::ComputeConversionDataSynonymFacts(
     // If there exist equation facts of the form |%a = opcode %representative|
     // and |%b = opcode %representative| where |opcode| is either OpConvertSToF
     // or OpConvertUToF, then |a| and |b| are synonymous.
-    std::vector<const protobufs::DataDescriptor*> convert_s_to_f_lhs;
-    std::vector<const protobufs::DataDescriptor*> convert_u_to_f_lhs;
-
-    for (const auto& fact : id_equations_) {
-      auto equivalence_class = synonymous_.GetEquivalenceClass(*fact.first);
-      auto dd_it =
-          std::find_if(equivalence_class.begin(), equivalence_class.end(),
-                       [this](const protobufs::DataDescriptor* a) {
-                         return ObjectStillExists(*a);
-                       });
-      if (dd_it == equivalence_class.end()) {
-        // Skip |equivalence_class| if it has no valid ids.
-        continue;
-      }
+    auto conversions = conversion_lhs_by_operand_.find(synonymous_.Find(&dd));
+    if (conversions == conversion_lhs_by_operand_.end()) {
+      return;
+    }
 
-      for (const auto& equation : fact.second) {
-        if (synonymous_.IsEquivalent(*equation.operands[0], dd)) {
-          if (equation.opcode == SpvOpConvertSToF) {
-            convert_s_to_f_lhs.push_back(*dd_it);
-          } else if (equation.opcode == SpvOpConvertUToF) {
-            convert_u_to_f_lhs.push_back(*dd_it);
-          }
+    // For each opcode, gather a data descriptor whose object still exists
+    // from the equivalence class of each left-hand-side.  The index is copied
+    // because adding synonyms below may merge entries of the index.
+    std::vector<std::vector<const protobufs::DataDescriptor*>> synonyms;
+    for (const auto& opcode_and_lhs : std::map<
+             SpvOp, std::vector<const protobufs::DataDescriptor*>>(
+             conversions->second)) {
+      synonyms.emplace_back();
+      for (const auto* lhs : opcode_and_lhs.second) {
+        auto equivalence_class = synonymous_.GetEquivalenceClass(*lhs);
+        auto dd_it =
+            std::find_if(equivalence_class.begin(), equivalence_class.end(),
+                         [this](const protobufs::DataDescriptor* a) {
+                           return ObjectStillExists(*a);
+                         });
+        if (dd_it != equivalence_class.end()) {
+          synonyms.back().push_back(*dd_it);
         }
       }
     }
 
-    // We use pointers in the initializer list here since otherwise we would
-    // copy memory from these vectors.
-    for (const auto* synonyms : {&convert_s_to_f_lhs, &convert_u_to_f_lhs}) {
-      for (const auto* synonym_a : *synonyms) {
-        for (const auto* synonym_b : *synonyms) {
-          // DataDescriptorsAreWellFormedAndComparable will be called in the
-          // AddDataSynonymFactRecursive method.
-          if (!synonymous_.IsEquivalent(*synonym_a, *synonym_b)) {
-            // |synonym_a| and |synonym_b| have compatible types - they are
-            // synonymous.
-            AddDataSynonymFactRecursive(*synonym_a, *synonym_b);
-          }
+    // It suffices to make every left-hand-side synonymous with the first.
+    for (const auto& lhs_synonyms : synonyms) {
+      for (const auto* synonym : lhs_synonyms) {
+        // DataDescriptorsAreWellFormedAndComparable will be called in the
+        // AddDataSynonymFactRecursive method.
+        if (!synonymous_.IsEquivalent(*lhs_synonyms[0], *synonym)) {
+          // |lhs_synonyms[0]| and |synonym| have compatible types - they are
+          // synonymous.
+          AddDataSynonymFactRecursive(*lhs_synonyms[0], *synonym);
         }
       }
     }
@@ -421,7 +473,8 @@ void DataSynonymAndIdEquationFacts::ComputeCompositeDataSynonymFacts(
 }
 
 void DataSynonymAndIdEquationFacts::ComputeClosureOfFacts(
-    uint32_t maximum_equivalence_class_size) {
+    uint32_t maximum_equivalence_class_size,
+    uint32_t maximum_pairs_to_consider) {
   // Suppose that obj_1[a_1, ..., a_m] and obj_2[b_1, ..., b_n] are distinct
   // data descriptors that describe objects of the same composite type, and that
   // the composite type is comprised of k components.
@@ -446,266 +499,262 @@ void DataSynonymAndIdEquationFacts::ComputeClosureOfFacts(
   // then we can conclude that:
   //   m[2] == v.
   //
-  // This method repeatedly searches the equivalence relation of data
-  // descriptors, deducing and adding such facts, until a pass over the
-  // relation leads to no further facts being deduced.
+  // Deducing such a fact requires every pair of synonymous components to have
+  // been observed, which is tracked by |candidate_composite_synonyms_|.  An
+  // equivalence class only needs to be searched for such pairs if it has
+  // changed since it was last searched, so this method works through the
+  // classes in |closure_worklist_|.  Since deducing a fact merges classes,
+  // which adds them to the worklist, this continues until no class is left
+  // to search, at which point the closure has been computed.
+  //
+  // If |maximum_pairs_to_consider| is non-zero, no further classes are
+  // searched once that many pairs of data descriptors have been considered;
+  // the remaining classes stay in the worklist for the next computation.  A
+  // class whose search has started is always finished, so the bound may be
+  // exceeded by the number of pairs in a single class.
+  uint32_t pairs_considered = 0;
+  while (!closure_worklist_.empty()) {
+    // Take the current worklist, keeping the first occurrence of each class
+    // that it mentions.  Classes that change while this batch is searched are
+    // added to a fresh worklist.
+    std::vector<const protobufs::DataDescriptor*> batch;
+    {
+      std::unordered_set<const protobufs::DataDescriptor*> in_batch;
+      for (const auto* dd : closure_worklist_) {
+        const auto* representative = synonymous_.Find(dd);
+        if (in_batch.insert(representative).second) {
+          batch.push_back(representative);
+        }
+      }
+      closure_worklist_.clear();
+    }
 
-  // The method relies on working with pairs of data descriptors, and in
-  // particular being able to hash and compare such pairs.
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+      if (maximum_pairs_to_consider != 0 &&
+          pairs_considered >= maximum_pairs_to_consider) {
+        // The budget is exhausted; the classes that have not been searched
+        // are searched by a later computation, ahead of any classes that have
+        // changed since this batch was taken.
+        closure_worklist_.insert(closure_worklist_.begin(), it, batch.end());
+        return;
+      }
 
-  using DataDescriptorPair =
-      std::pair<protobufs::DataDescriptor, protobufs::DataDescriptor>;
+      const auto* representative = *it;
+      if (synonymous_.Find(representative) != representative) {
+        // The class has been merged with another class while this batch was
+        // searched, so the merged class is in the worklist already.
+        continue;
+      }
 
-  struct DataDescriptorPairHash {
-    std::size_t operator()(const DataDescriptorPair& pair) const {
-      return DataDescriptorHash()(&pair.first) ^
-             DataDescriptorHash()(&pair.second);
+      if (synonymous_.GetEquivalenceClassSize(*representative) >
+          maximum_equivalence_class_size) {
+        // This equivalence class is larger than the maximum size we are willing
+        // to consider, so we skip it.  This potentially leads to missed fact
+        // deductions, but avoids excessive runtime for closure computation.
+        continue;
+      }
+
+      pairs_considered += ComputeClosureOfClass(representative);
     }
-  };
+  }
+}
 
-  struct DataDescriptorPairEquals {
-    bool operator()(const DataDescriptorPair& first,
-                    const DataDescriptorPair& second) const {
-      return (DataDescriptorEquals()(&first.first, &second.first) &&
-              DataDescriptorEquals()(&first.second, &second.second)) ||
-             (DataDescriptorEquals()(&first.first, &second.second) &&
-              DataDescriptorEquals()(&first.second, &second.first));
+uint32_t DataSynonymAndIdEquationFacts::ComputeClosureOfClass(
+    const protobufs::DataDescriptor* representative) {
+  auto equivalence_class = synonymous_.GetEquivalenceClass(*representative);
+  uint32_t pairs_considered = 0;
+
+  // Consider every data descriptor in the equivalence class.
+  for (auto dd1_it = equivalence_class.begin();
+       dd1_it != equivalence_class.end(); ++dd1_it) {
+    // If this data descriptor has no indices then it does not have the form
+    // obj_1[a_1, ..., a_m, i], so move on.
+    auto dd1 = *dd1_it;
+    if (dd1->index_size() == 0) {
+      continue;
     }
-  };
 
-  // This map records, for a given pair of composite data descriptors of the
-  // same type, all the indices at which the data descriptors are known to be
-  // synonymous.  A pair is a key to this map only if we have observed that
-  // the pair are synonymous at *some* index, but not at *all* indices.
-  // Once we find that a pair of data descriptors are equivalent at all indices
-  // we record the fact that they are synonymous and remove them from the map.
-  //
-  // Using the m and v example from above, initially the pair (m[2], v) would
-  // not be a key to the map.  If we find that m[2, 2] == v[2] holds, we would
-  // add an entry:
-  //   (m[2], v) -> [false, false, true, false]
-  // to record that they are synonymous at index 2.  If we then find that
-  // m[2, 0] == v[0] holds, we would update this entry to:
-  //   (m[2], v) -> [true, false, true, false]
-  // If we then find that m[2, 3] == v[3] holds, we would update this entry to:
-  //   (m[2], v) -> [true, false, true, true]
-  // Finally, if we then find that m[2, 1] == v[1] holds, which would make the
-  // boolean vector true at every index, we would add the fact:
-  //   m[2] == v
-  // to the equivalence relation and remove (m[2], v) from the map.
-  std::unordered_map<DataDescriptorPair, std::vector<bool>,
-                     DataDescriptorPairHash, DataDescriptorPairEquals>
-      candidate_composite_synonyms;
-
-  // We keep looking for new facts until we perform a complete pass over the
-  // equivalence relation without finding any new facts.
-  while (closure_computation_required_) {
-    // We have not found any new facts yet during this pass; we set this to
-    // 'true' if we do find a new fact.
-    closure_computation_required_ = false;
-
-    // Consider each class in the equivalence relation.
-    for (auto representative :
-         synonymous_.GetEquivalenceClassRepresentatives()) {
-      auto equivalence_class = synonymous_.GetEquivalenceClass(*representative);
-
-      if (equivalence_class.size() > maximum_equivalence_class_size) {
-        // This equivalence class is larger than the maximum size we are willing
-        // to consider, so we skip it.  This potentially leads to missed fact
-        // deductions, but avoids excessive runtime for closure computation.
+    // Consider every other data descriptor later in the equivalence class
+    // (due to symmetry, there is no need to compare with previous data
+    // descriptors).
+    auto dd2_it = dd1_it;
+    for (++dd2_it; dd2_it != equivalence_class.end(); ++dd2_it) {
+      pairs_considered++;
+      auto dd2 = *dd2_it;
+      // If this data descriptor has no indices then it does not have the
+      // form obj_2[b_1, ..., b_n, i], so move on.
+      if (dd2->index_size() == 0) {
         continue;
       }
 
-      // Consider every data descriptor in the equivalence class.
-      for (auto dd1_it = equivalence_class.begin();
-           dd1_it != equivalence_class.end(); ++dd1_it) {
-        // If this data descriptor has no indices then it does not have the form
-        // obj_1[a_1, ..., a_m, i], so move on.
-        auto dd1 = *dd1_it;
-        if (dd1->index_size() == 0) {
-          continue;
-        }
+      // At this point we know that:
+      // - |dd1| has the form obj_1[a_1, ..., a_m, i]
+      // - |dd2| has the form obj_2[b_1, ..., b_n, j]
+      assert(dd1->index_size() > 0 && dd2->index_size() > 0 &&
+             "Control should not reach here if either data descriptor has "
+             "no indices.");
 
-        // Consider every other data descriptor later in the equivalence class
-        // (due to symmetry, there is no need to compare with previous data
-        // descriptors).
-        auto dd2_it = dd1_it;
-        for (++dd2_it; dd2_it != equivalence_class.end(); ++dd2_it) {
-          auto dd2 = *dd2_it;
-          // If this data descriptor has no indices then it does not have the
-          // form obj_2[b_1, ..., b_n, i], so move on.
-          if (dd2->index_size() == 0) {
-            continue;
-          }
+      // We are only interested if i == j.
+      if (dd1->index(dd1->index_size() - 1) !=
+          dd2->index(dd2->index_size() - 1)) {
+        continue;
+      }
 
-          // At this point we know that:
-          // - |dd1| has the form obj_1[a_1, ..., a_m, i]
-          // - |dd2| has the form obj_2[b_1, ..., b_n, j]
-          assert(dd1->index_size() > 0 && dd2->index_size() > 0 &&
-                 "Control should not reach here if either data descriptor has "
-                 "no indices.");
-
-          // We are only interested if i == j.
-          if (dd1->index(dd1->index_size() - 1) !=
-              dd2->index(dd2->index_size() - 1)) {
-            continue;
-          }
+      const uint32_t common_final_index = dd1->index(dd1->index_size() - 1);
+
+      // Make data descriptors |dd1_prefix| and |dd2_prefix| for
+      //   obj_1[a_1, ..., a_m]
+      // and
+      //   obj_2[b_1, ..., b_n]
+      // These are the two data descriptors we might be getting closer to
+      // deducing as being synonymous, due to knowing that they are
+      // synonymous when extended by a particular index.
+      protobufs::DataDescriptor dd1_prefix;
+      dd1_prefix.set_object(dd1->object());
+      for (uint32_t i = 0; i < static_cast<uint32_t>(dd1->index_size() - 1);
+           i++) {
+        dd1_prefix.add_index(dd1->index(i));
+      }
+      protobufs::DataDescriptor dd2_prefix;
+      dd2_prefix.set_object(dd2->object());
+      for (uint32_t i = 0; i < static_cast<uint32_t>(dd2->index_size() - 1);
+           i++) {
+        dd2_prefix.add_index(dd2->index(i));
+      }
+      assert(!DataDescriptorEquals()(&dd1_prefix, &dd2_prefix) &&
+             "By construction these prefixes should be different.");
 
-          const uint32_t common_final_index = dd1->index(dd1->index_size() - 1);
-
-          // Make data descriptors |dd1_prefix| and |dd2_prefix| for
-          //   obj_1[a_1, ..., a_m]
-          // and
-          //   obj_2[b_1, ..., b_n]
-          // These are the two data descriptors we might be getting closer to
-          // deducing as being synonymous, due to knowing that they are
-          // synonymous when extended by a particular index.
-          protobufs::DataDescriptor dd1_prefix;
-          dd1_prefix.set_object(dd1->object());
-          for (uint32_t i = 0; i < static_cast<uint32_t>(dd1->index_size() - 1);
-               i++) {
-            dd1_prefix.add_index(dd1->index(i));
-          }
-          protobufs::DataDescriptor dd2_prefix;
-          dd2_prefix.set_object(dd2->object());
-          for (uint32_t i = 0; i < static_cast<uint32_t>(dd2->index_size() - 1);
-               i++) {
-            dd2_prefix.add_index(dd2->index(i));
-          }
-          assert(!DataDescriptorEquals()(&dd1_prefix, &dd2_prefix) &&
-                 "By construction these prefixes should be different.");
-
-          // If we already know that these prefixes are synonymous, move on.
-          if (synonymous_.Exists(dd1_prefix) &&
-              synonymous_.Exists(dd2_prefix) &&
-              synonymous_.IsEquivalent(dd1_prefix, dd2_prefix)) {
-            continue;
-          }
-          if (!ObjectStillExists(*dd1) || !ObjectStillExists(*dd2)) {
-            // The objects are not both available in the module, so we cannot
-            // investigate the types of the associated data descriptors; we need
-            // to move on.
-            continue;
-          }
-          // Get the type of obj_1
-          auto dd1_root_type_id =
-              fuzzerutil::GetTypeId(ir_context_, dd1->object());
-          // Use this type, together with a_1, ..., a_m, to get the type of
-          // obj_1[a_1, ..., a_m].
-          auto dd1_prefix_type = fuzzerutil::WalkCompositeTypeIndices(
-              ir_context_, dd1_root_type_id, dd1_prefix.index());
-
-          // Similarly, get the type of obj_2 and use it to get the type of
-          // obj_2[b_1, ..., b_n].
-          auto dd2_root_type_id =
-              fuzzerutil::GetTypeId(ir_context_, dd2->object());
-          auto dd2_prefix_type = fuzzerutil::WalkCompositeTypeIndices(
-              ir_context_, dd2_root_type_id, dd2_prefix.index());
-
-          // If the types of dd1_prefix and dd2_prefix are not the same, they
-          // cannot be synonymous.
-          if (dd1_prefix_type != dd2_prefix_type) {
-            continue;
-          }
+      // If we already know that these prefixes are synonymous, move on.
+      if (synonymous_.Exists(dd1_prefix) &&
+          synonymous_.Exists(dd2_prefix) &&
+          synonymous_.IsEquivalent(dd1_prefix, dd2_prefix)) {
+        continue;
+      }
+      if (!ObjectStillExists(*dd1) || !ObjectStillExists(*dd2)) {
+        // The objects are not both available in the module, so we cannot
+        // investigate the types of the associated data descriptors; we need
+        // to move on.
+        continue;
+      }
+      // Get the type of obj_1
+      auto dd1_root_type_id =
+          fuzzerutil::GetTypeId(ir_context_, dd1->object());
+      // Use this type, together with a_1, ..., a_m, to get the type of
+      // obj_1[a_1, ..., a_m].
+      auto dd1_prefix_type = fuzzerutil::WalkCompositeTypeIndices(
+          ir_context_, dd1_root_type_id, dd1_prefix.index());
+
+      // Similarly, get the type of obj_2 and use it to get the type of
+      // obj_2[b_1, ..., b_n].
+      auto dd2_root_type_id =
+          fuzzerutil::GetTypeId(ir_context_, dd2->object());
+      auto dd2_prefix_type = fuzzerutil::WalkCompositeTypeIndices(
+          ir_context_, dd2_root_type_id, dd2_prefix.index());
+
+      // If the types of dd1_prefix and dd2_prefix are not the same, they
+      // cannot be synonymous.
+      if (dd1_prefix_type != dd2_prefix_type) {
+        continue;
+      }
 
-          // At this point, we know we have synonymous data descriptors of the
-          // form:
-          //   obj_1[a_1, ..., a_m, i]
-          //   obj_2[b_1, ..., b_n, i]
-          // with the same last_index i, such that:
-          //   obj_1[a_1, ..., a_m]
-          // and
-          //   obj_2[b_1, ..., b_n]
-          // have the same type.
-
-          // Work out how many components there are in the (common) commposite
-          // type associated with obj_1[a_1, ..., a_m] and obj_2[b_1, ..., b_n].
-          // This depends on whether the composite type is array, matrix, struct
-          // or vector.
-          uint32_t num_components_in_composite;
-          auto composite_type =
-              ir_context_->get_type_mgr()->GetType(dd1_prefix_type);
-          auto composite_type_instruction =
-              ir_context_->get_def_use_mgr()->GetDef(dd1_prefix_type);
-          if (composite_type->AsArray()) {
-            num_components_in_composite = fuzzerutil::GetArraySize(
-                *composite_type_instruction, ir_context_);
-            if (num_components_in_composite == 0) {
-              // This indicates that the array has an unknown size, in which
-              // case we cannot be sure we have matched all of its elements with
-              // synonymous elements of another array.
-              continue;
-            }
-          } else if (composite_type->AsMatrix()) {
-            num_components_in_composite =
-                composite_type->AsMatrix()->element_count();
-          } else if (composite_type->AsStruct()) {
-            num_components_in_composite = fuzzerutil::GetNumberOfStructMembers(
-                *composite_type_instruction);
-          } else {
-            assert(composite_type->AsVector());
-            num_components_in_composite =
-                composite_type->AsVector()->element_count();
-          }
+      // At this point, we know we have synonymous data descriptors of the
+      // form:
+      //   obj_1[a_1, ..., a_m, i]
+      //   obj_2[b_1, ..., b_n, i]
+      // with the same last_index i, such that:
+      //   obj_1[a_1, ..., a_m]
+      // and
+      //   obj_2[b_1, ..., b_n]
+      // have the same type.
+
+      // Work out how many components there are in the (common) commposite
+      // type associated with obj_1[a_1, ..., a_m] and obj_2[b_1, ..., b_n].
+      // This depends on whether the composite type is array, matrix, struct
+      // or vector.
+      uint32_t num_components_in_composite;
+      auto composite_type =
+          ir_context_->get_type_mgr()->GetType(dd1_prefix_type);
+      auto composite_type_instruction =
+          ir_context_->get_def_use_mgr()->GetDef(dd1_prefix_type);
+      if (composite_type->AsArray()) {
+        num_components_in_composite = fuzzerutil::GetArraySize(
+            *composite_type_instruction, ir_context_);
+        if (num_components_in_composite == 0) {
+          // This indicates that the array has an unknown size, in which
+          // case we cannot be sure we have matched all of its elements with
+          // synonymous elements of another array.
+          continue;
+        }
+      } else if (composite_type->AsMatrix()) {
+        num_components_in_composite =
+            composite_type->AsMatrix()->element_count();
+      } else if (composite_type->AsStruct()) {
+        num_components_in_composite = fuzzerutil::GetNumberOfStructMembers(
+            *composite_type_instruction);
+      } else {
+        assert(composite_type->AsVector());
+        num_components_in_composite =
+            composite_type->AsVector()->element_count();
+      }
 
-          // We are one step closer to being able to say that |dd1_prefix| and
-          // |dd2_prefix| are synonymous.
-          DataDescriptorPair candidate_composite_synonym(dd1_prefix,
-                                                         dd2_prefix);
-
-          // We look up what we already know about this pair.
-          auto existing_entry =
-              candidate_composite_synonyms.find(candidate_composite_synonym);
-
-          if (existing_entry == candidate_composite_synonyms.end()) {
-            // If this is the first time we have seen the pair, we make a vector
-            // of size |num_components_in_composite| that is 'true' at the
-            // common final index associated with |dd1| and |dd2|, and 'false'
-            // everywhere else, and register this vector as being associated
-            // with the pair.
-            std::vector<bool> entry;
-            for (uint32_t i = 0; i < num_components_in_composite; i++) {
-              entry.push_back(i == common_final_index);
-            }
-            candidate_composite_synonyms[candidate_composite_synonym] = entry;
-            existing_entry =
-                candidate_composite_synonyms.find(candidate_composite_synonym);
-          } else {
-            // We have seen this pair of data descriptors before, and we now
-            // know that they are synonymous at one further index, so we
-            // update the entry to record that.
-            existing_entry->second[common_final_index] = true;
-          }
-          assert(existing_entry != candidate_composite_synonyms.end());
-
-          // Check whether |dd1_prefix| and |dd2_prefix| are now known to match
-          // at every sub-component.
-          bool all_components_match = true;
-          for (uint32_t i = 0; i < num_components_in_composite; i++) {
-            if (!existing_entry->second[i]) {
-              all_components_match = false;
-              break;
-            }
-          }
-          if (all_components_match) {
-            // The two prefixes match on all sub-components, so we know that
-            // they are synonymous.  We add this fact *non-recursively*, as we
-            // have deduced that |dd1_prefix| and |dd2_prefix| are synonymous
-            // by observing that all their sub-components are already
-            // synonymous.
-            assert(DataDescriptorsAreWellFormedAndComparable(dd1_prefix,
-                                                             dd2_prefix));
-            MakeEquivalent(dd1_prefix, dd2_prefix);
-            // Now that we know this pair of data descriptors are synonymous,
-            // there is no point recording how close they are to being
-            // synonymous.
-            candidate_composite_synonyms.erase(candidate_composite_synonym);
-          }
+      // We are one step closer to being able to say that |dd1_prefix| and
+      // |dd2_prefix| are synonymous.
+      DataDescriptorPair candidate_composite_synonym(dd1_prefix,
+                                                     dd2_prefix);
+
+      // We look up what we already know about this pair.
+      auto existing_entry =
+          candidate_composite_synonyms_.find(candidate_composite_synonym);
+
+      if (existing_entry == candidate_composite_synonyms_.end()) {
+        // If this is the first time we have seen the pair, we make a vector
+        // of size |num_components_in_composite| that is 'true' at the
+        // common final index associated with |dd1| and |dd2|, and 'false'
+        // everywhere else, and register this vector as being associated
+        // with the pair.
+        std::vector<bool> entry;
+        for (uint32_t i = 0; i < num_components_in_composite; i++) {
+          entry.push_back(i == common_final_index);
         }
+        candidate_composite_synonyms_[candidate_composite_synonym] = entry;
+        existing_entry =
+            candidate_composite_synonyms_.find(candidate_composite_synonym);
+      } else {
+        // We have seen this pair of data descriptors before, and we now
+        // know that they are synonymous at one further index, so we
+        // update the entry to record that.
+        existing_entry->second[common_final_index] = true;
+      }
+      assert(existing_entry != candidate_composite_synonyms_.end());
+
+      // Check whether |dd1_prefix| and |dd2_prefix| are now known to match
+      // at every sub-component.
+      bool all_components_match = true;
+      for (uint32_t i = 0; i < num_components_in_composite; i++) {
+        if (!existing_entry->second[i]) {
+          all_components_match = false;
+          break;
+        }
+      }
+      if (all_components_match) {
+        // The two prefixes match on all sub-components, so we know that
+        // they are synonymous.  We add this fact *non-recursively*, as we
+        // have deduced that |dd1_prefix| and |dd2_prefix| are synonymous
+        // by observing that all their sub-components are already
+        // synonymous.
+        assert(DataDescriptorsAreWellFormedAndComparable(dd1_prefix,
+                                                         dd2_prefix));
+        MakeEquivalent(dd1_prefix, dd2_prefix);
+        // Now that we know this pair of data descriptors are synonymous,
+        // there is no point recording how close they are to being
+        // synonymous.
+        candidate_composite_synonyms_.erase(candidate_composite_synonym);
       }
     }
   }
 }
+  return pairs_considered;
+}
 
 void DataSynonymAndIdEquationFacts::MakeEquivalent(
     const protobufs::DataDescriptor& dd1,
@@ -731,10 +780,6 @@ void DataSynonymAndIdEquationFacts::MakeEquivalent(
 
   // Make the data descriptors equivalent.
   synonymous_.MakeEquivalent(dd1, dd2);
-  // As we have updated the equivalence relation, we might be able to deduce
-  // more facts by performing a closure computation, so we record that such a
-  // computation is required.
-  closure_computation_required_ = true;
 
   // At this point, exactly one of |dd1_original_representative| and
   // |dd2_original_representative| will be the representative of the combined
@@ -753,6 +798,29 @@ void DataSynonymAndIdEquationFacts::MakeEquivalent(
   assert(no_longer_representative != still_representative &&
          "The current and former representatives cannot be the same.");
 
+  // As we have updated the equivalence relation, we might be able to deduce
+  // more facts by searching the merged class during a closure computation, so
+  // we record that the class must be searched.
+  closure_worklist_.push_back(still_representative);
+
+  // The conversions whose operands belong to the class of
+  // |no_longer_representative| now belong to the merged class.
+  auto no_longer_representative_conversions =
+      conversion_lhs_by_operand_.find(no_longer_representative);
+  if (no_longer_representative_conversions !=
+      conversion_lhs_by_operand_.end()) {
+    auto conversions =
+        std::move(no_longer_representative_conversions->second);
+    conversion_lhs_by_operand_.erase(no_longer_representative_conversions);
+    auto& still_representative_conversions =
+        conversion_lhs_by_operand_[still_representative];
+    for (const auto& opcode_and_lhs : conversions) {
+      auto& lhs = still_representative_conversions[opcode_and_lhs.first];
+      lhs.insert(lhs.end(), opcode_and_lhs.second.begin(),
+                 opcode_and_lhs.second.end());
+    }
+  }
+
   // We now need to add all equations about |no_longer_representative| to the
   // set of equations known about |still_representative|.
 
@@ -15,7 +15,10 @@
 #ifndef SOURCE_FUZZ_FACT_MANAGER_DATA_SYNONYM_AND_ID_EQUATION_FACTS_H_
 #define SOURCE_FUZZ_FACT_MANAGER_DATA_SYNONYM_AND_ID_EQUATION_FACTS_H_
 
+#include <map>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "source/fuzz/data_descriptor.h"
@@ -38,6 +41,11 @@ class DataSynonymAndIdEquationFacts {
  public:
   explicit DataSynonymAndIdEquationFacts(opt::IRContext* ir_context);
 
+  // Constructs a copy of |other| that holds facts about |ir_context|, which
+  // must contain a module identical to that of |other|.
+  DataSynonymAndIdEquationFacts(const DataSynonymAndIdEquationFacts& other,
+                                opt::IRContext* ir_context);
+
   // See method in FactManager which delegates to this method. Returns true if
   // neither |fact.data1()| nor |fact.data2()| contain an
   // irrelevant id. Otherwise, returns false. |dead_block_facts| and
@@ -73,7 +81,8 @@ class DataSynonymAndIdEquationFacts {
                     const protobufs::DataDescriptor& data_descriptor2) const;
 
   // See method in FactManager which delegates to this method.
-  void ComputeClosureOfFacts(uint32_t maximum_equivalence_class_size);
+  void ComputeClosureOfFacts(uint32_t maximum_equivalence_class_size,
+                             uint32_t maximum_pairs_to_consider);
 
  private:
   // This helper struct represents the right hand side of an equation as an
@@ -96,6 +105,31 @@ class DataSynonymAndIdEquationFacts {
   using OperationSet =
       std::unordered_set<Operation, OperationHash, OperationEquals>;
 
+  // An unordered pair of data descriptors, used during closure computation to
+  // record how close two composites are to being known to be synonymous.
+  using DataDescriptorPair =
+      std::pair<protobufs::DataDescriptor, protobufs::DataDescriptor>;
+
+  // Hashing for data descriptor pairs; symmetric, as pairs are unordered.
+  struct DataDescriptorPairHash {
+    size_t operator()(const DataDescriptorPair& pair) const;
+  };
+
+  // Equality for data descriptor pairs, which are unordered.
+  struct DataDescriptorPairEquals {
+    bool operator()(const DataDescriptorPair& first,
+                    const DataDescriptorPair& second) const;
+  };
+
+  // Considers every pair of data descriptors in the equivalence class whose
+  // representative is |representative|, recording in
+  // |candidate_composite_synonyms_| the components at which composites are
+  // thereby known to be synonymous, and adding a synonym between any two
+  // composites that are known to be synonymous at all components.  Returns the
+  // number of pairs considered.
+  uint32_t ComputeClosureOfClass(
+      const protobufs::DataDescriptor* representative);
+
   // Adds the synonym |dd1| = |dd2| to the set of managed facts, and recurses
   // into sub-components of the data descriptors, if they are composites, to
   // record that their components are pairwise-synonymous.
@@ -156,13 +190,23 @@ class DataSynonymAndIdEquationFacts {
                       DataDescriptorEquals>
       synonymous_;
 
-  // When a new synonym fact is added, it may be possible to deduce further
+  // When equivalence classes are merged, it may be possible to deduce further
   // synonym facts by computing a closure of all known facts.  However, this is
-  // an expensive operation, so it should be performed sparingly and only there
-  // is some chance of new facts being deduced.  This boolean tracks whether a
-  // closure computation is required - i.e., whether a new fact has been added
-  // since the last time such a computation was performed.
-  bool closure_computation_required_ = false;
+  // an expensive operation, so it is only performed for classes that have
+  // changed since they were last considered.  This records those classes, in
+  // the order in which they changed, each via a data descriptor that was the
+  // class representative at the time.  A class may be recorded more than once.
+  std::vector<const protobufs::DataDescriptor*> closure_worklist_;
+
+  // Records, for a pair of composite data descriptors of the same type that
+  // are known to be synonymous at *some* index but not yet at *all* indices,
+  // the indices at which they are known to be synonymous.  This persists
+  // between closure computations, so that a computation only needs to
+  // consider the classes in |closure_worklist_|.  See ComputeClosureOfFacts
+  // for an example.
+  std::unordered_map<DataDescriptorPair, std::vector<bool>,
+                     DataDescriptorPairHash, DataDescriptorPairEquals>
+      candidate_composite_synonyms_;
 
   // Represents a set of equations on data descriptors as a map indexed by
   // left-hand-side, mapping a left-hand-side to a set of operations, each of
@@ -174,6 +218,18 @@ class DataSynonymAndIdEquationFacts {
   std::unordered_map<const protobufs::DataDescriptor*, OperationSet>
       id_equations_;
 
+  // Indexes the OpConvertSToF and OpConvertUToF equations by opcode and
+  // operand class: maps the representative of a class to, for each of these
+  // opcodes, the left-hand-sides of the equations of that opcode whose operand
+  // belongs to the class.  A left-hand-side is recorded via a data descriptor
+  // that was its representative when the equation was added.  Entries are
+  // merged when classes are merged, so that the conversions of a class can be
+  // found without scanning every equation.
+  std::unordered_map<
+      const protobufs::DataDescriptor*,
+      std::map<SpvOp, std::vector<const protobufs::DataDescriptor*>>>
+      conversion_lhs_by_operand_;
+
   // Pointer to the SPIR-V module we store facts about.
   opt::IRContext* ir_context_;
 };
@@ -44,6 +44,13 @@ class FactManager {
  public:
   explicit FactManager(opt::IRContext* ir_context);
 
+  // Constructs a copy of |other| that holds facts about |ir_context|, which
+  // must contain a module identical to that of |other|.  |ir_context| may be
+  // null, in which case the copy can only be used as the source of further
+  // copies; this allows the facts about a module to be stored alongside a
+  // serialized form of the module.
+  FactManager(const FactManager& other, opt::IRContext* ir_context);
+
   // Adds all the facts from |facts|, checking them for validity with respect to
   // |ir_context_|. Warnings about invalid facts are communicated via
   // |message_consumer|; such facts are otherwise ignored.
@@ -90,16 +97,24 @@ class FactManager {
   // a.x == b.x and a.y == b.y, where a and b have vec2 type, we can record
   // that a == b holds.
   //
-  // This method is expensive, and should only be called (by applying a
+  // This method can be expensive, and should only be called (by applying a
   // transformation) at the start of a fuzzer pass that depends on data
   // synonym facts, rather than calling it every time a new data synonym fact
-  // is added.
+  // is added.  Only equivalence classes that have changed since the previous
+  // call are mined for new facts.
   //
   // The parameter |maximum_equivalence_class_size| specifies the size beyond
   // which equivalence classes should not be mined for new facts, to avoid
   // excessively-long closure computations.
   void ComputeClosureOfFacts(uint32_t maximum_equivalence_class_size);
 
+  // As above, except that once |maximum_pairs_to_consider| pairs of data
+  // descriptors have been compared, no further equivalence classes are mined
+  // and the closure is completed by later calls.  If
+  // |maximum_pairs_to_consider| is 0, the number of pairs is not bounded.
+  void ComputeClosureOfFacts(uint32_t maximum_equivalence_class_size,
+                             uint32_t maximum_pairs_to_consider);
+
   // The fact manager is responsible for managing a few distinct categories of
   // facts. In principle there could be different fact managers for each kind
   // of fact, but in practice providing one 'go to' place for facts is
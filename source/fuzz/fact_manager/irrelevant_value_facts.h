@@ -35,6 +35,11 @@ class IrrelevantValueFacts {
  public:
   explicit IrrelevantValueFacts(opt::IRContext* ir_context);
 
+  // Constructs a copy of |other| that holds facts about |ir_context|, which
+  // must contain a module identical to that of |other|.
+  IrrelevantValueFacts(const IrrelevantValueFacts& other,
+                       opt::IRContext* ir_context);
+
   // See method in FactManager which delegates to this method. Returns true if
   // |fact.pointer_id()| is a result id of pointer type in the |ir_context_| and
   // |fact.pointer_id()| does not participate in DataSynonym facts. Returns
@@ -15,6 +15,7 @@
 #include "source/fuzz/fuzzer.h"
 
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <numeric>
 
@@ -101,6 +102,17 @@
 namespace spvtools {
 namespace fuzz {
 
+namespace {
+
+// Counting the instructions of the module takes time linear in its size, so
+// while the fuzzing budget is far from exhausted the count is only refreshed
+// after this many repeated passes, or once the id bound has grown by a
+// sixteenth since the last count, whichever comes first.
+const uint32_t kMaxPassesBetweenInstructionCounts = 16;
+const uint32_t kIdBoundGrowthShiftBetweenInstructionCounts = 4;
+
+}  // namespace
+
 Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
                std::unique_ptr<TransformationContext> transformation_context,
                std::unique_ptr<FuzzerContext> fuzzer_context,
@@ -110,11 +122,31 @@ Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
                RepeatedPassStrategy repeated_pass_strategy,
                bool validate_after_each_fuzzer_pass,
                spv_validator_options validator_options)
+    : Fuzzer(std::move(ir_context), std::move(transformation_context),
+             std::move(fuzzer_context), std::move(consumer),
+             std::make_shared<DonorModuleCache>(donor_suppliers,
+                                                validator_options),
+             enable_all_passes, repeated_pass_strategy,
+             validate_after_each_fuzzer_pass, validator_options) {}
+
+Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
+               std::unique_ptr<TransformationContext> transformation_context,
+               std::unique_ptr<FuzzerContext> fuzzer_context,
+               MessageConsumer consumer,
+               std::shared_ptr<DonorModuleCache> donor_module_cache,
+               bool enable_all_passes,
+               RepeatedPassStrategy repeated_pass_strategy,
+               bool validate_after_each_fuzzer_pass,
+               spv_validator_options validator_options)
     : consumer_(std::move(consumer)),
       enable_all_passes_(enable_all_passes),
       validate_after_each_fuzzer_pass_(validate_after_each_fuzzer_pass),
       validator_options_(validator_options),
+      incremental_validator_(nullptr),
       num_repeated_passes_applied_(0),
+      counted_instructions_(0),
+      counted_id_bound_(0),
+      passes_since_instruction_count_(0),
       is_valid_(true),
       ir_context_(std::move(ir_context)),
       transformation_context_(std::move(transformation_context)),
@@ -123,7 +155,9 @@ Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
       pass_instances_(),
       repeated_pass_recommender_(nullptr),
       repeated_pass_manager_(nullptr),
-      final_passes_() {
+      final_passes_(),
+      final_pass_names_(),
+      pass_profiler_(nullptr) {
   assert(ir_context_ && "IRContext is not initialized");
   assert(fuzzer_context_ && "FuzzerContext is not initialized");
   assert(transformation_context_ && "TransformationContext is not initialized");
@@ -131,6 +165,17 @@ Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
                                           consumer_) &&
          "IRContext is invalid");
 
+  if (validate_after_each_fuzzer_pass_) {
+    // The module is required to be valid, so it serves as the starting point
+    // for incremental validation.
+    incremental_validator_ =
+        MakeUnique<IncrementalValidator>(validator_options_, consumer_);
+    incremental_validator_->SetLastValidModule(ir_context_.get());
+  }
+
+  fuzzer_context_->RecordModuleSize(CountInstructions(true),
+                                    ir_context_->module()->id_bound());
+
   // The following passes are likely to be very useful: many other passes
   // introduce synonyms, irrelevant ids and constants that these passes can work
   // with.  We thus enable them with high probability.
@@ -171,7 +216,7 @@ Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
     MaybeAddRepeatedPass<FuzzerPassConstructComposites>(&pass_instances_);
     MaybeAddRepeatedPass<FuzzerPassCopyObjects>(&pass_instances_);
     MaybeAddRepeatedPass<FuzzerPassDonateModules>(&pass_instances_,
-                                                  donor_suppliers);
+                                                  donor_module_cache);
     MaybeAddRepeatedPass<FuzzerPassDuplicateRegionsWithSelections>(
         &pass_instances_);
     MaybeAddRepeatedPass<FuzzerPassExpandVectorReductions>(&pass_instances_);
@@ -224,25 +269,31 @@ Fuzzer::Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
       repeated_pass_strategy, fuzzer_context_.get(), &pass_instances_,
       repeated_pass_recommender_.get());
 
-  MaybeAddFinalPass<FuzzerPassAdjustBranchWeights>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassAdjustFunctionControls>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassAdjustLoopControls>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassAdjustMemoryOperandsMasks>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassAdjustSelectionControls>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassAddNoContractionDecorations>(&final_passes_);
+  MaybeAddFinalPass<FuzzerPassAdjustBranchWeights>("AdjustBranchWeights");
+  MaybeAddFinalPass<FuzzerPassAdjustFunctionControls>("AdjustFunctionControls");
+  MaybeAddFinalPass<FuzzerPassAdjustLoopControls>("AdjustLoopControls");
+  MaybeAddFinalPass<FuzzerPassAdjustMemoryOperandsMasks>(
+      "AdjustMemoryOperandsMasks");
+  MaybeAddFinalPass<FuzzerPassAdjustSelectionControls>(
+      "AdjustSelectionControls");
+  MaybeAddFinalPass<FuzzerPassAddNoContractionDecorations>(
+      "AddNoContractionDecorations");
   if (!fuzzer_context_->IsWgslCompatible()) {
     // TODO(https://github.com/KhronosGroup/SPIRV-Tools/issues/4214):
     //  this is disabled temporarily due to some issues in the Tint compiler.
     //  Enable it back when the issues are resolved.
     MaybeAddFinalPass<FuzzerPassInterchangeSignednessOfIntegerOperands>(
-        &final_passes_);
+        "InterchangeSignednessOfIntegerOperands");
   }
-  MaybeAddFinalPass<FuzzerPassInterchangeZeroLikeConstants>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassPermuteFunctionVariables>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassPermutePhiOperands>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassSwapCommutableOperands>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassSwapFunctions>(&final_passes_);
-  MaybeAddFinalPass<FuzzerPassToggleAccessChainInstruction>(&final_passes_);
+  MaybeAddFinalPass<FuzzerPassInterchangeZeroLikeConstants>(
+      "InterchangeZeroLikeConstants");
+  MaybeAddFinalPass<FuzzerPassPermuteFunctionVariables>(
+      "PermuteFunctionVariables");
+  MaybeAddFinalPass<FuzzerPassPermutePhiOperands>("PermutePhiOperands");
+  MaybeAddFinalPass<FuzzerPassSwapCommutableOperands>("SwapCommutableOperands");
+  MaybeAddFinalPass<FuzzerPassSwapFunctions>("SwapFunctions");
+  MaybeAddFinalPass<FuzzerPassToggleAccessChainInstruction>(
+      "ToggleAccessChainInstruction");
 }
 
 Fuzzer::~Fuzzer() = default;
@@ -260,50 +311,123 @@ void Fuzzer::MaybeAddRepeatedPass(uint32_t percentage_chance_of_adding_pass,
 }
 
 template <typename FuzzerPassT, typename... Args>
-void Fuzzer::MaybeAddFinalPass(std::vector<std::unique_ptr<FuzzerPass>>* passes,
-                               Args&&... extra_args) {
+void Fuzzer::MaybeAddFinalPass(const char* pass_name, Args&&... extra_args) {
   if (enable_all_passes_ || fuzzer_context_->ChooseEven()) {
-    passes->push_back(MakeUnique<FuzzerPassT>(
+    final_passes_.push_back(MakeUnique<FuzzerPassT>(
         ir_context_.get(), transformation_context_.get(), fuzzer_context_.get(),
         &transformation_sequence_out_, std::forward<Args>(extra_args)...));
+    final_pass_names_.push_back(pass_name);
   }
 }
 
-bool Fuzzer::ApplyPassAndCheckValidity(FuzzerPass* pass) const {
-  pass->Apply();
-  return !validate_after_each_fuzzer_pass_ ||
-         fuzzerutil::IsValidAndWellFormed(ir_context_.get(), validator_options_,
-                                          consumer_);
+bool Fuzzer::ApplyPassAndCheckValidity(FuzzerPass* pass, const char* pass_name,
+                                       bool is_final_pass) {
+  if (pass_profiler_) {
+    pass_profiler_->BeginPass(ir_context_.get(), transformation_sequence_out_);
+    pass->Apply();
+    pass_profiler_->EndPass(pass_name, is_final_pass, ir_context_.get(),
+                            transformation_sequence_out_);
+  } else {
+    pass->Apply();
+  }
+  if (!validate_after_each_fuzzer_pass_) {
+    return true;
+  }
+  if (!incremental_validator_->IsValid(ir_context_.get())) {
+    consumer_(SPV_MSG_INFO, nullptr, {},
+              "Module is invalid (set a breakpoint to inspect).");
+    return false;
+  }
+  return fuzzerutil::IsWellFormed(ir_context_.get(), consumer_);
 }
 
 opt::IRContext* Fuzzer::GetIRContext() { return ir_context_.get(); }
 
+uint32_t Fuzzer::CountInstructions(bool force_count) {
+  const auto id_bound = ir_context_->module()->id_bound();
+  if (force_count ||
+      ++passes_since_instruction_count_ >= kMaxPassesBetweenInstructionCounts ||
+      id_bound - counted_id_bound_ >=
+          (counted_id_bound_ >> kIdBoundGrowthShiftBetweenInstructionCounts)) {
+    counted_instructions_ =
+        fuzzerutil::GetNumberOfInstructions(ir_context_.get());
+    counted_id_bound_ = id_bound;
+    passes_since_instruction_count_ = 0;
+    return counted_instructions_;
+  }
+  // Most new instructions have a result id, so the growth of the id bound
+  // since the last count stands in for the instructions added since then.
+  return counted_instructions_ + (id_bound - counted_id_bound_);
+}
+
 const protobufs::TransformationSequence& Fuzzer::GetTransformationSequence()
     const {
   return transformation_sequence_out_;
 }
 
+void Fuzzer::SetPassProfiler(FuzzerPassProfiler* pass_profiler) {
+  pass_profiler_ = pass_profiler;
+}
+
+void Fuzzer::SetPreferredPassSequence(std::vector<std::string> pass_names) {
+  preferred_pass_sequence_ = std::move(pass_names);
+}
+
 Fuzzer::Result Fuzzer::Run(uint32_t num_of_transformations_to_apply) {
   assert(is_valid_ && "The module was invalidated during the previous fuzzing");
 
+  const auto run_start_time = std::chrono::steady_clock::now();
   const auto initial_num_of_transformations =
       static_cast<uint32_t>(transformation_sequence_out_.transformation_size());
 
   auto status = Status::kComplete;
+  size_t num_passes_chosen = 0;
   do {
-    if (!ApplyPassAndCheckValidity(
-            repeated_pass_manager_->ChoosePass(transformation_sequence_out_))) {
+    const auto selection_start_time = std::chrono::steady_clock::now();
+    FuzzerPass* pass = nullptr;
+    if (num_passes_chosen < preferred_pass_sequence_.size() &&
+        !fuzzer_context_->IsBudgetNearlyExhausted() &&
+        fuzzer_context_->ChoosePercentage(
+            fuzzer_context_->GetChanceOfFollowingPreferredPassSequence())) {
+      pass = pass_instances_.GetPassByName(
+          preferred_pass_sequence_[num_passes_chosen]);
+    }
+    if (!pass) {
+      pass = repeated_pass_manager_->ChoosePass(transformation_sequence_out_);
+    }
+    num_passes_chosen++;
+    if (pass_profiler_) {
+      pass_profiler_->RecordPassSelection(
+          std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        selection_start_time)
+              .count());
+    }
+    if (!ApplyPassAndCheckValidity(pass, pass_instances_.GetPassName(pass),
+                                   false)) {
       status = Status::kFuzzerPassLedToInvalidModule;
       break;
     }
 
-    // Check that the module is small enough.
+    // Check that the module is small enough.  Its size is also recorded, so
+    // that passes that grow the module can be throttled as it nears the
+    // limits.
+    const auto instruction_count =
+        CountInstructions(fuzzer_context_->IsBudgetNearlyExhausted());
+    fuzzer_context_->RecordModuleSize(instruction_count,
+                                      ir_context_->module()->id_bound());
     if (ir_context_->module()->id_bound() >=
-        fuzzer_context_->GetIdBoundLimit()) {
+            fuzzer_context_->GetIdBoundLimit() ||
+        instruction_count >= fuzzer_context_->GetInstructionCountLimit()) {
       status = Status::kModuleTooBig;
       break;
     }
 
+    // Check that fuzzing has not run out of time.
+    if (fuzzer_context_->IsTimeLimitReached()) {
+      status = Status::kTimeLimitReached;
+      break;
+    }
+
     auto transformations_applied_so_far = static_cast<uint32_t>(
         transformation_sequence_out_.transformation_size());
     assert(transformations_applied_so_far >= initial_num_of_transformations &&
@@ -340,8 +464,9 @@ Fuzzer::Result Fuzzer::Run(uint32_t num_of_transformations_to_apply) {
     // We apply this transformations despite the fact that we might exceed
     // |num_of_transformations_to_apply|. This is not a problem for us since
     // these fuzzer passes are relatively simple yet might trigger some bugs.
-    for (auto& pass : final_passes_) {
-      if (!ApplyPassAndCheckValidity(pass.get())) {
+    for (size_t i = 0; i < final_passes_.size(); i++) {
+      if (!ApplyPassAndCheckValidity(final_passes_[i].get(),
+                                     final_pass_names_[i], true)) {
         status = Status::kFuzzerPassLedToInvalidModule;
         break;
       }
@@ -349,6 +474,12 @@ Fuzzer::Result Fuzzer::Run(uint32_t num_of_transformations_to_apply) {
   }
 
   is_valid_ = status != Status::kFuzzerPassLedToInvalidModule;
+  if (pass_profiler_) {
+    pass_profiler_->RecordRun(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      run_start_time)
+            .count());
+  }
   return {status, static_cast<uint32_t>(
                       transformation_sequence_out_.transformation_size()) !=
                       initial_num_of_transformations};
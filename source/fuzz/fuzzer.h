@@ -16,12 +16,16 @@
 #define SOURCE_FUZZ_FUZZER_H_
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "source/fuzz/donor_module_cache.h"
 #include "source/fuzz/fuzzer_context.h"
 #include "source/fuzz/fuzzer_pass.h"
+#include "source/fuzz/fuzzer_pass_profiler.h"
 #include "source/fuzz/fuzzer_util.h"
+#include "source/fuzz/incremental_validator.h"
 #include "source/fuzz/pass_management/repeated_pass_instances.h"
 #include "source/fuzz/pass_management/repeated_pass_manager.h"
 #include "source/fuzz/pass_management/repeated_pass_recommender.h"
@@ -43,6 +47,7 @@ class Fuzzer {
     kModuleTooBig,
     kTransformationLimitReached,
     kFuzzerStuck,
+    kTimeLimitReached,
     kFuzzerPassLedToInvalidModule,
   };
 
@@ -64,6 +69,19 @@ class Fuzzer {
          bool validate_after_each_fuzzer_pass,
          spv_validator_options validator_options);
 
+  // As above, except that donor modules are obtained from
+  // |donor_module_cache|, which may be null if there are no donors.  Sharing
+  // a cache between fuzzers means that each donor is only obtained, validated
+  // and summarized once across all of them.
+  Fuzzer(std::unique_ptr<opt::IRContext> ir_context,
+         std::unique_ptr<TransformationContext> transformation_context,
+         std::unique_ptr<FuzzerContext> fuzzer_context,
+         MessageConsumer consumer,
+         std::shared_ptr<DonorModuleCache> donor_module_cache,
+         bool enable_all_passes, RepeatedPassStrategy repeated_pass_strategy,
+         bool validate_after_each_fuzzer_pass,
+         spv_validator_options validator_options);
+
   // Disables copy/move constructor/assignment operations.
   Fuzzer(const Fuzzer&) = delete;
   Fuzzer(Fuzzer&&) = delete;
@@ -90,6 +108,21 @@ class Fuzzer {
   // Returns the sequence of applied transformations.
   const protobufs::TransformationSequence& GetTransformationSequence() const;
 
+  // Makes |pass_profiler| record the cost of each fuzzer pass applied by
+  // subsequent calls to Run, together with the time spent choosing repeated
+  // passes and the time taken by each call.  |pass_profiler| is not owned, and
+  // may be null to disable profiling, which is the default.
+  void SetPassProfiler(FuzzerPassProfiler* pass_profiler);
+
+  // Makes subsequent calls to Run prefer to apply the repeated passes named in
+  // |pass_names|, in order, as named by RepeatedPassInstances: the i-th
+  // repeated pass applied by a call is, with the chance given by the fuzzer
+  // context, the i-th pass of the sequence, if that pass is enabled and the
+  // fuzzing budget is not nearly exhausted.  Otherwise, and once the sequence
+  // is used up, the pass manager chooses passes as usual.  This is how
+  // feedback-directed fuzzing repeats pass sequences that proved productive.
+  void SetPreferredPassSequence(std::vector<std::string> pass_names);
+
  private:
   // A convenience method to add a repeated fuzzer pass to |pass_instances| with
   // probability |percentage_chance_of_adding_pass|%, or with probability 100%
@@ -111,15 +144,15 @@ class Fuzzer {
                                       std::forward<Args>(extra_args)...);
   }
 
-  // A convenience method to add a final fuzzer pass to |passes| with
-  // probability 50%, or with probability 100% if |enable_all_passes_| is true.
+  // A convenience method to add a final fuzzer pass, called |pass_name|, to
+  // |final_passes_| with probability 50%, or with probability 100% if
+  // |enable_all_passes_| is true.
   //
   // All fuzzer passes take members |ir_context_|, |transformation_context_|,
   // |fuzzer_context_| and |transformation_sequence_out_| as parameters.  Extra
   // arguments can be provided via |extra_args|.
   template <typename FuzzerPassT, typename... Args>
-  void MaybeAddFinalPass(std::vector<std::unique_ptr<FuzzerPass>>* passes,
-                         Args&&... extra_args);
+  void MaybeAddFinalPass(const char* pass_name, Args&&... extra_args);
 
   // Decides whether to apply more repeated passes. The probability decreases as
   // the number of transformations that have been applied increases.
@@ -127,12 +160,25 @@ class Fuzzer {
   // |continue_fuzzing_probabilistically| is true.
   bool ShouldContinueRepeatedPasses(bool continue_fuzzing_probabilistically);
 
-  // Applies |pass|, which must be a pass constructed with |ir_context|.
+  // Applies |pass|, which must be a pass constructed with |ir_context|, and
+  // which is called |pass_name| and is a final pass if |is_final_pass| holds;
+  // the name and kind of the pass are only used for profiling.
   // If |validate_after_each_fuzzer_pass_| is not set, true is always returned.
   // Otherwise, true is returned if and only if |ir_context| passes validation,
   // every block has its enclosing function as its parent, and every
-  // instruction has a distinct unique id.
-  bool ApplyPassAndCheckValidity(FuzzerPass* pass) const;
+  // instruction has a distinct unique id.  Validation is incremental: only
+  // the parts of the module that may have been affected by |pass| are
+  // re-validated.
+  bool ApplyPassAndCheckValidity(FuzzerPass* pass, const char* pass_name,
+                                 bool is_final_pass);
+
+  // Returns the number of instructions in the module being fuzzed.  Counting
+  // takes time linear in the size of the module, so unless |force_count|
+  // holds the result may be an estimate, made from the previous count and the
+  // growth of the id bound since, until enough passes have been applied or
+  // the id bound has grown enough to warrant a fresh count.  Must be called
+  // once after each repeated pass.
+  uint32_t CountInstructions(bool force_count);
 
   // Message consumer that will be invoked once for each message communicated
   // from the library.
@@ -148,11 +194,22 @@ class Fuzzer {
   // Options to control validation.
   const spv_validator_options validator_options_;
 
+  // Used to validate the module after each fuzzer pass, if
+  // |validate_after_each_fuzzer_pass_| is set; null otherwise.
+  std::unique_ptr<IncrementalValidator> incremental_validator_;
+
   // The number of repeated fuzzer passes that have been applied is kept track
   // of, in order to enforce a hard limit on the number of times such passes
   // can be applied.
   uint32_t num_repeated_passes_applied_;
 
+  // The number of instructions in the module, as last counted, together with
+  // the id bound at the time and the number of repeated passes applied since;
+  // see CountInstructions.
+  uint32_t counted_instructions_;
+  uint32_t counted_id_bound_;
+  uint32_t passes_since_instruction_count_;
+
   // We use this to determine whether we can continue fuzzing incrementally
   // since the previous call to the Run method could've returned
   // kFuzzerPassLedToInvalidModule.
@@ -187,6 +244,16 @@ class Fuzzer {
   // Some passes that it does not make sense to apply repeatedly, as they do not
   // unlock other passes.
   std::vector<std::unique_ptr<FuzzerPass>> final_passes_;
+
+  // The names of the passes in |final_passes_|, in the same order.
+  std::vector<const char*> final_pass_names_;
+
+  // Records the cost of fuzzer passes if not null; not owned.
+  FuzzerPassProfiler* pass_profiler_;
+
+  // The names of the repeated passes that each call to Run should prefer to
+  // apply, in order.
+  std::vector<std::string> preferred_pass_sequence_;
 };
 
 }  // namespace fuzz
@@ -14,7 +14,9 @@
 
 #include "source/fuzz/fuzzer_context.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace spvtools {
 namespace fuzz {
@@ -30,8 +32,18 @@ const uint32_t kIdBoundGap = 100;
 // Limits to help control the overall fuzzing process and rein in individual
 // fuzzer passes.
 const uint32_t kIdBoundLimit = 50000;
+const uint32_t kInstructionCountLimit = 100000;
 const uint32_t kTransformationLimit = 2000;
 
+// Once this percentage of the budget has been used, passes that grow the
+// module are throttled, increasingly so as the rest of the budget is used.
+const uint32_t kPercentageOfBudgetUsedBeforeThrottling = 80;
+
+// When the fuzzer has been given a preferred sequence of repeated passes, the
+// chance that it applies the next pass of the sequence rather than letting the
+// pass manager choose.
+const uint32_t kChanceOfFollowingPreferredPassSequence = 80;
+
 // Default <minimum, maximum> pairs of probabilities for applying various
 // transformations. All values are percentages. Keep them in alphabetical order.
 const std::pair<uint32_t, uint32_t>
@@ -174,6 +186,7 @@ const uint32_t kDefaultMaxNewArraySizeLimit = 100;
 //  think whether there is a better limit on the maximum number of parameters.
 const uint32_t kDefaultMaxNumberOfFunctionParameters = 128;
 const uint32_t kDefaultMaxNumberOfNewParameters = 15;
+const uint32_t kDefaultMaxPairsToConsiderForDataSynonymFactClosure = 100000;
 const uint32_t kGetDefaultMaxNumberOfParametersReplacedWithStruct = 5;
 
 // Default functions for controlling how deep to go during recursive
@@ -193,6 +206,11 @@ FuzzerContext::FuzzerContext(std::unique_ptr<RandomGenerator> random_generator,
     : random_generator_(std::move(random_generator)),
       next_fresh_id_(min_fresh_id),
       is_wgsl_compatible_(is_wgsl_compatible),
+      instruction_count_(0),
+      id_bound_(0),
+      has_time_limit_(false),
+      start_time_(),
+      time_limit_(),
       max_equivalence_class_size_for_data_synonym_fact_closure_(
           kDefaultMaxEquivalenceClassSizeForDataSynonymFactClosure),
       max_loop_control_partial_count_(kDefaultMaxLoopControlPartialCount),
@@ -203,6 +221,8 @@ FuzzerContext::FuzzerContext(std::unique_ptr<RandomGenerator> random_generator,
       max_number_of_new_parameters_(kDefaultMaxNumberOfNewParameters),
       max_number_of_parameters_replaced_with_struct_(
           kGetDefaultMaxNumberOfParametersReplacedWithStruct),
+      max_pairs_to_consider_for_data_synonym_fact_closure_(
+          kDefaultMaxPairsToConsiderForDataSynonymFactClosure),
       go_deeper_in_constant_obfuscation_(
           kDefaultGoDeeperInConstantObfuscation) {
   chance_of_accepting_repeated_pass_recommendation_ =
@@ -421,6 +441,61 @@ uint32_t FuzzerContext::GetTransformationLimit() const {
   return kTransformationLimit;
 }
 
+uint32_t FuzzerContext::GetInstructionCountLimit() const {
+  return kInstructionCountLimit;
+}
+
+void FuzzerContext::SetTimeLimit(uint32_t seconds) {
+  has_time_limit_ = seconds != 0;
+  start_time_ = std::chrono::steady_clock::now();
+  time_limit_ = std::chrono::seconds(seconds);
+}
+
+bool FuzzerContext::IsTimeLimitReached() const {
+  return has_time_limit_ &&
+         std::chrono::steady_clock::now() - start_time_ >= time_limit_;
+}
+
+void FuzzerContext::RecordModuleSize(uint32_t instruction_count,
+                                     uint32_t id_bound) {
+  instruction_count_ = instruction_count;
+  id_bound_ = id_bound;
+}
+
+uint32_t FuzzerContext::GetPercentageOfBudgetUsed() const {
+  uint64_t result = std::max(
+      static_cast<uint64_t>(instruction_count_) * 100 / kInstructionCountLimit,
+      static_cast<uint64_t>(id_bound_) * 100 / kIdBoundLimit);
+  if (has_time_limit_) {
+    result = std::max(
+        result, static_cast<uint64_t>((std::chrono::steady_clock::now() -
+                                       start_time_) *
+                                      100 / time_limit_));
+  }
+  return static_cast<uint32_t>(std::min<uint64_t>(
+      result, std::numeric_limits<uint32_t>::max()));
+}
+
+bool FuzzerContext::IsBudgetNearlyExhausted() const {
+  return GetPercentageOfBudgetUsed() >= kPercentageOfBudgetUsedBeforeThrottling;
+}
+
+uint32_t FuzzerContext::GetChanceOfApplyingPassThatGrowsModule() const {
+  auto percentage_used = GetPercentageOfBudgetUsed();
+  if (percentage_used < kPercentageOfBudgetUsedBeforeThrottling) {
+    return 100;
+  }
+  if (percentage_used >= 100) {
+    return 0;
+  }
+  return (100 - percentage_used) * 100 /
+         (100 - kPercentageOfBudgetUsedBeforeThrottling);
+}
+
+uint32_t FuzzerContext::GetChanceOfFollowingPreferredPassSequence() const {
+  return kChanceOfFollowingPreferredPassSequence;
+}
+
 uint32_t FuzzerContext::GetMinFreshId(opt::IRContext* ir_context) {
   return ir_context->module()->id_bound() + kIdBoundGap;
 }
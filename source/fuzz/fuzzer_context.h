@@ -15,6 +15,7 @@
 #ifndef SOURCE_FUZZ_FUZZER_CONTEXT_H_
 #define SOURCE_FUZZ_FUZZER_CONTEXT_H_
 
+#include <chrono>
 #include <functional>
 #include <utility>
 
@@ -117,6 +118,42 @@ class FuzzerContext {
   // fuzzer passes.
   uint32_t GetTransformationLimit() const;
 
+  // A suggested limit on the number of instructions in the module being
+  // fuzzed, used in the same way as the limit on the id bound.
+  uint32_t GetInstructionCountLimit() const;
+
+  // Limits fuzzing to |seconds| from now; 0, the default, means that there is
+  // no time limit.  Unlike the other limits, a time limit makes the outcome of
+  // fuzzing depend on the speed of the machine, and not only on the seed.
+  void SetTimeLimit(uint32_t seconds);
+
+  // Returns true if and only if a time limit has been set and has passed.
+  bool IsTimeLimitReached() const;
+
+  // Records the current size of the module being fuzzed, for use in deciding
+  // how much of the fuzzing budget has been used.
+  void RecordModuleSize(uint32_t instruction_count, uint32_t id_bound);
+
+  // Returns the percentage of the fuzzing budget that has been used: the
+  // largest of the recorded instruction count and id bound, relative to their
+  // limits, and of the elapsed time, relative to the time limit if there is
+  // one.  The result may exceed 100.
+  uint32_t GetPercentageOfBudgetUsed() const;
+
+  // Returns true if and only if so much of the fuzzing budget has been used
+  // that passes which grow the module should be throttled.
+  bool IsBudgetNearlyExhausted() const;
+
+  // Returns the chance, as a percentage, with which a pass that grows the
+  // module should be applied.  This is 100 until the budget is nearly
+  // exhausted, and then falls to 0 as the rest of the budget is used.
+  uint32_t GetChanceOfApplyingPassThatGrowsModule() const;
+
+  // Returns the chance, as a percentage, with which the next pass of a
+  // preferred sequence of repeated passes should be applied, rather than a
+  // pass chosen by the pass manager.  See Fuzzer::SetPreferredPassSequence.
+  uint32_t GetChanceOfFollowingPreferredPassSequence() const;
+
   // Returns the minimum fresh id that can be used given the |ir_context|.
   static uint32_t GetMinFreshId(opt::IRContext* ir_context);
 
@@ -392,6 +429,9 @@ class FuzzerContext {
   uint32_t GetMaximumNumberOfParametersReplacedWithStruct() const {
     return max_number_of_parameters_replaced_with_struct_;
   }
+  uint32_t GetMaximumPairsToConsiderForDataSynonymFactClosure() const {
+    return max_pairs_to_consider_for_data_synonym_fact_closure_;
+  }
   std::pair<uint32_t, uint32_t> GetRandomBranchWeights() {
     std::pair<uint32_t, uint32_t> branch_weights = {0, 0};
 
@@ -475,6 +515,16 @@ class FuzzerContext {
   // True if all transformations should be compatible with WGSL spec.
   bool is_wgsl_compatible_;
 
+  // The size of the module being fuzzed, as last recorded.
+  uint32_t instruction_count_;
+  uint32_t id_bound_;
+
+  // If |has_time_limit_| holds, fuzzing should stop once |time_limit_| has
+  // elapsed since |start_time_|.
+  bool has_time_limit_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::duration time_limit_;
+
   // Probabilities associated with applying various transformations.
   // Keep them in alphabetical order.
   uint32_t chance_of_accepting_repeated_pass_recommendation_;
@@ -574,6 +624,7 @@ class FuzzerContext {
   uint32_t max_number_of_function_parameters_;
   uint32_t max_number_of_new_parameters_;
   uint32_t max_number_of_parameters_replaced_with_struct_;
+  uint32_t max_pairs_to_consider_for_data_synonym_fact_closure_;
 
   // Functions to determine with what probability to go deeper when generating
   // or mutating constructs recursively.
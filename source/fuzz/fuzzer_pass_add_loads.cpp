@@ -14,6 +14,7 @@
 
 #include "source/fuzz/fuzzer_pass_add_loads.h"
 
+#include "source/fuzz/available_instructions.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/transformation_load.h"
 
@@ -28,10 +29,34 @@ FuzzerPassAddLoads::FuzzerPassAddLoads(
                  transformations) {}
 
 void FuzzerPassAddLoads::Apply() {
+  // The pointers that it is possible to load from.  With variable pointers a
+  // load can itself yield such a pointer, so loads are added as they are made.
+  AvailableInstructions loadable_pointers(
+      GetIRContext(),
+      [](opt::IRContext* context, opt::Instruction* instruction) -> bool {
+        if (!instruction->result_id() || !instruction->type_id()) {
+          return false;
+        }
+        switch (instruction->opcode()) {
+          case SpvOpConstantNull:
+          case SpvOpUndef:
+            // Do not allow loading from a null or undefined pointer; this
+            // might be OK if the block is dead, but for now we conservatively
+            // avoid it.
+            return false;
+          default:
+            break;
+        }
+        return context->get_def_use_mgr()
+                   ->GetDef(instruction->type_id())
+                   ->opcode() == SpvOpTypePointer;
+      });
+
   ForEachInstructionWithInstructionDescriptor(
-      [this](opt::Function* function, opt::BasicBlock* block,
-             opt::BasicBlock::iterator inst_it,
-             const protobufs::InstructionDescriptor& instruction_descriptor)
+      [this, &loadable_pointers](
+          opt::Function* /*unused*/, opt::BasicBlock* /*unused*/,
+          opt::BasicBlock::iterator inst_it,
+          const protobufs::InstructionDescriptor& instruction_descriptor)
           -> void {
         assert(inst_it->opcode() ==
                    instruction_descriptor.target_instruction_opcode() &&
@@ -50,28 +75,8 @@ void FuzzerPassAddLoads::Apply() {
           return;
         }
 
-        std::vector<opt::Instruction*> relevant_instructions =
-            FindAvailableInstructions(
-                function, block, inst_it,
-                [](opt::IRContext* context,
-                   opt::Instruction* instruction) -> bool {
-                  if (!instruction->result_id() || !instruction->type_id()) {
-                    return false;
-                  }
-                  switch (instruction->opcode()) {
-                    case SpvOpConstantNull:
-                    case SpvOpUndef:
-                      // Do not allow loading from a null or undefined pointer;
-                      // this might be OK if the block is dead, but for now we
-                      // conservatively avoid it.
-                      return false;
-                    default:
-                      break;
-                  }
-                  return context->get_def_use_mgr()
-                             ->GetDef(instruction->type_id())
-                             ->opcode() == SpvOpTypePointer;
-                });
+        auto relevant_instructions =
+            loadable_pointers.GetAvailableBeforeInstruction(&*inst_it);
 
         // At this point, |relevant_instructions| contains all the pointers
         // we might think of loading from.
@@ -81,12 +86,15 @@ void FuzzerPassAddLoads::Apply() {
 
         // Choose a pointer at random, and create and apply a loading
         // transformation based on it.
+        auto fresh_id = GetFuzzerContext()->GetFreshId();
         ApplyTransformation(TransformationLoad(
-            GetFuzzerContext()->GetFreshId(),
+            fresh_id,
             relevant_instructions[GetFuzzerContext()->RandomIndex(
                                       relevant_instructions)]
                 ->result_id(),
             instruction_descriptor));
+        loadable_pointers.AddInstruction(
+            GetIRContext()->get_def_use_mgr()->GetDef(fresh_id));
       });
 }
 
@@ -14,6 +14,7 @@
 
 #include "source/fuzz/fuzzer_pass_add_stores.h"
 
+#include "source/fuzz/available_instructions.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/transformation_store.h"
 
@@ -28,10 +29,61 @@ FuzzerPassAddStores::FuzzerPassAddStores(
                  transformations) {}
 
 void FuzzerPassAddStores::Apply() {
+  // The pointers that it is possible to store to in a dead block, and the
+  // subset of those that it is possible to store to anywhere because the value
+  // of their pointee is irrelevant.
+  auto is_writable_pointer = [](opt::IRContext* context,
+                                opt::Instruction* instruction) -> bool {
+    if (!instruction->result_id() || !instruction->type_id()) {
+      return false;
+    }
+    auto type_inst = context->get_def_use_mgr()->GetDef(instruction->type_id());
+    if (type_inst->opcode() != SpvOpTypePointer) {
+      // Not a pointer.
+      return false;
+    }
+    if (instruction->IsReadOnlyPointer()) {
+      // Read only: cannot store to it.
+      return false;
+    }
+    switch (instruction->opcode()) {
+      case SpvOpConstantNull:
+      case SpvOpUndef:
+        // Do not allow storing to a null or undefined pointer; this might be
+        // OK if the block is dead, but for now we conservatively avoid it.
+        return false;
+      default:
+        break;
+    }
+    return true;
+  };
+  AvailableInstructions writable_pointers(GetIRContext(), is_writable_pointer);
+  AvailableInstructions writable_pointers_with_irrelevant_pointees(
+      GetIRContext(),
+      [this, &is_writable_pointer](opt::IRContext* context,
+                                   opt::Instruction* instruction) -> bool {
+        return is_writable_pointer(context, instruction) &&
+               GetTransformationContext()
+                   ->GetFactManager()
+                   ->PointeeValueIsIrrelevant(instruction->result_id());
+      });
+
+  // The values that it is possible to store, indexed by type.
+  AvailableInstructions values_by_type(
+      GetIRContext(),
+      [](opt::IRContext* /*unused*/, opt::Instruction* instruction) -> bool {
+        return instruction->result_id() && instruction->type_id();
+      },
+      [](opt::IRContext* /*unused*/, opt::Instruction* instruction) {
+        return instruction->type_id();
+      });
+
   ForEachInstructionWithInstructionDescriptor(
-      [this](opt::Function* function, opt::BasicBlock* block,
-             opt::BasicBlock::iterator inst_it,
-             const protobufs::InstructionDescriptor& instruction_descriptor)
+      [this, &writable_pointers, &writable_pointers_with_irrelevant_pointees,
+       &values_by_type](
+          opt::Function* /*unused*/, opt::BasicBlock* block,
+          opt::BasicBlock::iterator inst_it,
+          const protobufs::InstructionDescriptor& instruction_descriptor)
           -> void {
         assert(inst_it->opcode() ==
                    instruction_descriptor.target_instruction_opcode() &&
@@ -51,43 +103,15 @@ void FuzzerPassAddStores::Apply() {
           return;
         }
 
-        // Look for pointers we might consider storing to.
-        std::vector<opt::Instruction*> relevant_pointers =
-            FindAvailableInstructions(
-                function, block, inst_it,
-                [this, block](opt::IRContext* context,
-                              opt::Instruction* instruction) -> bool {
-                  if (!instruction->result_id() || !instruction->type_id()) {
-                    return false;
-                  }
-                  auto type_inst = context->get_def_use_mgr()->GetDef(
-                      instruction->type_id());
-                  if (type_inst->opcode() != SpvOpTypePointer) {
-                    // Not a pointer.
-                    return false;
-                  }
-                  if (instruction->IsReadOnlyPointer()) {
-                    // Read only: cannot store to it.
-                    return false;
-                  }
-                  switch (instruction->opcode()) {
-                    case SpvOpConstantNull:
-                    case SpvOpUndef:
-                      // Do not allow storing to a null or undefined pointer;
-                      // this might be OK if the block is dead, but for now we
-                      // conservatively avoid it.
-                      return false;
-                    default:
-                      break;
-                  }
-                  return GetTransformationContext()
-                             ->GetFactManager()
-                             ->BlockIsDead(block->id()) ||
-                         GetTransformationContext()
-                             ->GetFactManager()
-                             ->PointeeValueIsIrrelevant(
-                                 instruction->result_id());
-                });
+        // Look for pointers we might consider storing to: any writable pointer
+        // in a dead block, and otherwise only those whose pointee value is
+        // irrelevant.
+        auto relevant_pointers =
+            (GetTransformationContext()->GetFactManager()->BlockIsDead(
+                 block->id())
+                 ? writable_pointers
+                 : writable_pointers_with_irrelevant_pointees)
+                .GetAvailableBeforeInstruction(&*inst_it);
 
         // At this point, |relevant_pointers| contains all the pointers we might
         // think of storing to.
@@ -98,19 +122,11 @@ void FuzzerPassAddStores::Apply() {
         auto pointer = relevant_pointers[GetFuzzerContext()->RandomIndex(
             relevant_pointers)];
 
-        std::vector<opt::Instruction*> relevant_values =
-            FindAvailableInstructions(
-                function, block, inst_it,
-                [pointer](opt::IRContext* context,
-                          opt::Instruction* instruction) -> bool {
-                  if (!instruction->result_id() || !instruction->type_id()) {
-                    return false;
-                  }
-                  return instruction->type_id() ==
-                         context->get_def_use_mgr()
-                             ->GetDef(pointer->type_id())
-                             ->GetSingleWordInOperand(1);
-                });
+        auto relevant_values = values_by_type.GetAvailableBeforeInstruction(
+            &*inst_it, GetIRContext()
+                           ->get_def_use_mgr()
+                           ->GetDef(pointer->type_id())
+                           ->GetSingleWordInOperand(1));
 
         if (relevant_values.empty()) {
           return;
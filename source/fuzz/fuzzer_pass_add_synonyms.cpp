@@ -14,10 +14,15 @@
 
 #include "source/fuzz/fuzzer_pass_add_synonyms.h"
 
+#include <map>
+#include <memory>
+
+#include "source/fuzz/available_instructions.h"
 #include "source/fuzz/fuzzer_context.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/instruction_descriptor.h"
 #include "source/fuzz/transformation_add_synonym.h"
+#include "source/util/make_unique.h"
 
 namespace spvtools {
 namespace fuzz {
@@ -30,10 +35,18 @@ FuzzerPassAddSynonyms::FuzzerPassAddSynonyms(
                  transformations) {}
 
 void FuzzerPassAddSynonyms::Apply() {
+  // For each synonym type that has been chosen so far, the instructions that
+  // a synonym of that type can be made of.  These are computed on demand, and
+  // the synonyms that this pass adds are added to them.
+  std::map<protobufs::TransformationAddSynonym::SynonymType,
+           std::unique_ptr<AvailableInstructions>>
+      synonym_candidates;
+
   ForEachInstructionWithInstructionDescriptor(
-      [this](opt::Function* function, opt::BasicBlock* block,
-             opt::BasicBlock::iterator inst_it,
-             const protobufs::InstructionDescriptor& instruction_descriptor) {
+      [this, &synonym_candidates](
+          opt::Function* /*unused*/, opt::BasicBlock* block,
+          opt::BasicBlock::iterator inst_it,
+          const protobufs::InstructionDescriptor& instruction_descriptor) {
         if (GetTransformationContext()->GetFactManager()->BlockIsDead(
                 block->id())) {
           // Don't create synonyms in dead blocks.
@@ -55,15 +68,20 @@ void FuzzerPassAddSynonyms::Apply() {
         auto synonym_type = GetFuzzerContext()->GetRandomSynonymType();
 
         // Select all instructions that can be used to create a synonym to.
-        auto available_instructions = FindAvailableInstructions(
-            function, block, inst_it,
-            [synonym_type, this](opt::IRContext* ir_context,
-                                 opt::Instruction* inst) {
-              // Check that we can create a synonym to |inst| as described by
-              // the |synonym_type| and insert it before |inst_it|.
-              return TransformationAddSynonym::IsInstructionValid(
-                  ir_context, *GetTransformationContext(), inst, synonym_type);
-            });
+        auto& candidates = synonym_candidates[synonym_type];
+        if (!candidates) {
+          candidates = MakeUnique<AvailableInstructions>(
+              GetIRContext(), [synonym_type, this](opt::IRContext* ir_context,
+                                                   opt::Instruction* inst) {
+                // Check that we can create a synonym to |inst| as described by
+                // the |synonym_type|.
+                return TransformationAddSynonym::IsInstructionValid(
+                    ir_context, *GetTransformationContext(), inst,
+                    synonym_type);
+              });
+        }
+        auto available_instructions =
+            candidates->GetAvailableBeforeInstruction(&*inst_it);
 
         if (available_instructions.empty()) {
           return;
@@ -123,9 +141,17 @@ void FuzzerPassAddSynonyms::Apply() {
             break;
         }
 
+        auto synonym_fresh_id = GetFuzzerContext()->GetFreshId();
         ApplyTransformation(TransformationAddSynonym(
-            existing_synonym->result_id(), synonym_type,
-            GetFuzzerContext()->GetFreshId(), instruction_descriptor));
+            existing_synonym->result_id(), synonym_type, synonym_fresh_id,
+            instruction_descriptor));
+
+        // The new synonym may itself be a candidate for further synonyms.
+        auto* synonym =
+            GetIRContext()->get_def_use_mgr()->GetDef(synonym_fresh_id);
+        for (auto& entry : synonym_candidates) {
+          entry.second->AddInstruction(synonym);
+        }
       });
 }
 
@@ -37,7 +37,9 @@ void FuzzerPassApplyIdSynonyms::Apply() {
   // that are available.
   ApplyTransformation(TransformationComputeDataSynonymFactClosure(
       GetFuzzerContext()
-          ->GetMaximumEquivalenceClassSizeForDataSynonymFactClosure()));
+          ->GetMaximumEquivalenceClassSizeForDataSynonymFactClosure(),
+      GetFuzzerContext()
+          ->GetMaximumPairsToConsiderForDataSynonymFactClosure()));
 
   for (auto id_with_known_synonyms : GetTransformationContext()
                                          ->GetFactManager()
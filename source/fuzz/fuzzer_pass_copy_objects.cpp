@@ -14,6 +14,7 @@
 
 #include "source/fuzz/fuzzer_pass_copy_objects.h"
 
+#include "source/fuzz/available_instructions.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
 #include "source/fuzz/transformation_add_synonym.h"
@@ -29,10 +30,21 @@ FuzzerPassCopyObjects::FuzzerPassCopyObjects(
                  transformations) {}
 
 void FuzzerPassCopyObjects::Apply() {
+  // The instructions that it is possible to copy.  Copies are themselves
+  // copyable, so they are added as they are made.
+  AvailableInstructions copyable_instructions(
+      GetIRContext(), [this](opt::IRContext* ir_context,
+                             opt::Instruction* inst) -> bool {
+        return TransformationAddSynonym::IsInstructionValid(
+            ir_context, *GetTransformationContext(), inst,
+            protobufs::TransformationAddSynonym::COPY_OBJECT);
+      });
+
   ForEachInstructionWithInstructionDescriptor(
-      [this](opt::Function* function, opt::BasicBlock* block,
-             opt::BasicBlock::iterator inst_it,
-             const protobufs::InstructionDescriptor& instruction_descriptor)
+      [this, &copyable_instructions](
+          opt::Function* /*unused*/, opt::BasicBlock* block,
+          opt::BasicBlock::iterator inst_it,
+          const protobufs::InstructionDescriptor& instruction_descriptor)
           -> void {
         assert(inst_it->opcode() ==
                    instruction_descriptor.target_instruction_opcode() &&
@@ -58,13 +70,8 @@ void FuzzerPassCopyObjects::Apply() {
           return;
         }
 
-        const auto relevant_instructions = FindAvailableInstructions(
-            function, block, inst_it,
-            [this](opt::IRContext* ir_context, opt::Instruction* inst) {
-              return TransformationAddSynonym::IsInstructionValid(
-                  ir_context, *GetTransformationContext(), inst,
-                  protobufs::TransformationAddSynonym::COPY_OBJECT);
-            });
+        const auto relevant_instructions =
+            copyable_instructions.GetAvailableBeforeInstruction(&*inst_it);
 
         // At this point, |relevant_instructions| contains all the instructions
         // we might think of copying.
@@ -74,12 +81,15 @@ void FuzzerPassCopyObjects::Apply() {
 
         // Choose a copyable instruction at random, and create and apply an
         // object copying transformation based on it.
+        auto copied_id = relevant_instructions[GetFuzzerContext()->RandomIndex(
+                                                   relevant_instructions)]
+                             ->result_id();
+        auto fresh_id = GetFuzzerContext()->GetFreshId();
         ApplyTransformation(TransformationAddSynonym(
-            relevant_instructions[GetFuzzerContext()->RandomIndex(
-                                      relevant_instructions)]
-                ->result_id(),
-            protobufs::TransformationAddSynonym::COPY_OBJECT,
-            GetFuzzerContext()->GetFreshId(), instruction_descriptor));
+            copied_id, protobufs::TransformationAddSynonym::COPY_OBJECT,
+            fresh_id, instruction_descriptor));
+        copyable_instructions.AddInstruction(
+            GetIRContext()->get_def_use_mgr()->GetDef(fresh_id));
       });
 }
 
@@ -18,7 +18,6 @@
 #include <queue>
 #include <set>
 
-#include "source/fuzz/call_graph.h"
 #include "source/fuzz/instruction_message.h"
 #include "source/fuzz/transformation_add_constant_boolean.h"
 #include "source/fuzz/transformation_add_constant_composite.h"
@@ -45,49 +44,58 @@ FuzzerPassDonateModules::FuzzerPassDonateModules(
     opt::IRContext* ir_context, TransformationContext* transformation_context,
     FuzzerContext* fuzzer_context,
     protobufs::TransformationSequence* transformations,
-    const std::vector<fuzzerutil::ModuleSupplier>& donor_suppliers)
+    std::shared_ptr<DonorModuleCache> donor_module_cache)
     : FuzzerPass(ir_context, transformation_context, fuzzer_context,
                  transformations),
-      donor_suppliers_(donor_suppliers) {}
+      donor_module_cache_(std::move(donor_module_cache)) {}
 
 void FuzzerPassDonateModules::Apply() {
-  // If there are no donor suppliers, this fuzzer pass is a no-op.
-  if (donor_suppliers_.empty()) {
+  // If there are no donors, this fuzzer pass is a no-op.
+  if (!donor_module_cache_ || donor_module_cache_->size() == 0) {
     return;
   }
 
   // Donate at least one module, and probabilistically decide when to stop
   // donating modules.
   do {
-    // Choose a donor supplier at random, and get the module that it provides.
-    std::unique_ptr<opt::IRContext> donor_ir_context = donor_suppliers_.at(
-        GetFuzzerContext()->RandomIndex(donor_suppliers_))();
-    assert(donor_ir_context != nullptr && "Supplying of donor failed");
-    assert(
-        fuzzerutil::IsValid(donor_ir_context.get(),
-                            GetTransformationContext()->GetValidatorOptions(),
-                            fuzzerutil::kSilentMessageConsumer) &&
-        "The donor module must be valid");
-    // Donate the supplied module.
-    //
+    // Choose a donor at random.  The cache validates and summarizes each donor
+    // only once, so all that is needed here is a copy of the donor module.
+    const auto* donor = donor_module_cache_->GetDonor(
+        GetFuzzerContext()->RandomIndex(*donor_module_cache_));
     // Randomly decide whether to make the module livesafe (see
     // FactFunctionIsLivesafe); doing so allows it to be used for live code
     // injection but restricts its behaviour to allow this, and means that its
     // functions cannot be transformed as if they were arbitrary dead code.
+    //
+    // The decision is made even if the donor turns out to be unavailable, so
+    // that the choices made later do not depend on whether it was.
     bool make_livesafe = GetFuzzerContext()->ChoosePercentage(
         GetFuzzerContext()->ChanceOfMakingDonorLivesafe());
-    DonateSingleModule(donor_ir_context.get(), make_livesafe);
+    if (donor == nullptr) {
+      // The supplier failed, or supplied an invalid module; skip the donor.
+      continue;
+    }
+    // Donate the supplied module.
+    std::unique_ptr<opt::IRContext> donor_ir_context = donor->Clone();
+    DonateSingleModule(donor_ir_context.get(), donor->GetSummary(),
+                       make_livesafe);
   } while (GetFuzzerContext()->ChoosePercentage(
       GetFuzzerContext()->GetChanceOfDonatingAdditionalModule()));
 }
 
 void FuzzerPassDonateModules::DonateSingleModule(
     opt::IRContext* donor_ir_context, bool make_livesafe) {
+  DonateSingleModule(donor_ir_context,
+                     DonorModuleSummary::Summarize(donor_ir_context),
+                     make_livesafe);
+}
+
+void FuzzerPassDonateModules::DonateSingleModule(
+    opt::IRContext* donor_ir_context, const DonorModuleSummary& donor_summary,
+    bool make_livesafe) {
   // Check that the donated module has capabilities, supported by the recipient
   // module.
-  for (const auto& capability_inst : donor_ir_context->capabilities()) {
-    auto capability =
-        static_cast<SpvCapability>(capability_inst.GetSingleWordInOperand(0));
+  for (auto capability : donor_summary.capabilities) {
     if (!GetIRContext()->get_feature_mgr()->HasCapability(capability)) {
       return;
     }
@@ -114,8 +122,10 @@ void FuzzerPassDonateModules::DonateSingleModule(
 
   HandleExternalInstructionImports(donor_ir_context,
                                    &original_id_to_donated_id);
-  HandleTypesAndValues(donor_ir_context, &original_id_to_donated_id);
-  HandleFunctions(donor_ir_context, &original_id_to_donated_id, make_livesafe);
+  HandleTypesAndValues(donor_ir_context, donor_summary,
+                       &original_id_to_donated_id);
+  HandleFunctions(donor_ir_context, donor_summary, &original_id_to_donated_id,
+                  make_livesafe);
 
   // TODO(https://github.com/KhronosGroup/SPIRV-Tools/issues/3115) Handle some
   //  kinds of decoration.
@@ -175,10 +185,15 @@ void FuzzerPassDonateModules::HandleExternalInstructionImports(
 }
 
 void FuzzerPassDonateModules::HandleTypesAndValues(
-    opt::IRContext* donor_ir_context,
+    opt::IRContext* donor_ir_context, const DonorModuleSummary& donor_summary,
     std::map<uint32_t, uint32_t>* original_id_to_donated_id) {
-  // Consider every type/global/constant/undef in the module.
+  // Consider every type/global/constant/undef in the module, except those
+  // that relate to images and samplers, which we do not donate.
   for (auto& type_or_value : donor_ir_context->module()->types_values()) {
+    if (donor_summary.undonatable_type_and_value_ids.count(
+            type_or_value.result_id())) {
+      continue;
+    }
     HandleTypeOrValue(type_or_value, original_id_to_donated_id);
   }
 }
@@ -591,14 +606,10 @@ void FuzzerPassDonateModules::HandleTypeOrValue(
 }
 
 void FuzzerPassDonateModules::HandleFunctions(
-    opt::IRContext* donor_ir_context,
+    opt::IRContext* donor_ir_context, const DonorModuleSummary& donor_summary,
     std::map<uint32_t, uint32_t>* original_id_to_donated_id,
     bool make_livesafe) {
-  // Get the ids of functions in the donor module, topologically sorted
-  // according to the donor's call graph.
-  auto topological_order =
-      CallGraph(donor_ir_context).GetFunctionsInTopologicalOrder();
-
+  const auto& topological_order = donor_summary.functions_in_topological_order;
   // Donate the functions in reverse topological order.  This ensures that a
   // function gets donated before any function that depends on it.  This allows
   // donation of the functions to be separated into a number of transformations,
@@ -607,14 +618,11 @@ void FuzzerPassDonateModules::HandleFunctions(
   for (auto function_id = topological_order.rbegin();
        function_id != topological_order.rend(); ++function_id) {
     // Find the function to be donated.
-    opt::Function* function_to_donate = nullptr;
-    for (auto& function : *donor_ir_context->module()) {
-      if (function.result_id() == *function_id) {
-        function_to_donate = &function;
-        break;
-      }
-    }
-    assert(function_to_donate && "Function to be donated was not found.");
+    opt::Function* function_to_donate =
+        &donor_ir_context->module()
+             ->begin()[donor_summary.function_positions.at(*function_id)];
+    assert(function_to_donate->result_id() == *function_id &&
+           "Function to be donated was not found.");
 
     if (!original_id_to_donated_id->count(
             function_to_donate->DefInst().GetSingleWordInOperand(1))) {
@@ -634,14 +642,14 @@ void FuzzerPassDonateModules::HandleFunctions(
 
     // Consider every instruction of the donor function.
     function_to_donate->ForEachInst(
-        [this, &donated_instructions, donor_ir_context,
+        [this, &donated_instructions, donor_ir_context, &donor_summary,
          &original_id_to_donated_id,
          &skipped_instructions](const opt::Instruction* instruction) {
           if (instruction->opcode() == SpvOpArrayLength) {
             // We treat OpArrayLength specially.
             HandleOpArrayLength(*instruction, original_id_to_donated_id,
                                 &donated_instructions);
-          } else if (!CanDonateInstruction(donor_ir_context, *instruction,
+          } else if (!CanDonateInstruction(donor_summary, *instruction,
                                            *original_id_to_donated_id,
                                            skipped_instructions)) {
             // This is an instruction that we cannot directly donate.
@@ -668,7 +676,8 @@ void FuzzerPassDonateModules::HandleFunctions(
 }
 
 bool FuzzerPassDonateModules::CanDonateInstruction(
-    opt::IRContext* donor_ir_context, const opt::Instruction& instruction,
+    const DonorModuleSummary& donor_summary,
+    const opt::Instruction& instruction,
     const std::map<uint32_t, uint32_t>& original_id_to_donated_id,
     const std::set<uint32_t>& skipped_instructions) const {
   if (instruction.type_id() &&
@@ -739,16 +748,10 @@ bool FuzzerPassDonateModules::CanDonateInstruction(
       // donate images.
       return false;
     case SpvOpLoad:
-      switch (donor_ir_context->get_def_use_mgr()
-                  ->GetDef(instruction.type_id())
-                  ->opcode()) {
-        case SpvOpTypeImage:
-        case SpvOpTypeSampledImage:
-        case SpvOpTypeSampler:
-          // Again, we ignore instructions that relate to accessing images.
-          return false;
-        default:
-          break;
+      if (donor_summary.undonatable_type_and_value_ids.count(
+              instruction.type_id())) {
+        // Again, we ignore instructions that relate to accessing images.
+        return false;
       }
     default:
       break;
@@ -758,7 +761,7 @@ bool FuzzerPassDonateModules::CanDonateInstruction(
   // have skipped any of these operands then we cannot donate the instruction.
   bool result = true;
   instruction.WhileEachInId(
-      [donor_ir_context, &original_id_to_donated_id, &result,
+      [&donor_summary, &original_id_to_donated_id, &result,
        &skipped_instructions](const uint32_t* in_id) -> bool {
         if (!original_id_to_donated_id.count(*in_id)) {
           // We do not have a mapped result id for this id operand.  That either
@@ -769,7 +772,7 @@ bool FuzzerPassDonateModules::CanDonateInstruction(
           if (skipped_instructions.count(*in_id) ||
               // A function or global value does not have an associated basic
               // block.
-              !donor_ir_context->get_instr_block(*in_id)) {
+              !donor_summary.ids_defined_in_blocks.count(*in_id)) {
             result = false;
             return false;
           }
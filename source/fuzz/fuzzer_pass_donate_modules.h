@@ -15,8 +15,10 @@
 #ifndef SOURCE_FUZZ_FUZZER_PASS_DONATE_MODULES_H_
 #define SOURCE_FUZZ_FUZZER_PASS_DONATE_MODULES_H_
 
+#include <memory>
 #include <vector>
 
+#include "source/fuzz/donor_module_cache.h"
 #include "source/fuzz/fuzzer_pass.h"
 #include "source/fuzz/fuzzer_util.h"
 
@@ -31,7 +33,7 @@ class FuzzerPassDonateModules : public FuzzerPass {
       opt::IRContext* ir_context, TransformationContext* transformation_context,
       FuzzerContext* fuzzer_context,
       protobufs::TransformationSequence* transformations,
-      const std::vector<fuzzerutil::ModuleSupplier>& donor_suppliers);
+      std::shared_ptr<DonorModuleCache> donor_module_cache);
 
   void Apply() override;
 
@@ -41,6 +43,11 @@ class FuzzerPassDonateModules : public FuzzerPass {
   // FactFunctionIsLivesafe).
   void DonateSingleModule(opt::IRContext* donor_ir_context, bool make_livesafe);
 
+  // As above, where |donor_summary| is the summary of |donor_ir_context|.
+  void DonateSingleModule(opt::IRContext* donor_ir_context,
+                          const DonorModuleSummary& donor_summary,
+                          bool make_livesafe);
+
  private:
   // Adapts a storage class coming from a donor module so that it will work
   // in a recipient module, e.g. by changing Uniform to Private.
@@ -54,14 +61,16 @@ class FuzzerPassDonateModules : public FuzzerPass {
       opt::IRContext* donor_ir_context,
       std::map<uint32_t, uint32_t>* original_id_to_donated_id);
 
-  // Considers all types, globals, constants and undefs in |donor_ir_context|.
-  // For each instruction, uses |original_to_donated_id| to map its result id to
+  // Considers all types, globals, constants and undefs in |donor_ir_context|,
+  // skipping those that |donor_summary| records as undonatable.  For each
+  // instruction, uses |original_to_donated_id| to map its result id to
   // either (1) the id of an existing identical instruction in the recipient, or
   // (2) to a fresh id, in which case the instruction is also added to the
   // recipient (with any operand ids that it uses being remapped via
   // |original_id_to_donated_id|).
   void HandleTypesAndValues(
       opt::IRContext* donor_ir_context,
+      const DonorModuleSummary& donor_summary,
       std::map<uint32_t, uint32_t>* original_id_to_donated_id);
 
   // Helper method for HandleTypesAndValues, to handle a single type/value.
@@ -70,23 +79,26 @@ class FuzzerPassDonateModules : public FuzzerPass {
       std::map<uint32_t, uint32_t>* original_id_to_donated_id);
 
   // Assumes that |donor_ir_context| does not exhibit recursion.  Considers the
-  // functions in |donor_ir_context|'s call graph in a reverse-topologically-
-  // sorted order (leaves-to-root), adding each function to the recipient
-  // module, rewritten to use fresh ids and using |original_id_to_donated_id| to
-  // remap ids.  The |make_livesafe| argument captures whether the functions in
-  // the module are required to be made livesafe before being added to the
-  // recipient.
-  void HandleFunctions(opt::IRContext* donor_ir_context,
-                       std::map<uint32_t, uint32_t>* original_id_to_donated_id,
-                       bool make_livesafe);
+  // functions in |donor_ir_context|'s call graph in the reverse (leaves-to-
+  // root) of the topological order recorded in |donor_summary|, adding each
+  // function to the recipient module, rewritten to use fresh ids and using
+  // |original_id_to_donated_id| to remap ids.  The |make_livesafe| argument
+  // captures whether the functions in the module are required to be made
+  // livesafe before being added to the recipient.
+  void HandleFunctions(
+      opt::IRContext* donor_ir_context,
+      const DonorModuleSummary& donor_summary,
+      std::map<uint32_t, uint32_t>* original_id_to_donated_id,
+      bool make_livesafe);
 
   // During donation we will have to ignore some instructions, e.g. because they
   // use opcodes that we cannot support or because they reference the ids of
   // instructions that have not been donated.  This function encapsulates the
-  // logic for deciding which whether instruction |instruction| from
-  // |donor_ir_context| can be donated.
+  // logic for deciding which whether instruction |instruction| from the donor
+  // summarized by |donor_summary| can be donated.
   bool CanDonateInstruction(
-      opt::IRContext* donor_ir_context, const opt::Instruction& instruction,
+      const DonorModuleSummary& donor_summary,
+      const opt::Instruction& instruction,
       const std::map<uint32_t, uint32_t>& original_id_to_donated_id,
       const std::set<uint32_t>& skipped_instructions) const;
 
@@ -152,8 +164,8 @@ class FuzzerPassDonateModules : public FuzzerPass {
   // array or struct; i.e. it is not an opaque type.
   bool IsBasicType(const opt::Instruction& instruction) const;
 
-  // Functions that supply SPIR-V modules
-  std::vector<fuzzerutil::ModuleSupplier> donor_suppliers_;
+  // Supplies the SPIR-V modules to be donated; may be null if there are none.
+  std::shared_ptr<DonorModuleCache> donor_module_cache_;
 };
 
 }  // namespace fuzz
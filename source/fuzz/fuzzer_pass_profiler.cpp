@@ -0,0 +1,190 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/fuzzer_pass_profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <locale>
+#include <map>
+#include <sstream>
+
+#include "source/fuzz/fuzzer_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+// The invocations of a single fuzzer pass, aggregated.
+struct PassSummary {
+  std::string pass_name;
+  bool is_final_pass;
+  uint32_t invocations;
+  double seconds;
+  uint64_t transformations_applied;
+  int64_t id_bound_growth;
+  int64_t instruction_count_growth;
+};
+
+// Returns |count| / |seconds|, or 0 if |seconds| is 0.
+double PerSecond(uint64_t count, double seconds) {
+  return seconds > 0 ? static_cast<double>(count) / seconds : 0;
+}
+
+}  // namespace
+
+FuzzerPassProfiler::FuzzerPassProfiler()
+    : pass_start_num_transformations_(0),
+      pass_start_id_bound_(0),
+      pass_start_instruction_count_(0),
+      pass_selection_seconds_(0),
+      num_pass_selections_(0),
+      run_seconds_(0),
+      num_runs_(0) {}
+
+FuzzerPassProfiler::~FuzzerPassProfiler() = default;
+
+void FuzzerPassProfiler::BeginPass(
+    opt::IRContext* ir_context,
+    const protobufs::TransformationSequence& transformations) {
+  pass_start_num_transformations_ =
+      static_cast<uint32_t>(transformations.transformation_size());
+  pass_start_id_bound_ = ir_context->module()->id_bound();
+  pass_start_instruction_count_ =
+      fuzzerutil::GetNumberOfInstructions(ir_context);
+  // The clock is read last so that measuring the module is not included in
+  // the time taken by the pass.
+  pass_start_time_ = std::chrono::steady_clock::now();
+}
+
+void FuzzerPassProfiler::EndPass(
+    const std::string& pass_name, bool is_final_pass,
+    opt::IRContext* ir_context,
+    const protobufs::TransformationSequence& transformations) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - pass_start_time_;
+  const auto num_transformations =
+      static_cast<uint32_t>(transformations.transformation_size());
+  assert(num_transformations >= pass_start_num_transformations_ &&
+         "Number of transformations cannot decrease");
+  pass_invocations_.push_back(
+      {pass_name, is_final_pass, elapsed.count(),
+       num_transformations - pass_start_num_transformations_,
+       pass_start_id_bound_, ir_context->module()->id_bound(),
+       pass_start_instruction_count_,
+       fuzzerutil::GetNumberOfInstructions(ir_context)});
+}
+
+void FuzzerPassProfiler::RecordPassSelection(double seconds) {
+  pass_selection_seconds_ += seconds;
+  num_pass_selections_++;
+}
+
+void FuzzerPassProfiler::RecordRun(double seconds) {
+  run_seconds_ += seconds;
+  num_runs_++;
+}
+
+std::string FuzzerPassProfiler::ToJson(bool include_invocations) const {
+  std::map<std::string, PassSummary> summary_by_name;
+  uint64_t total_transformations = 0;
+  for (const auto& invocation : pass_invocations_) {
+    auto& summary = summary_by_name
+                        .emplace(invocation.pass_name,
+                                 PassSummary{invocation.pass_name,
+                                             invocation.is_final_pass, 0, 0, 0,
+                                             0, 0})
+                        .first->second;
+    summary.invocations++;
+    summary.seconds += invocation.seconds;
+    summary.transformations_applied += invocation.transformations_applied;
+    summary.id_bound_growth += static_cast<int64_t>(invocation.id_bound_after) -
+                               invocation.id_bound_before;
+    summary.instruction_count_growth +=
+        static_cast<int64_t>(invocation.instruction_count_after) -
+        invocation.instruction_count_before;
+    total_transformations += invocation.transformations_applied;
+  }
+
+  std::vector<PassSummary> summaries;
+  for (const auto& entry : summary_by_name) {
+    summaries.push_back(entry.second);
+  }
+  std::stable_sort(summaries.begin(), summaries.end(),
+                   [](const PassSummary& first, const PassSummary& second) {
+                     return first.seconds > second.seconds;
+                   });
+
+  // Pass names are identifiers, so need no escaping.
+  std::ostringstream out;
+  out.imbue(std::locale::classic());
+  out << std::fixed << std::setprecision(6);
+  out << "{\n";
+  out << "  \"runs\": " << num_runs_ << ",\n";
+  out << "  \"run_seconds\": " << run_seconds_ << ",\n";
+  out << "  \"transformations_applied\": " << total_transformations << ",\n";
+  out << "  \"transformations_per_second\": "
+      << PerSecond(total_transformations, run_seconds_) << ",\n";
+  out << "  \"pass_selections\": " << num_pass_selections_ << ",\n";
+  out << "  \"pass_selection_seconds\": " << pass_selection_seconds_ << ",\n";
+  out << "  \"passes\": [";
+  for (size_t i = 0; i < summaries.size(); i++) {
+    const auto& summary = summaries[i];
+    out << (i == 0 ? "\n" : ",\n");
+    out << "    {\"name\": \"" << summary.pass_name << "\", \"final\": "
+        << (summary.is_final_pass ? "true" : "false")
+        << ", \"invocations\": " << summary.invocations
+        << ", \"seconds\": " << summary.seconds
+        << ", \"transformations_applied\": " << summary.transformations_applied
+        << ", \"transformations_per_second\": "
+        << PerSecond(summary.transformations_applied, summary.seconds)
+        << ", \"id_bound_growth\": " << summary.id_bound_growth
+        << ", \"instruction_count_growth\": "
+        << summary.instruction_count_growth << "}";
+  }
+  out << (summaries.empty() ? "]" : "\n  ]");
+  if (include_invocations) {
+    out << ",\n  \"invocations\": [";
+    for (size_t i = 0; i < pass_invocations_.size(); i++) {
+      const auto& invocation = pass_invocations_[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    {\"name\": \"" << invocation.pass_name << "\", \"final\": "
+          << (invocation.is_final_pass ? "true" : "false")
+          << ", \"seconds\": " << invocation.seconds
+          << ", \"transformations_applied\": "
+          << invocation.transformations_applied
+          << ", \"id_bound_before\": " << invocation.id_bound_before
+          << ", \"id_bound_after\": " << invocation.id_bound_after
+          << ", \"instruction_count_before\": "
+          << invocation.instruction_count_before
+          << ", \"instruction_count_after\": "
+          << invocation.instruction_count_after << "}";
+    }
+    out << (pass_invocations_.empty() ? "]" : "\n  ]");
+  }
+  out << "\n}\n";
+  return out.str();
+}
+
+void FuzzerPassProfiler::Clear() {
+  pass_invocations_.clear();
+  pass_selection_seconds_ = 0;
+  num_pass_selections_ = 0;
+  run_seconds_ = 0;
+  num_runs_ = 0;
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
@@ -0,0 +1,139 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_FUZZER_PASS_PROFILER_H_
+#define SOURCE_FUZZ_FUZZER_PASS_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+#include "source/opt/ir_context.h"
+
+namespace spvtools {
+namespace fuzz {
+
+// Records the cost of each fuzzer pass invocation made by a Fuzzer: how long
+// the pass took, how many transformations it applied and how much it grew the
+// module.  The time spent by the repeated pass manager choosing passes is
+// recorded separately.  The records can be emitted as a JSON report, which is
+// intended to guide the tuning of the probabilities in FuzzerContext.
+//
+// Measuring the size of the module requires a traversal of the module, so
+// that profiling slows fuzzing down somewhat; a Fuzzer that has no profiler
+// does not pay this cost.
+class FuzzerPassProfiler {
+ public:
+  // The cost of a single invocation of a fuzzer pass.
+  struct PassInvocation {
+    // The name of the pass, without the "FuzzerPass" prefix.
+    std::string pass_name;
+
+    // True if the pass is a final pass, false if it is a repeated pass.
+    bool is_final_pass;
+
+    // The time taken by the pass, excluding any validation performed after it.
+    double seconds;
+
+    // The number of transformations applied by the pass.
+    uint32_t transformations_applied;
+
+    // The id bound of the module before and after the pass.
+    uint32_t id_bound_before;
+    uint32_t id_bound_after;
+
+    // The number of instructions in the module before and after the pass.
+    uint32_t instruction_count_before;
+    uint32_t instruction_count_after;
+  };
+
+  FuzzerPassProfiler();
+
+  // Disables copy/move constructor/assignment operations.
+  FuzzerPassProfiler(const FuzzerPassProfiler&) = delete;
+  FuzzerPassProfiler(FuzzerPassProfiler&&) = delete;
+  FuzzerPassProfiler& operator=(const FuzzerPassProfiler&) = delete;
+  FuzzerPassProfiler& operator=(FuzzerPassProfiler&&) = delete;
+
+  ~FuzzerPassProfiler();
+
+  // Must be called immediately before a fuzzer pass is applied to
+  // |ir_context|, with |transformations| being the sequence to which the pass
+  // appends the transformations it applies.
+  void BeginPass(opt::IRContext* ir_context,
+                 const protobufs::TransformationSequence& transformations);
+
+  // Must be called immediately after the fuzzer pass called |pass_name| has
+  // been applied, with the same arguments as the preceding call to BeginPass.
+  // Records an invocation of the pass.
+  void EndPass(const std::string& pass_name, bool is_final_pass,
+               opt::IRContext* ir_context,
+               const protobufs::TransformationSequence& transformations);
+
+  // Records that the repeated pass manager took |seconds| to choose a pass.
+  void RecordPassSelection(double seconds);
+
+  // Records that a run of the fuzzer took |seconds| in total.
+  void RecordRun(double seconds);
+
+  // Returns every pass invocation recorded so far, in order.
+  const std::vector<PassInvocation>& GetPassInvocations() const {
+    return pass_invocations_;
+  }
+
+  // Returns the total time spent choosing repeated passes.
+  double GetPassSelectionSeconds() const { return pass_selection_seconds_; }
+
+  // Returns the number of repeated passes that have been chosen.
+  uint32_t GetNumPassSelections() const { return num_pass_selections_; }
+
+  // Returns the total time of all recorded runs of the fuzzer.
+  double GetRunSeconds() const { return run_seconds_; }
+
+  // Returns the number of recorded runs of the fuzzer.
+  uint32_t GetNumRuns() const { return num_runs_; }
+
+  // Returns a JSON object summarizing the records.  The "passes" member has
+  // an entry per fuzzer pass, aggregating its invocations, sorted so that the
+  // most expensive passes come first; the "invocations" member lists every
+  // invocation in order if |include_invocations| holds.
+  std::string ToJson(bool include_invocations) const;
+
+  // Discards all records.
+  void Clear();
+
+ private:
+  // The time at which the pass in progress, if any, began.
+  std::chrono::steady_clock::time_point pass_start_time_;
+
+  // The size of the module when the pass in progress began.
+  uint32_t pass_start_num_transformations_;
+  uint32_t pass_start_id_bound_;
+  uint32_t pass_start_instruction_count_;
+
+  std::vector<PassInvocation> pass_invocations_;
+
+  double pass_selection_seconds_;
+  uint32_t num_pass_selections_;
+
+  double run_seconds_;
+  uint32_t num_runs_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_FUZZER_PASS_PROFILER_H_
@@ -475,6 +475,10 @@ bool IsValidAndWellFormed(const opt::IRContext* ir_context,
              "Module is invalid (set a breakpoint to inspect).");
     return false;
   }
+  return IsWellFormed(ir_context, std::move(consumer));
+}
+
+bool IsWellFormed(const opt::IRContext* ir_context, MessageConsumer consumer) {
   // Check that all blocks in the module have appropriate parent functions.
   for (auto& function : *ir_context->module()) {
     for (auto& block : function) {
@@ -516,10 +520,15 @@ bool IsValidAndWellFormed(const opt::IRContext* ir_context,
 }
 
 std::unique_ptr<opt::IRContext> CloneIRContext(opt::IRContext* context) {
-  std::vector<uint32_t> binary;
-  context->module()->ToBinary(&binary, false);
-  return BuildModule(context->grammar().target_env(), nullptr, binary.data(),
-                     binary.size());
+  return context->Clone();
+}
+
+uint32_t GetNumberOfInstructions(const opt::IRContext* ir_context) {
+  uint32_t result = 0;
+  const opt::Module* module = ir_context->module();
+  module->ForEachInst(
+      [&result](const opt::Instruction* /*unused*/) { result++; });
+  return result;
 }
 
 bool IsNonFunctionTypeId(opt::IRContext* ir_context, uint32_t id) {
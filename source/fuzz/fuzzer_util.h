@@ -183,10 +183,19 @@ bool IsValidAndWellFormed(const opt::IRContext* context,
                           spv_validator_options validator_options,
                           MessageConsumer consumer);
 
-// Returns a clone of |context|, by writing |context| to a binary and then
-// parsing it again.
+// Returns true if and only if every basic block in |context| has its enclosing
+// function as its parent, and every instruction in |context| has a distinct
+// unique id.  Unlike IsValidAndWellFormed, this does not invoke the validator.
+// |consumer| is used for error reporting.
+bool IsWellFormed(const opt::IRContext* context, MessageConsumer consumer);
+
+// Returns a clone of |context|; see opt::IRContext::Clone.
 std::unique_ptr<opt::IRContext> CloneIRContext(opt::IRContext* context);
 
+// Returns the number of instructions in the module of |ir_context|, excluding
+// debug line instructions.  Takes time linear in the size of the module.
+uint32_t GetNumberOfInstructions(const opt::IRContext* ir_context);
+
 // Returns true if and only if |id| is the id of a type that is not a function
 // type.
 bool IsNonFunctionTypeId(opt::IRContext* ir_context, uint32_t id);
@@ -0,0 +1,512 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/incremental_validator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+#include "source/opcode.h"
+#include "source/spirv_constant.h"
+#include "source/util/make_unique.h"
+
+namespace spvtools {
+namespace fuzz {
+
+namespace {
+
+// Returns the opcode of the instruction that starts at |offset| in |binary|.
+SpvOp OpcodeAt(const std::vector<uint32_t>& binary, size_t offset) {
+  return static_cast<SpvOp>(binary[offset] & 0xFFFF);
+}
+
+// Returns the number of words of the instruction that starts at |offset| in
+// |binary|.
+size_t WordCountAt(const std::vector<uint32_t>& binary, size_t offset) {
+  return binary[offset] >> 16;
+}
+
+// Returns true if and only if |opcode| is a debug or annotation instruction
+// whose first operand is the id of the target that it names or decorates.
+bool IsNameOrDecorationOfId(SpvOp opcode) {
+  switch (opcode) {
+    case SpvOpName:
+    case SpvOpMemberName:
+    case SpvOpDecorate:
+    case SpvOpDecorateId:
+    case SpvOpDecorateString:
+    case SpvOpMemberDecorate:
+    case SpvOpMemberDecorateString:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the result id of the instruction that starts at |offset| in
+// |binary|, or 0 if it does not have one.
+uint32_t ResultIdAt(const AssemblyGrammar& grammar,
+                    const std::vector<uint32_t>& binary, size_t offset) {
+  spv_opcode_desc opcode_desc;
+  if (grammar.lookupOpcode(OpcodeAt(binary, offset), &opcode_desc) !=
+          SPV_SUCCESS ||
+      !opcode_desc->hasResult) {
+    return 0;
+  }
+  return binary[offset + (opcode_desc->hasType ? 2 : 1)];
+}
+
+}  // namespace
+
+IncrementalValidator::IncrementalValidator(
+    spv_validator_options validator_options, MessageConsumer consumer)
+    : validator_options_(validator_options),
+      consumer_(std::move(consumer)),
+      target_env_(SPV_ENV_UNIVERSAL_1_0),
+      tools_(nullptr),
+      quiet_tools_(nullptr),
+      num_functions_validated_by_last_check_(0) {}
+
+IncrementalValidator::~IncrementalValidator() = default;
+
+bool IncrementalValidator::IsValid(opt::IRContext* ir_context) {
+  auto current = TakeSnapshot(ir_context);
+  auto target_env = ir_context->grammar().target_env();
+
+  // Try incremental validation first.  Errors are not reported at this stage:
+  // if the reduced module turns out to be invalid then the module is
+  // validated in full, which determines the result and yields error messages
+  // about the module itself.
+  num_functions_validated_by_last_check_ = 0;
+  std::vector<uint32_t> reduced_binary;
+  size_t num_functions_kept = 0;
+  bool is_valid = false;
+  if (last_valid_module_ &&
+      BuildReducedBinary(*current, &reduced_binary, &num_functions_kept)) {
+    num_functions_validated_by_last_check_ += num_functions_kept;
+    is_valid = ValidateBinary(target_env, reduced_binary, false);
+  }
+  if (!is_valid) {
+    for (const auto& summary : current->function_summaries) {
+      if (summary->entry_block_id) {
+        num_functions_validated_by_last_check_++;
+      }
+    }
+    is_valid = ValidateBinary(target_env, current->binary, true);
+  }
+  if (is_valid) {
+    last_valid_module_ = std::move(current);
+  }
+  return is_valid;
+}
+
+void IncrementalValidator::SetLastValidModule(opt::IRContext* ir_context) {
+  last_valid_module_ = TakeSnapshot(ir_context);
+}
+
+const std::vector<uint32_t>& IncrementalValidator::GetLastValidBinary() const {
+  assert(last_valid_module_ && "There is no valid module.");
+  return last_valid_module_->binary;
+}
+
+std::unique_ptr<IncrementalValidator::ModuleSnapshot>
+IncrementalValidator::TakeSnapshot(opt::IRContext* ir_context) const {
+  auto result = MakeUnique<ModuleSnapshot>();
+  ir_context->module()->ToBinary(&result->binary, false);
+  const auto& binary = result->binary;
+  const auto& grammar = ir_context->grammar();
+
+  // Split the binary into functions and the remaining instructions.  Line
+  // instructions that immediately precede a function are considered to be
+  // part of that function.
+  size_t line_instructions_start = SPV_INDEX_INSTRUCTION;
+  size_t function_start = 0;
+  bool in_function = false;
+  for (size_t offset = SPV_INDEX_INSTRUCTION; offset < binary.size();) {
+    auto opcode = OpcodeAt(binary, offset);
+    auto word_count = WordCountAt(binary, offset);
+    assert(word_count > 0 && offset + word_count <= binary.size() &&
+           "Malformed binary.");
+    if (in_function) {
+      if (opcode == SpvOpFunctionEnd) {
+        result->functions.push_back(
+            {function_start, offset + word_count - function_start});
+        in_function = false;
+        line_instructions_start = offset + word_count;
+      }
+    } else if (opcode == SpvOpFunction) {
+      result->function_index[binary[offset + 2]] =
+          result->function_ids.size();
+      result->function_ids.push_back(binary[offset + 2]);
+      function_start = line_instructions_start;
+      in_function = true;
+    } else if (opcode != SpvOpLine && opcode != SpvOpNoLine) {
+      // Line instructions that were held back turned out not to precede a
+      // function.
+      for (size_t line_offset = line_instructions_start; line_offset < offset;
+           line_offset += WordCountAt(binary, line_offset)) {
+        result->global_instructions.push_back(
+            {line_offset, WordCountAt(binary, line_offset)});
+      }
+      result->global_instructions.push_back({offset, word_count});
+      if (auto result_id = ResultIdAt(grammar, binary, offset)) {
+        result->global_ids.push_back(result_id);
+      }
+      line_instructions_start = offset + word_count;
+    }
+    offset += word_count;
+  }
+  for (size_t line_offset = line_instructions_start;
+       line_offset < binary.size();
+       line_offset += WordCountAt(binary, line_offset)) {
+    result->global_instructions.push_back(
+        {line_offset, WordCountAt(binary, line_offset)});
+  }
+  assert(!in_function && "Unterminated function.");
+
+  // Summarize the functions, reusing the summaries of those that have not
+  // changed since the last valid module.
+  for (size_t i = 0; i < result->function_ids.size(); i++) {
+    if (last_valid_module_) {
+      const ModuleSnapshot& last = *last_valid_module_;
+      auto last_function = last.function_index.find(result->function_ids[i]);
+      if (last_function != last.function_index.end() &&
+          SameWords(*result, result->functions[i], last,
+                    last.functions[last_function->second])) {
+        result->function_summaries.push_back(
+            last.function_summaries[last_function->second]);
+        continue;
+      }
+    }
+    result->function_summaries.push_back(
+        SummarizeFunction(grammar, binary, result->functions[i]));
+  }
+  return result;
+}
+
+std::shared_ptr<const IncrementalValidator::FunctionSummary>
+IncrementalValidator::SummarizeFunction(const AssemblyGrammar& grammar,
+                                        const std::vector<uint32_t>& binary,
+                                        const WordRange& function) {
+  auto result = std::make_shared<FunctionSummary>();
+  result->entry_block_id = 0;
+  for (size_t offset = function.offset;
+       offset < function.offset + function.num_words;
+       offset += WordCountAt(binary, offset)) {
+    auto opcode = OpcodeAt(binary, offset);
+    switch (opcode) {
+      case SpvOpLine:
+      case SpvOpNoLine:
+        break;
+      case SpvOpFunction:
+        result->header_words.insert(
+            result->header_words.end(), binary.begin() + offset,
+            binary.begin() + offset + WordCountAt(binary, offset));
+        break;
+      case SpvOpFunctionParameter:
+        result->header_words.insert(
+            result->header_words.end(), binary.begin() + offset,
+            binary.begin() + offset + WordCountAt(binary, offset));
+        result->parameter_ids.push_back(binary[offset + 2]);
+        break;
+      case SpvOpLabel:
+        if (!result->entry_block_id) {
+          result->entry_block_id = binary[offset + 1];
+        }
+        result->body_ids.push_back(binary[offset + 1]);
+        break;
+      case SpvOpFunctionCall:
+        // The operands of OpFunctionCall are its result type, result id and
+        // called function.
+        result->callees.insert(binary[offset + 3]);
+        result->body_ids.push_back(binary[offset + 2]);
+        break;
+      default:
+        if (auto result_id = ResultIdAt(grammar, binary, offset)) {
+          result->body_ids.push_back(result_id);
+        }
+        break;
+    }
+  }
+  return result;
+}
+
+bool IncrementalValidator::SameWords(const ModuleSnapshot& snapshot1,
+                                     const WordRange& range1,
+                                     const ModuleSnapshot& snapshot2,
+                                     const WordRange& range2) {
+  if (range1.num_words != range2.num_words) {
+    return false;
+  }
+  auto begin1 = snapshot1.binary.begin() + range1.offset;
+  auto begin2 = snapshot2.binary.begin() + range2.offset;
+  return std::equal(begin1, begin1 + range1.num_words, begin2);
+}
+
+bool IncrementalValidator::BuildReducedBinary(
+    const ModuleSnapshot& current, std::vector<uint32_t>* reduced_binary,
+    size_t* num_functions_kept) const {
+  const ModuleSnapshot& last = *last_valid_module_;
+
+  // The instructions that are not part of functions must be those of the last
+  // valid module, with some new instructions inserted.
+  std::vector<WordRange> inserted_global_instructions;
+  size_t last_index = 0;
+  for (const auto& range : current.global_instructions) {
+    if (last_index < last.global_instructions.size() &&
+        SameWords(current, range, last,
+                  last.global_instructions[last_index])) {
+      last_index++;
+    } else {
+      inserted_global_instructions.push_back(range);
+    }
+  }
+  if (last_index != last.global_instructions.size()) {
+    return false;
+  }
+
+  // Every function of the last valid module must still be present, in the
+  // same relative order.  Record which functions are new or have changed,
+  // and which functions are called from new call sites.  A function is
+  // unchanged exactly when it shares its summary with the last valid module.
+  std::unordered_set<uint32_t> changed_functions;
+  std::vector<uint32_t> newly_called_functions;
+  size_t num_matched_functions = 0;
+  size_t next_last_index = 0;
+  for (size_t i = 0; i < current.function_ids.size(); i++) {
+    auto function_id = current.function_ids[i];
+    const auto& summary = current.function_summaries[i];
+    auto last_function = last.function_index.find(function_id);
+    if (last_function == last.function_index.end()) {
+      changed_functions.insert(function_id);
+      newly_called_functions.insert(newly_called_functions.end(),
+                                    summary->callees.begin(),
+                                    summary->callees.end());
+      continue;
+    }
+    if (last_function->second < next_last_index) {
+      return false;
+    }
+    next_last_index = last_function->second + 1;
+    num_matched_functions++;
+    const auto& last_summary = last.function_summaries[last_function->second];
+    if (summary != last_summary) {
+      changed_functions.insert(function_id);
+      for (auto callee : summary->callees) {
+        if (last_summary->callees.count(callee) == 0) {
+          newly_called_functions.push_back(callee);
+        }
+      }
+    }
+  }
+  if (num_matched_functions != last.function_ids.size()) {
+    return false;
+  }
+
+  // Record the function in which each id is defined, and check that no id is
+  // defined twice: hiding the body of a function could otherwise hide a
+  // duplicate definition.
+  std::unordered_map<uint32_t, uint32_t> function_defining_id;
+  std::unordered_set<uint32_t> defined_ids(current.global_ids.begin(),
+                                           current.global_ids.end());
+  if (defined_ids.size() != current.global_ids.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < current.function_ids.size(); i++) {
+    auto function_id = current.function_ids[i];
+    const auto& summary = *current.function_summaries[i];
+    if (!defined_ids.insert(function_id).second) {
+      return false;
+    }
+    for (const auto* ids : {&summary.parameter_ids, &summary.body_ids}) {
+      for (auto id : *ids) {
+        if (!defined_ids.insert(id).second) {
+          return false;
+        }
+        function_defining_id[id] = function_id;
+      }
+    }
+  }
+
+  // New instructions outside functions are acceptable if they are types,
+  // constants or global variables, which cannot affect existing functions, or
+  // if they name or decorate new ids or ids of functions that will be
+  // validated.
+  std::unordered_set<uint32_t> new_global_ids;
+  for (const auto& range : inserted_global_instructions) {
+    auto opcode = OpcodeAt(current.binary, range.offset);
+    if (spvOpcodeGeneratesType(opcode)) {
+      new_global_ids.insert(current.binary[range.offset + 1]);
+    } else if (spvOpcodeIsConstant(opcode) || opcode == SpvOpVariable ||
+               opcode == SpvOpUndef) {
+      new_global_ids.insert(current.binary[range.offset + 2]);
+    } else if (!IsNameOrDecorationOfId(opcode)) {
+      return false;
+    }
+  }
+  for (const auto& range : inserted_global_instructions) {
+    auto opcode = OpcodeAt(current.binary, range.offset);
+    if (!IsNameOrDecorationOfId(opcode)) {
+      continue;
+    }
+    auto target = current.binary[range.offset + 1];
+    if (new_global_ids.count(target)) {
+      continue;
+    }
+    if (current.function_index.count(target)) {
+      changed_functions.insert(target);
+    } else if (function_defining_id.count(target)) {
+      changed_functions.insert(function_defining_id.at(target));
+    } else {
+      return false;
+    }
+  }
+
+  // Keep the changed functions, the functions they (transitively) newly call,
+  // and all of their transitive callers, so that every entry point reaching a
+  // changed function still reaches it.
+  std::unordered_set<uint32_t> functions_to_keep = changed_functions;
+  std::vector<uint32_t> worklist = newly_called_functions;
+  std::unordered_set<uint32_t> visited;
+  while (!worklist.empty()) {
+    auto function_id = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(function_id).second ||
+        !current.function_index.count(function_id)) {
+      continue;
+    }
+    functions_to_keep.insert(function_id);
+    for (auto callee :
+         current.function_summaries[current.function_index.at(function_id)]
+             ->callees) {
+      worklist.push_back(callee);
+    }
+  }
+  std::unordered_map<uint32_t, std::vector<uint32_t>> callers;
+  for (size_t i = 0; i < current.function_ids.size(); i++) {
+    for (auto callee : current.function_summaries[i]->callees) {
+      callers[callee].push_back(current.function_ids[i]);
+    }
+  }
+  worklist.assign(changed_functions.begin(), changed_functions.end());
+  visited.clear();
+  while (!worklist.empty()) {
+    auto function_id = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(function_id).second) {
+      continue;
+    }
+    functions_to_keep.insert(function_id);
+    for (auto caller : callers[function_id]) {
+      worklist.push_back(caller);
+    }
+  }
+
+  // Determine the ids whose definitions disappear when the bodies of the
+  // remaining functions are hidden.  The entry block label of each such
+  // function is retained.
+  std::unordered_set<uint32_t> hidden_ids;
+  bool hides_some_function = false;
+  *num_functions_kept = 0;
+  for (size_t i = 0; i < current.function_ids.size(); i++) {
+    const auto& summary = *current.function_summaries[i];
+    if (!summary.entry_block_id) {
+      continue;
+    }
+    if (functions_to_keep.count(current.function_ids[i])) {
+      ++*num_functions_kept;
+      continue;
+    }
+    hides_some_function = true;
+    for (auto id : summary.body_ids) {
+      if (id != summary.entry_block_id) {
+        hidden_ids.insert(id);
+      }
+    }
+  }
+  if (!hides_some_function) {
+    return false;
+  }
+
+  // Emit the reduced module: the header, the instructions outside functions
+  // other than names and decorations of hidden ids, and the functions, with
+  // the bodies of those that are not kept replaced by an unreachable block.
+  reduced_binary->assign(current.binary.begin(),
+                         current.binary.begin() + SPV_INDEX_INSTRUCTION);
+  size_t global_index = 0;
+  for (size_t function_index = 0;
+       function_index <= current.function_ids.size(); function_index++) {
+    size_t end = function_index < current.function_ids.size()
+                     ? current.functions[function_index].offset
+                     : current.binary.size();
+    for (; global_index < current.global_instructions.size() &&
+           current.global_instructions[global_index].offset < end;
+         global_index++) {
+      const auto& range = current.global_instructions[global_index];
+      auto opcode = OpcodeAt(current.binary, range.offset);
+      if (IsNameOrDecorationOfId(opcode) &&
+          hidden_ids.count(current.binary[range.offset + 1])) {
+        continue;
+      }
+      if (opcode == SpvOpGroupDecorate) {
+        for (size_t i = 2; i < range.num_words; i++) {
+          if (hidden_ids.count(current.binary[range.offset + i])) {
+            return false;
+          }
+        }
+      }
+      reduced_binary->insert(
+          reduced_binary->end(), current.binary.begin() + range.offset,
+          current.binary.begin() + range.offset + range.num_words);
+    }
+    if (function_index == current.function_ids.size()) {
+      break;
+    }
+    const auto& summary = *current.function_summaries[function_index];
+    if (functions_to_keep.count(current.function_ids[function_index]) ||
+        !summary.entry_block_id) {
+      const auto& range = current.functions[function_index];
+      reduced_binary->insert(
+          reduced_binary->end(), current.binary.begin() + range.offset,
+          current.binary.begin() + range.offset + range.num_words);
+      continue;
+    }
+    reduced_binary->insert(reduced_binary->end(), summary.header_words.begin(),
+                           summary.header_words.end());
+    reduced_binary->push_back((2u << 16) | SpvOpLabel);
+    reduced_binary->push_back(summary.entry_block_id);
+    reduced_binary->push_back((1u << 16) | SpvOpUnreachable);
+    reduced_binary->push_back((1u << 16) | SpvOpFunctionEnd);
+  }
+  return true;
+}
+
+bool IncrementalValidator::ValidateBinary(spv_target_env target_env,
+                                          const std::vector<uint32_t>& binary,
+                                          bool report_errors) {
+  if (!tools_ || target_env != target_env_) {
+    target_env_ = target_env;
+    tools_ = MakeUnique<SpirvTools>(target_env);
+    if (consumer_) {
+      tools_->SetMessageConsumer(consumer_);
+    }
+    quiet_tools_ = MakeUnique<SpirvTools>(target_env);
+  }
+  SpirvTools* tools = report_errors ? tools_.get() : quiet_tools_.get();
+  return tools->Validate(binary.data(), binary.size(), validator_options_);
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
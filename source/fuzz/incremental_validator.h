@@ -0,0 +1,192 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_INCREMENTAL_VALIDATOR_H_
+#define SOURCE_FUZZ_INCREMENTAL_VALIDATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source/assembly_grammar.h"
+#include "source/opt/ir_context.h"
+#include "spirv-tools/libspirv.hpp"
+
+namespace spvtools {
+namespace fuzz {
+
+// Validates a module that is repeatedly modified, re-validating only the parts
+// of the module that may have been affected by the modifications made since
+// the module was last found to be valid.
+//
+// The module is serialized on every check and compared with the last valid
+// module.  If the differences are confined to function bodies, plus new types,
+// constants, global variables and the names and decorations of new ids, then
+// only the affected functions are re-validated: the validator is run on a
+// variant of the module in which every other function body is replaced by a
+// single unreachable block.  The affected functions are those that changed,
+// their transitive callers (so that execution model checks still see every
+// entry point that reaches them), and the transitive callees of any newly-
+// added calls.  Any other kind of change leads to the whole module being
+// validated.
+//
+// What is needed about each function, such as the functions it calls and the
+// ids it defines, is carried over from the last valid module for functions
+// whose words are unchanged, and the validator contexts are reused across
+// checks.
+//
+// A module is only ever reported as invalid after validating it in full, so
+// that incremental validation never gives rise to spurious failures and
+// error messages always refer to the real module.
+class IncrementalValidator {
+ public:
+  // |validator_options| controls validation, and |consumer| is used to report
+  // validation errors.
+  IncrementalValidator(spv_validator_options validator_options,
+                       MessageConsumer consumer);
+
+  // Disables copy/move constructor/assignment operations.
+  IncrementalValidator(const IncrementalValidator&) = delete;
+  IncrementalValidator(IncrementalValidator&&) = delete;
+  IncrementalValidator& operator=(const IncrementalValidator&) = delete;
+  IncrementalValidator& operator=(IncrementalValidator&&) = delete;
+
+  ~IncrementalValidator();
+
+  // Returns true if and only if the module of |ir_context| is valid.  The
+  // first call validates the module in full; subsequent calls validate
+  // incrementally with respect to the most recent module that was found to be
+  // valid, or that was passed to SetLastValidModule.
+  bool IsValid(opt::IRContext* ir_context);
+
+  // Records the module of |ir_context|, which must be valid, as the module
+  // with respect to which the next call to IsValid validates incrementally.
+  void SetLastValidModule(opt::IRContext* ir_context);
+
+  // Returns true if and only if a module has been found to be valid, or has
+  // been passed to SetLastValidModule.
+  bool HasLastValidModule() const { return last_valid_module_ != nullptr; }
+
+  // Returns the binary of the most recent module that was found to be valid,
+  // or that was passed to SetLastValidModule.  Requires HasLastValidModule().
+  const std::vector<uint32_t>& GetLastValidBinary() const;
+
+  // Returns the number of function bodies that the most recent call to
+  // IsValid passed to the validator: every function with a body if the
+  // module was validated in full, and fewer if it was validated
+  // incrementally.  Exposed for testing.
+  size_t GetNumFunctionsValidatedByLastCheck() const {
+    return num_functions_validated_by_last_check_;
+  }
+
+ private:
+  // The location of an instruction, or of a run of instructions, in a binary:
+  // the offset of its first word and the number of words it occupies.
+  struct WordRange {
+    size_t offset;
+    size_t num_words;
+  };
+
+  // What is needed about a function of a serialized module, found from its
+  // words.
+  struct FunctionSummary {
+    // The ids of the functions that it calls.
+    std::unordered_set<uint32_t> callees;
+    // The ids of its parameters.
+    std::vector<uint32_t> parameter_ids;
+    // The other ids that it defines, apart from its own.
+    std::vector<uint32_t> body_ids;
+    // The words of its OpFunction and OpFunctionParameter instructions, which
+    // are all that is kept of it when its body is hidden.
+    std::vector<uint32_t> header_words;
+    // The id of its entry block, or 0 if it is a declaration.
+    uint32_t entry_block_id;
+  };
+
+  // A serialized module, split into the instructions that are not part of any
+  // function and the functions themselves.
+  struct ModuleSnapshot {
+    std::vector<uint32_t> binary;
+    std::vector<WordRange> global_instructions;
+    // The result ids of the instructions in |global_instructions|.
+    std::vector<uint32_t> global_ids;
+    std::vector<uint32_t> function_ids;
+    std::vector<WordRange> functions;
+    // The summaries of the functions, in the same order as |functions|.  A
+    // function whose words are the same as in the last valid module shares
+    // its summary with that module.
+    std::vector<std::shared_ptr<const FunctionSummary>> function_summaries;
+    // Maps the id of each function to its index in |function_ids|.
+    std::unordered_map<uint32_t, size_t> function_index;
+  };
+
+  // Serializes the module of |ir_context| into a snapshot, reusing the
+  // summaries of the functions of |last_valid_module_| that are unchanged.
+  std::unique_ptr<ModuleSnapshot> TakeSnapshot(
+      opt::IRContext* ir_context) const;
+
+  // Summarizes the function that occupies |function| in |binary|, using
+  // |grammar| to find the result ids of its instructions.
+  static std::shared_ptr<const FunctionSummary> SummarizeFunction(
+      const AssemblyGrammar& grammar, const std::vector<uint32_t>& binary,
+      const WordRange& function);
+
+  // Returns true if and only if |range1| in |snapshot1| and |range2| in
+  // |snapshot2| hold identical words.
+  static bool SameWords(const ModuleSnapshot& snapshot1,
+                        const WordRange& range1,
+                        const ModuleSnapshot& snapshot2,
+                        const WordRange& range2);
+
+  // Attempts to build a binary for a variant of |current| in which only the
+  // functions affected by the changes since |last_valid_module_| are kept in
+  // full, and sets |num_functions_kept| to the number of function bodies that
+  // the variant keeps.  Returns false if the changes cannot be confined to
+  // functions in this way, or if every function would have to be kept in
+  // full, in which case the module should be validated in full.
+  bool BuildReducedBinary(const ModuleSnapshot& current,
+                          std::vector<uint32_t>* reduced_binary,
+                          size_t* num_functions_kept) const;
+
+  // Returns true if and only if |binary| is valid for |target_env|.  Errors
+  // are reported to |consumer_| if |report_errors| holds.
+  bool ValidateBinary(spv_target_env target_env,
+                      const std::vector<uint32_t>& binary, bool report_errors);
+
+  const spv_validator_options validator_options_;
+
+  const MessageConsumer consumer_;
+
+  // Validators for |target_env_|, which are created when first needed and
+  // then reused: |tools_| reports errors to |consumer_|, while |quiet_tools_|
+  // reports nothing.
+  spv_target_env target_env_;
+  std::unique_ptr<SpirvTools> tools_;
+  std::unique_ptr<SpirvTools> quiet_tools_;
+
+  // See GetNumFunctionsValidatedByLastCheck.
+  size_t num_functions_validated_by_last_check_;
+
+  // The most recent module that is known to be valid, or null if there is no
+  // such module yet.
+  std::unique_ptr<ModuleSnapshot> last_valid_module_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_INCREMENTAL_VALIDATOR_H_
@@ -15,6 +15,9 @@
 #ifndef SOURCE_FUZZ_REPEATED_PASS_INSTANCES_H_
 #define SOURCE_FUZZ_REPEATED_PASS_INSTANCES_H_
 
+#include <string>
+#include <unordered_map>
+
 #include "source/fuzz/fuzzer_pass_add_access_chains.h"
 #include "source/fuzz/fuzzer_pass_add_bit_instruction_synonyms.h"
 #include "source/fuzz/fuzzer_pass_add_composite_extract.h"
@@ -91,7 +94,7 @@ class RepeatedPassInstances {
 // provides the following public methods:
 //
 // // Requires that SetPass has not been called previously with FuzzerPassFoo.
-// // Adds |pass| to the set of known pass instances.
+// // Adds |pass| to the set of known pass instances, under the name "Foo".
 // void SetPass(std::unique_ptr<FuzzerPassFoo> pass);
 //
 // // Returns a pointer to a pass instance of type FuzzerPassFoo that was
@@ -104,6 +107,7 @@ class RepeatedPassInstances {
   void SetPass(std::unique_ptr<FuzzerPass##NAME> pass) {                 \
     assert(NAME##_ == nullptr && "Attempt to set pass multiple times."); \
     NAME##_ = pass.get();                                                \
+    pass_names_[pass.get()] = #NAME;                                     \
     passes_.push_back(std::move(pass));                                  \
   }                                                                      \
                                                                          \
@@ -176,9 +180,47 @@ class RepeatedPassInstances {
     return passes_;
   }
 
+  // Yields the registered passes that replace, move or remove instructions
+  // rather than adding them, so that they can be preferred when the module
+  // being fuzzed is close to its size limits.
+  std::vector<FuzzerPass*> GetSizeNeutralPasses() const {
+    std::vector<FuzzerPass*> result;
+    for (FuzzerPass* pass :
+         {static_cast<FuzzerPass*>(ApplyIdSynonyms_),
+          static_cast<FuzzerPass*>(MergeBlocks_),
+          static_cast<FuzzerPass*>(PermuteBlocks_),
+          static_cast<FuzzerPass*>(PermuteInstructions_),
+          static_cast<FuzzerPass*>(ReplaceIrrelevantIds_)}) {
+      if (pass != nullptr) {
+        result.push_back(pass);
+      }
+    }
+    return result;
+  }
+
+  // Returns the name under which |pass|, which must have been registered via
+  // SetPass(), was registered.
+  const char* GetPassName(const FuzzerPass* pass) const {
+    assert(pass_names_.count(pass) && "The pass has not been registered.");
+    return pass_names_.at(pass);
+  }
+
+  // Returns the registered pass called |name|, or nullptr if there is none.
+  FuzzerPass* GetPassByName(const std::string& name) const {
+    for (const auto& entry : pass_names_) {
+      if (name == entry.second) {
+        return const_cast<FuzzerPass*>(entry.first);
+      }
+    }
+    return nullptr;
+  }
+
  private:
   // The distinct fuzzer pass instances that have been registered via SetPass().
   std::vector<std::unique_ptr<FuzzerPass>> passes_;
+
+  // Maps each registered pass instance to its name.
+  std::unordered_map<const FuzzerPass*, const char*> pass_names_;
 };
 
 }  // namespace fuzz
@@ -14,6 +14,8 @@
 
 #include "source/fuzz/pass_management/repeated_pass_manager.h"
 
+#include <algorithm>
+
 #include "source/fuzz/pass_management/repeated_pass_manager_looped_with_recommendations.h"
 #include "source/fuzz/pass_management/repeated_pass_manager_random_with_recommendations.h"
 #include "source/fuzz/pass_management/repeated_pass_manager_simple.h"
@@ -27,6 +29,24 @@ RepeatedPassManager::RepeatedPassManager(FuzzerContext* fuzzer_context,
 
 RepeatedPassManager::~RepeatedPassManager() = default;
 
+FuzzerPass* RepeatedPassManager::ChoosePass(
+    const protobufs::TransformationSequence& applied_transformations) {
+  auto result = ChooseNextPass(applied_transformations);
+  if (!fuzzer_context_->IsBudgetNearlyExhausted()) {
+    return result;
+  }
+  auto size_neutral_passes = pass_instances_->GetSizeNeutralPasses();
+  if (size_neutral_passes.empty() ||
+      std::find(size_neutral_passes.begin(), size_neutral_passes.end(),
+                result) != size_neutral_passes.end() ||
+      fuzzer_context_->ChoosePercentage(
+          fuzzer_context_->GetChanceOfApplyingPassThatGrowsModule())) {
+    return result;
+  }
+  return size_neutral_passes[fuzzer_context_->RandomIndex(
+      size_neutral_passes)];
+}
+
 std::unique_ptr<RepeatedPassManager> RepeatedPassManager::Create(
     RepeatedPassStrategy strategy, FuzzerContext* fuzzer_context,
     RepeatedPassInstances* pass_instances,
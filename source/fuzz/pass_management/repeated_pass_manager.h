@@ -47,8 +47,12 @@ class RepeatedPassManager {
   // Returns the fuzzer pass instance that should be run next.  The
   // transformations that have been applied so far are provided via
   // |applied_transformations| and can be used to influence the decision.
-  virtual FuzzerPass* ChoosePass(
-      const protobufs::TransformationSequence& applied_transformations) = 0;
+  //
+  // The pass is chosen by ChooseNextPass, except that, once the fuzzing budget
+  // tracked by the fuzzer context is nearly exhausted, a pass that would grow
+  // the module is increasingly likely to be replaced by a size-neutral pass.
+  FuzzerPass* ChoosePass(
+      const protobufs::TransformationSequence& applied_transformations);
 
   // Creates a corresponding RepeatedPassManager based on the |strategy|.
   static std::unique_ptr<RepeatedPassManager> Create(
@@ -57,6 +61,11 @@ class RepeatedPassManager {
       RepeatedPassRecommender* pass_recommender);
 
  protected:
+  // Implements the strategy of the pass manager, choosing the pass that
+  // should be run next, as described for ChoosePass.
+  virtual FuzzerPass* ChooseNextPass(
+      const protobufs::TransformationSequence& applied_transformations) = 0;
+
   FuzzerContext* GetFuzzerContext() { return fuzzer_context_; }
 
   RepeatedPassInstances* GetPassInstances() { return pass_instances_; }
@@ -42,7 +42,7 @@ RepeatedPassManagerLoopedWithRecommendations::
 RepeatedPassManagerLoopedWithRecommendations::
     ~RepeatedPassManagerLoopedWithRecommendations() = default;
 
-FuzzerPass* RepeatedPassManagerLoopedWithRecommendations::ChoosePass(
+FuzzerPass* RepeatedPassManagerLoopedWithRecommendations::ChooseNextPass(
     const protobufs::TransformationSequence& applied_transformations) {
   assert((next_pass_index_ > 0 ||
           recommended_pass_indices_.count(next_pass_index_) == 0) &&
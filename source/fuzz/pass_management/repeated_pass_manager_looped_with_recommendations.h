@@ -41,8 +41,9 @@ class RepeatedPassManagerLoopedWithRecommendations
 
   ~RepeatedPassManagerLoopedWithRecommendations() override;
 
-  FuzzerPass* ChoosePass(const protobufs::TransformationSequence&
-                             applied_transformations) override;
+ protected:
+  FuzzerPass* ChooseNextPass(const protobufs::TransformationSequence&
+                                 applied_transformations) override;
 
  private:
   // The loop of fuzzer passes to be applied, populated on construction.
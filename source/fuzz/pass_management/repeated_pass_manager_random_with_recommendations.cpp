@@ -29,7 +29,7 @@ RepeatedPassManagerRandomWithRecommendations::
 RepeatedPassManagerRandomWithRecommendations::
     ~RepeatedPassManagerRandomWithRecommendations() = default;
 
-FuzzerPass* RepeatedPassManagerRandomWithRecommendations::ChoosePass(
+FuzzerPass* RepeatedPassManagerRandomWithRecommendations::ChooseNextPass(
     const protobufs::TransformationSequence& applied_transformations) {
   assert(static_cast<uint32_t>(applied_transformations.transformation_size()) >=
              num_transformations_applied_before_last_pass_choice_ &&
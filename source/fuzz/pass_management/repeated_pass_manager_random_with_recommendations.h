@@ -42,8 +42,9 @@ class RepeatedPassManagerRandomWithRecommendations
 
   ~RepeatedPassManagerRandomWithRecommendations() override;
 
-  FuzzerPass* ChoosePass(const protobufs::TransformationSequence&
-                             applied_transformations) override;
+ protected:
+  FuzzerPass* ChooseNextPass(const protobufs::TransformationSequence&
+                                 applied_transformations) override;
 
  private:
   // The queue of passes that have been recommended based on previously-chosen
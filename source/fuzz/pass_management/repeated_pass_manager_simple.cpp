@@ -23,7 +23,7 @@ RepeatedPassManagerSimple::RepeatedPassManagerSimple(
 
 RepeatedPassManagerSimple::~RepeatedPassManagerSimple() = default;
 
-FuzzerPass* RepeatedPassManagerSimple::ChoosePass(
+FuzzerPass* RepeatedPassManagerSimple::ChooseNextPass(
     const protobufs::TransformationSequence& /*unused*/) {
   auto& passes = GetPassInstances()->GetPasses();
   return passes[GetFuzzerContext()->RandomIndex(passes)].get();
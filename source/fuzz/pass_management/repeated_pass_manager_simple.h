@@ -29,8 +29,9 @@ class RepeatedPassManagerSimple : public RepeatedPassManager {
 
   ~RepeatedPassManagerSimple() override;
 
-  FuzzerPass* ChoosePass(const protobufs::TransformationSequence&
-                             applied_transformations) override;
+ protected:
+  FuzzerPass* ChooseNextPass(const protobufs::TransformationSequence&
+                                 applied_transformations) override;
 };
 
 }  // namespace fuzz
@@ -0,0 +1,187 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/replay_checkpoint_cache.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "source/util/make_unique.h"
+
+namespace spvtools {
+namespace fuzz {
+
+ReplayCheckpointCache::ReplayCheckpointCache(uint32_t checkpoint_interval,
+                                             uint32_t max_checkpoints)
+    : checkpoint_interval_(checkpoint_interval),
+      max_checkpoints_(max_checkpoints),
+      use_counter_(0) {
+  assert(checkpoint_interval_ > 0 &&
+         "The checkpoint interval must be positive.");
+}
+
+ReplayCheckpointCache::~ReplayCheckpointCache() = default;
+
+std::shared_ptr<const ReplayCheckpointCache::Checkpoint>
+ReplayCheckpointCache::FindDeepestCheckpoint(
+    const TransformationSubsequence& transformations,
+    uint32_t num_transformations) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  use_counter_++;
+
+  std::shared_ptr<const Checkpoint> result;
+  const std::vector<std::shared_ptr<Checkpoint>>* candidates = &roots_;
+  while (true) {
+    std::shared_ptr<const Checkpoint> next;
+    for (auto& candidate : *candidates) {
+      if (candidate->num_transformations_consumed_ <= num_transformations &&
+          MatchesTransformations(*candidate, transformations)) {
+        next = candidate;
+        break;
+      }
+    }
+    if (!next) {
+      return result;
+    }
+    next->last_use_ = use_counter_;
+    result = next;
+    candidates = &next->children_;
+  }
+}
+
+std::shared_ptr<const ReplayCheckpointCache::Checkpoint>
+ReplayCheckpointCache::AddCheckpoint(
+    const std::shared_ptr<const Checkpoint>& parent,
+    const TransformationSubsequence& transformations,
+    uint32_t num_transformations_consumed, opt::IRContext* ir_context,
+    const FactManager& fact_manager, const std::vector<bool>& applied) {
+  assert(num_transformations_consumed > 0 &&
+         num_transformations_consumed % checkpoint_interval_ == 0 &&
+         "Checkpoints must be taken at multiples of the interval.");
+  assert((parent ? parent->num_transformations_consumed_ : 0) +
+                 checkpoint_interval_ ==
+             num_transformations_consumed &&
+         "The parent must be the checkpoint for the preceding interval.");
+  assert(applied.size() == num_transformations_consumed &&
+         "Every consumed transformation must be recorded as applied or not.");
+
+  if (max_checkpoints_ == 0) {
+    return nullptr;
+  }
+
+  // Capture the state without holding the lock, as this is the expensive part
+  // of taking a checkpoint.
+  auto checkpoint = std::make_shared<Checkpoint>();
+  checkpoint->num_transformations_consumed_ = num_transformations_consumed;
+  ir_context->module()->ToBinary(&checkpoint->binary_, false);
+  checkpoint->fact_manager_ = MakeUnique<FactManager>(fact_manager, nullptr);
+  checkpoint->applied_ = applied;
+  checkpoint->sequence_ = transformations.GetSequence();
+  for (uint32_t i = num_transformations_consumed - checkpoint_interval_;
+       i < num_transformations_consumed; i++) {
+    checkpoint->transformations_since_parent_.push_back(
+        transformations[i].SerializeAsString());
+    checkpoint->indices_since_parent_.push_back(
+        transformations.GetIndexInSequence(i));
+  }
+  checkpoint->parent_ = parent.get();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (parent && parent->evicted_) {
+    // The parent is no longer reachable, so neither would this checkpoint be.
+    return nullptr;
+  }
+  auto& siblings = parent ? parent->children_ : roots_;
+  for (auto& sibling : siblings) {
+    if (sibling->transformations_since_parent_ ==
+        checkpoint->transformations_since_parent_) {
+      // An identical checkpoint has already been recorded, e.g. by a replayer
+      // running concurrently.
+      sibling->last_use_ = ++use_counter_;
+      return sibling;
+    }
+  }
+  while (all_checkpoints_.size() >= max_checkpoints_) {
+    if (!EvictLeastRecentlyUsedLeaf(parent.get())) {
+      return nullptr;
+    }
+  }
+  checkpoint->last_use_ = ++use_counter_;
+  siblings.push_back(checkpoint);
+  all_checkpoints_.push_back(checkpoint.get());
+  return checkpoint;
+}
+
+uint32_t ReplayCheckpointCache::GetNumCheckpoints() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<uint32_t>(all_checkpoints_.size());
+}
+
+bool ReplayCheckpointCache::MatchesTransformations(
+    const Checkpoint& checkpoint,
+    const TransformationSubsequence& transformations) {
+  const uint32_t end = checkpoint.num_transformations_consumed_;
+  if (end > transformations.size()) {
+    return false;
+  }
+  const uint32_t begin =
+      end -
+      static_cast<uint32_t>(checkpoint.transformations_since_parent_.size());
+  const bool same_sequence =
+      checkpoint.sequence_ == transformations.GetSequence();
+  for (uint32_t i = begin; i < end; i++) {
+    if (same_sequence && checkpoint.indices_since_parent_[i - begin] ==
+                             transformations.GetIndexInSequence(i)) {
+      // The very same transformation; no need to compare serializations.
+      continue;
+    }
+    if (checkpoint.transformations_since_parent_[i - begin] !=
+        transformations[i].SerializeAsString()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReplayCheckpointCache::EvictLeastRecentlyUsedLeaf(const Checkpoint* keep) {
+  auto victim = all_checkpoints_.end();
+  for (auto it = all_checkpoints_.begin(); it != all_checkpoints_.end(); ++it) {
+    if (*it == keep || !(*it)->children_.empty()) {
+      continue;
+    }
+    if (victim == all_checkpoints_.end() ||
+        (*it)->last_use_ < (*victim)->last_use_) {
+      victim = it;
+    }
+  }
+  if (victim == all_checkpoints_.end()) {
+    return false;
+  }
+  Checkpoint* checkpoint = *victim;
+  checkpoint->evicted_ = true;
+  all_checkpoints_.erase(victim);
+  // Detach the checkpoint from the tree; replayers that still hold a pointer
+  // to it keep it alive until they are done with it.
+  auto& siblings =
+      checkpoint->parent_ ? checkpoint->parent_->children_ : roots_;
+  siblings.erase(std::find_if(
+      siblings.begin(), siblings.end(),
+      [checkpoint](const std::shared_ptr<Checkpoint>& sibling) {
+        return sibling.get() == checkpoint;
+      }));
+  return true;
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
@@ -0,0 +1,174 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_REPLAY_CHECKPOINT_CACHE_H_
+#define SOURCE_FUZZ_REPLAY_CHECKPOINT_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "source/fuzz/fact_manager/fact_manager.h"
+#include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+#include "source/fuzz/transformation_subsequence.h"
+#include "source/opt/ir_context.h"
+
+namespace spvtools {
+namespace fuzz {
+
+// Caches the state reached part-way through replaying sequences of
+// transformations, so that a replay of a sequence that shares a prefix with a
+// previously-replayed sequence can resume from the state reached after that
+// prefix instead of starting from scratch.  This is useful when the same
+// input binary and initial facts are replayed many times with similar
+// sequences, as happens during shrinking.
+//
+// Checkpoints are taken every |checkpoint_interval| transformations, and are
+// organised as a tree: each checkpoint records the transformations that were
+// consumed since its parent checkpoint, so that the transformation prefix
+// leading to a checkpoint is the concatenation of the transformations along
+// the path from the root.  A checkpoint stores the module as a binary
+// together with a copy of the facts that were known at that point.
+//
+// A cache must only be used with replays of a single input binary, set of
+// initial facts and validator options.  All methods are thread-safe, so a
+// cache can be shared by replayers running concurrently.
+class ReplayCheckpointCache {
+ public:
+  // The state reached after consuming a prefix of a transformation sequence.
+  // Checkpoints are immutable once created.
+  class Checkpoint {
+   public:
+    // The number of transformations of the sequence that had been considered
+    // (whether or not they turned out to be applicable) when this checkpoint
+    // was taken.
+    uint32_t GetNumTransformationsConsumed() const {
+      return num_transformations_consumed_;
+    }
+
+    // The module that arose from replaying the prefix.
+    const std::vector<uint32_t>& GetBinary() const { return binary_; }
+
+    // The facts that were known after replaying the prefix; this fact manager
+    // is not associated with an IR context, and so must be copied for use.
+    const FactManager& GetFactManager() const { return *fact_manager_; }
+
+    // Element i is true if and only if transformation i of the prefix was
+    // applicable, and thus was applied.
+    const std::vector<bool>& GetApplied() const { return applied_; }
+
+   private:
+    friend class ReplayCheckpointCache;
+
+    uint32_t num_transformations_consumed_ = 0;
+    std::vector<uint32_t> binary_;
+    std::unique_ptr<FactManager> fact_manager_;
+    std::vector<bool> applied_;
+
+    // The serialized transformations consumed since the parent checkpoint.
+    std::vector<std::string> transformations_since_parent_;
+
+    // The sequence of which the checkpoint's prefix is a subsequence, and the
+    // indices in that sequence of the transformations consumed since the
+    // parent checkpoint.  A subsequence of the same sequence can be matched
+    // against the checkpoint by comparing indices, without serializing its
+    // transformations.
+    std::shared_ptr<const protobufs::TransformationSequence> sequence_;
+    std::vector<uint32_t> indices_since_parent_;
+
+    // The checkpoint for the preceding interval, or nullptr for the first
+    // interval.
+    const Checkpoint* parent_ = nullptr;
+
+    // Tree structure and bookkeeping, which may change after the checkpoint
+    // has been created; guarded by the cache's mutex.
+    mutable std::vector<std::shared_ptr<Checkpoint>> children_;
+    mutable bool evicted_ = false;
+    mutable uint64_t last_use_ = 0;
+  };
+
+  // Creates a cache that takes a checkpoint every |checkpoint_interval|
+  // transformations, and that holds at most |max_checkpoints| checkpoints.
+  ReplayCheckpointCache(uint32_t checkpoint_interval, uint32_t max_checkpoints);
+
+  // Disables copy/move constructor/assignment operations.
+  ReplayCheckpointCache(const ReplayCheckpointCache&) = delete;
+  ReplayCheckpointCache(ReplayCheckpointCache&&) = delete;
+  ReplayCheckpointCache& operator=(const ReplayCheckpointCache&) = delete;
+  ReplayCheckpointCache& operator=(ReplayCheckpointCache&&) = delete;
+
+  ~ReplayCheckpointCache();
+
+  uint32_t GetCheckpointInterval() const { return checkpoint_interval_; }
+
+  // Returns the deepest checkpoint whose prefix is a prefix of the first
+  // |num_transformations| transformations of |transformations|, or nullptr if
+  // there is no such checkpoint.
+  std::shared_ptr<const Checkpoint> FindDeepestCheckpoint(
+      const TransformationSubsequence& transformations,
+      uint32_t num_transformations);
+
+  // Records a checkpoint for the state reached after consuming the first
+  // |num_transformations_consumed| transformations of |transformations|,
+  // which must be a multiple of the checkpoint interval.  |parent| must be the
+  // checkpoint for the preceding interval, or nullptr if this is the first
+  // interval.  |ir_context| and |fact_manager| capture the state, and
+  // |applied| records which of the consumed transformations were applied.
+  //
+  // Returns the new checkpoint, which can be used as the parent of the next
+  // checkpoint, or nullptr if no checkpoint was recorded (e.g. because the
+  // parent has been evicted in the meantime).
+  std::shared_ptr<const Checkpoint> AddCheckpoint(
+      const std::shared_ptr<const Checkpoint>& parent,
+      const TransformationSubsequence& transformations,
+      uint32_t num_transformations_consumed, opt::IRContext* ir_context,
+      const FactManager& fact_manager, const std::vector<bool>& applied);
+
+  // Returns the number of checkpoints currently held by the cache.
+  uint32_t GetNumCheckpoints();
+
+ private:
+  // Returns true if and only if |checkpoint| records exactly the
+  // transformations of |transformations| in the interval ending at its
+  // number of consumed transformations.
+  static bool MatchesTransformations(
+      const Checkpoint& checkpoint,
+      const TransformationSubsequence& transformations);
+
+  // Removes the least-recently-used checkpoint that has no children, other
+  // than |keep|.  Returns false if there is no such checkpoint.  Requires
+  // |mutex_| to be held.
+  bool EvictLeastRecentlyUsedLeaf(const Checkpoint* keep);
+
+  const uint32_t checkpoint_interval_;
+  const uint32_t max_checkpoints_;
+
+  std::mutex mutex_;
+
+  // The checkpoints for the first interval of a sequence.
+  std::vector<std::shared_ptr<Checkpoint>> roots_;
+
+  // All checkpoints currently in the cache.
+  std::vector<Checkpoint*> all_checkpoints_;
+
+  // Incremented on every lookup, to track how recently checkpoints were used.
+  uint64_t use_counter_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_REPLAY_CHECKPOINT_CACHE_H_
@@ -20,30 +20,66 @@
 
 #include "source/fuzz/counter_overflow_id_source.h"
 #include "source/fuzz/fact_manager/fact_manager.h"
+#include "source/fuzz/incremental_validator.h"
 #include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
 #include "source/fuzz/transformation.h"
 #include "source/fuzz/transformation_context.h"
 #include "source/opt/build_module.h"
+#include "source/spirv_constant.h"
 #include "source/util/make_unique.h"
 
 namespace spvtools {
 namespace fuzz {
+namespace {
+
+// Moves the transformations of |sequence| into a new shared sequence.  Swapping
+// is constant-time, whether or not the message type supports moving.
+std::shared_ptr<const protobufs::TransformationSequence> TakeSequence(
+    protobufs::TransformationSequence* sequence) {
+  auto result = std::make_shared<protobufs::TransformationSequence>();
+  result->Swap(sequence);
+  return result;
+}
+
+}  // namespace
 
 Replayer::Replayer(
     spv_target_env target_env, MessageConsumer consumer,
     const std::vector<uint32_t>& binary_in,
     const protobufs::FactSequence& initial_facts,
-    const protobufs::TransformationSequence& transformation_sequence_in,
+    protobufs::TransformationSequence transformation_sequence_in,
     uint32_t num_transformations_to_apply, bool validate_during_replay,
-    spv_validator_options validator_options)
+    spv_validator_options validator_options,
+    ReplayCheckpointCache* checkpoint_cache)
+    : target_env_(target_env),
+      consumer_(std::move(consumer)),
+      binary_in_(binary_in),
+      initial_facts_(initial_facts),
+      transformations_in_(TakeSequence(&transformation_sequence_in)),
+      report_applied_transformations_as_message_(true),
+      num_transformations_to_apply_(num_transformations_to_apply),
+      validate_during_replay_(validate_during_replay),
+      validator_options_(validator_options),
+      checkpoint_cache_(checkpoint_cache) {}
+
+Replayer::Replayer(spv_target_env target_env, MessageConsumer consumer,
+                   const std::vector<uint32_t>& binary_in,
+                   const protobufs::FactSequence& initial_facts,
+                   TransformationSubsequence transformation_subsequence_in,
+                   uint32_t num_transformations_to_apply,
+                   bool validate_during_replay,
+                   spv_validator_options validator_options,
+                   ReplayCheckpointCache* checkpoint_cache)
     : target_env_(target_env),
       consumer_(std::move(consumer)),
       binary_in_(binary_in),
       initial_facts_(initial_facts),
-      transformation_sequence_in_(transformation_sequence_in),
+      transformations_in_(std::move(transformation_subsequence_in)),
+      report_applied_transformations_as_message_(false),
       num_transformations_to_apply_(num_transformations_to_apply),
       validate_during_replay_(validate_during_replay),
-      validator_options_(validator_options) {}
+      validator_options_(validator_options),
+      checkpoint_cache_(checkpoint_cache) {}
 
 Replayer::~Replayer() = default;
 
@@ -52,9 +88,7 @@ Replayer::ReplayerResult Replayer::Run() {
   // header files being used.
   GOOGLE_PROTOBUF_VERIFY_VERSION;
 
-  if (num_transformations_to_apply_ >
-      static_cast<uint32_t>(
-          transformation_sequence_in_.transformation_size())) {
+  if (num_transformations_to_apply_ > transformations_in_.size()) {
     consumer_(SPV_MSG_ERROR, nullptr, {},
               "The number of transformations to be replayed must not "
               "exceed the size of the transformation sequence.");
@@ -78,25 +112,14 @@ Replayer::ReplayerResult Replayer::Run() {
             nullptr, protobufs::TransformationSequence()};
   }
 
-  // Build the module from the input binary.
-  std::unique_ptr<opt::IRContext> ir_context =
-      BuildModule(target_env_, consumer_, binary_in_.data(), binary_in_.size());
-  assert(ir_context);
-
-  // For replay validation, we track the last valid SPIR-V binary that was
-  // observed. Initially this is the input binary.
-  std::vector<uint32_t> last_valid_binary;
-  if (validate_during_replay_) {
-    last_valid_binary = binary_in_;
-  }
-
   // We find the smallest id that is (a) not in use by the original module, and
   // (b) not used by any transformation in the sequence to be replayed.  This
   // serves as a starting id from which to issue overflow ids if they are
   // required during replay.
-  uint32_t first_overflow_id = ir_context->module()->id_bound();
-  for (auto& transformation : transformation_sequence_in_.transformation()) {
-    auto fresh_ids = Transformation::FromMessage(transformation)->GetFreshIds();
+  uint32_t first_overflow_id = binary_in_[SPV_INDEX_BOUND];
+  for (uint32_t i = 0; i < transformations_in_.size(); i++) {
+    auto fresh_ids =
+        Transformation::FromMessage(transformations_in_[i])->GetFreshIds();
     if (!fresh_ids.empty()) {
       first_overflow_id =
           std::max(first_overflow_id,
@@ -104,66 +127,132 @@ Replayer::ReplayerResult Replayer::Run() {
     }
   }
 
-  std::unique_ptr<TransformationContext> transformation_context =
-      MakeUnique<TransformationContext>(
-          MakeUnique<FactManager>(ir_context.get()), validator_options_,
-          MakeUnique<CounterOverflowIdSource>(first_overflow_id));
-  transformation_context->GetFactManager()->AddInitialFacts(consumer_,
-                                                            initial_facts_);
+  // If possible, resume from the deepest checkpoint that matches a prefix of
+  // the transformations to be applied.
+  std::shared_ptr<const ReplayCheckpointCache::Checkpoint> checkpoint;
+  if (checkpoint_cache_) {
+    checkpoint = checkpoint_cache_->FindDeepestCheckpoint(
+        transformations_in_, num_transformations_to_apply_);
+  }
+
+  // Build the module from the input binary, or from the checkpoint.
+  const std::vector<uint32_t>& initial_binary =
+      checkpoint ? checkpoint->GetBinary() : binary_in_;
+  std::unique_ptr<opt::IRContext> ir_context = BuildModule(
+      target_env_, consumer_, initial_binary.data(), initial_binary.size());
+  assert(ir_context);
+
+  // For replay validation, the module is validated incrementally with respect
+  // to the last valid module that was observed, which is available from the
+  // validator for inspection.  Initially this is the module from which replay
+  // starts; a checkpoint is only ever taken from a valid module.
+  IncrementalValidator validator(validator_options_, consumer_);
+  if (validate_during_replay_) {
+    validator.SetLastValidModule(ir_context.get());
+  }
+
+  // Checkpoints are only taken before any overflow ids have been issued, so
+  // the overflow id source always starts afresh.
+  std::unique_ptr<TransformationContext> transformation_context;
+  if (checkpoint) {
+    transformation_context = MakeUnique<TransformationContext>(
+        MakeUnique<FactManager>(checkpoint->GetFactManager(),
+                                ir_context.get()),
+        validator_options_,
+        MakeUnique<CounterOverflowIdSource>(first_overflow_id));
+  } else {
+    transformation_context = MakeUnique<TransformationContext>(
+        MakeUnique<FactManager>(ir_context.get()), validator_options_,
+        MakeUnique<CounterOverflowIdSource>(first_overflow_id));
+    transformation_context->GetFactManager()->AddInitialFacts(consumer_,
+                                                              initial_facts_);
+  }
 
   // We track the largest id bound observed, to ensure that it only increases
   // as transformations are applied.
   uint32_t max_observed_id_bound = ir_context->module()->id_bound();
   (void)(max_observed_id_bound);  // Keep release-mode compilers happy.
 
-  protobufs::TransformationSequence transformation_sequence_out;
+  // The indices, in the underlying sequence, of the transformations that were
+  // applied.
+  std::vector<uint32_t> applied_indices;
 
-  // Consider the transformation proto messages in turn.
+  // Tracks, for each transformation consumed so far, whether it was applied;
+  // this is recorded in checkpoints.
+  std::vector<bool> applied;
+
+  // Consider the transformation proto messages in turn, skipping those that
+  // were consumed before the checkpoint (if any).
   uint32_t counter = 0;
-  for (auto& message : transformation_sequence_in_.transformation()) {
-    if (counter >= num_transformations_to_apply_) {
-      break;
+  if (checkpoint) {
+    applied = checkpoint->GetApplied();
+    counter = checkpoint->GetNumTransformationsConsumed();
+    for (uint32_t i = 0; i < counter; i++) {
+      if (applied[i]) {
+        applied_indices.push_back(transformations_in_.GetIndexInSequence(i));
+      }
     }
-    counter++;
-
-    auto transformation = Transformation::FromMessage(message);
+  }
+  for (; counter < num_transformations_to_apply_; counter++) {
+    auto transformation =
+        Transformation::FromMessage(transformations_in_[counter]);
 
     // Check whether the transformation can be applied.
-    if (transformation->IsApplicable(ir_context.get(),
-                                     *transformation_context)) {
-      // The transformation is applicable, so apply it, and copy it to the
-      // sequence of transformations that were applied.
+    bool is_applicable = transformation->IsApplicable(ir_context.get(),
+                                                      *transformation_context);
+    applied.push_back(is_applicable);
+    if (is_applicable) {
+      // The transformation is applicable, so apply it, and record that it
+      // was applied.
       transformation->Apply(ir_context.get(), transformation_context.get());
-      *transformation_sequence_out.add_transformation() = message;
+      applied_indices.push_back(
+          transformations_in_.GetIndexInSequence(counter));
 
       assert(ir_context->module()->id_bound() >= max_observed_id_bound &&
              "The module's id bound should only increase due to applying "
              "transformations.");
       max_observed_id_bound = ir_context->module()->id_bound();
 
-      if (validate_during_replay_) {
-        std::vector<uint32_t> binary_to_validate;
-        ir_context->module()->ToBinary(&binary_to_validate, false);
-
-        // Check whether the latest transformation led to a valid binary.
-        if (!tools.Validate(&binary_to_validate[0], binary_to_validate.size(),
-                            validator_options_)) {
-          consumer_(SPV_MSG_INFO, nullptr, {},
-                    "Binary became invalid during replay (set a "
-                    "breakpoint to inspect); stopping.");
-          return {Replayer::ReplayerResultStatus::kReplayValidationFailure,
-                  nullptr, nullptr, protobufs::TransformationSequence()};
-        }
-
-        // The binary was valid, so it becomes the latest valid binary.
-        last_valid_binary = std::move(binary_to_validate);
+      // Check whether the latest transformation led to a valid binary; only
+      // the parts of the module that it may have affected are re-validated.
+      if (validate_during_replay_ && !validator.IsValid(ir_context.get())) {
+        consumer_(SPV_MSG_INFO, nullptr, {},
+                  "Binary became invalid during replay (set a "
+                  "breakpoint to inspect); stopping.");
+        return {Replayer::ReplayerResultStatus::kReplayValidationFailure,
+                nullptr, nullptr, protobufs::TransformationSequence()};
       }
     }
+
+    // Take a checkpoint at the end of each interval, as long as the checkpoint
+    // for the previous interval is available.  No checkpoint is taken once
+    // overflow ids have been issued: their values depend on the whole
+    // sequence being replayed, not just on the prefix.
+    const uint32_t num_consumed = counter + 1;
+    if (checkpoint_cache_ &&
+        num_consumed % checkpoint_cache_->GetCheckpointInterval() == 0 &&
+        (checkpoint ||
+         num_consumed == checkpoint_cache_->GetCheckpointInterval()) &&
+        transformation_context->GetOverflowIdSource()
+            ->GetIssuedOverflowIds()
+            .empty()) {
+      checkpoint = checkpoint_cache_->AddCheckpoint(
+          checkpoint, transformations_in_, num_consumed,
+          ir_context.get(), *transformation_context->GetFactManager(),
+          applied);
+    }
   }
 
+  TransformationSubsequence applied_subsequence(
+      transformations_in_.GetSequence(), std::move(applied_indices));
+  protobufs::TransformationSequence transformation_sequence_out;
+  if (report_applied_transformations_as_message_) {
+    transformation_sequence_out = applied_subsequence.ToMessage();
+  }
   return {Replayer::ReplayerResultStatus::kComplete, std::move(ir_context),
           std::move(transformation_context),
-          std::move(transformation_sequence_out)};
+          std::move(transformation_sequence_out),
+          std::move(applied_subsequence)};
 }
 
 }  // namespace fuzz
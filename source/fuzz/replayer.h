@@ -19,7 +19,9 @@
 #include <vector>
 
 #include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+#include "source/fuzz/replay_checkpoint_cache.h"
 #include "source/fuzz/transformation_context.h"
+#include "source/fuzz/transformation_subsequence.h"
 #include "source/opt/ir_context.h"
 #include "spirv-tools/libspirv.hpp"
 
@@ -44,14 +46,39 @@ class Replayer {
     std::unique_ptr<opt::IRContext> transformed_module;
     std::unique_ptr<TransformationContext> transformation_context;
     protobufs::TransformationSequence applied_transformations;
+    // The transformations that were applied, as a subsequence of the
+    // transformations to be replayed.
+    TransformationSubsequence applied_subsequence;
   };
 
+  // The replayer takes ownership of |transformation_sequence_in|, so callers
+  // that no longer need the sequence should move it in to avoid a copy.
+  //
+  // If |checkpoint_cache| is not null, replay resumes from the deepest cached
+  // checkpoint that matches a prefix of the transformations to be applied, and
+  // records further checkpoints as it goes.  The cache must only be shared
+  // between replayers that have the same |binary_in|, |initial_facts| and
+  // |validator_options|.
   Replayer(spv_target_env target_env, MessageConsumer consumer,
            const std::vector<uint32_t>& binary_in,
            const protobufs::FactSequence& initial_facts,
-           const protobufs::TransformationSequence& transformation_sequence_in,
+           protobufs::TransformationSequence transformation_sequence_in,
            uint32_t num_transformations_to_apply, bool validate_during_replay,
-           spv_validator_options validator_options);
+           spv_validator_options validator_options,
+           ReplayCheckpointCache* checkpoint_cache = nullptr);
+
+  // As above, except that the transformations to be replayed are given as a
+  // subsequence, which avoids copying them.  A replayer created this way only
+  // reports the applied transformations via |applied_subsequence|, leaving
+  // |applied_transformations| empty, so that no transformations are copied
+  // by replay.
+  Replayer(spv_target_env target_env, MessageConsumer consumer,
+           const std::vector<uint32_t>& binary_in,
+           const protobufs::FactSequence& initial_facts,
+           TransformationSubsequence transformation_subsequence_in,
+           uint32_t num_transformations_to_apply, bool validate_during_replay,
+           spv_validator_options validator_options,
+           ReplayCheckpointCache* checkpoint_cache = nullptr);
 
   // Disables copy/move constructor/assignment operations.
   Replayer(const Replayer&) = delete;
@@ -62,7 +89,7 @@ class Replayer {
   ~Replayer();
 
   // Attempts to apply the first |num_transformations_to_apply_| transformations
-  // from |transformation_sequence_in_| to |binary_in_|.  Initial facts about
+  // from |transformations_in_| to |binary_in_|.  Initial facts about
   // the input binary and the context in which it will execute are provided via
   // |initial_facts_|.
   //
@@ -87,7 +114,12 @@ class Replayer {
   const protobufs::FactSequence& initial_facts_;
 
   // The transformations to be replayed.
-  const protobufs::TransformationSequence& transformation_sequence_in_;
+  const TransformationSubsequence transformations_in_;
+
+  // True if the applied transformations should also be reported as a
+  // self-contained message, which is the case if the transformations to be
+  // replayed were given as a message.
+  const bool report_applied_transformations_as_message_;
 
   // The number of transformations that should be replayed.
   const uint32_t num_transformations_to_apply_;
@@ -97,6 +129,9 @@ class Replayer {
 
   // Options to control validation
   spv_validator_options validator_options_;
+
+  // Optional cache of replay checkpoints; not owned.
+  ReplayCheckpointCache* checkpoint_cache_;
 };
 
 }  // namespace fuzz
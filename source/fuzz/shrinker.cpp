@@ -14,7 +14,10 @@
 
 #include "source/fuzz/shrinker.h"
 
+#include <algorithm>
+#include <memory>
 #include <sstream>
+#include <thread>
 
 #include "source/fuzz/added_function_reducer.h"
 #include "source/fuzz/pseudo_random_generator.h"
@@ -29,6 +32,16 @@ namespace fuzz {
 
 namespace {
 
+// The minimum number of transformations between replay checkpoints.
+const uint32_t kMinReplayCheckpointInterval = 16;
+
+// The number of checkpoints that should be taken, at most, when replaying the
+// whole of the initial transformation sequence.
+const uint32_t kReplayCheckpointsPerSequence = 64;
+
+// The maximum number of replay checkpoints to keep at any one time.
+const uint32_t kMaxReplayCheckpoints = 4 * kReplayCheckpointsPerSequence;
+
 // A helper to get the size of a protobuf transformation sequence in a less
 // verbose manner.
 uint32_t NumRemainingTransformations(
@@ -36,30 +49,6 @@ uint32_t NumRemainingTransformations(
   return static_cast<uint32_t>(transformation_sequence.transformation_size());
 }
 
-// A helper to return a transformation sequence identical to |transformations|,
-// except that a chunk of size |chunk_size| starting from |chunk_index| x
-// |chunk_size| is removed (or as many transformations as available if the whole
-// chunk is not).
-protobufs::TransformationSequence RemoveChunk(
-    const protobufs::TransformationSequence& transformations,
-    uint32_t chunk_index, uint32_t chunk_size) {
-  uint32_t lower = chunk_index * chunk_size;
-  uint32_t upper = std::min((chunk_index + 1) * chunk_size,
-                            NumRemainingTransformations(transformations));
-  assert(lower < upper);
-  assert(upper <= NumRemainingTransformations(transformations));
-  protobufs::TransformationSequence result;
-  for (uint32_t j = 0; j < NumRemainingTransformations(transformations); j++) {
-    if (j >= lower && j < upper) {
-      continue;
-    }
-    protobufs::Transformation transformation =
-        transformations.transformation()[j];
-    *result.mutable_transformation()->Add() = transformation;
-  }
-  return result;
-}
-
 }  // namespace
 
 Shrinker::Shrinker(
@@ -69,7 +58,7 @@ Shrinker::Shrinker(
     const protobufs::TransformationSequence& transformation_sequence_in,
     const InterestingnessFunction& interestingness_function,
     uint32_t step_limit, bool validate_during_replay,
-    spv_validator_options validator_options)
+    spv_validator_options validator_options, uint32_t num_threads)
     : target_env_(target_env),
       consumer_(std::move(consumer)),
       binary_in_(binary_in),
@@ -78,7 +67,8 @@ Shrinker::Shrinker(
       interestingness_function_(interestingness_function),
       step_limit_(step_limit),
       validate_during_replay_(validate_during_replay),
-      validator_options_(validator_options) {}
+      validator_options_(validator_options),
+      num_threads_(std::max(1u, num_threads)) {}
 
 Shrinker::~Shrinker() = default;
 
@@ -103,14 +93,26 @@ Shrinker::ShrinkerResult Shrinker::Run() {
             std::vector<uint32_t>(), protobufs::TransformationSequence()};
   }
 
+  // Shrinking replays many sequences that share long prefixes, so replays
+  // resume from checkpoints taken periodically during earlier replays.
+  ReplayCheckpointCache checkpoint_cache(
+      std::max(kMinReplayCheckpointInterval,
+               NumRemainingTransformations(transformation_sequence_in_) /
+                   kReplayCheckpointsPerSequence),
+      kMaxReplayCheckpoints);
+
+  // The sequences that are tried during shrinking are all subsequences of the
+  // initial sequence, which is shared by them rather than copied for each.
+  TransformationSubsequence initial_transformations(
+      std::make_shared<protobufs::TransformationSequence>(
+          transformation_sequence_in_));
+
   // Run a replay of the initial transformation sequence to check that it
   // succeeds.
   auto initial_replay_result =
       Replayer(target_env_, consumer_, binary_in_, initial_facts_,
-               transformation_sequence_in_,
-               static_cast<uint32_t>(
-                   transformation_sequence_in_.transformation_size()),
-               validate_during_replay_, validator_options_)
+               initial_transformations, initial_transformations.size(),
+               validate_during_replay_, validator_options_, &checkpoint_cache)
           .Run();
   if (initial_replay_result.status !=
       Replayer::ReplayerResultStatus::kComplete) {
@@ -123,8 +125,8 @@ Shrinker::ShrinkerResult Shrinker::Run() {
   std::vector<uint32_t> current_best_binary;
   initial_replay_result.transformed_module->module()->ToBinary(
       &current_best_binary, false);
-  protobufs::TransformationSequence current_best_transformations =
-      std::move(initial_replay_result.applied_transformations);
+  TransformationSubsequence current_best_transformations =
+      std::move(initial_replay_result.applied_subsequence);
 
   // Check that the binary produced by applying the initial transformations is
   // indeed interesting.
@@ -139,7 +141,7 @@ Shrinker::ShrinkerResult Shrinker::Run() {
                          // have been tried, whether successful or not.
 
   uint32_t chunk_size =
-      std::max(1u, NumRemainingTransformations(current_best_transformations) /
+      std::max(1u, current_best_transformations.size() /
                        2);  // The number of contiguous transformations that the
                             // shrinker will try to remove in one go; starts
                             // high and decreases during the shrinking process.
@@ -149,7 +151,7 @@ Shrinker::ShrinkerResult Shrinker::Run() {
   // - run out of transformations to remove, or
   // - cannot make the chunk size any smaller.
   while (attempt < step_limit_ &&
-         !current_best_transformations.transformation().empty() &&
+         !current_best_transformations.empty() &&
          chunk_size > 0) {
     bool progress_this_round =
         false;  // Used to decide whether to make the chunk size with which we
@@ -158,73 +160,92 @@ Shrinker::ShrinkerResult Shrinker::Run() {
                 // size, we set this flag so that we do not yet decrease the
                 // chunk size.
 
-    assert(chunk_size <=
-               NumRemainingTransformations(current_best_transformations) &&
+    assert(chunk_size <= current_best_transformations.size() &&
            "Chunk size should never exceed the number of transformations that "
            "remain.");
 
     // The number of chunks is the ceiling of (#remaining_transformations /
     // chunk_size).
     const uint32_t num_chunks =
-        (NumRemainingTransformations(current_best_transformations) +
-         chunk_size - 1) /
-        chunk_size;
+        (current_best_transformations.size() + chunk_size - 1) / chunk_size;
     assert(num_chunks >= 1 && "There should be at least one chunk.");
-    assert(num_chunks * chunk_size >=
-               NumRemainingTransformations(current_best_transformations) &&
+    assert(num_chunks * chunk_size >= current_best_transformations.size() &&
            "All transformations should be in some chunk.");
 
     // We go through the transformations in reverse, in chunks of size
     // |chunk_size|, using |chunk_index| to track which chunk to try removing
-    // next.  The loop exits early if we reach the shrinking step limit.
-    for (int chunk_index = num_chunks - 1;
-         attempt < step_limit_ && chunk_index >= 0; chunk_index--) {
-      // Remove a chunk of transformations according to the current index and
-      // chunk size.
-      auto transformations_with_chunk_removed =
-          RemoveChunk(current_best_transformations,
-                      static_cast<uint32_t>(chunk_index), chunk_size);
-
-      // Replay the smaller sequence of transformations to get a next binary and
-      // transformation sequence. Note that the transformations arising from
-      // replay might be even smaller than the transformations with the chunk
-      // removed, because removing those transformations might make further
-      // transformations inapplicable.
-      auto replay_result =
-          Replayer(
-              target_env_, consumer_, binary_in_, initial_facts_,
-              transformations_with_chunk_removed,
-              static_cast<uint32_t>(
-                  transformations_with_chunk_removed.transformation_size()),
-              validate_during_replay_, validator_options_)
-              .Run();
-      if (replay_result.status != Replayer::ReplayerResultStatus::kComplete) {
-        // Replay should not fail; if it does, we need to abort shrinking.
-        return {ShrinkerResultStatus::kReplayFailed, std::vector<uint32_t>(),
-                protobufs::TransformationSequence()};
+    // next.  Up to |num_threads_| consecutive chunks are tried at once, each
+    // removal being replayed and checked for interestingness independently.
+    // The loop exits early if we reach the shrinking step limit.
+    int chunk_index = static_cast<int>(num_chunks) - 1;
+    while (attempt < step_limit_ && chunk_index >= 0) {
+      const uint32_t batch_size =
+          std::min({num_threads_, step_limit_ - attempt,
+                    static_cast<uint32_t>(chunk_index) + 1});
+
+      std::vector<ChunkRemovalResult> results(batch_size);
+      if (batch_size == 1) {
+        results[0] = TryRemoveChunk(current_best_transformations,
+                                    static_cast<uint32_t>(chunk_index),
+                                    chunk_size, attempt, &checkpoint_cache);
+      } else {
+        std::vector<std::thread> threads;
+        threads.reserve(batch_size);
+        for (uint32_t i = 0; i < batch_size; i++) {
+          threads.emplace_back([this, &results, &current_best_transformations,
+                                &checkpoint_cache, chunk_index, chunk_size,
+                                attempt, i]() {
+            results[i] = TryRemoveChunk(
+                current_best_transformations,
+                static_cast<uint32_t>(chunk_index) - i, chunk_size,
+                attempt + i, &checkpoint_cache);
+          });
+        }
+        for (auto& thread : threads) {
+          thread.join();
+        }
+      }
+      // Each chunk removal was a shrink attempt, whether successful or not.
+      attempt += batch_size;
+
+      // Among the interesting results, pick the one with the fewest
+      // transformations.  Ties are broken in favour of the highest chunk
+      // index, so that with a single thread the order in which chunks are
+      // removed is the same as for serial shrinking.
+      int best = -1;
+      for (uint32_t i = 0; i < batch_size; i++) {
+        if (!results[i].replay_succeeded) {
+          // Replay should not fail; if it does, we need to abort shrinking.
+          return {ShrinkerResultStatus::kReplayFailed, std::vector<uint32_t>(),
+                  protobufs::TransformationSequence()};
+        }
+        if (results[i].interesting &&
+            (best == -1 ||
+             results[i].applied_transformations.size() <
+                 results[best].applied_transformations.size())) {
+          best = static_cast<int>(i);
+        }
       }
 
-      assert(
-          NumRemainingTransformations(replay_result.applied_transformations) >=
-              chunk_index * chunk_size &&
-          "Removing this chunk of transformations should not have an effect "
-          "on earlier chunks.");
-
-      std::vector<uint32_t> transformed_binary;
-      replay_result.transformed_module->module()->ToBinary(&transformed_binary,
-                                                           false);
-      if (interestingness_function_(transformed_binary, attempt)) {
-        // If the binary arising from the smaller transformation sequence is
-        // interesting, this becomes our current best binary and transformation
-        // sequence.
-        current_best_binary = std::move(transformed_binary);
-        current_best_transformations =
-            std::move(replay_result.applied_transformations);
-        progress_this_round = true;
+      if (best == -1) {
+        // None of the chunks in this batch could be removed; move on to the
+        // next batch.
+        chunk_index -= static_cast<int>(batch_size);
+        continue;
       }
-      // Either way, this was a shrink attempt, so increment our count of shrink
-      // attempts.
-      attempt++;
+
+      // The binary arising from the smaller transformation sequence is
+      // interesting, so this becomes our current best binary and
+      // transformation sequence.
+      current_best_binary = std::move(results[best].transformed_binary);
+      current_best_transformations =
+          std::move(results[best].applied_transformations);
+      progress_this_round = true;
+
+      // Chunks below the removed chunk that were tried in this batch were
+      // tried against a sequence that still contained the removed chunk, so
+      // they need to be tried again.
+      chunk_index -= best + 1;
     }
     if (!progress_this_round) {
       // If we didn't manage to remove any chunks at this chunk size, try a
@@ -233,12 +254,16 @@ Shrinker::ShrinkerResult Shrinker::Run() {
     }
     // Decrease the chunk size until it becomes no larger than the number of
     // remaining transformations.
-    while (chunk_size >
-           NumRemainingTransformations(current_best_transformations)) {
+    while (chunk_size > current_best_transformations.size()) {
       chunk_size /= 2;
     }
   }
 
+  // The remaining transformations are now copied, as reducing added functions
+  // changes them.
+  protobufs::TransformationSequence remaining_transformations =
+      current_best_transformations.ToMessage();
+
   // We now use spirv-reduce to minimise the functions associated with any
   // AddFunction transformations that remain.
   //
@@ -247,10 +272,10 @@ Shrinker::ShrinkerResult Shrinker::Run() {
        attempt < step_limit_ &&
        transformation_index <
            static_cast<uint32_t>(
-               current_best_transformations.transformation_size());
+               remaining_transformations.transformation_size());
        transformation_index++) {
     // Skip all transformations apart from TransformationAddFunction.
-    if (!current_best_transformations.transformation(transformation_index)
+    if (!remaining_transformations.transformation(transformation_index)
              .has_add_function()) {
       continue;
     }
@@ -259,7 +284,7 @@ Shrinker::ShrinkerResult Shrinker::Run() {
     // encapsulated in a separate class.
     auto added_function_reducer_result =
         AddedFunctionReducer(target_env_, consumer_, binary_in_, initial_facts_,
-                             current_best_transformations, transformation_index,
+                             remaining_transformations, transformation_index,
                              interestingness_function_, validate_during_replay_,
                              validator_options_, step_limit_, attempt)
             .Run();
@@ -270,13 +295,13 @@ Shrinker::ShrinkerResult Shrinker::Run() {
       return {ShrinkerResultStatus::kAddedFunctionReductionFailed,
               std::vector<uint32_t>(), protobufs::TransformationSequence()};
     }
-    assert(current_best_transformations.transformation_size() ==
+    assert(remaining_transformations.transformation_size() ==
                added_function_reducer_result.applied_transformations
                    .transformation_size() &&
            "The number of transformations should not have changed.");
     current_best_binary =
         std::move(added_function_reducer_result.transformed_binary);
-    current_best_transformations =
+    remaining_transformations =
         std::move(added_function_reducer_result.applied_transformations);
     // The added function reducer reports how many reduction attempts
     // spirv-reduce took when reducing the function.  We regard each of these
@@ -297,11 +322,54 @@ Shrinker::ShrinkerResult Shrinker::Run() {
     consumer_(SPV_MSG_WARNING, nullptr, {}, strstream.str().c_str());
     return {Shrinker::ShrinkerResultStatus::kStepLimitReached,
             std::move(current_best_binary),
-            std::move(current_best_transformations)};
+            std::move(remaining_transformations)};
   }
   return {Shrinker::ShrinkerResultStatus::kComplete,
           std::move(current_best_binary),
-          std::move(current_best_transformations)};
+          std::move(remaining_transformations)};
+}
+
+Shrinker::ChunkRemovalResult Shrinker::TryRemoveChunk(
+    const TransformationSubsequence& transformations, uint32_t chunk_index,
+    uint32_t chunk_size, uint32_t attempt,
+    ReplayCheckpointCache* checkpoint_cache) const {
+  // Remove a chunk of size |chunk_size| starting from |chunk_index| x
+  // |chunk_size| (or as many transformations as are available if the whole
+  // chunk is not).  This only copies the indices of the remaining
+  // transformations.
+  const uint32_t lower = chunk_index * chunk_size;
+  const uint32_t upper =
+      std::min((chunk_index + 1) * chunk_size, transformations.size());
+  assert(lower < upper);
+  auto transformations_with_chunk_removed =
+      transformations.WithoutRange(lower, upper);
+
+  // Replay the smaller sequence of transformations to get a next binary and
+  // transformation sequence. Note that the transformations arising from replay
+  // might be even smaller than the transformations with the chunk removed,
+  // because removing those transformations might make further transformations
+  // inapplicable.
+  auto replay_result =
+      Replayer(target_env_, consumer_, binary_in_, initial_facts_,
+               transformations_with_chunk_removed,
+               transformations_with_chunk_removed.size(),
+               validate_during_replay_, validator_options_, checkpoint_cache)
+          .Run();
+  if (replay_result.status != Replayer::ReplayerResultStatus::kComplete) {
+    return {false, false, std::vector<uint32_t>(),
+            TransformationSubsequence()};
+  }
+
+  assert(replay_result.applied_subsequence.size() >= lower &&
+         "Removing this chunk of transformations should not have an effect "
+         "on earlier chunks.");
+
+  std::vector<uint32_t> transformed_binary;
+  replay_result.transformed_module->module()->ToBinary(&transformed_binary,
+                                                       false);
+  bool interesting = interestingness_function_(transformed_binary, attempt);
+  return {true, interesting, std::move(transformed_binary),
+          std::move(replay_result.applied_subsequence)};
 }
 
 uint32_t Shrinker::GetIdBound(const std::vector<uint32_t>& binary) const {
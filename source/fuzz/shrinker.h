@@ -19,6 +19,8 @@
 #include <vector>
 
 #include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+#include "source/fuzz/replay_checkpoint_cache.h"
+#include "source/fuzz/transformation_subsequence.h"
 #include "spirv-tools/libspirv.hpp"
 
 namespace spvtools {
@@ -56,13 +58,17 @@ class Shrinker {
   using InterestingnessFunction = std::function<bool(
       const std::vector<uint32_t>& binary, uint32_t counter)>;
 
+  // If |num_threads| is greater than 1, up to |num_threads| chunk removals are
+  // replayed and checked for interestingness concurrently, each on its own
+  // thread; in this case |interestingness_function| and |consumer| must be
+  // safe to invoke from multiple threads at once.
   Shrinker(spv_target_env target_env, MessageConsumer consumer,
            const std::vector<uint32_t>& binary_in,
            const protobufs::FactSequence& initial_facts,
            const protobufs::TransformationSequence& transformation_sequence_in,
            const InterestingnessFunction& interestingness_function,
            uint32_t step_limit, bool validate_during_replay,
-           spv_validator_options validator_options);
+           spv_validator_options validator_options, uint32_t num_threads);
 
   // Disables copy/move constructor/assignment operations.
   Shrinker(const Shrinker&) = delete;
@@ -88,6 +94,28 @@ class Shrinker {
   ShrinkerResult Run();
 
  private:
+  // The outcome of an attempt to shrink by removing a chunk of
+  // transformations.
+  struct ChunkRemovalResult {
+    // False if replaying the smaller transformation sequence failed.
+    bool replay_succeeded;
+    // True if the binary arising from replay is interesting.
+    bool interesting;
+    std::vector<uint32_t> transformed_binary;
+    TransformationSubsequence applied_transformations;
+  };
+
+  // Replays |transformations| with the chunk of size |chunk_size| starting
+  // from |chunk_index| x |chunk_size| removed, and checks whether the resulting
+  // binary is interesting, passing |attempt| to the interestingness function.
+  // Replay resumes from checkpoints in |checkpoint_cache| where possible.
+  // This does not modify the state of the shrinker, so that several chunk
+  // removals can be tried concurrently.
+  ChunkRemovalResult TryRemoveChunk(
+      const TransformationSubsequence& transformations,
+      uint32_t chunk_index, uint32_t chunk_size, uint32_t attempt,
+      ReplayCheckpointCache* checkpoint_cache) const;
+
   // Returns the id bound for the given SPIR-V binary, which is assumed to be
   // valid.
   uint32_t GetIdBound(const std::vector<uint32_t>& binary) const;
@@ -120,6 +148,9 @@ class Shrinker {
 
   // Options to control validation.
   spv_validator_options validator_options_;
+
+  // The maximum number of chunk removals to try concurrently.
+  const uint32_t num_threads_;
 };
 
 }  // namespace fuzz
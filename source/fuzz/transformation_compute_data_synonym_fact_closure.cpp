@@ -24,8 +24,10 @@ TransformationComputeDataSynonymFactClosure::
 
 TransformationComputeDataSynonymFactClosure::
     TransformationComputeDataSynonymFactClosure(
-        uint32_t maximum_equivalence_class_size) {
+        uint32_t maximum_equivalence_class_size,
+        uint32_t maximum_pairs_to_consider) {
   message_.set_maximum_equivalence_class_size(maximum_equivalence_class_size);
+  message_.set_maximum_pairs_to_consider(maximum_pairs_to_consider);
 }
 
 bool TransformationComputeDataSynonymFactClosure::IsApplicable(
@@ -37,7 +39,8 @@ void TransformationComputeDataSynonymFactClosure::Apply(
     opt::IRContext* /*unused*/,
     TransformationContext* transformation_context) const {
   transformation_context->GetFactManager()->ComputeClosureOfFacts(
-      message_.maximum_equivalence_class_size());
+      message_.maximum_equivalence_class_size(),
+      message_.maximum_pairs_to_consider());
 }
 
 protobufs::Transformation
@@ -28,8 +28,9 @@ class TransformationComputeDataSynonymFactClosure : public Transformation {
   explicit TransformationComputeDataSynonymFactClosure(
       protobufs::TransformationComputeDataSynonymFactClosure message);
 
-  explicit TransformationComputeDataSynonymFactClosure(
-      uint32_t maximum_equivalence_class_size);
+  TransformationComputeDataSynonymFactClosure(
+      uint32_t maximum_equivalence_class_size,
+      uint32_t maximum_pairs_to_consider);
 
   // This transformation is trivially applicable.
   bool IsApplicable(
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/transformation_subsequence.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+
+namespace spvtools {
+namespace fuzz {
+
+TransformationSubsequence::TransformationSubsequence()
+    : sequence_(std::make_shared<protobufs::TransformationSequence>()) {}
+
+TransformationSubsequence::TransformationSubsequence(
+    std::shared_ptr<const protobufs::TransformationSequence> sequence)
+    : sequence_(std::move(sequence)) {
+  assert(sequence_ && "A sequence must be provided.");
+  indices_in_sequence_.reserve(
+      static_cast<size_t>(sequence_->transformation_size()));
+  for (uint32_t i = 0;
+       i < static_cast<uint32_t>(sequence_->transformation_size()); i++) {
+    indices_in_sequence_.push_back(i);
+  }
+}
+
+TransformationSubsequence::TransformationSubsequence(
+    std::shared_ptr<const protobufs::TransformationSequence> sequence,
+    std::vector<uint32_t> indices_in_sequence)
+    : sequence_(std::move(sequence)),
+      indices_in_sequence_(std::move(indices_in_sequence)) {
+  assert(sequence_ && "A sequence must be provided.");
+  assert(std::adjacent_find(indices_in_sequence_.begin(),
+                            indices_in_sequence_.end(),
+                            std::greater_equal<uint32_t>()) ==
+             indices_in_sequence_.end() &&
+         "Indices must be strictly increasing.");
+  assert((indices_in_sequence_.empty() ||
+          indices_in_sequence_.back() <
+              static_cast<uint32_t>(sequence_->transformation_size())) &&
+         "Indices must be in range.");
+}
+
+TransformationSubsequence TransformationSubsequence::WithoutRange(
+    uint32_t lower, uint32_t upper) const {
+  assert(lower <= upper && upper <= size() && "Invalid range.");
+  std::vector<uint32_t> indices;
+  indices.reserve(indices_in_sequence_.size() - (upper - lower));
+  indices.insert(indices.end(), indices_in_sequence_.begin(),
+                 indices_in_sequence_.begin() + lower);
+  indices.insert(indices.end(), indices_in_sequence_.begin() + upper,
+                 indices_in_sequence_.end());
+  return TransformationSubsequence(sequence_, std::move(indices));
+}
+
+protobufs::TransformationSequence TransformationSubsequence::ToMessage()
+    const {
+  protobufs::TransformationSequence result;
+  for (auto index : indices_in_sequence_) {
+    *result.add_transformation() =
+        sequence_->transformation(static_cast<int>(index));
+  }
+  return result;
+}
+
+}  // namespace fuzz
+}  // namespace spvtools
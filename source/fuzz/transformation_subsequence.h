@@ -0,0 +1,90 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_FUZZ_TRANSFORMATION_SUBSEQUENCE_H_
+#define SOURCE_FUZZ_TRANSFORMATION_SUBSEQUENCE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
+
+namespace spvtools {
+namespace fuzz {
+
+// A subsequence of a sequence of transformations, represented by the indices
+// of its transformations in the sequence.  The sequence is shared by all of
+// the subsequences that are derived from it, rather than copied, so that
+// e.g. removing a chunk of transformations costs one index per remaining
+// transformation, however large the transformations themselves are.
+class TransformationSubsequence {
+ public:
+  // Creates an empty subsequence of an empty sequence.
+  TransformationSubsequence();
+
+  // Creates a subsequence that comprises the whole of |sequence|.
+  explicit TransformationSubsequence(
+      std::shared_ptr<const protobufs::TransformationSequence> sequence);
+
+  // Creates the subsequence of |sequence| comprising the transformations at
+  // |indices_in_sequence|, which must be in range and strictly increasing.
+  TransformationSubsequence(
+      std::shared_ptr<const protobufs::TransformationSequence> sequence,
+      std::vector<uint32_t> indices_in_sequence);
+
+  // Returns the number of transformations in the subsequence.
+  uint32_t size() const {
+    return static_cast<uint32_t>(indices_in_sequence_.size());
+  }
+
+  bool empty() const { return indices_in_sequence_.empty(); }
+
+  // Returns transformation |index| of the subsequence.
+  const protobufs::Transformation& operator[](uint32_t index) const {
+    return sequence_->transformation(
+        static_cast<int>(indices_in_sequence_[index]));
+  }
+
+  // Returns the index in the underlying sequence of transformation |index| of
+  // the subsequence.
+  uint32_t GetIndexInSequence(uint32_t index) const {
+    return indices_in_sequence_[index];
+  }
+
+  // Returns the underlying sequence.
+  const std::shared_ptr<const protobufs::TransformationSequence>& GetSequence()
+      const {
+    return sequence_;
+  }
+
+  // Returns a subsequence of the same sequence that is identical to this one,
+  // except that transformations [|lower|, |upper|) are removed.  Requires
+  // |lower| <= |upper| <= size().
+  TransformationSubsequence WithoutRange(uint32_t lower, uint32_t upper) const;
+
+  // Returns a copy of the transformations of the subsequence, for use where a
+  // self-contained message is needed, e.g. when writing them out.
+  protobufs::TransformationSequence ToMessage() const;
+
+ private:
+  std::shared_ptr<const protobufs::TransformationSequence> sequence_;
+
+  std::vector<uint32_t> indices_in_sequence_;
+};
+
+}  // namespace fuzz
+}  // namespace spvtools
+
+#endif  // SOURCE_FUZZ_TRANSFORMATION_SUBSEQUENCE_H_
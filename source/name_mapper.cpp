@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <locale>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -297,6 +298,7 @@ spv_result_t FriendlyNameMapper::ParseInstruction(
       break;
     case SpvOpConstant: {
       std::ostringstream value;
+      value.imbue(std::locale::classic());
       EmitNumericLiteral(&value, inst, inst.operands[2]);
       auto value_str = value.str();
       // Use 'n' to signify negative. Other invalid characters will be mapped
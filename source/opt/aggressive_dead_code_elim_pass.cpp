@@ -179,12 +179,10 @@ bool AggressiveDCEPass::IsTargetDead(Instruction* inst) {
 void AggressiveDCEPass::ProcessLoad(Function* func, uint32_t varId) {
   // Only process locals
   if (!IsLocalVar(varId)) return;
-  // Return if already processed
-  if (live_local_vars_.find(varId) != live_local_vars_.end()) return;
+  // Return if already processed, else cache varId as processed
+  if (live_local_vars_.Set(varId)) return;
   // Mark all stores to varId as live
   AddStores(func, varId);
-  // Cache varId as processed
-  live_local_vars_.insert(varId);
 }
 
 bool AggressiveDCEPass::IsStructuredHeader(BasicBlock* bp,
@@ -339,7 +337,7 @@ bool AggressiveDCEPass::AggressiveDCE(Function* func) {
   call_in_func_ = false;
   func_is_entry_point_ = false;
   private_stores_.clear();
-  live_local_vars_.clear();
+  live_local_vars_.ClearAll();
   // Stacks to keep track of when we are inside an if- or loop-construct.
   // When immediately inside an if- or loop-construct, we do not initially
   // mark branches live. All other branches must be marked live.
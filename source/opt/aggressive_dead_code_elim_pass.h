@@ -181,7 +181,7 @@ class AggressiveDCEPass : public MemPass {
   utils::BitVector live_insts_;
 
   // Live Local Variables
-  std::unordered_set<uint32_t> live_local_vars_;
+  utils::BitVector live_local_vars_;
 
   // List of instructions to delete. Deletion is delayed until debug and
   // annotation instructions are processed.
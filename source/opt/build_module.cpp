@@ -21,6 +21,7 @@
 #include "source/opt/ir_loader.h"
 #include "source/table.h"
 #include "source/util/make_unique.h"
+#include "source/val/validate.h"
 
 namespace spvtools {
 namespace {
@@ -58,18 +59,41 @@ std::unique_ptr<opt::IRContext> BuildModule(spv_target_env env,
                                             const uint32_t* binary,
                                             const size_t size,
                                             bool extra_line_tracking) {
-  auto context = spvContextCreate(env);
-  SetContextMessageConsumer(context, consumer);
+  spv_context_t context = *GetSharedContext(env);
+  SetContextMessageConsumer(&context, consumer);
 
   auto irContext = MakeUnique<opt::IRContext>(env, consumer);
   opt::IrLoader loader(consumer, irContext->module());
   loader.SetExtraLineTracking(extra_line_tracking);
 
-  spv_result_t status = spvBinaryParse(context, &loader, binary, size,
+  spv_result_t status = spvBinaryParse(&context, &loader, binary, size,
                                        SetSpvHeader, SetSpvInst, nullptr);
   loader.EndModule();
 
-  spvContextDestroy(context);
+  return status == SPV_SUCCESS ? std::move(irContext) : nullptr;
+}
+
+std::unique_ptr<opt::IRContext> BuildAndValidateModule(
+    spv_target_env env, MessageConsumer consumer, const uint32_t* binary,
+    const size_t size, spv_const_validator_options validator_options) {
+  spv_context_t context = *GetSharedContext(env);
+  SetContextMessageConsumer(&context, consumer);
+
+  auto irContext = MakeUnique<opt::IRContext>(env, consumer);
+  opt::IrLoader loader(consumer, irContext->module());
+  loader.SetExtraLineTracking(true);
+
+  // The validator reports a single diagnostic; hand it on to |consumer| the
+  // way SpirvTools::Validate does.
+  spv_diagnostic diagnostic = nullptr;
+  spv_result_t status = val::ValidateBinaryAndForwardInstructions(
+      &context, validator_options, binary, size, &diagnostic, &loader,
+      SetSpvHeader, SetSpvInst);
+  if (status != SPV_SUCCESS && diagnostic != nullptr && consumer) {
+    consumer(SPV_MSG_ERROR, nullptr, diagnostic->position, diagnostic->error);
+  }
+  spvDiagnosticDestroy(diagnostic);
+  loader.EndModule();
 
   return status == SPV_SUCCESS ? std::move(irContext) : nullptr;
 }
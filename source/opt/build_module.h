@@ -41,6 +41,16 @@ std::unique_ptr<opt::IRContext> BuildModule(spv_target_env env,
                                             const uint32_t* binary,
                                             size_t size);
 
+// Like the above, but also validates |binary| according to
+// |validator_options| while it is being decoded, so that the instructions are
+// fully decoded only once; the validator's only other pass over the binary is
+// a prescan of the OpCapability and OpExtension prologue.  Returns nullptr,
+// and sends the errors to |consumer|, if |binary| is invalid or if errors
+// occur while building the module.
+std::unique_ptr<opt::IRContext> BuildAndValidateModule(
+    spv_target_env env, MessageConsumer consumer, const uint32_t* binary,
+    size_t size, spv_const_validator_options validator_options);
+
 // Builds an Module and returns the owning IRContext from the given
 // SPIR-V assembly |text|.  The |text| will be encoded according to the given
 // target |env|. Returns nullptr if errors occur and sends the errors to
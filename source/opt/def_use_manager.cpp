@@ -50,7 +50,9 @@ void DefUseManager::AnalyzeInstUse(Instruction* inst) {
   used_ids->clear();  // It might have existed before.
 
   for (uint32_t i = 0; i < inst->NumOperands(); ++i) {
-    switch (inst->GetOperand(i).type) {
+    // Read through a const pointer, so that an instruction journaled by a
+    // transaction is not taken to be changed.
+    switch (static_cast<const Instruction*>(inst)->GetOperand(i).type) {
       // For any id type but result id type
       case SPV_OPERAND_TYPE_ID:
       case SPV_OPERAND_TYPE_TYPE_ID:
@@ -31,6 +31,7 @@ namespace opt {
 
 class CFG;
 class IRContext;
+class IRJournal;
 class Module;
 
 // A SPIR-V function.
@@ -190,6 +191,8 @@ class Function {
   std::unique_ptr<Instruction> end_inst_;
   // Non-semantic instructions succeeded by this function.
   std::vector<std::unique_ptr<Instruction>> non_semantic_;
+
+  friend class IRJournal;
 };
 
 // Pretty-prints |func| to |str|. Returns |str|.
@@ -51,7 +51,8 @@ Instruction::Instruction(IRContext* c)
       has_type_id_(false),
       has_result_id_(false),
       unique_id_(c->TakeNextUniqueId()),
-      dbg_scope_(kNoDebugScope, kNoInlinedAt) {}
+      dbg_scope_(kNoDebugScope, kNoInlinedAt),
+      journaled_(false) {}
 
 Instruction::Instruction(IRContext* c, SpvOp op)
     : utils::IntrusiveNodeBase<Instruction>(),
@@ -60,7 +61,8 @@ Instruction::Instruction(IRContext* c, SpvOp op)
       has_type_id_(false),
       has_result_id_(false),
       unique_id_(c->TakeNextUniqueId()),
-      dbg_scope_(kNoDebugScope, kNoInlinedAt) {}
+      dbg_scope_(kNoDebugScope, kNoInlinedAt),
+      journaled_(false) {}
 
 Instruction::Instruction(IRContext* c, const spv_parsed_instruction_t& inst,
                          std::vector<Instruction>&& dbg_line)
@@ -70,15 +72,17 @@ Instruction::Instruction(IRContext* c, const spv_parsed_instruction_t& inst,
       has_result_id_(inst.result_id != 0),
       unique_id_(c->TakeNextUniqueId()),
       dbg_line_insts_(std::move(dbg_line)),
-      dbg_scope_(kNoDebugScope, kNoInlinedAt) {
+      dbg_scope_(kNoDebugScope, kNoInlinedAt),
+      journaled_(false) {
   assert((!IsDebugLineInst(opcode_) || dbg_line.empty()) &&
          "Op(No)Line attaching to Op(No)Line found");
+  operands_.reserve(inst.num_operands);
   for (uint32_t i = 0; i < inst.num_operands; ++i) {
     const auto& current_payload = inst.operands[i];
-    std::vector<uint32_t> words(
-        inst.words + current_payload.offset,
-        inst.words + current_payload.offset + current_payload.num_words);
-    operands_.emplace_back(current_payload.type, std::move(words));
+    const uint32_t* first_word = inst.words + current_payload.offset;
+    operands_.emplace_back(current_payload.type, Operand::OperandData());
+    operands_.back().words.insert(operands_.back().words.end(), first_word,
+                                  first_word + current_payload.num_words);
   }
 }
 
@@ -89,13 +93,15 @@ Instruction::Instruction(IRContext* c, const spv_parsed_instruction_t& inst,
       has_type_id_(inst.type_id != 0),
       has_result_id_(inst.result_id != 0),
       unique_id_(c->TakeNextUniqueId()),
-      dbg_scope_(dbg_scope) {
+      dbg_scope_(dbg_scope),
+      journaled_(false) {
+  operands_.reserve(inst.num_operands);
   for (uint32_t i = 0; i < inst.num_operands; ++i) {
     const auto& current_payload = inst.operands[i];
-    std::vector<uint32_t> words(
-        inst.words + current_payload.offset,
-        inst.words + current_payload.offset + current_payload.num_words);
-    operands_.emplace_back(current_payload.type, std::move(words));
+    const uint32_t* first_word = inst.words + current_payload.offset;
+    operands_.emplace_back(current_payload.type, Operand::OperandData());
+    operands_.back().words.insert(operands_.back().words.end(), first_word,
+                                  first_word + current_payload.num_words);
   }
 }
 
@@ -108,7 +114,8 @@ Instruction::Instruction(IRContext* c, SpvOp op, uint32_t ty_id,
       has_result_id_(res_id != 0),
       unique_id_(c->TakeNextUniqueId()),
       operands_(),
-      dbg_scope_(kNoDebugScope, kNoInlinedAt) {
+      dbg_scope_(kNoDebugScope, kNoInlinedAt),
+      journaled_(false) {
   if (has_type_id_) {
     operands_.emplace_back(spv_operand_type_t::SPV_OPERAND_TYPE_TYPE_ID,
                            std::initializer_list<uint32_t>{ty_id});
@@ -120,21 +127,52 @@ Instruction::Instruction(IRContext* c, SpvOp op, uint32_t ty_id,
   operands_.insert(operands_.end(), in_operands.begin(), in_operands.end());
 }
 
+Instruction::Instruction(const Instruction& that)
+    : utils::IntrusiveNodeBase<Instruction>(that),
+      context_(that.context_),
+      opcode_(that.opcode_),
+      has_type_id_(that.has_type_id_),
+      has_result_id_(that.has_result_id_),
+      unique_id_(that.unique_id_),
+      operands_(that.operands_),
+      dbg_line_insts_(that.dbg_line_insts_),
+      dbg_scope_(that.dbg_scope_),
+      journaled_(false) {}
+
+Instruction& Instruction::operator=(const Instruction& that) {
+  RecordBeforeImageIfJournaled();
+  utils::IntrusiveNodeBase<Instruction>::operator=(that);
+  context_ = that.context_;
+  opcode_ = that.opcode_;
+  has_type_id_ = that.has_type_id_;
+  has_result_id_ = that.has_result_id_;
+  unique_id_ = that.unique_id_;
+  operands_ = that.operands_;
+  dbg_line_insts_ = that.dbg_line_insts_;
+  dbg_scope_ = that.dbg_scope_;
+  return *this;
+}
+
 Instruction::Instruction(Instruction&& that)
     : utils::IntrusiveNodeBase<Instruction>(),
       opcode_(that.opcode_),
       has_type_id_(that.has_type_id_),
       has_result_id_(that.has_result_id_),
       unique_id_(that.unique_id_),
-      operands_(std::move(that.operands_)),
-      dbg_line_insts_(std::move(that.dbg_line_insts_)),
-      dbg_scope_(that.dbg_scope_) {
+      dbg_scope_(that.dbg_scope_),
+      journaled_(false) {
+  // Moving from |that| changes it, so the journal must see it first.
+  that.RecordBeforeImageIfJournaled();
+  operands_ = std::move(that.operands_);
+  dbg_line_insts_ = std::move(that.dbg_line_insts_);
   for (auto& i : dbg_line_insts_) {
     i.dbg_scope_ = that.dbg_scope_;
   }
 }
 
 Instruction& Instruction::operator=(Instruction&& that) {
+  RecordBeforeImageIfJournaled();
+  that.RecordBeforeImageIfJournaled();
   opcode_ = that.opcode_;
   has_type_id_ = that.has_type_id_;
   has_result_id_ = that.has_result_id_;
@@ -157,6 +195,13 @@ Instruction* Instruction::Clone(IRContext* c) const {
   return clone;
 }
 
+void Instruction::RecordBeforeImage() {
+  journaled_ = false;
+  if (IRJournal* journal = context_->journal()) {
+    journal->RecordBeforeImage(*this);
+  }
+}
+
 uint32_t Instruction::GetSingleWordOperand(uint32_t index) const {
   const auto& words = GetOperand(index).words;
   assert(words.size() == 1 && "expected the operand only taking one word");
@@ -189,6 +234,7 @@ void Instruction::ToBinaryWithoutAttachedDebugInsts(
 }
 
 void Instruction::ReplaceOperands(const OperandList& new_operands) {
+  RecordBeforeImageIfJournaled();
   operands_.clear();
   operands_.insert(operands_.begin(), new_operands.begin(), new_operands.end());
 }
@@ -502,6 +548,7 @@ uint32_t Instruction::GetTypeComponent(uint32_t element) const {
 }
 
 void Instruction::UpdateLexicalScope(uint32_t scope) {
+  RecordBeforeImageIfJournaled();
   dbg_scope_.SetLexicalScope(scope);
   for (auto& i : dbg_line_insts_) {
     i.dbg_scope_.SetLexicalScope(scope);
@@ -513,6 +560,7 @@ void Instruction::UpdateLexicalScope(uint32_t scope) {
 }
 
 void Instruction::UpdateDebugInlinedAt(uint32_t new_inlined_at) {
+  RecordBeforeImageIfJournaled();
   dbg_scope_.SetInlinedAt(new_inlined_at);
   for (auto& i : dbg_line_insts_) {
     i.dbg_scope_.SetInlinedAt(new_inlined_at);
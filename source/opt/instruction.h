@@ -19,6 +19,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,7 @@
 #include "source/opcode.h"
 #include "source/operand.h"
 #include "source/opt/reflect.h"
+#include "source/util/allocator.h"
 #include "source/util/ilist_node.h"
 #include "source/util/small_vector.h"
 #include "spirv-tools/libspirv.h"
@@ -40,6 +42,7 @@ namespace opt {
 
 class Function;
 class IRContext;
+class IRJournal;
 class Module;
 class InstructionList;
 
@@ -120,6 +123,11 @@ inline bool operator!=(const Operand& o1, const Operand& o2) {
   return !(o1 == o2);
 }
 
+// OperandList grows by moving its operands only if moving cannot throw;
+// otherwise it copies each operand, and any heap buffer that it holds.
+static_assert(std::is_nothrow_move_constructible<Operand>::value,
+              "Moving an Operand must not throw.");
+
 // This structure is used to represent a DebugScope instruction from
 // the OpenCL.100.DebugInfo extened instruction set. Note that we can
 // ignore the result id of DebugScope instruction because it is not
@@ -170,6 +178,15 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   using iterator = OperandList::iterator;
   using const_iterator = OperandList::const_iterator;
 
+  // Instructions are the most numerous objects of a module, so they are
+  // obtained from the client allocator, if one is in scope (see
+  // utils::ScopedAllocator).  The same allocator must be in scope when they
+  // are destroyed.
+  static void* operator new(size_t size) { return utils::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    utils::Deallocate(ptr, size);
+  }
+
   // Creates a default OpNop instruction.
   // This exists solely for containers that can't do without. Should be removed.
   Instruction()
@@ -179,7 +196,8 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
         has_type_id_(false),
         has_result_id_(false),
         unique_id_(0),
-        dbg_scope_(kNoDebugScope, kNoInlinedAt) {}
+        dbg_scope_(kNoDebugScope, kNoInlinedAt),
+        journaled_(false) {}
 
   // Creates a default OpNop instruction.
   Instruction(IRContext*);
@@ -203,13 +221,13 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
 
   // TODO: I will want to remove these, but will first have to remove the use of
   // std::vector<Instruction>.
-  Instruction(const Instruction&) = default;
-  Instruction& operator=(const Instruction&) = default;
+  Instruction(const Instruction&);
+  Instruction& operator=(const Instruction&);
 
   Instruction(Instruction&&);
   Instruction& operator=(Instruction&&);
 
-  ~Instruction() override = default;
+  ~Instruction() override { RecordBeforeImageIfJournaled(); }
 
   // Returns a newly allocated instruction that has the same operands, result,
   // and type as |this|.  The new instruction is not linked into any list.
@@ -225,7 +243,10 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   // invalidate the instruction.
   // TODO(qining): Remove this function when instruction building and insertion
   // is well implemented.
-  void SetOpcode(SpvOp op) { opcode_ = op; }
+  void SetOpcode(SpvOp op) {
+    RecordBeforeImageIfJournaled();
+    opcode_ = op;
+  }
   uint32_t type_id() const {
     return has_type_id_ ? GetSingleWordOperand(0) : 0;
   }
@@ -238,7 +259,10 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   }
   // Returns the vector of line-related debug instructions attached to this
   // instruction and the caller can directly modify them.
-  std::vector<Instruction>& dbg_line_insts() { return dbg_line_insts_; }
+  std::vector<Instruction>& dbg_line_insts() {
+    RecordBeforeImageIfJournaled();
+    return dbg_line_insts_;
+  }
   const std::vector<Instruction>& dbg_line_insts() const {
     return dbg_line_insts_;
   }
@@ -248,10 +272,14 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   }
 
   // Clear line-related debug instructions attached to this instruction.
-  void clear_dbg_line_insts() { dbg_line_insts_.clear(); }
+  void clear_dbg_line_insts() {
+    RecordBeforeImageIfJournaled();
+    dbg_line_insts_.clear();
+  }
 
   // Set line-related debug instructions.
   void set_dbg_line_insts(const std::vector<Instruction>& lines) {
+    RecordBeforeImageIfJournaled();
     dbg_line_insts_ = lines;
   }
 
@@ -261,8 +289,14 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   // inline void InsertAfter(Instruction* pos);
 
   // Begin and end iterators for operands.
-  iterator begin() { return operands_.begin(); }
-  iterator end() { return operands_.end(); }
+  iterator begin() {
+    RecordBeforeImageIfJournaled();
+    return operands_.begin();
+  }
+  iterator end() {
+    RecordBeforeImageIfJournaled();
+    return operands_.end();
+  }
   const_iterator begin() const { return operands_.cbegin(); }
   const_iterator end() const { return operands_.cend(); }
   // Const begin and end iterators for operands.
@@ -315,10 +349,12 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   void UpdateDebugInfoFrom(const Instruction* from);
   // Remove the |index|-th operand
   void RemoveOperand(uint32_t index) {
+    RecordBeforeImageIfJournaled();
     operands_.erase(operands_.begin() + index);
   }
   // Insert an operand before the |index|-th operand
   void InsertOperand(uint32_t index, Operand&& operand) {
+    RecordBeforeImageIfJournaled();
     operands_.insert(operands_.begin() + index, operand);
   }
 
@@ -337,6 +373,7 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
     return GetSingleWordOperand(index + TypeResultIdCount());
   }
   void RemoveInOperand(uint32_t index) {
+    RecordBeforeImageIfJournaled();
     operands_.erase(operands_.begin() + index + TypeResultIdCount());
   }
 
@@ -581,6 +618,18 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   // instruction that samples a image, reads an image, or writes to an image.
   bool IsValidBaseImage() const;
 
+  // Gives the transaction journal of the context a copy of this instruction,
+  // if the journal has not yet recorded the state of this instruction.  Called
+  // before any change to this instruction, and before anything that could
+  // lead to a change, such as handing out a non-const reference to one of its
+  // operands.
+  inline void RecordBeforeImageIfJournaled() {
+    if (journaled_) {
+      RecordBeforeImage();
+    }
+  }
+  void RecordBeforeImage();
+
   IRContext* context_;  // IR Context
   SpvOp opcode_;        // Opcode
   bool has_type_id_;    // True if the instruction has a type id
@@ -596,7 +645,13 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   // DebugScope that wraps this instruction.
   DebugScope dbg_scope_;
 
+  // True if this instruction is part of the module of a context with an
+  // active transaction, and the transaction journal has not yet recorded the
+  // state of this instruction.  See IRJournal.
+  bool journaled_;
+
   friend InstructionList;
+  friend IRJournal;
 };
 
 // Pretty-prints |inst| to |str| and returns |str|.
@@ -620,6 +675,7 @@ inline bool Instruction::operator<(const Instruction& other) const {
 }
 
 inline Operand& Instruction::GetOperand(uint32_t index) {
+  RecordBeforeImageIfJournaled();
   assert(index < operands_.size() && "operand index out of bound");
   return operands_[index];
 }
@@ -630,6 +686,7 @@ inline const Operand& Instruction::GetOperand(uint32_t index) const {
 }
 
 inline void Instruction::AddOperand(Operand&& operand) {
+  RecordBeforeImageIfJournaled();
   operands_.push_back(std::move(operand));
 }
 
@@ -642,10 +699,12 @@ inline void Instruction::SetOperand(uint32_t index,
                                     Operand::OperandData&& data) {
   assert(index < operands_.size() && "operand index out of bound");
   assert(index >= TypeResultIdCount() && "operand is not a in-operand");
+  RecordBeforeImageIfJournaled();
   operands_[index].words = std::move(data);
 }
 
 inline void Instruction::SetInOperands(OperandList&& new_operands) {
+  RecordBeforeImageIfJournaled();
   // Remove the old in operands.
   operands_.erase(operands_.begin() + TypeResultIdCount(), operands_.end());
   // Add the new in operands.
@@ -663,11 +722,13 @@ inline void Instruction::SetResultId(uint32_t res_id) {
   // and reset the has_result_id_ flag.
   assert(res_id != 0);
 
+  RecordBeforeImageIfJournaled();
   auto ridx = has_type_id_ ? 1 : 0;
   operands_[ridx].words = {res_id};
 }
 
 inline void Instruction::SetDebugScope(const DebugScope& scope) {
+  RecordBeforeImageIfJournaled();
   dbg_scope_ = scope;
   for (auto& i : dbg_line_insts_) {
     i.dbg_scope_ = scope;
@@ -685,6 +746,7 @@ inline void Instruction::SetResultType(uint32_t ty_id) {
   // and reset the has_type_id_ flag.
   assert(ty_id != 0);
 
+  RecordBeforeImageIfJournaled();
   operands_.front().words = {ty_id};
 }
 
@@ -694,6 +756,7 @@ inline bool Instruction::IsNop() const {
 }
 
 inline void Instruction::ToNop() {
+  RecordBeforeImageIfJournaled();
   opcode_ = SpvOpNop;
   has_type_id_ = false;
   has_result_id_ = false;
@@ -703,6 +766,10 @@ inline void Instruction::ToNop() {
 inline bool Instruction::WhileEachInst(
     const std::function<bool(Instruction*)>& f, bool run_on_debug_line_insts) {
   if (run_on_debug_line_insts) {
+    // |f| may change the attached line instructions.
+    if (!dbg_line_insts_.empty()) {
+      RecordBeforeImageIfJournaled();
+    }
     for (auto& dbg_line : dbg_line_insts_) {
       if (!f(&dbg_line)) return false;
     }
@@ -743,6 +810,7 @@ inline void Instruction::ForEachInst(
 }
 
 inline void Instruction::ForEachId(const std::function<void(uint32_t*)>& f) {
+  RecordBeforeImageIfJournaled();
   for (auto& operand : operands_)
     if (spvIsIdType(operand.type)) f(&operand.words[0]);
 }
@@ -755,6 +823,7 @@ inline void Instruction::ForEachId(
 
 inline bool Instruction::WhileEachInId(
     const std::function<bool(uint32_t*)>& f) {
+  RecordBeforeImageIfJournaled();
   for (auto& operand : operands_) {
     if (spvIsInIdType(operand.type) && !f(&operand.words[0])) {
       return false;
@@ -790,6 +859,7 @@ inline void Instruction::ForEachInId(
 
 inline bool Instruction::WhileEachInOperand(
     const std::function<bool(uint32_t*)>& f) {
+  RecordBeforeImageIfJournaled();
   for (auto& operand : operands_) {
     switch (operand.type) {
       case SPV_OPERAND_TYPE_RESULT_ID:
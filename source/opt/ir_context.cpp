@@ -39,6 +39,41 @@ static const uint32_t kDebugGlobalVariableOperandVariableIndex = 11;
 namespace spvtools {
 namespace opt {
 
+std::unique_ptr<IRContext> IRContext::Clone(
+    Analysis analyses_to_preserve) const {
+  std::unique_ptr<IRContext> clone(
+      new IRContext(grammar_.target_env(), consumer_));
+  clone->module_ = module_->Clone(clone.get());
+  clone->max_id_bound_ = max_id_bound_;
+  clone->preserve_bindings_ = preserve_bindings_;
+  clone->preserve_spec_constants_ = preserve_spec_constants_;
+  clone->BuildInvalidAnalyses(
+      static_cast<Analysis>(valid_analyses_ & analyses_to_preserve));
+  return clone;
+}
+
+void IRContext::BeginTransaction() {
+  assert(!journal_ && "A transaction is already active.");
+  journal_ = MakeUnique<IRJournal>(this);
+}
+
+void IRContext::CommitTransaction() {
+  assert(journal_ && "There is no transaction to commit.");
+  journal_->Commit();
+  journal_.reset();
+}
+
+void IRContext::RollbackTransaction() {
+  assert(journal_ && "There is no transaction to roll back.");
+  // The journal is detached before the current module is discarded, so that
+  // the instructions being destroyed do not try to record their state.
+  std::unique_ptr<IRJournal> journal = std::move(journal_);
+  std::unique_ptr<Module> module = journal->Rollback();
+  InvalidateAnalysesExceptFor(kAnalysisNone);
+  ResetFeatureManager();
+  module_ = std::move(module);
+}
+
 void IRContext::BuildInvalidAnalyses(IRContext::Analysis set) {
   if (set & kAnalysisDefUse) {
     BuildDefUseManager();
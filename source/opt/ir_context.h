@@ -35,6 +35,7 @@
 #include "source/opt/dominator_analysis.h"
 #include "source/opt/feature_manager.h"
 #include "source/opt/fold.h"
+#include "source/opt/ir_journal.h"
 #include "source/opt/loop_descriptor.h"
 #include "source/opt/module.h"
 #include "source/opt/register_pressure.h"
@@ -42,7 +43,9 @@
 #include "source/opt/struct_cfg_analysis.h"
 #include "source/opt/type_manager.h"
 #include "source/opt/value_number_table.h"
+#include "source/table.h"
 #include "source/util/make_unique.h"
+#include "source/util/timer.h"
 
 namespace spvtools {
 namespace opt {
@@ -92,8 +95,7 @@ class IRContext {
 
   // Creates an |IRContext| that contains an owned |Module|
   IRContext(spv_target_env env, MessageConsumer c)
-      : syntax_context_(spvContextCreate(env)),
-        grammar_(syntax_context_),
+      : grammar_(GetSharedContext(env)),
         unique_id_(0),
         module_(new Module()),
         consumer_(std::move(c)),
@@ -105,13 +107,11 @@ class IRContext {
         max_id_bound_(kDefaultMaxIdBound),
         preserve_bindings_(false),
         preserve_spec_constants_(false) {
-    SetContextMessageConsumer(syntax_context_, consumer_);
     module_->SetContext(this);
   }
 
   IRContext(spv_target_env env, std::unique_ptr<Module>&& m, MessageConsumer c)
-      : syntax_context_(spvContextCreate(env)),
-        grammar_(syntax_context_),
+      : grammar_(GetSharedContext(env)),
         unique_id_(0),
         module_(std::move(m)),
         consumer_(std::move(c)),
@@ -122,15 +122,58 @@ class IRContext {
         max_id_bound_(kDefaultMaxIdBound),
         preserve_bindings_(false),
         preserve_spec_constants_(false) {
-    SetContextMessageConsumer(syntax_context_, consumer_);
     module_->SetContext(this);
     InitializeCombinators();
   }
 
-  ~IRContext() { spvContextDestroy(syntax_context_); }
+  ~IRContext() {
+    // Any transaction must end before the module is destroyed.
+    journal_.reset();
+  }
 
   Module* module() const { return module_.get(); }
 
+  // Returns a deep copy of this context.  The copy has the same target
+  // environment, message consumer and settings, and its module is a copy of
+  // this context's module, made directly rather than by writing the module to
+  // a binary and parsing it again.  Instructions in the copy have unique ids
+  // of their own.
+  //
+  // The analyses in |analyses_to_preserve| that are valid in this context are
+  // built eagerly for the copy, so that they are valid there too; all other
+  // analyses are built on demand, as usual.
+  std::unique_ptr<IRContext> Clone(
+      Analysis analyses_to_preserve = kAnalysisNone) const;
+
+  // Starts a transaction.  The changes made to the module from then on,
+  // including the allocation of ids, can be undone by RollbackTransaction, or
+  // kept by CommitTransaction.  There can be at most one transaction at a
+  // time.
+  //
+  // This is cheaper than cloning the module up front: starting a transaction
+  // takes time linear in the size of the module but copies no instructions,
+  // and during the transaction each instruction is copied at most once, the
+  // first time it is changed or deleted.  See IRJournal.
+  void BeginTransaction();
+
+  // Ends the current transaction, keeping the changes made during it.
+  void CommitTransaction();
+
+  // Ends the current transaction, restoring the module to its state when the
+  // transaction started, and invalidating all analyses.  As with re-parsing
+  // the module, pointers to its functions, basic blocks and instructions are
+  // no longer valid afterwards; the restored instructions have the unique ids
+  // they had when the transaction started.
+  void RollbackTransaction();
+
+  // Returns true if and only if a transaction has been started and not yet
+  // ended.
+  bool HasActiveTransaction() const { return journal_ != nullptr; }
+
+  // Returns the journal of the current transaction, or nullptr if there is
+  // none.
+  IRJournal* journal() const { return journal_.get(); }
+
   // Returns a vector of pointers to constant-creation instructions in this
   // context.
   inline std::vector<Instruction*> GetConstants();
@@ -609,12 +652,14 @@ class IRContext {
  private:
   // Builds the def-use manager from scratch, even if it was already valid.
   void BuildDefUseManager() {
+    SPIRV_TRACE_SCOPE("Build def-use manager");
     def_use_mgr_ = MakeUnique<analysis::DefUseManager>(module());
     valid_analyses_ = valid_analyses_ | kAnalysisDefUse;
   }
 
   // Builds the instruction-block map for the whole module.
   void BuildInstrToBlockMapping() {
+    SPIRV_TRACE_SCOPE("Build instruction-to-block map");
     instr_to_block_.clear();
     for (auto& fn : *module_) {
       for (auto& block : fn) {
@@ -628,6 +673,7 @@ class IRContext {
 
   // Builds the instruction-function map for the whole module.
   void BuildIdToFuncMapping() {
+    SPIRV_TRACE_SCOPE("Build id-to-function map");
     id_to_func_.clear();
     for (auto& fn : *module_) {
       id_to_func_[fn.result_id()] = &fn;
@@ -636,22 +682,26 @@ class IRContext {
   }
 
   void BuildDecorationManager() {
+    SPIRV_TRACE_SCOPE("Build decoration manager");
     decoration_mgr_ = MakeUnique<analysis::DecorationManager>(module());
     valid_analyses_ = valid_analyses_ | kAnalysisDecorations;
   }
 
   void BuildCFG() {
+    SPIRV_TRACE_SCOPE("Build CFG");
     cfg_ = MakeUnique<CFG>(module());
     valid_analyses_ = valid_analyses_ | kAnalysisCFG;
   }
 
   void BuildScalarEvolutionAnalysis() {
+    SPIRV_TRACE_SCOPE("Build scalar evolution analysis");
     scalar_evolution_analysis_ = MakeUnique<ScalarEvolutionAnalysis>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisScalarEvolution;
   }
 
   // Builds the liveness analysis from scratch, even if it was already valid.
   void BuildRegPressureAnalysis() {
+    SPIRV_TRACE_SCOPE("Build liveness analysis");
     reg_pressure_ = MakeUnique<LivenessAnalysis>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisRegisterPressure;
   }
@@ -659,6 +709,7 @@ class IRContext {
   // Builds the value number table analysis from scratch, even if it was already
   // valid.
   void BuildValueNumberTable() {
+    SPIRV_TRACE_SCOPE("Build value number table");
     vn_table_ = MakeUnique<ValueNumberTable>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisValueNumberTable;
   }
@@ -666,6 +717,7 @@ class IRContext {
   // Builds the structured CFG analysis from scratch, even if it was already
   // valid.
   void BuildStructuredCFGAnalysis() {
+    SPIRV_TRACE_SCOPE("Build structured CFG analysis");
     struct_cfg_analysis_ = MakeUnique<StructuredCFGAnalysis>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisStructuredCFG;
   }
@@ -673,6 +725,7 @@ class IRContext {
   // Builds the constant manager from scratch, even if it was already
   // valid.
   void BuildConstantManager() {
+    SPIRV_TRACE_SCOPE("Build constant manager");
     constant_mgr_ = MakeUnique<analysis::ConstantManager>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisConstants;
   }
@@ -680,6 +733,7 @@ class IRContext {
   // Builds the type manager from scratch, even if it was already
   // valid.
   void BuildTypeManager() {
+    SPIRV_TRACE_SCOPE("Build type manager");
     type_mgr_ = MakeUnique<analysis::TypeManager>(consumer(), this);
     valid_analyses_ = valid_analyses_ | kAnalysisTypes;
   }
@@ -687,6 +741,7 @@ class IRContext {
   // Builds the debug information manager from scratch, even if it was
   // already valid.
   void BuildDebugInfoManager() {
+    SPIRV_TRACE_SCOPE("Build debug info manager");
     debug_info_mgr_ = MakeUnique<analysis::DebugInfoManager>(this);
     valid_analyses_ = valid_analyses_ | kAnalysisDebugInfo;
   }
@@ -744,11 +799,9 @@ class IRContext {
   // Add |var_id| to all entry points in module.
   void AddVarToEntryPoints(uint32_t var_id);
 
-  // The SPIR-V syntax context containing grammar tables for opcodes and
-  // operands.
-  spv_context syntax_context_;
-
-  // Auxiliary object for querying SPIR-V grammar facts.
+  // Auxiliary object for querying SPIR-V grammar facts, using the grammar
+  // tables of the context shared by all IRContexts for the same target
+  // environment.
   AssemblyGrammar grammar_;
 
   // An unique identifier for instructions in |module_|. Can be used to order
@@ -761,6 +814,9 @@ class IRContext {
   // The module being processed within this IR context.
   std::unique_ptr<Module> module_;
 
+  // The journal of the current transaction, if any.
+  std::unique_ptr<IRJournal> journal_;
+
   // A message consumer for diagnostics.
   MessageConsumer consumer_;
 
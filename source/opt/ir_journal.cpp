@@ -0,0 +1,175 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/ir_journal.h"
+
+#include <cassert>
+#include <utility>
+
+#include "source/opt/ir_context.h"
+#include "source/util/make_unique.h"
+
+namespace spvtools {
+namespace opt {
+
+IRJournal::IRJournal(IRContext* context)
+    : context_(context),
+      is_journaling_(true),
+      header_(context->module()->header_),
+      contains_debug_info_(context->module()->contains_debug_info_),
+      memory_model_(nullptr),
+      trailing_dbg_line_info_(context->module()->trailing_dbg_line_info_) {
+  Module* module = context->module();
+  for (InstructionList* section : GetGlobalSections(module)) {
+    global_sections_.emplace_back();
+    for (auto& inst : *section) {
+      global_sections_.back().push_back(Track(&inst));
+    }
+  }
+  if (module->memory_model_) {
+    memory_model_ = Track(module->memory_model_.get());
+  }
+  functions_.reserve(module->functions_.size());
+  for (auto& function : module->functions_) {
+    functions_.emplace_back();
+    FunctionLayout& layout = functions_.back();
+    layout.def_inst = Track(function->def_inst_.get());
+    for (auto& param : function->params_) {
+      layout.params.push_back(Track(param.get()));
+    }
+    for (auto& inst : function->debug_insts_in_header_) {
+      layout.debug_insts_in_header.push_back(Track(&inst));
+    }
+    layout.blocks.reserve(function->blocks_.size());
+    for (auto& block : function->blocks_) {
+      layout.blocks.push_back({Track(block->GetLabelInst()), {}});
+      for (auto& inst : *block) {
+        layout.blocks.back().instructions.push_back(Track(&inst));
+      }
+    }
+    layout.end_inst = Track(function->end_inst_.get());
+    for (auto& inst : function->non_semantic_) {
+      layout.non_semantic.push_back(Track(inst.get()));
+    }
+  }
+}
+
+IRJournal::~IRJournal() {
+  if (is_journaling_) {
+    StopJournaling();
+  }
+}
+
+void IRJournal::RecordBeforeImage(const Instruction& inst) {
+  assert(is_journaling_ && "Journaling has stopped.");
+  assert(before_images_.count(&inst) == 0 &&
+         "The state of the instruction has already been recorded.");
+  before_images_[&inst] = MakeUnique<Instruction>(inst);
+}
+
+void IRJournal::Commit() {
+  assert(is_journaling_ && "Journaling has stopped.");
+  StopJournaling();
+  before_images_.clear();
+}
+
+std::unique_ptr<Module> IRJournal::Rollback() {
+  assert(is_journaling_ && "Journaling has stopped.");
+  // This must happen first, while |before_images_| still tells which
+  // instructions no longer exist.
+  StopJournaling();
+
+  std::unique_ptr<Module> module(new Module());
+  module->SetContext(context_);
+  module->SetHeader(header_);
+  module->contains_debug_info_ = contains_debug_info_;
+  auto sections = GetGlobalSections(module.get());
+  for (size_t i = 0; i < sections.size(); i++) {
+    for (Instruction* inst : global_sections_[i]) {
+      sections[i]->push_back(TakeBeforeImage(inst));
+    }
+  }
+  if (memory_model_) {
+    module->memory_model_ = TakeBeforeImage(memory_model_);
+  }
+  module->functions_.reserve(functions_.size());
+  for (const auto& layout : functions_) {
+    std::unique_ptr<Function> function(
+        new Function(TakeBeforeImage(layout.def_inst)));
+    for (Instruction* param : layout.params) {
+      function->AddParameter(TakeBeforeImage(param));
+    }
+    for (Instruction* inst : layout.debug_insts_in_header) {
+      function->AddDebugInstructionInHeader(TakeBeforeImage(inst));
+    }
+    function->blocks_.reserve(layout.blocks.size());
+    for (const auto& block_layout : layout.blocks) {
+      std::unique_ptr<BasicBlock> block(
+          new BasicBlock(TakeBeforeImage(block_layout.label)));
+      for (Instruction* inst : block_layout.instructions) {
+        block->AddInstruction(TakeBeforeImage(inst));
+      }
+      function->AddBasicBlock(std::move(block));
+    }
+    function->SetFunctionEnd(TakeBeforeImage(layout.end_inst));
+    for (Instruction* inst : layout.non_semantic) {
+      function->AddNonSemanticInstruction(TakeBeforeImage(inst));
+    }
+    module->AddFunction(std::move(function));
+  }
+  module->trailing_dbg_line_info_ = std::move(trailing_dbg_line_info_);
+
+  before_images_.clear();
+  return module;
+}
+
+std::vector<InstructionList*> IRJournal::GetGlobalSections(Module* module) {
+  return {&module->capabilities_,       &module->extensions_,
+          &module->ext_inst_imports_,   &module->entry_points_,
+          &module->execution_modes_,    &module->debugs1_,
+          &module->debugs2_,            &module->debugs3_,
+          &module->ext_inst_debuginfo_, &module->annotations_,
+          &module->types_values_};
+}
+
+Instruction* IRJournal::Track(Instruction* inst) {
+  inst->journaled_ = true;
+  instructions_.push_back(inst);
+  return inst;
+}
+
+std::unique_ptr<Instruction> IRJournal::TakeBeforeImage(Instruction* inst) {
+  auto before_image = before_images_.find(inst);
+  if (before_image != before_images_.end()) {
+    return std::move(before_image->second);
+  }
+  // |inst| has not been changed, so a copy of it is as it was when journaling
+  // started.  The copy keeps the unique id of |inst|, which is fine because
+  // |inst| is about to be discarded with the rest of the current module.
+  return MakeUnique<Instruction>(*inst);
+}
+
+void IRJournal::StopJournaling() {
+  is_journaling_ = false;
+  for (Instruction* inst : instructions_) {
+    // An instruction with a before image may no longer exist, and is no
+    // longer journaled anyway.
+    if (before_images_.count(inst) == 0) {
+      inst->journaled_ = false;
+    }
+  }
+}
+
+}  // namespace opt
+}  // namespace spvtools
@@ -0,0 +1,131 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_IR_JOURNAL_H_
+#define SOURCE_OPT_IR_JOURNAL_H_
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "source/opt/instruction.h"
+#include "source/opt/instruction_list.h"
+#include "source/opt/module.h"
+
+namespace spvtools {
+namespace opt {
+
+class IRContext;
+
+// Records what is needed to undo the changes made to the module of an
+// IRContext after some point, without copying the module at that point.  This
+// is the mechanism behind IRContext::BeginTransaction, CommitTransaction and
+// RollbackTransaction, which are what clients should use.
+//
+// When journaling starts, the journal records the layout of the module: the
+// header, and which instructions appear where, as pointers.  From then on,
+// each of those instructions gives the journal a copy of itself the first time
+// it is about to be changed, moved from or deleted.  No copy is made of an
+// instruction that is left alone, or that is added and removed again after
+// journaling started.
+//
+// Committing only has to tell the instructions that were never changed that
+// they are no longer journaled.  Rolling back builds a new module with the
+// recorded layout, taking each instruction from its recorded copy if there is
+// one, and from the current module otherwise; the current module must then be
+// discarded.  Every instruction in the new module has the unique id it had when
+// journaling started.
+class IRJournal {
+ public:
+  // Starts journaling the module of |context|.
+  explicit IRJournal(IRContext* context);
+
+  IRJournal(const IRJournal&) = delete;
+  IRJournal& operator=(const IRJournal&) = delete;
+
+  // Stops journaling, as Commit does, unless journaling was already stopped.
+  ~IRJournal();
+
+  // Records a copy of |inst|, which must be an instruction of the journaled
+  // module whose state has not been recorded yet.
+  void RecordBeforeImage(const Instruction& inst);
+
+  // Returns the number of instructions whose state has been recorded because
+  // they were changed, moved from or deleted.
+  size_t GetNumBeforeImages() const { return before_images_.size(); }
+
+  // Stops journaling, keeping all changes made to the module.
+  void Commit();
+
+  // Stops journaling and returns the module as it was when journaling
+  // started.  The current module is not changed, and must be discarded by the
+  // caller.
+  std::unique_ptr<Module> Rollback();
+
+ private:
+  struct BasicBlockLayout {
+    Instruction* label;
+    std::vector<Instruction*> instructions;
+  };
+
+  struct FunctionLayout {
+    Instruction* def_inst;
+    std::vector<Instruction*> params;
+    std::vector<Instruction*> debug_insts_in_header;
+    std::vector<BasicBlockLayout> blocks;
+    Instruction* end_inst;
+    std::vector<Instruction*> non_semantic;
+  };
+
+  // Returns the lists that hold the instructions of |module| that are outside
+  // functions, apart from the memory model, in module layout order.
+  static std::vector<InstructionList*> GetGlobalSections(Module* module);
+
+  // Marks |inst| as journaled, and returns it.
+  Instruction* Track(Instruction* inst);
+
+  // Returns the instruction that should take the place of |inst| when rolling
+  // back: its recorded copy if there is one, and a copy of |inst| otherwise.
+  std::unique_ptr<Instruction> TakeBeforeImage(Instruction* inst);
+
+  // Marks all instructions that are still journaled as no longer journaled.
+  void StopJournaling();
+
+  IRContext* context_;
+
+  // True until Commit or Rollback is called.
+  bool is_journaling_;
+
+  // The layout of the module when journaling started.
+  ModuleHeader header_;
+  bool contains_debug_info_;
+  std::vector<std::vector<Instruction*>> global_sections_;
+  Instruction* memory_model_;
+  std::vector<FunctionLayout> functions_;
+  std::vector<Instruction> trailing_dbg_line_info_;
+
+  // Every instruction in the layout above.
+  std::vector<Instruction*> instructions_;
+
+  // Maps each instruction that has been changed, moved from or deleted since
+  // journaling started to a copy of its state when journaling started.
+  std::unordered_map<const Instruction*, std::unique_ptr<Instruction>>
+      before_images_;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_IR_JOURNAL_H_
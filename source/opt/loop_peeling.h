@@ -16,6 +16,7 @@
 #define SOURCE_OPT_LOOP_PEELING_H_
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <memory>
 #include <tuple>
@@ -250,12 +251,16 @@ class LoopPeelingPass : public Pass {
   // Sets the loop peeling growth threshold. If the code size increase is above
   // |code_grow_threshold|, the loop will not be peeled. The code size is
   // measured in terms of SPIR-V instructions.
+  // The threshold is shared by all loop peeling passes, and may be set while
+  // other threads are running them.
   static void SetLoopPeelingThreshold(size_t code_grow_threshold) {
-    code_grow_threshold_ = code_grow_threshold;
+    code_grow_threshold_.store(code_grow_threshold);
   }
 
   // Returns the loop peeling code growth threshold.
-  static size_t GetLoopPeelingThreshold() { return code_grow_threshold_; }
+  static size_t GetLoopPeelingThreshold() {
+    return code_grow_threshold_.load();
+  }
 
   const char* name() const override { return "loop-peeling"; }
 
@@ -326,7 +331,7 @@ class LoopPeelingPass : public Pass {
   // Peel |loop| if profitable.
   std::pair<bool, Loop*> ProcessLoop(Loop* loop, CodeMetrics* loop_size);
 
-  static size_t code_grow_threshold_;
+  static std::atomic<size_t> code_grow_threshold_;
   LoopPeelingStats* stats_;
 };
 
@@ -24,6 +24,65 @@
 
 namespace spvtools {
 namespace opt {
+namespace {
+
+// Instruction::Clone copies the line instructions attached to an instruction
+// as they are, so that the copies still belong to the original context.
+// Replaces the line instructions attached to |inst| by clones that belong to
+// the context of |inst|.
+void CloneDbgLineInstsIntoOwnContext(Instruction* inst) {
+  if (inst->dbg_line_insts().empty()) {
+    return;
+  }
+  std::vector<Instruction> dbg_line_insts;
+  dbg_line_insts.reserve(inst->dbg_line_insts().size());
+  for (const auto& dbg_line_inst : inst->dbg_line_insts()) {
+    std::unique_ptr<Instruction> clone(dbg_line_inst.Clone(inst->context()));
+    dbg_line_insts.push_back(*clone);
+  }
+  inst->set_dbg_line_insts(dbg_line_insts);
+}
+
+}  // namespace
+
+std::unique_ptr<Module> Module::Clone(IRContext* context) const {
+  std::unique_ptr<Module> clone(new Module());
+  clone->SetContext(context);
+  clone->header_ = header_;
+  clone->contains_debug_info_ = contains_debug_info_;
+
+  auto clone_list = [context](const InstructionList& from,
+                              InstructionList* to) {
+    for (const auto& inst : from) {
+      to->push_back(std::unique_ptr<Instruction>(inst.Clone(context)));
+    }
+  };
+  clone_list(capabilities_, &clone->capabilities_);
+  clone_list(extensions_, &clone->extensions_);
+  clone_list(ext_inst_imports_, &clone->ext_inst_imports_);
+  if (memory_model_) {
+    clone->memory_model_.reset(memory_model_->Clone(context));
+  }
+  clone_list(entry_points_, &clone->entry_points_);
+  clone_list(execution_modes_, &clone->execution_modes_);
+  clone_list(debugs1_, &clone->debugs1_);
+  clone_list(debugs2_, &clone->debugs2_);
+  clone_list(debugs3_, &clone->debugs3_);
+  clone_list(ext_inst_debuginfo_, &clone->ext_inst_debuginfo_);
+  clone_list(annotations_, &clone->annotations_);
+  clone_list(types_values_, &clone->types_values_);
+  clone->functions_.reserve(functions_.size());
+  for (const auto& function : functions_) {
+    clone->functions_.emplace_back(function->Clone(context));
+  }
+  for (const auto& dbg_line_inst : trailing_dbg_line_info_) {
+    std::unique_ptr<Instruction> inst_clone(dbg_line_inst.Clone(context));
+    clone->trailing_dbg_line_info_.push_back(*inst_clone);
+  }
+
+  clone->ForEachInst(CloneDbgLineInstsIntoOwnContext);
+  return clone;
+}
 
 uint32_t Module::TakeNextIdBound() {
   if (context()) {
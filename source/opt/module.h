@@ -29,6 +29,7 @@ namespace spvtools {
 namespace opt {
 
 class IRContext;
+class IRJournal;
 
 // A struct for containing the module header information.
 struct ModuleHeader {
@@ -246,6 +247,12 @@ class Module {
   // If |skip_nop| is true and this is a OpNop, do nothing.
   void ToBinary(std::vector<uint32_t>* binary, bool skip_nop) const;
 
+  // Returns a deep copy of this module whose instructions, including attached
+  // line instructions, belong to |context| and have unique ids taken from
+  // |context|.  The copy's associated context is set to |context|, which is
+  // expected to own the copy.
+  std::unique_ptr<Module> Clone(IRContext* context) const;
+
   // Returns 1 more than the maximum Id value mentioned in the module.
   uint32_t ComputeIdBound() const;
 
@@ -303,6 +310,8 @@ class Module {
 
   // This module contains DebugScope/DebugNoScope or OpLine/OpNoLine.
   bool contains_debug_info_;
+
+  friend class IRJournal;
 };
 
 // Pretty-prints |module| to |str|. Returns |str|.
@@ -14,19 +14,26 @@
 
 #include "spirv-tools/optimizer.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "source/binary.h"
+#include "source/diagnostic.h"
 #include "source/opt/build_module.h"
 #include "source/opt/graphics_robust_access_pass.h"
 #include "source/opt/log.h"
 #include "source/opt/pass_manager.h"
 #include "source/opt/passes.h"
 #include "source/spirv_optimizer_options.h"
+#include "source/table.h"
+#include "source/util/allocator.h"
 #include "source/util/make_unique.h"
 #include "source/util/string_utils.h"
 
@@ -34,10 +41,29 @@ namespace spvtools {
 
 struct Optimizer::PassToken::Impl {
   Impl(std::unique_ptr<opt::Pass> p) : pass(std::move(p)) {}
+  Impl(std::function<std::unique_ptr<opt::Pass>()> f)
+      : pass(f()), factory(std::move(f)) {}
 
   std::unique_ptr<opt::Pass> pass;  // Internal implementation pass.
+
+  // Creates a fresh instance of the pass for each run of the optimizer.  Null
+  // for out-of-tree passes, which can only be run once.
+  std::function<std::unique_ptr<opt::Pass>()> factory;
 };
 
+namespace {
+
+// Returns a token for a pass of type |T| constructed from |args|, that is
+// instantiated from copies of |args| each time the optimizer is run.
+template <typename T, typename... Args>
+Optimizer::PassToken MakePassToken(Args... args) {
+  return MakeUnique<Optimizer::PassToken::Impl>(
+      std::function<std::unique_ptr<opt::Pass>()>(
+          [args...]() { return MakeUnique<T>(args...); }));
+}
+
+}  // namespace
+
 Optimizer::PassToken::PassToken(
     std::unique_ptr<Optimizer::PassToken::Impl> impl)
     : impl_(std::move(impl)) {}
@@ -56,12 +82,91 @@ Optimizer::PassToken& Optimizer::PassToken::operator=(PassToken&& that) {
 Optimizer::PassToken::~PassToken() {}
 
 struct Optimizer::Impl {
-  explicit Impl(spv_target_env env) : target_env(env), pass_manager() {}
-
-  spv_target_env target_env;      // Target environment.
-  opt::PassManager pass_manager;  // Internal implementation pass manager.
+  // A pass registered with the optimizer.
+  struct RegisteredPass {
+    // The name of the pass.
+    std::string name;
+
+    // Creates the instance of the pass used by a run of the optimizer.
+    std::function<std::unique_ptr<opt::Pass>()> factory;
+
+    // For a pass without a factory, the only instance of the pass, which is
+    // used by the first run of the optimizer.
+    std::unique_ptr<opt::Pass> pass;
+  };
+
+  explicit Impl(spv_target_env env)
+      : target_env(env),
+        print_all_stream(nullptr),
+        time_report_stream(nullptr),
+        validate_after_all(false),
+        allocator{nullptr, nullptr, nullptr},
+        has_run_passes_without_factory(false) {}
+
+  spv_target_env target_env;  // Target environment.
+  MessageConsumer consumer;   // Message consumer.
+
+  // Options for the pass manager of each run; see the corresponding setters
+  // of opt::PassManager.
+  std::ostream* print_all_stream;
+  std::ostream* time_report_stream;
+  bool validate_after_all;
+
+  // The allocator of the instructions of the modules that runs build from a
+  // binary; the global operator new is used if it has no |allocate| function.
+  spv_allocator_t allocator;
+
+  // The registered passes, in order.  Each run of the optimizer gets its own
+  // pass manager and its own instances of the passes, so that no state is
+  // carried from one run to the next and runs can proceed concurrently.
+  std::vector<RegisteredPass> passes;
+
+  // Set by the first run that uses the passes without a factory, if any; such
+  // passes cannot be used by another run.
+  std::atomic<bool> has_run_passes_without_factory;
+
+  // Runs the registered passes on |context|, as directed by |opt_options|.
+  opt::Pass::Status RunPasses(opt::IRContext* context,
+                              const spv_optimizer_options opt_options);
 };
 
+opt::Pass::Status Optimizer::Impl::RunPasses(
+    opt::IRContext* context, const spv_optimizer_options opt_options) {
+  context->set_max_id_bound(opt_options->max_id_bound_);
+  context->set_preserve_bindings(opt_options->preserve_bindings_);
+  context->set_preserve_spec_constants(opt_options->preserve_spec_constants_);
+
+  opt::PassManager pass_manager;
+  pass_manager.SetMessageConsumer(consumer);
+  pass_manager.SetPrintAll(print_all_stream);
+  pass_manager.SetTimeReport(time_report_stream);
+  pass_manager.SetValidateAfterAll(validate_after_all);
+  pass_manager.SetValidatorOptions(&opt_options->val_options_);
+  pass_manager.SetTargetEnv(target_env);
+  bool uses_passes_without_factory = false;
+  for (const auto& registered_pass : passes) {
+    if (!registered_pass.factory) {
+      uses_passes_without_factory = true;
+    }
+  }
+  if (uses_passes_without_factory &&
+      has_run_passes_without_factory.exchange(true)) {
+    Errorf(consumer, nullptr, {},
+           "The optimizer cannot be run more than once, as it has passes that "
+           "were registered without a way to instantiate them again");
+    return opt::Pass::Status::Failure;
+  }
+  for (auto& registered_pass : passes) {
+    std::unique_ptr<opt::Pass> pass = registered_pass.factory
+                                          ? registered_pass.factory()
+                                          : std::move(registered_pass.pass);
+    pass->SetMessageConsumer(consumer);
+    pass_manager.AddPass(std::move(pass));
+  }
+
+  return pass_manager.Run(context);
+}
+
 Optimizer::Optimizer(spv_target_env env) : impl_(new Impl(env)) {
   assert(env != SPV_ENV_WEBGPU_0);
 }
@@ -69,21 +174,20 @@ Optimizer::Optimizer(spv_target_env env) : impl_(new Impl(env)) {
 Optimizer::~Optimizer() {}
 
 void Optimizer::SetMessageConsumer(MessageConsumer c) {
-  // All passes' message consumer needs to be updated.
-  for (uint32_t i = 0; i < impl_->pass_manager.NumPasses(); ++i) {
-    impl_->pass_manager.GetPass(i)->SetMessageConsumer(c);
-  }
-  impl_->pass_manager.SetMessageConsumer(std::move(c));
+  // Passes get the consumer when they are instantiated for a run.
+  impl_->consumer = std::move(c);
 }
 
-const MessageConsumer& Optimizer::consumer() const {
-  return impl_->pass_manager.consumer();
-}
+const MessageConsumer& Optimizer::consumer() const { return impl_->consumer; }
 
 Optimizer& Optimizer::RegisterPass(PassToken&& p) {
-  // Change to use the pass manager's consumer.
-  p.impl_->pass->SetMessageConsumer(consumer());
-  impl_->pass_manager.AddPass(std::move(p.impl_->pass));
+  Impl::RegisteredPass registered_pass;
+  registered_pass.name = p.impl_->pass->name();
+  registered_pass.factory = std::move(p.impl_->factory);
+  if (!registered_pass.factory) {
+    registered_pass.pass = std::move(p.impl_->pass);
+  }
+  impl_->passes.push_back(std::move(registered_pass));
   return *this;
 }
 
@@ -536,25 +640,20 @@ bool Optimizer::Run(const uint32_t* original_binary,
                     const size_t original_binary_size,
                     std::vector<uint32_t>* optimized_binary,
                     const spv_optimizer_options opt_options) const {
-  spvtools::SpirvTools tools(impl_->target_env);
-  tools.SetMessageConsumer(impl_->pass_manager.consumer());
-  if (opt_options->run_validator_ &&
-      !tools.Validate(original_binary, original_binary_size,
-                      &opt_options->val_options_)) {
-    return false;
-  }
-
-  std::unique_ptr<opt::IRContext> context = BuildModule(
-      impl_->target_env, consumer(), original_binary, original_binary_size);
+  utils::ScopedAllocator scoped_allocator(&impl_->allocator);
+
+  // When validating, the module is built from the same parse of the binary
+  // that the validator uses, rather than parsing the binary again.
+  std::unique_ptr<opt::IRContext> context =
+      opt_options->run_validator_
+          ? BuildAndValidateModule(impl_->target_env, consumer(),
+                                   original_binary, original_binary_size,
+                                   &opt_options->val_options_)
+          : BuildModule(impl_->target_env, consumer(), original_binary,
+                        original_binary_size);
   if (context == nullptr) return false;
 
-  context->set_max_id_bound(opt_options->max_id_bound_);
-  context->set_preserve_bindings(opt_options->preserve_bindings_);
-  context->set_preserve_spec_constants(opt_options->preserve_spec_constants_);
-
-  impl_->pass_manager.SetValidatorOptions(&opt_options->val_options_);
-  impl_->pass_manager.SetTargetEnv(impl_->target_env);
-  auto status = impl_->pass_manager.Run(context.get());
+  auto status = impl_->RunPasses(context.get(), opt_options);
 
   if (status == opt::Pass::Status::Failure) {
     return false;
@@ -590,354 +689,427 @@ bool Optimizer::Run(const uint32_t* original_binary,
   return true;
 }
 
+bool Optimizer::Run(opt::IRContext* context,
+                    const spv_optimizer_options opt_options) const {
+  // The instructions of |context| are freed through whichever allocator is in
+  // scope then, so new ones come from the allocator in scope now rather than
+  // from the one set with SetAllocator().
+  return impl_->RunPasses(context, opt_options) != opt::Pass::Status::Failure;
+}
+
 Optimizer& Optimizer::SetPrintAll(std::ostream* out) {
-  impl_->pass_manager.SetPrintAll(out);
+  impl_->print_all_stream = out;
   return *this;
 }
 
 Optimizer& Optimizer::SetTimeReport(std::ostream* out) {
-  impl_->pass_manager.SetTimeReport(out);
+  impl_->time_report_stream = out;
   return *this;
 }
 
 Optimizer& Optimizer::SetValidateAfterAll(bool validate) {
-  impl_->pass_manager.SetValidateAfterAll(validate);
+  impl_->validate_after_all = validate;
+  return *this;
+}
+
+Optimizer& Optimizer::SetAllocator(const spv_allocator_t* allocator) {
+  impl_->allocator =
+      allocator ? *allocator : spv_allocator_t{nullptr, nullptr, nullptr};
   return *this;
 }
 
 Optimizer::PassToken CreateNullPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::NullPass>());
+  return MakePassToken<opt::NullPass>();
 }
 
 Optimizer::PassToken CreateStripDebugInfoPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::StripDebugInfoPass>());
+  return MakePassToken<opt::StripDebugInfoPass>();
 }
 
 Optimizer::PassToken CreateStripReflectInfoPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::StripReflectInfoPass>());
+  return MakePassToken<opt::StripReflectInfoPass>();
 }
 
 Optimizer::PassToken CreateEliminateDeadFunctionsPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::EliminateDeadFunctionsPass>());
+  return MakePassToken<opt::EliminateDeadFunctionsPass>();
 }
 
 Optimizer::PassToken CreateEliminateDeadMembersPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::EliminateDeadMembersPass>());
+  return MakePassToken<opt::EliminateDeadMembersPass>();
 }
 
 Optimizer::PassToken CreateSetSpecConstantDefaultValuePass(
     const std::unordered_map<uint32_t, std::string>& id_value_map) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SetSpecConstantDefaultValuePass>(id_value_map));
+  return MakePassToken<opt::SetSpecConstantDefaultValuePass>(id_value_map);
 }
 
 Optimizer::PassToken CreateSetSpecConstantDefaultValuePass(
     const std::unordered_map<uint32_t, std::vector<uint32_t>>& id_value_map) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SetSpecConstantDefaultValuePass>(id_value_map));
+  return MakePassToken<opt::SetSpecConstantDefaultValuePass>(id_value_map);
 }
 
 Optimizer::PassToken CreateFlattenDecorationPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::FlattenDecorationPass>());
+  return MakePassToken<opt::FlattenDecorationPass>();
 }
 
 Optimizer::PassToken CreateFreezeSpecConstantValuePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::FreezeSpecConstantValuePass>());
+  return MakePassToken<opt::FreezeSpecConstantValuePass>();
 }
 
 Optimizer::PassToken CreateFoldSpecConstantOpAndCompositePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::FoldSpecConstantOpAndCompositePass>());
+  return MakePassToken<opt::FoldSpecConstantOpAndCompositePass>();
 }
 
 Optimizer::PassToken CreateUnifyConstantPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::UnifyConstantPass>());
+  return MakePassToken<opt::UnifyConstantPass>();
 }
 
 Optimizer::PassToken CreateEliminateDeadConstantPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::EliminateDeadConstantPass>());
+  return MakePassToken<opt::EliminateDeadConstantPass>();
 }
 
 Optimizer::PassToken CreateDeadVariableEliminationPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::DeadVariableElimination>());
+  return MakePassToken<opt::DeadVariableElimination>();
 }
 
 Optimizer::PassToken CreateStrengthReductionPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::StrengthReductionPass>());
+  return MakePassToken<opt::StrengthReductionPass>();
 }
 
 Optimizer::PassToken CreateBlockMergePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::BlockMergePass>());
+  return MakePassToken<opt::BlockMergePass>();
 }
 
 Optimizer::PassToken CreateInlineExhaustivePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InlineExhaustivePass>());
+  return MakePassToken<opt::InlineExhaustivePass>();
 }
 
 Optimizer::PassToken CreateInlineOpaquePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InlineOpaquePass>());
+  return MakePassToken<opt::InlineOpaquePass>();
 }
 
 Optimizer::PassToken CreateLocalAccessChainConvertPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LocalAccessChainConvertPass>());
+  return MakePassToken<opt::LocalAccessChainConvertPass>();
 }
 
 Optimizer::PassToken CreateLocalSingleBlockLoadStoreElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LocalSingleBlockLoadStoreElimPass>());
+  return MakePassToken<opt::LocalSingleBlockLoadStoreElimPass>();
 }
 
 Optimizer::PassToken CreateLocalSingleStoreElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LocalSingleStoreElimPass>());
+  return MakePassToken<opt::LocalSingleStoreElimPass>();
 }
 
 Optimizer::PassToken CreateInsertExtractElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SimplificationPass>());
+  return MakePassToken<opt::SimplificationPass>();
 }
 
 Optimizer::PassToken CreateDeadInsertElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::DeadInsertElimPass>());
+  return MakePassToken<opt::DeadInsertElimPass>();
 }
 
 Optimizer::PassToken CreateDeadBranchElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::DeadBranchElimPass>());
+  return MakePassToken<opt::DeadBranchElimPass>();
 }
 
 Optimizer::PassToken CreateLocalMultiStoreElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SSARewritePass>());
+  return MakePassToken<opt::SSARewritePass>();
 }
 
 Optimizer::PassToken CreateAggressiveDCEPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::AggressiveDCEPass>());
+  return MakePassToken<opt::AggressiveDCEPass>();
 }
 
 Optimizer::PassToken CreateRemoveUnusedInterfaceVariablesPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::RemoveUnusedInterfaceVariablesPass>());
+  return MakePassToken<opt::RemoveUnusedInterfaceVariablesPass>();
 }
 
 Optimizer::PassToken CreatePropagateLineInfoPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::EmptyPass>());
+  return MakePassToken<opt::EmptyPass>();
 }
 
 Optimizer::PassToken CreateRedundantLineInfoElimPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::EmptyPass>());
+  return MakePassToken<opt::EmptyPass>();
 }
 
 Optimizer::PassToken CreateCompactIdsPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::CompactIdsPass>());
+  return MakePassToken<opt::CompactIdsPass>();
 }
 
 Optimizer::PassToken CreateMergeReturnPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::MergeReturnPass>());
+  return MakePassToken<opt::MergeReturnPass>();
 }
 
 std::vector<const char*> Optimizer::GetPassNames() const {
   std::vector<const char*> v;
-  for (uint32_t i = 0; i < impl_->pass_manager.NumPasses(); i++) {
-    v.push_back(impl_->pass_manager.GetPass(i)->name());
+  for (const auto& registered_pass : impl_->passes) {
+    v.push_back(registered_pass.name.c_str());
   }
   return v;
 }
 
 Optimizer::PassToken CreateCFGCleanupPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::CFGCleanupPass>());
+  return MakePassToken<opt::CFGCleanupPass>();
 }
 
 Optimizer::PassToken CreateLocalRedundancyEliminationPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LocalRedundancyEliminationPass>());
+  return MakePassToken<opt::LocalRedundancyEliminationPass>();
 }
 
 Optimizer::PassToken CreateLoopFissionPass(size_t threshold) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LoopFissionPass>(threshold));
+  return MakePassToken<opt::LoopFissionPass>(threshold);
 }
 
 Optimizer::PassToken CreateLoopFusionPass(size_t max_registers_per_loop) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LoopFusionPass>(max_registers_per_loop));
+  return MakePassToken<opt::LoopFusionPass>(max_registers_per_loop);
 }
 
 Optimizer::PassToken CreateLoopInvariantCodeMotionPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::LICMPass>());
+  return MakePassToken<opt::LICMPass>();
 }
 
 Optimizer::PassToken CreateLoopPeelingPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LoopPeelingPass>());
+  return MakePassToken<opt::LoopPeelingPass>();
 }
 
 Optimizer::PassToken CreateLoopUnswitchPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LoopUnswitchPass>());
+  return MakePassToken<opt::LoopUnswitchPass>();
 }
 
 Optimizer::PassToken CreateRedundancyEliminationPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::RedundancyEliminationPass>());
+  return MakePassToken<opt::RedundancyEliminationPass>();
 }
 
 Optimizer::PassToken CreateRemoveDuplicatesPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::RemoveDuplicatesPass>());
+  return MakePassToken<opt::RemoveDuplicatesPass>();
 }
 
 Optimizer::PassToken CreateScalarReplacementPass(uint32_t size_limit) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::ScalarReplacementPass>(size_limit));
+  return MakePassToken<opt::ScalarReplacementPass>(size_limit);
 }
 
 Optimizer::PassToken CreatePrivateToLocalPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::PrivateToLocalPass>());
+  return MakePassToken<opt::PrivateToLocalPass>();
 }
 
 Optimizer::PassToken CreateCCPPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::CCPPass>());
+  return MakePassToken<opt::CCPPass>();
 }
 
 Optimizer::PassToken CreateWorkaround1209Pass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::Workaround1209>());
+  return MakePassToken<opt::Workaround1209>();
 }
 
 Optimizer::PassToken CreateIfConversionPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::IfConversion>());
+  return MakePassToken<opt::IfConversion>();
 }
 
 Optimizer::PassToken CreateReplaceInvalidOpcodePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::ReplaceInvalidOpcodePass>());
+  return MakePassToken<opt::ReplaceInvalidOpcodePass>();
 }
 
 Optimizer::PassToken CreateSimplificationPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SimplificationPass>());
+  return MakePassToken<opt::SimplificationPass>();
 }
 
 Optimizer::PassToken CreateLoopUnrollPass(bool fully_unroll, int factor) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::LoopUnroller>(fully_unroll, factor));
+  return MakePassToken<opt::LoopUnroller>(fully_unroll, factor);
 }
 
 Optimizer::PassToken CreateSSARewritePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::SSARewritePass>());
+  return MakePassToken<opt::SSARewritePass>();
 }
 
 Optimizer::PassToken CreateCopyPropagateArraysPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::CopyPropagateArrays>());
+  return MakePassToken<opt::CopyPropagateArrays>();
 }
 
 Optimizer::PassToken CreateVectorDCEPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::VectorDCE>());
+  return MakePassToken<opt::VectorDCE>();
 }
 
 Optimizer::PassToken CreateReduceLoadSizePass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::ReduceLoadSize>());
+  return MakePassToken<opt::ReduceLoadSize>();
 }
 
 Optimizer::PassToken CreateCombineAccessChainsPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::CombineAccessChains>());
+  return MakePassToken<opt::CombineAccessChains>();
 }
 
 Optimizer::PassToken CreateUpgradeMemoryModelPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::UpgradeMemoryModel>());
+  return MakePassToken<opt::UpgradeMemoryModel>();
 }
 
 Optimizer::PassToken CreateInstBindlessCheckPass(
     uint32_t desc_set, uint32_t shader_id, bool desc_length_enable,
     bool desc_init_enable, bool buff_oob_enable, bool texbuff_oob_enable) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InstBindlessCheckPass>(
-          desc_set, shader_id, desc_length_enable, desc_init_enable,
-          buff_oob_enable, texbuff_oob_enable,
-          desc_length_enable || desc_init_enable || buff_oob_enable));
+  return MakePassToken<opt::InstBindlessCheckPass>(
+      desc_set, shader_id, desc_length_enable, desc_init_enable,
+      buff_oob_enable, texbuff_oob_enable,
+      desc_length_enable || desc_init_enable || buff_oob_enable);
 }
 
 Optimizer::PassToken CreateInstDebugPrintfPass(uint32_t desc_set,
                                                uint32_t shader_id) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InstDebugPrintfPass>(desc_set, shader_id));
+  return MakePassToken<opt::InstDebugPrintfPass>(desc_set, shader_id);
 }
 
 Optimizer::PassToken CreateInstBuffAddrCheckPass(uint32_t desc_set,
                                                  uint32_t shader_id) {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InstBuffAddrCheckPass>(desc_set, shader_id));
+  return MakePassToken<opt::InstBuffAddrCheckPass>(desc_set, shader_id);
 }
 
 Optimizer::PassToken CreateConvertRelaxedToHalfPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::ConvertToHalfPass>());
+  return MakePassToken<opt::ConvertToHalfPass>();
 }
 
 Optimizer::PassToken CreateRelaxFloatOpsPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::RelaxFloatOpsPass>());
+  return MakePassToken<opt::RelaxFloatOpsPass>();
 }
 
 Optimizer::PassToken CreateCodeSinkingPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::CodeSinkingPass>());
+  return MakePassToken<opt::CodeSinkingPass>();
 }
 
 Optimizer::PassToken CreateFixStorageClassPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::FixStorageClass>());
+  return MakePassToken<opt::FixStorageClass>();
 }
 
 Optimizer::PassToken CreateGraphicsRobustAccessPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::GraphicsRobustAccessPass>());
+  return MakePassToken<opt::GraphicsRobustAccessPass>();
 }
 
 Optimizer::PassToken CreateDescriptorScalarReplacementPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::DescriptorScalarReplacement>());
+  return MakePassToken<opt::DescriptorScalarReplacement>();
 }
 
 Optimizer::PassToken CreateWrapOpKillPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(MakeUnique<opt::WrapOpKill>());
+  return MakePassToken<opt::WrapOpKill>();
 }
 
 Optimizer::PassToken CreateAmdExtToKhrPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::AmdExtensionToKhrPass>());
+  return MakePassToken<opt::AmdExtensionToKhrPass>();
 }
 
 Optimizer::PassToken CreateInterpolateFixupPass() {
-  return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InterpFixupPass>());
+  return MakePassToken<opt::InterpFixupPass>();
 }
 
+namespace {
+
+// Returns the consumer to which the in-memory module API functions taking
+// |context| and |diagnostic| send their messages.
+MessageConsumer GetCApiConsumer(const spv_const_context context,
+                                spv_diagnostic* diagnostic) {
+  spv_context_t hijack_context = *context;
+  if (diagnostic) {
+    *diagnostic = nullptr;
+    UseDiagnosticAsMessageConsumer(&hijack_context, diagnostic);
+  }
+  return hijack_context.consumer;
+}
+
+}  // namespace
 }  // namespace spvtools
+
+struct spv_ir_module_t {
+  spv_target_env target_env;
+
+  // The allocator of the instructions of |context|, copied from the context
+  // the module was created with.  It is in scope whenever instructions are
+  // created or destroyed.
+  spv_allocator_t allocator;
+  std::unique_ptr<spvtools::opt::IRContext> context;
+
+  // The optimizer of the last call to spvIRModuleOptimize, and the flags its
+  // passes were registered from.  It is reused by the next call with the same
+  // flags, which then need not be parsed again.
+  std::unique_ptr<spvtools::Optimizer> optimizer;
+  std::vector<std::string> optimizer_flags;
+};
+
+spv_result_t spvIRModuleCreate(const spv_const_context context,
+                               const uint32_t* words, const size_t num_words,
+                               spv_const_validator_options options,
+                               spv_ir_module* module,
+                               spv_diagnostic* diagnostic) {
+  auto consumer = spvtools::GetCApiConsumer(context, diagnostic);
+  spvtools::utils::ScopedAllocator scoped_allocator(&context->allocator);
+  auto ir_context =
+      options ? spvtools::BuildAndValidateModule(context->target_env, consumer,
+                                                 words, num_words, options)
+              : spvtools::BuildModule(context->target_env, consumer, words,
+                                      num_words);
+  if (ir_context == nullptr) return SPV_ERROR_INVALID_BINARY;
+
+  // |consumer| may refer to |diagnostic|, which need not outlive this call.
+  ir_context->SetMessageConsumer(context->consumer);
+  *module = new spv_ir_module_t{context->target_env, context->allocator,
+                                std::move(ir_context), nullptr, {}};
+  return SPV_SUCCESS;
+}
+
+void spvIRModuleDestroy(spv_ir_module module) {
+  if (module == nullptr) return;
+  spvtools::utils::ScopedAllocator scoped_allocator(&module->allocator);
+  module->context.reset();
+  delete module;
+}
+
+spv_result_t spvIRModuleOptimize(const spv_const_context context,
+                                 spv_ir_module module,
+                                 const char* const* flags,
+                                 const size_t num_flags,
+                                 spv_optimizer_options options,
+                                 spv_diagnostic* diagnostic) {
+  auto consumer = spvtools::GetCApiConsumer(context, diagnostic);
+  std::vector<std::string> flag_strings(flags, flags + num_flags);
+  if (!module->optimizer || module->optimizer_flags != flag_strings) {
+    module->optimizer =
+        spvtools::MakeUnique<spvtools::Optimizer>(module->target_env);
+    module->optimizer->SetMessageConsumer(consumer);
+    if (!module->optimizer->RegisterPassesFromFlags(flag_strings)) {
+      module->optimizer.reset();
+      return SPV_ERROR_INVALID_VALUE;
+    }
+    module->optimizer_flags = std::move(flag_strings);
+  }
+  // The consumer belongs to this call's |context| and |diagnostic|, so it is
+  // set again even on a reused optimizer.
+  spvtools::Optimizer& optimizer = *module->optimizer;
+  optimizer.SetMessageConsumer(consumer);
+  spvtools::utils::ScopedAllocator scoped_allocator(&module->allocator);
+
+  spv_optimizer_options_t default_options;
+  if (options == nullptr) options = &default_options;
+  module->context->SetMessageConsumer(consumer);
+  bool succeeded = optimizer.Run(module->context.get(), options);
+  module->context->SetMessageConsumer(context->consumer);
+  optimizer.SetMessageConsumer(context->consumer);
+  return succeeded ? SPV_SUCCESS : SPV_ERROR_INTERNAL;
+}
+
+spv_result_t spvIRModuleValidate(const spv_const_context context,
+                                 spv_const_ir_module module,
+                                 spv_const_validator_options options,
+                                 spv_diagnostic* diagnostic) {
+  std::vector<uint32_t> binary;
+  module->context->module()->ToBinary(&binary, /* skip_nop = */ true);
+  if (options == nullptr) {
+    return spvValidateBinary(context, binary.data(), binary.size(),
+                             diagnostic);
+  }
+  spv_const_binary_t the_binary{binary.data(), binary.size()};
+  return spvValidateWithOptions(context, options, &the_binary, diagnostic);
+}
+
+spv_result_t spvIRModuleToBinary(spv_const_ir_module module,
+                                 spv_binary* binary) {
+  std::vector<uint32_t> words;
+  module->context->module()->ToBinary(&words, /* skip_nop = */ true);
+
+  spvtools::utils::ScopedAllocator scoped_allocator(&module->allocator);
+  *binary = spvBinaryCreate(words.size());
+  std::copy(words.begin(), words.end(), (*binary)->code);
+  return SPV_SUCCESS;
+}
@@ -47,8 +47,12 @@ Pass::Status PassManager::Run(IRContext* context) {
   for (auto& pass : passes_) {
     print_disassembly("; IR before pass ", pass.get());
     SPIRV_TIMER_SCOPED(time_report_stream_, (pass ? pass->name() : ""), true);
+    SPIRV_TRACE_SCOPE(pass->name());
     const auto one_status = pass->Run(context);
-    if (one_status == Pass::Status::Failure) return one_status;
+    if (one_status == Pass::Status::Failure) {
+      passes_.clear();
+      return one_status;
+    }
     if (one_status == Pass::Status::SuccessWithChange) status = one_status;
 
     if (validate_after_all_) {
@@ -61,6 +65,7 @@ Pass::Status PassManager::Run(IRContext* context) {
         msg += pass->name();
         spv_position_t null_pos{0, 0, 0};
         consumer()(SPV_MSG_INTERNAL_ERROR, "", null_pos, msg.c_str());
+        passes_.clear();
         return Pass::Status::Failure;
       }
     }
@@ -73,7 +73,8 @@ class PassManager {
   // corresponding Status::Success if processing is succesful to indicate
   // whether changes are made to the module.
   //
-  // After running all the passes, they are removed from the list.
+  // After running the passes, whether or not they succeed, they are removed
+  // from the list.
   Pass::Status Run(IRContext* context);
 
   // Sets the option to print the disassembly before each pass and after the
@@ -23,6 +23,8 @@
 #include "source/opt/function.h"
 #include "source/opt/ir_context.h"
 #include "source/opt/iterator.h"
+#include "source/util/bit_vector.h"
+#include "source/util/sparse_bit_vector.h"
 
 namespace spvtools {
 namespace opt {
@@ -220,7 +222,7 @@ class ComputeRegisterLiveness {
       }
       live_inout->used_registers_ = reg_count;
 
-      std::unordered_set<uint32_t> die_in_block;
+      utils::SparseBitVector die_in_block;
       for (Instruction& insn : make_range(bb.rbegin(), bb.rend())) {
         // If it is a phi instruction, the register pressure will not change
         // anymore.
@@ -236,10 +238,10 @@ class ComputeRegisterLiveness {
                 // already taken into account.
                 return;
               }
-              if (!die_in_block.count(*id)) {
+              if (!die_in_block.Get(*id)) {
                 live_inout->AddRegisterClass(def_use_manager_.GetDef(*id));
                 reg_count++;
-                die_in_block.insert(*id);
+                die_in_block.Set(*id);
               }
             });
         live_inout->used_registers_ =
@@ -301,17 +303,17 @@ void RegisterLiveness::ComputeLoopRegisterPressure(
                                         live_inout->live_in_.end());
   }
 
-  std::unordered_set<uint32_t> seen_insn;
+  utils::BitVector seen_insn;
   for (Instruction* insn : loop_reg_pressure->live_out_) {
     loop_reg_pressure->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
+    seen_insn.Set(insn->result_id());
   }
   for (Instruction* insn : loop_reg_pressure->live_in_) {
-    if (!seen_insn.count(insn->result_id())) {
+    if (!seen_insn.Get(insn->result_id())) {
       continue;
     }
     loop_reg_pressure->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
+    seen_insn.Set(insn->result_id());
   }
 
   loop_reg_pressure->used_registers_ = 0;
@@ -326,7 +328,7 @@ void RegisterLiveness::ComputeLoopRegisterPressure(
 
     for (Instruction& insn : *bb) {
       if (insn.opcode() == SpvOpPhi || !CreatesRegisterUsage(&insn) ||
-          seen_insn.count(insn.result_id())) {
+          seen_insn.Get(insn.result_id())) {
         continue;
       }
       loop_reg_pressure->AddRegisterClass(&insn);
@@ -360,17 +362,17 @@ void RegisterLiveness::SimulateFusion(
   }
 
   // Compute the register usage information.
-  std::unordered_set<uint32_t> seen_insn;
+  utils::BitVector seen_insn;
   for (Instruction* insn : sim_result->live_out_) {
     sim_result->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
+    seen_insn.Set(insn->result_id());
   }
   for (Instruction* insn : sim_result->live_in_) {
-    if (!seen_insn.count(insn->result_id())) {
+    if (!seen_insn.Get(insn->result_id())) {
       continue;
     }
     sim_result->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
+    seen_insn.Set(insn->result_id());
   }
 
   sim_result->used_registers_ = 0;
@@ -404,7 +406,7 @@ void RegisterLiveness::SimulateFusion(
 
     for (Instruction& insn : *bb) {
       if (insn.opcode() == SpvOpPhi || !CreatesRegisterUsage(&insn) ||
-          seen_insn.count(insn.result_id())) {
+          seen_insn.Get(insn.result_id())) {
         continue;
       }
       sim_result->AddRegisterClass(&insn);
@@ -435,7 +437,7 @@ void RegisterLiveness::SimulateFusion(
 
     for (Instruction& insn : *bb) {
       if (insn.opcode() == SpvOpPhi || !CreatesRegisterUsage(&insn) ||
-          seen_insn.count(insn.result_id())) {
+          seen_insn.Get(insn.result_id())) {
         continue;
       }
       sim_result->AddRegisterClass(&insn);
@@ -530,7 +532,7 @@ void RegisterLiveness::SimulateFission(
     size_t l2_reg_count =
         std::distance(l2_block_live_out.begin(), l2_block_live_out.end());
 
-    std::unordered_set<uint32_t> die_in_block;
+    utils::SparseBitVector die_in_block;
     for (Instruction& insn : make_range(bb->rbegin(), bb->rend())) {
       if (insn.opcode() == SpvOpPhi) {
         break;
@@ -547,14 +549,14 @@ void RegisterLiveness::SimulateFission(
           // already taken into account.
           return;
         }
-        if (!die_in_block.count(*id)) {
+        if (!die_in_block.Get(*id)) {
           if (does_belong_to_loop1) {
             l1_reg_count++;
           }
           if (does_belong_to_loop2) {
             l2_reg_count++;
           }
-          die_in_block.insert(*id);
+          die_in_block.Set(*id);
         }
       });
       l1_sim_result->used_registers_ =
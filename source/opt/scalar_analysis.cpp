@@ -46,10 +46,12 @@
 namespace spvtools {
 namespace opt {
 
-uint32_t SENode::NumberOfNodes = 0;
+SENode::SENode(ScalarEvolutionAnalysis* parent_analysis)
+    : parent_analysis_(parent_analysis),
+      unique_id_(parent_analysis->TakeNextNodeId()) {}
 
 ScalarEvolutionAnalysis::ScalarEvolutionAnalysis(IRContext* context)
-    : context_(context), pretend_equal_{} {
+    : context_(context), pretend_equal_{}, num_nodes_(0) {
   // Create and cached the CantComputeNode.
   cached_cant_compute_ =
       GetCachedOrAdd(std::unique_ptr<SECantCompute>(new SECantCompute(this)));
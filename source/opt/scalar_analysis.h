@@ -127,6 +127,10 @@ class ScalarEvolutionAnalysis {
     pretend_equal_[std::get<1>(loop_pair)] = std::get<0>(loop_pair);
   }
 
+  // Returns a new id for a node of this analysis.  Ids increase in the order
+  // the nodes are created.
+  uint32_t TakeNextNodeId() { return ++num_nodes_; }
+
  private:
   SENode* AnalyzeConstant(const Instruction* inst);
 
@@ -169,6 +173,11 @@ class ScalarEvolutionAnalysis {
   // Loops that should be considered the same for performing analysis for loop
   // fusion.
   std::map<const Loop*, const Loop*> pretend_equal_;
+
+  // The number of nodes created for this analysis.  This is per analysis
+  // rather than global so that analyses in concurrent runs of the optimizer
+  // do not share any state.
+  uint32_t num_nodes_;
 };
 
 // Wrapping class to manipulate SENode pointer using + - * / operators.
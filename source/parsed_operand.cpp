@@ -18,8 +18,19 @@
 
 #include <cassert>
 #include "source/util/hex_float.h"
+#include "source/util/parse_number.h"
 
 namespace spvtools {
+namespace {
+
+// Writes |value| to |out| in decimal, whatever the locale of |out|.
+template <typename T>
+void EmitInteger(std::ostream* out, T value) {
+  char buffer[utils::kMaxFormattedIntegerSize];
+  out->write(buffer, utils::FormatInteger(value, buffer));
+}
+
+}  // namespace
 
 void EmitNumericLiteral(std::ostream* out, const spv_parsed_instruction_t& inst,
                         const spv_parsed_operand_t& operand) {
@@ -34,10 +45,10 @@ void EmitNumericLiteral(std::ostream* out, const spv_parsed_instruction_t& inst,
   if (operand.num_words == 1) {
     switch (operand.number_kind) {
       case SPV_NUMBER_SIGNED_INT:
-        *out << int32_t(word);
+        EmitInteger(out, int64_t(int32_t(word)));
         break;
       case SPV_NUMBER_UNSIGNED_INT:
-        *out << word;
+        EmitInteger(out, uint64_t(word));
         break;
       case SPV_NUMBER_FLOATING:
         if (operand.number_bit_width == 16) {
@@ -57,10 +68,10 @@ void EmitNumericLiteral(std::ostream* out, const spv_parsed_instruction_t& inst,
         uint64_t(word) | (uint64_t(inst.words[operand.offset + 1]) << 32);
     switch (operand.number_kind) {
       case SPV_NUMBER_SIGNED_INT:
-        *out << int64_t(bits);
+        EmitInteger(out, int64_t(bits));
         break;
       case SPV_NUMBER_UNSIGNED_INT:
-        *out << bits;
+        EmitInteger(out, bits);
         break;
       case SPV_NUMBER_FLOATING:
         // Assume only 64-bit floats.
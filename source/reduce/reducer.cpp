@@ -35,13 +35,17 @@
 namespace spvtools {
 namespace reduce {
 
-Reducer::Reducer(spv_target_env target_env) : target_env_(target_env) {}
+Reducer::Reducer(spv_target_env target_env)
+    : target_env_(target_env),
+      passes_(static_cast<size_t>(PassLevel::kInstruction) + 1) {}
 
 Reducer::~Reducer() = default;
 
 void Reducer::SetMessageConsumer(MessageConsumer c) {
-  for (auto& pass : passes_) {
-    pass->SetMessageConsumer(c);
+  for (auto& level : passes_) {
+    for (auto& pass : level) {
+      pass->SetMessageConsumer(c);
+    }
   }
   for (auto& pass : cleanup_passes_) {
     pass->SetMessageConsumer(c);
@@ -82,14 +86,15 @@ Reducer::ReductionResultStatus Reducer::Run(
     return Reducer::ReductionResultStatus::kInitialStateNotInteresting;
   }
 
-  Reducer::ReductionResultStatus result =
-      RunPasses(&passes_, options, validator_options, tools, &current_binary,
-                &reductions_applied);
+  Reducer::ReductionResultStatus result = RunPassesHierarchically(
+      options, validator_options, tools, &current_binary, &reductions_applied);
 
   if (result == Reducer::ReductionResultStatus::kComplete) {
     // Cleanup passes.
+    bool cleanup_made_progress = false;
     result = RunPasses(&cleanup_passes_, options, validator_options, tools,
-                       &current_binary, &reductions_applied);
+                       &current_binary, &reductions_applied,
+                       &cleanup_made_progress);
   }
 
   if (result == Reducer::ReductionResultStatus::kComplete) {
@@ -104,34 +109,55 @@ Reducer::ReductionResultStatus Reducer::Run(
 }
 
 void Reducer::AddDefaultReductionPasses() {
+  // Function-level passes.
+
   AddReductionPass(
-      spvtools::MakeUnique<RemoveUnusedInstructionReductionOpportunityFinder>(
-          false));
+      spvtools::MakeUnique<RemoveFunctionReductionOpportunityFinder>(),
+      PassLevel::kFunction);
+
+  // Block-level passes.
+
+  AddReductionPass(spvtools::MakeUnique<
+                       StructuredConstructToBlockReductionOpportunityFinder>(),
+                   PassLevel::kBlock);
+  AddReductionPass(spvtools::MakeUnique<
+                       StructuredLoopToSelectionReductionOpportunityFinder>(),
+                   PassLevel::kBlock);
   AddReductionPass(
-      spvtools::MakeUnique<OperandToUndefReductionOpportunityFinder>());
+      spvtools::MakeUnique<MergeBlocksReductionOpportunityFinder>(),
+      PassLevel::kBlock);
   AddReductionPass(
-      spvtools::MakeUnique<OperandToConstReductionOpportunityFinder>());
+      spvtools::MakeUnique<RemoveBlockReductionOpportunityFinder>(),
+      PassLevel::kBlock);
   AddReductionPass(
-      spvtools::MakeUnique<OperandToDominatingIdReductionOpportunityFinder>());
-  AddReductionPass(spvtools::MakeUnique<
-                   StructuredConstructToBlockReductionOpportunityFinder>());
-  AddReductionPass(spvtools::MakeUnique<
-                   StructuredLoopToSelectionReductionOpportunityFinder>());
+      spvtools::MakeUnique<RemoveSelectionReductionOpportunityFinder>(),
+      PassLevel::kBlock);
   AddReductionPass(
-      spvtools::MakeUnique<MergeBlocksReductionOpportunityFinder>());
+      spvtools::MakeUnique<
+          ConditionalBranchToSimpleConditionalBranchOpportunityFinder>(),
+      PassLevel::kBlock);
   AddReductionPass(
-      spvtools::MakeUnique<RemoveFunctionReductionOpportunityFinder>());
+      spvtools::MakeUnique<SimpleConditionalBranchToBranchOpportunityFinder>(),
+      PassLevel::kBlock);
+
+  // Instruction-level passes.
+
   AddReductionPass(
-      spvtools::MakeUnique<RemoveBlockReductionOpportunityFinder>());
+      spvtools::MakeUnique<RemoveUnusedInstructionReductionOpportunityFinder>(
+          false),
+      PassLevel::kInstruction);
   AddReductionPass(
-      spvtools::MakeUnique<RemoveSelectionReductionOpportunityFinder>());
+      spvtools::MakeUnique<OperandToUndefReductionOpportunityFinder>(),
+      PassLevel::kInstruction);
   AddReductionPass(
-      spvtools::MakeUnique<
-          ConditionalBranchToSimpleConditionalBranchOpportunityFinder>());
+      spvtools::MakeUnique<OperandToConstReductionOpportunityFinder>(),
+      PassLevel::kInstruction);
   AddReductionPass(
-      spvtools::MakeUnique<SimpleConditionalBranchToBranchOpportunityFinder>());
+      spvtools::MakeUnique<OperandToDominatingIdReductionOpportunityFinder>(),
+      PassLevel::kInstruction);
   AddReductionPass(spvtools::MakeUnique<
-                   RemoveUnusedStructMemberReductionOpportunityFinder>());
+                       RemoveUnusedStructMemberReductionOpportunityFinder>(),
+                   PassLevel::kInstruction);
 
   // Cleanup passes.
 
@@ -141,8 +167,8 @@ void Reducer::AddDefaultReductionPasses() {
 }
 
 void Reducer::AddReductionPass(
-    std::unique_ptr<ReductionOpportunityFinder> finder) {
-  passes_.push_back(
+    std::unique_ptr<ReductionOpportunityFinder> finder, PassLevel level) {
+  passes_[static_cast<size_t>(level)].push_back(
       spvtools::MakeUnique<ReductionPass>(target_env_, std::move(finder)));
 }
 
@@ -157,11 +183,38 @@ bool Reducer::ReachedStepLimit(uint32_t current_step,
   return current_step >= options->step_limit;
 }
 
+Reducer::ReductionResultStatus Reducer::RunPassesHierarchically(
+    spv_const_reducer_options options, spv_validator_options validator_options,
+    const SpirvTools& tools, std::vector<uint32_t>* current_binary,
+    uint32_t* const reductions_applied) {
+  size_t level = 0;
+  while (level < passes_.size()) {
+    bool made_progress = false;
+    Reducer::ReductionResultStatus result =
+        RunPasses(&passes_[level], options, validator_options, tools,
+                  current_binary, reductions_applied, &made_progress);
+    if (result != Reducer::ReductionResultStatus::kComplete) {
+      return result;
+    }
+    if (made_progress && level > 0) {
+      // Progress at a finer level may have enabled further reductions at
+      // coarser levels (e.g. removing the last call to a function makes the
+      // function removable), so restart from the coarsest level.
+      level = 0;
+    } else {
+      // The passes at this level, and all coarser levels, have reached a
+      // fixed point, so move on to the next finer level.
+      level++;
+    }
+  }
+  return Reducer::ReductionResultStatus::kComplete;
+}
+
 Reducer::ReductionResultStatus Reducer::RunPasses(
     std::vector<std::unique_ptr<ReductionPass>>* passes,
     spv_const_reducer_options options, spv_validator_options validator_options,
     const SpirvTools& tools, std::vector<uint32_t>* current_binary,
-    uint32_t* const reductions_applied) {
+    uint32_t* const reductions_applied, bool* made_progress) {
   // Determines whether, on completing one round of reduction passes, it is
   // worthwhile trying a further round.
   bool another_round_worthwhile = true;
@@ -225,6 +278,7 @@ Reducer::ReductionResultStatus Reducer::RunPasses(
           *current_binary = std::move(maybe_result);
           interesting = true;
           another_round_worthwhile = true;
+          *made_progress = true;
         }
         // We must call this before the next call to TryApplyReduction.
         pass->NotifyInteresting(interesting);
@@ -40,6 +40,20 @@ class Reducer {
     kStateInvalid,
   };
 
+  // The level of a reduction pass.  Passes are scheduled hierarchically: all
+  // passes at a coarser level are run until they make no further progress
+  // before passes at a finer level are tried.  Whenever a finer level makes
+  // progress, scheduling restarts from the coarsest level, since e.g. removing
+  // a call instruction may make a whole function removable.
+  enum class PassLevel {
+    // Passes that remove or simplify whole functions.
+    kFunction,
+    // Passes that remove or simplify blocks and control-flow regions.
+    kBlock,
+    // Passes that remove or simplify individual instructions and operands.
+    kInstruction,
+  };
+
   // The type for a function that will take a binary and return true if and
   // only if the binary is deemed interesting. (The function also takes an
   // integer argument that will be incremented each time the function is
@@ -83,8 +97,10 @@ class Reducer {
   void AddDefaultReductionPasses();
 
   // Adds a reduction pass based on the given finder to the sequence of passes
-  // that will be iterated over.
-  void AddReductionPass(std::unique_ptr<ReductionOpportunityFinder> finder);
+  // that will be iterated over at the given |level|.  Passes added without a
+  // level are treated as instruction-level passes.
+  void AddReductionPass(std::unique_ptr<ReductionOpportunityFinder> finder,
+                        PassLevel level = PassLevel::kInstruction);
 
   // Adds a cleanup reduction pass based on the given finder to the sequence of
   // passes that will run after other passes.
@@ -105,6 +121,15 @@ class Reducer {
 
   ReductionResultStatus RunPasses(
       std::vector<std::unique_ptr<ReductionPass>>* passes,
+      spv_const_reducer_options options,
+      spv_validator_options validator_options, const SpirvTools& tools,
+      std::vector<uint32_t>* current_binary, uint32_t* reductions_applied,
+      bool* made_progress);
+
+  // Runs the passes of |passes_| level by level, from coarsest to finest,
+  // restarting from the coarsest level each time a finer level makes
+  // progress.
+  ReductionResultStatus RunPassesHierarchically(
       spv_const_reducer_options options,
       spv_validator_options validator_options, const SpirvTools& tools,
       std::vector<uint32_t>* current_binary, uint32_t* reductions_applied);
@@ -112,7 +137,8 @@ class Reducer {
   const spv_target_env target_env_;
   MessageConsumer consumer_;
   InterestingnessFunction interestingness_function_;
-  std::vector<std::unique_ptr<ReductionPass>> passes_;
+  // The reduction passes, indexed by PassLevel.
+  std::vector<std::vector<std::unique_ptr<ReductionPass>>> passes_;
   std::vector<std::unique_ptr<ReductionPass>> cleanup_passes_;
 };
 
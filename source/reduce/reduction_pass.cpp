@@ -23,18 +23,23 @@ namespace reduce {
 
 std::vector<uint32_t> ReductionPass::TryApplyReduction(
     const std::vector<uint32_t>& binary, uint32_t target_function) {
-  // We represent modules as binaries because (a) attempts at reduction need to
-  // end up in binary form to be passed on to SPIR-V-consuming tools, and (b)
-  // when we apply a reduction step we need to do it on a fresh version of the
-  // module as if the reduction step proves to be uninteresting we need to
-  // backtrack; re-parsing from binary provides a very clean way of cloning the
-  // module.
-  std::unique_ptr<opt::IRContext> context =
-      BuildModule(target_env_, consumer_, binary.data(), binary.size());
-  assert(context);
+  assert(!(context_ && context_->HasActiveTransaction()) &&
+         "NotifyInteresting must be called after a reduction step.");
+  // We represent modules as binaries because attempts at reduction need to end
+  // up in binary form to be passed on to SPIR-V-consuming tools.  The module
+  // is only re-parsed if the binary is not the one the pass last worked on:
+  // if a reduction step proves to be uninteresting we backtrack by rolling
+  // back the transaction in which it was applied, which is cheaper than
+  // parsing the module again.
+  if (!context_ || binary != context_binary_) {
+    context_ =
+        BuildModule(target_env_, consumer_, binary.data(), binary.size());
+    assert(context_);
+    context_binary_ = binary;
+  }
 
   std::vector<std::unique_ptr<ReductionOpportunity>> opportunities =
-      finder_->GetAvailableOpportunities(context.get(), target_function);
+      finder_->GetAvailableOpportunities(context_.get(), target_function);
 
   // There is no point in having a granularity larger than the number of
   // opportunities, so reduce the granularity in this case.
@@ -54,6 +59,7 @@ std::vector<uint32_t> ReductionPass::TryApplyReduction(
     return std::vector<uint32_t>();
   }
 
+  context_->BeginTransaction();
   for (uint32_t i = index_;
        i < std::min(index_ + granularity_, (uint32_t)opportunities.size());
        ++i) {
@@ -61,7 +67,8 @@ std::vector<uint32_t> ReductionPass::TryApplyReduction(
   }
 
   std::vector<uint32_t> result;
-  context->module()->ToBinary(&result, false);
+  context_->module()->ToBinary(&result, false);
+  pending_binary_ = result;
   return result;
 }
 
@@ -77,6 +84,15 @@ bool ReductionPass::ReachedMinimumGranularity() const {
 std::string ReductionPass::GetName() const { return finder_->GetName(); }
 
 void ReductionPass::NotifyInteresting(bool interesting) {
+  if (context_ && context_->HasActiveTransaction()) {
+    if (interesting) {
+      context_->CommitTransaction();
+      context_binary_ = std::move(pending_binary_);
+    } else {
+      context_->RollbackTransaction();
+    }
+    pending_binary_.clear();
+  }
   if (!interesting) {
     index_ += granularity_;
   }
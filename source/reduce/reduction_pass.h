@@ -16,6 +16,8 @@
 #define SOURCE_REDUCE_REDUCTION_PASS_H_
 
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include "source/opt/ir_context.h"
 #include "source/reduce/reduction_opportunity_finder.h"
@@ -50,6 +52,11 @@ class ReductionPass {
   // case, the index will be reset and the granularity lowered for the next
   // round.
   //
+  // The chunk is applied within a transaction on a module that the pass keeps
+  // between calls, so that the module only needs to be parsed again when
+  // |binary| is not the binary that the previous call started from or
+  // produced.
+  //
   // If |target_function| is non-zero, only reduction opportunities that
   // simplify the internals of the function with result id |target_function|
   // will be applied.
@@ -59,6 +66,8 @@ class ReductionPass {
   // Notifies the reduction pass whether the binary returned from
   // TryApplyReduction is interesting, so that the next call to
   // TryApplyReduction will avoid applying the same chunk of opportunities.
+  // The changes made by the chunk are kept if the binary is interesting, and
+  // rolled back otherwise.
   void NotifyInteresting(bool interesting);
 
   // Sets a consumer to which relevant messages will be directed.
@@ -78,6 +87,15 @@ class ReductionPass {
   MessageConsumer consumer_;
   uint32_t index_;
   uint32_t granularity_;
+
+  // The module that the next call to TryApplyReduction can start from if it
+  // is given |context_binary_|, or null.  While the caller decides whether
+  // the binary returned by TryApplyReduction is interesting, |context_| holds
+  // that binary's module within a transaction, and |pending_binary_| holds
+  // the binary itself.
+  std::unique_ptr<opt::IRContext> context_;
+  std::vector<uint32_t> context_binary_;
+  std::vector<uint32_t> pending_binary_;
 };
 
 }  // namespace reduce
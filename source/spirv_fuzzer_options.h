@@ -38,6 +38,9 @@ struct spv_fuzzer_options_t {
   // See spvFuzzerOptionsSetShrinkerStepLimit.
   uint32_t shrinker_step_limit;
 
+  // See spvFuzzerOptionsSetShrinkerNumThreads.
+  uint32_t shrinker_num_threads;
+
   // See spvFuzzerOptionsValidateAfterEveryPass.
   bool fuzzer_pass_validation_enabled;
 
@@ -62,6 +62,7 @@ const char* spvTargetEnvDescription(spv_target_env env) {
     case SPV_ENV_VULKAN_1_1:
       return "SPIR-V 1.3 (under Vulkan 1.1 semantics)";
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
     case SPV_ENV_UNIVERSAL_1_4:
@@ -102,6 +103,7 @@ uint32_t spvVersionForTargetEnv(spv_target_env env) {
     case SPV_ENV_VULKAN_1_1:
       return SPV_SPIRV_VERSION_WORD(1, 3);
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
     case SPV_ENV_UNIVERSAL_1_4:
@@ -212,6 +214,7 @@ bool spvIsVulkanEnv(spv_target_env env) {
     case SPV_ENV_VULKAN_1_2:
       return true;
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
   }
@@ -246,6 +249,7 @@ bool spvIsOpenCLEnv(spv_target_env env) {
     case SPV_ENV_OPENCL_2_2:
       return true;
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
   }
@@ -280,6 +284,7 @@ bool spvIsOpenGLEnv(spv_target_env env) {
     case SPV_ENV_OPENGL_4_5:
       return true;
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
   }
@@ -320,6 +325,7 @@ std::string spvLogStringForEnv(spv_target_env env) {
       return "Universal";
     }
     case SPV_ENV_WEBGPU_0:
+    case SPV_ENV_MAX:
       assert(false);
       break;
   }
@@ -14,7 +14,9 @@
 
 #include "source/table.h"
 
+#include <cassert>
 #include <utility>
+#include <vector>
 
 spv_context spvContextCreate(spv_target_env env) {
   switch (env) {
@@ -54,13 +56,38 @@ spv_context spvContextCreate(spv_target_env env) {
   spvOperandTableGet(&operand_table, env);
   spvExtInstTableGet(&ext_inst_table, env);
 
-  return new spv_context_t{env, opcode_table, operand_table, ext_inst_table,
-                           nullptr /* a null default consumer */};
+  return new spv_context_t{env,
+                           opcode_table,
+                           operand_table,
+                           ext_inst_table,
+                           nullptr /* a null default consumer */,
+                           {nullptr, nullptr, nullptr} /* no allocator */};
 }
 
 void spvContextDestroy(spv_context context) { delete context; }
 
+void spvContextSetAllocator(spv_context context,
+                            const spv_allocator_t* allocator) {
+  context->allocator =
+      allocator ? *allocator : spv_allocator_t{nullptr, nullptr, nullptr};
+}
+
 void spvtools::SetContextMessageConsumer(spv_context context,
                                          spvtools::MessageConsumer consumer) {
   context->consumer = std::move(consumer);
 }
+
+spv_const_context spvtools::GetSharedContext(spv_target_env env) {
+  // A context only refers to the static grammar tables, so the contexts for
+  // all the environments are created together, the first time one is needed.
+  static const std::vector<spv_context>* const contexts = []() {
+    auto* result = new std::vector<spv_context>();
+    for (int i = 0; i < SPV_ENV_MAX; i++) {
+      result->push_back(spvContextCreate(static_cast<spv_target_env>(i)));
+    }
+    return result;
+  }();
+  const auto index = static_cast<size_t>(env);
+  assert(index < contexts->size() && "Invalid target environment value.");
+  return index < contexts->size() ? (*contexts)[index] : nullptr;
+}
@@ -112,6 +112,9 @@ struct spv_context_t {
   const spv_operand_table operand_table;
   const spv_ext_inst_table ext_inst_table;
   spvtools::MessageConsumer consumer;
+  // The allocator set with spvContextSetAllocator; |allocate| is null if
+  // there is none.
+  spv_allocator_t allocator;
 };
 
 namespace spvtools {
@@ -119,6 +122,14 @@ namespace spvtools {
 // Sets the message consumer to |consumer| in the given |context|. The original
 // message consumer will be overwritten.
 void SetContextMessageConsumer(spv_context context, MessageConsumer consumer);
+
+// Returns the context for |env| that is shared by the whole process, or
+// nullptr if |env| is not supported.  |env| must be a value of spv_target_env
+// below SPV_ENV_MAX; other values fail an assertion.  The context is created
+// on first use, is never destroyed, and must not be modified, so it can be
+// used from any thread.  It has no message consumer; to report messages, copy
+// it and set the message consumer of the copy.
+spv_const_context GetSharedContext(spv_target_env env);
 }  // namespace spvtools
 
 // Populates *table with entries for env.
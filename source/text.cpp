@@ -39,8 +39,10 @@
 #include "source/spirv_target_env.h"
 #include "source/table.h"
 #include "source/text_handler.h"
+#include "source/util/allocator.h"
 #include "source/util/bitutils.h"
 #include "source/util/parse_number.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.h"
 
 bool spvIsValidIDCharacter(const char value) {
@@ -775,8 +777,8 @@ spv_result_t spvTextToBinaryInternal(const spvtools::AssemblyGrammar& grammar,
     totalSize += inst.words.size();
   }
 
-  uint32_t* data = new uint32_t[totalSize];
-  if (!data) return SPV_ERROR_OUT_OF_MEMORY;
+  spv_binary binary = spvBinaryCreate(totalSize);
+  uint32_t* data = binary->code;
   uint64_t currentIndex = SPV_INDEX_INSTRUCTION;
   for (auto& inst : instructions) {
     memcpy(data + currentIndex, inst.words.data(),
@@ -784,16 +786,10 @@ spv_result_t spvTextToBinaryInternal(const spvtools::AssemblyGrammar& grammar,
     currentIndex += inst.words.size();
   }
 
-  if (auto error = SetHeader(grammar.target_env(), context.getBound(), data))
+  if (auto error = SetHeader(grammar.target_env(), context.getBound(), data)) {
+    spvBinaryDestroy(binary);
     return error;
-
-  spv_binary binary = new spv_binary_t();
-  if (!binary) {
-    delete[] data;
-    return SPV_ERROR_OUT_OF_MEMORY;
   }
-  binary->code = data;
-  binary->wordCount = totalSize;
 
   *pBinary = binary;
 
@@ -817,6 +813,8 @@ spv_result_t spvTextToBinaryWithOptions(const spv_const_context context,
                                         const uint32_t options,
                                         spv_binary* pBinary,
                                         spv_diagnostic* pDiagnostic) {
+  SPIRV_TRACE_SCOPE("Assemble");
+  spvtools::utils::ScopedAllocator scoped_allocator(&context->allocator);
   spv_context_t hijack_context = *context;
   if (pDiagnostic) {
     *pDiagnostic = nullptr;
@@ -835,7 +833,7 @@ spv_result_t spvTextToBinaryWithOptions(const spv_const_context context,
 
 void spvTextDestroy(spv_text text) {
   if (text) {
-    if (text->str) delete[] text->str;
-    delete text;
+    spvtools::utils::DeallocateTagged(const_cast<char*>(text->str));
+    spvtools::utils::DeallocateTagged(text);
   }
 }
@@ -0,0 +1,109 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/util/allocator.h"
+
+#include <cassert>
+#include <new>
+
+namespace spvtools {
+namespace utils {
+namespace {
+
+// The header in front of the memory returned by AllocateTagged.  Its size is
+// a multiple of the alignment of any object, so the memory after it is
+// aligned as well.
+struct alignas(std::max_align_t) TagHeader {
+  // How to free the allocation, copied from the allocator so that freeing
+  // does not depend on the allocator object.
+  void (*deallocate)(void* user_data, void* ptr, size_t size);
+  void* user_data;
+  // The size of the allocation, including the header.
+  size_t size;
+};
+
+void GlobalDeallocate(void*, void* ptr, size_t) { ::operator delete(ptr); }
+
+void IgnoreDeallocate(void*, void*, size_t) {}
+
+thread_local const spv_allocator_t* current_allocator = nullptr;
+
+thread_local AllocationStats thread_allocation_stats = {0, 0};
+
+void CountAllocation(size_t size) {
+  thread_allocation_stats.count++;
+  thread_allocation_stats.bytes += size;
+}
+
+}  // namespace
+
+void* Allocate(size_t size) {
+  const spv_allocator_t* allocator = current_allocator;
+  CountAllocation(size);
+  if (allocator == nullptr) {
+    return ::operator new(size);
+  }
+  void* ptr = allocator->allocate(allocator->user_data, size);
+  assert(ptr != nullptr && "A client allocator must not return null.");
+  return ptr;
+}
+
+void Deallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) return;
+  const spv_allocator_t* allocator = current_allocator;
+  if (allocator == nullptr) {
+    ::operator delete(ptr);
+  } else if (allocator->deallocate != nullptr) {
+    allocator->deallocate(allocator->user_data, ptr, size);
+  }
+}
+
+void* AllocateTagged(size_t size) {
+  const spv_allocator_t* allocator = current_allocator;
+  CountAllocation(size);
+  const size_t total_size = sizeof(TagHeader) + size;
+  TagHeader header;
+  void* base;
+  if (allocator == nullptr) {
+    base = ::operator new(total_size);
+    header = {GlobalDeallocate, nullptr, total_size};
+  } else {
+    base = allocator->allocate(allocator->user_data, total_size);
+    assert(base != nullptr && "A client allocator must not return null.");
+    header = {allocator->deallocate ? allocator->deallocate : IgnoreDeallocate,
+              allocator->user_data, total_size};
+  }
+  return new (base) TagHeader(header) + 1;
+}
+
+void DeallocateTagged(void* ptr) {
+  if (ptr == nullptr) return;
+  TagHeader* header = static_cast<TagHeader*>(ptr) - 1;
+  const TagHeader copy = *header;
+  copy.deallocate(copy.user_data, header, copy.size);
+}
+
+AllocationStats GetThreadAllocationStats() { return thread_allocation_stats; }
+
+ScopedAllocator::ScopedAllocator(const spv_allocator_t* allocator)
+    : previous_(current_allocator) {
+  current_allocator =
+      allocator != nullptr && allocator->allocate != nullptr ? allocator
+                                                             : nullptr;
+}
+
+ScopedAllocator::~ScopedAllocator() { current_allocator = previous_; }
+
+}  // namespace utils
+}  // namespace spvtools
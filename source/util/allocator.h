@@ -0,0 +1,92 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_UTIL_ALLOCATOR_H_
+#define SOURCE_UTIL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "spirv-tools/libspirv.h"
+
+namespace spvtools {
+namespace utils {
+
+// Allocates |size| bytes from the allocator that is current on the calling
+// thread (see ScopedAllocator), or with the global operator new if there is
+// none.  The memory is aligned for any object.
+void* Allocate(size_t size);
+
+// Frees |ptr|, which must have been returned by Allocate(|size|), through the
+// allocator that is current on the calling thread, or with the global
+// operator delete if there is none.  That must be the allocator that was
+// current when |ptr| was allocated: nothing is recorded about an allocation,
+// so that Allocate and Deallocate cost no more than a call to the allocator
+// and need no lock.  Code that allocates on behalf of a client therefore
+// keeps the client's allocator in scope wherever the memory is freed.  Does
+// nothing if |ptr| is null.
+void Deallocate(void* ptr, size_t size);
+
+// Like Allocate, but the memory is tagged with the allocator it came from, in
+// a header in front of it, so that DeallocateTagged frees it through that
+// allocator whichever allocator is then current.  This suits the objects that
+// the C API hands to the client, which are few, and which are destroyed by
+// functions that take no context.  The client's allocator is asked for the
+// header as well as |size| bytes.
+void* AllocateTagged(size_t size);
+
+// Frees |ptr|, which must have been returned by AllocateTagged, through the
+// allocator that allocated it.  Does nothing if |ptr| is null.
+void DeallocateTagged(void* ptr);
+
+// The allocations made by Allocate and AllocateTagged on a thread, whichever
+// allocator they came from.
+struct AllocationStats {
+  // The number of allocations.
+  uint64_t count;
+  // The number of bytes requested, not including any header.
+  uint64_t bytes;
+};
+
+// Returns the allocations made on the calling thread so far.
+// Profiling measures the allocations of a range of code as the difference
+// between two calls.
+AllocationStats GetThreadAllocationStats();
+
+// Makes an allocator current on the calling thread for the lifetime of the
+// object, restoring the previously current one afterwards.
+//
+// Classes whose objects should come from a client's allocator define their
+// operator new and delete in terms of Allocate and Deallocate; code that
+// creates or destroys such objects on behalf of the client then runs with the
+// client's allocator in scope.
+class ScopedAllocator {
+ public:
+  // Makes |allocator| current.  If |allocator| is null, or has no |allocate|
+  // function, the global operator new is used while the object is alive.
+  // |allocator| must outlive the object.
+  explicit ScopedAllocator(const spv_allocator_t* allocator);
+  ~ScopedAllocator();
+
+  ScopedAllocator(const ScopedAllocator&) = delete;
+  ScopedAllocator& operator=(const ScopedAllocator&) = delete;
+
+ private:
+  const spv_allocator_t* previous_;
+};
+
+}  // namespace utils
+}  // namespace spvtools
+
+#endif  // SOURCE_UTIL_ALLOCATOR_H_
@@ -14,6 +14,7 @@
 
 #include "source/util/bit_vector.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -21,16 +22,7 @@ namespace spvtools {
 namespace utils {
 
 void BitVector::ReportDensity(std::ostream& out) {
-  uint32_t count = 0;
-
-  for (BitContainer e : bits_) {
-    while (e != 0) {
-      if ((e & 1) != 0) {
-        ++count;
-      }
-      e = e >> 1;
-    }
-  }
+  uint32_t count = Count();
 
   out << "count=" << count
       << ", total size (bytes)=" << bits_.size() * sizeof(BitContainer)
@@ -38,29 +30,127 @@ void BitVector::ReportDensity(std::ostream& out) {
       << (double)(bits_.size() * sizeof(BitContainer)) / (double)(count);
 }
 
-bool BitVector::Or(const BitVector& other) {
-  auto this_it = this->bits_.begin();
-  auto other_it = other.bits_.begin();
-  bool modified = false;
-
-  while (this_it != this->bits_.end() && other_it != other.bits_.end()) {
-    auto temp = *this_it | *other_it;
-    if (temp != *this_it) {
-      modified = true;
-      *this_it = temp;
+uint32_t BitVector::Count() const {
+  uint32_t count = 0;
+  for (BitContainer e : bits_) {
+    count += static_cast<uint32_t>(CountSetBits64(e));
+  }
+  return count;
+}
+
+bool BitVector::FindNextSet(uint32_t i, uint32_t* next) const {
+  size_t element_index = i / kBitContainerSize;
+  if (element_index >= bits_.size()) {
+    return false;
+  }
+
+  // Ignores the bits below |i| in the first element.
+  const BitContainer mask = ~static_cast<BitContainer>(0)
+                           << (i % kBitContainerSize);
+  BitContainer element = bits_[element_index] & mask;
+  while (element == 0) {
+    if (++element_index == bits_.size()) {
+      return false;
     }
-    ++this_it;
-    ++other_it;
+    element = bits_[element_index];
   }
+  *next = static_cast<uint32_t>(element_index * kBitContainerSize +
+                                LowestSetBitPosition(element));
+  return true;
+}
+
+// The loops over the elements below are kept free of branches and of
+// iterators, so that they are vectorized.
 
-  if (other_it != other.bits_.end()) {
+bool BitVector::Or(const BitVector& other) {
+  const size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer* this_bits = bits_.data();
+  const BitContainer* other_bits = other.bits_.data();
+  BitContainer changed = 0;
+
+  for (size_t i = 0; i < common_size; ++i) {
+    const BitContainer result = this_bits[i] | other_bits[i];
+    changed |= result ^ this_bits[i];
+    this_bits[i] = result;
+  }
+
+  bool modified = changed != 0;
+  if (common_size < other.bits_.size()) {
     modified = true;
-    this->bits_.insert(this->bits_.end(), other_it, other.bits_.end());
+    bits_.insert(bits_.end(), other.bits_.begin() + common_size,
+                 other.bits_.end());
   }
 
   return modified;
 }
 
+bool BitVector::And(const BitVector& other) {
+  const size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer* this_bits = bits_.data();
+  const BitContainer* other_bits = other.bits_.data();
+  BitContainer changed = 0;
+
+  for (size_t i = 0; i < common_size; ++i) {
+    const BitContainer result = this_bits[i] & other_bits[i];
+    changed |= result ^ this_bits[i];
+    this_bits[i] = result;
+  }
+
+  // The bits past the end of |other| are 0 there.
+  for (size_t i = common_size; i < bits_.size(); ++i) {
+    changed |= this_bits[i];
+    this_bits[i] = 0;
+  }
+
+  return changed != 0;
+}
+
+bool BitVector::AndNot(const BitVector& other) {
+  const size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer* this_bits = bits_.data();
+  const BitContainer* other_bits = other.bits_.data();
+  BitContainer changed = 0;
+
+  for (size_t i = 0; i < common_size; ++i) {
+    changed |= this_bits[i] & other_bits[i];
+    this_bits[i] &= ~other_bits[i];
+  }
+
+  return changed != 0;
+}
+
+bool BitVector::Intersects(const BitVector& other) const {
+  const size_t common_size = std::min(bits_.size(), other.bits_.size());
+  const BitContainer* this_bits = bits_.data();
+  const BitContainer* other_bits = other.bits_.data();
+  BitContainer common = 0;
+
+  for (size_t i = 0; i < common_size; ++i) {
+    common |= this_bits[i] & other_bits[i];
+  }
+
+  return common != 0;
+}
+
+bool BitVector::operator==(const BitVector& other) const {
+  const size_t common_size = std::min(bits_.size(), other.bits_.size());
+  const BitContainer* this_bits = bits_.data();
+  const BitContainer* other_bits = other.bits_.data();
+  BitContainer difference = 0;
+
+  for (size_t i = 0; i < common_size; ++i) {
+    difference |= this_bits[i] ^ other_bits[i];
+  }
+
+  // The longer vector must have no bit set past the end of the shorter one.
+  const BitVector& longer = bits_.size() > common_size ? *this : other;
+  for (size_t i = common_size; i < longer.bits_.size(); ++i) {
+    difference |= longer.bits_[i];
+  }
+
+  return difference == 0;
+}
+
 std::ostream& operator<<(std::ostream& out, const BitVector& bv) {
   out << "{";
   for (uint32_t i = 0; i < bv.bits_.size(); ++i) {
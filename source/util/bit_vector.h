@@ -15,16 +15,25 @@
 #ifndef SOURCE_UTIL_BIT_VECTOR_H_
 #define SOURCE_UTIL_BIT_VECTOR_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <vector>
 
+#include "source/util/bitutils.h"
+
 namespace spvtools {
 namespace utils {
 
 // Implements a bit vector class.
 //
 // All bits default to zero, and the upper bound is 2^32-1.
+//
+// The bits are packed into 64-bit words, and the bulk operations (Or, And,
+// AndNot, Intersects, Count) are straight loops over the words that the
+// compiler can vectorize, which makes the class suitable for dataflow sets
+// over a dense space such as the ids of a module.  See SparseBitVector for
+// sets over a large space with few members.
 class BitVector {
  private:
   using BitContainer = uint64_t;
@@ -99,6 +108,30 @@ class BitVector {
     return true;
   }
 
+  // Sets every bit to 0, keeping the storage.
+  void ClearAll() { bits_.assign(bits_.size(), 0); }
+
+  // Returns the number of bits that are 1.
+  uint32_t Count() const;
+
+  // Returns true if the first bit that is 1 at index |i| or above exists, in
+  // which case its index is written to |*next|.
+  bool FindNextSet(uint32_t i, uint32_t* next) const;
+
+  // Calls |f| on the index of each bit that is 1, in increasing order.
+  template <typename F>
+  void ForEachSetBit(const F& f) const {
+    for (size_t element_index = 0; element_index < bits_.size();
+         ++element_index) {
+      BitContainer element = bits_[element_index];
+      while (element != 0) {
+        f(static_cast<uint32_t>(element_index * kBitContainerSize +
+                                LowestSetBitPosition(element)));
+        element &= element - 1;
+      }
+    }
+  }
+
   // Print a report on the densicy of the bit vector, number of 1 bits, number
   // of bytes, and average bytes for 1 bit, to |out|.
   void ReportDensity(std::ostream& out);
@@ -109,6 +142,22 @@ class BitVector {
   // |this|.  Return true if |this| changed.
   bool Or(const BitVector& that);
 
+  // Performs a bitwise-and operation on |this| and |that|, storing the result
+  // in |this|.  Return true if |this| changed.
+  bool And(const BitVector& that);
+
+  // Clears in |this| the bits that are 1 in |that|.  Return true if |this|
+  // changed.
+  bool AndNot(const BitVector& that);
+
+  // Returns true if some bit is 1 in both |this| and |that|.
+  bool Intersects(const BitVector& that) const;
+
+  // Returns true if |this| and |that| have the same bits set, whatever the
+  // size of their storage.
+  bool operator==(const BitVector& that) const;
+  bool operator!=(const BitVector& that) const { return !(*this == that); }
+
  private:
   std::vector<BitContainer> bits_;
 };
@@ -105,6 +105,27 @@ size_t CountSetBits(T word) {
   return count;
 }
 
+// Returns number of '1' bits in a 64-bit word, using the dedicated instruction
+// where the compiler provides it.
+inline size_t CountSetBits64(uint64_t word) {
+#if defined(__GNUC__)
+  return static_cast<size_t>(__builtin_popcountll(word));
+#else
+  return CountSetBits(word);
+#endif
+}
+
+// Returns the position of the least significant '1' bit of |word|, which must
+// not be zero.
+inline size_t LowestSetBitPosition(uint64_t word) {
+  assert(word != 0 && "word must have a bit set");
+#if defined(__GNUC__)
+  return static_cast<size_t>(__builtin_ctzll(word));
+#else
+  return CountSetBits((word & (0 - word)) - 1);
+#endif
+}
+
 // Checks if the bit at the |position| is set to '1'.
 // Bits zero-indexed starting at the least significant bit.
 // |position| must be within the bit width of |T|.
@@ -14,8 +14,10 @@
 
 #include "source/util/parse_number.h"
 
+#include <cstring>
 #include <functional>
 #include <iomanip>
+#include <locale>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -52,8 +54,59 @@ class ErrorMsgStream {
   // destructor is called.
   std::string* error_msg_sink_;
 };
+
+// A read-only stream buffer over a null-terminated string.  Unlike
+// std::stringbuf, it reads the string in place rather than copying it.
+class CStringBuffer : public std::streambuf {
+ public:
+  void Reset(const char* text) {
+    char* begin = const_cast<char*>(text);
+    setg(begin, begin, begin + std::strlen(text));
+  }
+};
+
+// A stream reading a CStringBuffer in the classic locale.
+struct ClassicStream {
+  ClassicStream() : stream(&buffer) { stream.imbue(std::locale::classic()); }
+
+  CStringBuffer buffer;
+  std::istream stream;
+};
 }  // namespace
 
+std::istream& GetClassicStream(const char* text) {
+  // Constructing a stream, and imbuing it with a locale, costs more than
+  // parsing a typical literal, so each thread keeps one.
+  thread_local ClassicStream classic_stream;
+  classic_stream.buffer.Reset(text);
+  classic_stream.stream.clear();
+  classic_stream.stream.flags(std::ios_base::skipws | std::ios_base::dec);
+  return classic_stream.stream;
+}
+
+size_t FormatInteger(uint64_t value, char* buffer) {
+  // Writes the digits from the least significant one, at the end of |digits|.
+  char digits[kMaxFormattedIntegerSize];
+  char* first = digits + kMaxFormattedIntegerSize;
+  do {
+    *--first = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  const size_t size = digits + kMaxFormattedIntegerSize - first;
+  std::memcpy(buffer, first, size);
+  return size;
+}
+
+size_t FormatInteger(int64_t value, char* buffer) {
+  if (value >= 0) {
+    return FormatInteger(static_cast<uint64_t>(value), buffer);
+  }
+  buffer[0] = '-';
+  // Negates in unsigned arithmetic, which is defined for the most negative
+  // value.
+  return 1 + FormatInteger(0 - static_cast<uint64_t>(value), buffer + 1);
+}
+
 EncodeNumberStatus ParseAndEncodeIntegerNumber(
     const char* text, const NumberType& type,
     std::function<void(uint32_t)> emit, std::string* error_msg) {
@@ -15,9 +15,13 @@
 #ifndef SOURCE_UTIL_PARSE_NUMBER_H_
 #define SOURCE_UTIL_PARSE_NUMBER_H_
 
+#include <cstdint>
 #include <functional>
+#include <istream>
+#include <limits>
 #include <string>
 #include <tuple>
+#include <type_traits>
 
 #include "source/util/hex_float.h"
 #include "spirv-tools/libspirv.h"
@@ -70,30 +74,6 @@ inline int AssumedBitWidth(const NumberType& type) {
   return 0;
 }
 
-// A templated class with a static member function Clamp, where Clamp sets a
-// referenced value of type T to 0 if T is an unsigned integer type, and
-// returns true if it modified the referenced value.
-template <typename T, typename = void>
-class ClampToZeroIfUnsignedType {
- public:
-  // The default specialization does not clamp the value.
-  static bool Clamp(T*) { return false; }
-};
-
-// The specialization of ClampToZeroIfUnsignedType for unsigned integer types.
-template <typename T>
-class ClampToZeroIfUnsignedType<
-    T, typename std::enable_if<std::is_unsigned<T>::value>::type> {
- public:
-  static bool Clamp(T* value_pointer) {
-    if (*value_pointer) {
-      *value_pointer = 0;
-      return true;
-    }
-    return false;
-  }
-};
-
 // Returns true if the given value fits within the target scalar integral type.
 // The target type may have an unusual bit width. If the value was originally
 // specified as a hexadecimal number, then the overflow bits should be zero.
@@ -160,23 +140,92 @@ bool CheckRangeAndIfHexThenSignExtend(T value, const NumberType& type,
   return true;
 }
 
+// Parses an integer of type T from |text|, like the standard streams do with
+// std::setbase(0) in the classic locale: after optional white space and an
+// optional sign, a number with a "0x" or "0X" prefix is hexadecimal, one with
+// a "0" prefix is octal, and any other is decimal.  The number should take up
+// the rest of the string, and should be within bounds for T; a negative number
+// is accepted for an unsigned type only if it is zero.  On success, returns
+// true and populates the object referenced by |value_pointer|.  On failure,
+// returns false.  Unlike the streams, this does not allocate, and does not
+// depend on the locale of the process.
+template <typename T>
+bool ParseInteger(const char* text, T* value_pointer) {
+  static_assert(std::is_integral<T>::value, "Integer type required");
+  if (!text) return false;
+
+  const char* p = text;
+  while (*p == ' ' || (*p >= '\t' && *p <= '\r')) ++p;
+  const bool negative = *p == '-';
+  if (*p == '-' || *p == '+') ++p;
+
+  uint64_t base = 10;
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    base = 16;
+    p += 2;
+  } else if (p[0] == '0') {
+    // The leading zero is parsed as an octal digit.
+    base = 8;
+  }
+  if (*p == 0) return false;
+
+  uint64_t magnitude = 0;
+  for (; *p != 0; ++p) {
+    uint64_t digit;
+    if (*p >= '0' && *p <= '9') {
+      digit = *p - '0';
+    } else if (*p >= 'a' && *p <= 'f') {
+      digit = *p - 'a' + 10;
+    } else if (*p >= 'A' && *p <= 'F') {
+      digit = *p - 'A' + 10;
+    } else {
+      return false;
+    }
+    if (digit >= base || magnitude > (UINT64_MAX - digit) / base) {
+      return false;
+    }
+    magnitude = magnitude * base + digit;
+  }
+
+  const uint64_t max_value =
+      static_cast<uint64_t>(std::numeric_limits<T>::max());
+  if (negative) {
+    // The magnitude of the most negative value is one more than the maximum.
+    const uint64_t max_magnitude = std::is_signed<T>::value ? max_value + 1 : 0;
+    if (magnitude > max_magnitude) return false;
+    *value_pointer = static_cast<T>(0 - magnitude);
+  } else {
+    if (magnitude > max_value) return false;
+    *value_pointer = static_cast<T>(magnitude);
+  }
+  return true;
+}
+
+// Returns a stream reading |text| in the classic locale, with the default
+// format flags.  The stream reads |text| in place rather than copying it, and
+// it is reused by each call on the same thread, so it is valid until the next
+// call on that thread.
+std::istream& GetClassicStream(const char* text);
+
 // Parses a numeric value of a given type from the given text.  The number
 // should take up the entire string, and should be within bounds for the target
 // type. On success, returns true and populates the object referenced by
 // value_pointer. On failure, returns false.
+//
+// Integers are parsed by ParseInteger.  Other types, such as HexFloat, are
+// read from a stream in the classic locale; numbers in SPIR-V assembly do not
+// depend on the locale of the process.
 template <typename T>
-bool ParseNumber(const char* text, T* value_pointer) {
-  // C++11 doesn't define std::istringstream(int8_t&), so calling this method
-  // with a single-byte type leads to implementation-defined behaviour.
-  // Similarly for uint8_t.
-  static_assert(sizeof(T) > 1,
-                "Single-byte types are not supported in this parse method");
+typename std::enable_if<std::is_integral<T>::value, bool>::type ParseNumber(
+    const char* text, T* value_pointer) {
+  return ParseInteger(text, value_pointer);
+}
 
+template <typename T>
+typename std::enable_if<!std::is_integral<T>::value, bool>::type ParseNumber(
+    const char* text, T* value_pointer) {
   if (!text) return false;
-  std::istringstream text_stream(text);
-  // Allow both decimal and hex input for integers.
-  // It also allows octal input, but we don't care about that case.
-  text_stream >> std::setbase(0);
+  std::istream& text_stream = GetClassicStream(text);
   text_stream >> *value_pointer;
 
   // We should have read something.
@@ -186,14 +235,20 @@ bool ParseNumber(const char* text, T* value_pointer) {
   // It should have been in range.
   ok = ok && !text_stream.fail();
 
-  // Work around a bug in the GNU C++11 library. It will happily parse
-  // "-1" for uint16_t as 65535.
-  if (ok && text[0] == '-')
-    ok = !ClampToZeroIfUnsignedType<T>::Clamp(value_pointer);
-
   return ok;
 }
 
+// The number of characters needed to format any 64-bit integer in decimal,
+// including its sign.
+const size_t kMaxFormattedIntegerSize = 20;
+
+// Writes |value| in decimal to |buffer|, which must have room for
+// kMaxFormattedIntegerSize characters, and returns the number of characters
+// written.  No terminating null is written.  Unlike the standard streams, this
+// does not depend on the locale of the process.
+size_t FormatInteger(uint64_t value, char* buffer);
+size_t FormatInteger(int64_t value, char* buffer);
+
 // Enum to indicate the parsing and encoding status.
 enum class EncodeNumberStatus {
   kSuccess = 0,
@@ -15,9 +15,15 @@
 #ifndef SOURCE_UTIL_SMALL_VECTOR_H_
 #define SOURCE_UTIL_SMALL_VECTOR_H_
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -31,6 +37,13 @@ namespace utils {
 // optimized for when the number of elements in the vector are small.  Small is
 // defined by the template parameter |small_size|.
 //
+// The elements are stored in a buffer inside the object until there are more
+// than |small_size| of them, and in a single heap buffer after that.  Either
+// way they are reached through the same pointer, and the size and capacity
+// are packed into two 32-bit words, so a |SmallVector<uint32_t, 2>| takes 24
+// bytes.  Moving a vector whose elements are on the heap takes the heap
+// buffer rather than moving the elements.
+//
 // Note that |SmallVector| is not always faster than an |std::vector|, so you
 // should experiment with different values for |small_size| and compare to
 // using and |std::vector|.
@@ -44,119 +57,87 @@ class SmallVector {
   using iterator = T*;
   using const_iterator = const T*;
 
-  SmallVector()
-      : size_(0),
-        small_data_(reinterpret_cast<T*>(buffer)),
-        large_data_(nullptr) {}
+  SmallVector() : data_(small_data()), size_(0), capacity_(small_size) {}
 
   SmallVector(const SmallVector& that) : SmallVector() { *this = that; }
 
-  SmallVector(SmallVector&& that) : SmallVector() { *this = std::move(that); }
+  // Moving does not throw as long as moving a T does not, so that containers
+  // of SmallVectors, such as Instruction::OperandList, move rather than copy
+  // them when they grow.
+  SmallVector(SmallVector&& that) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : SmallVector() {
+    *this = std::move(that);
+  }
 
   SmallVector(const std::vector<T>& vec) : SmallVector() {
-    if (vec.size() > small_size) {
-      large_data_ = MakeUnique<std::vector<T>>(vec);
-    } else {
-      size_ = vec.size();
-      for (uint32_t i = 0; i < size_; i++) {
-        new (small_data_ + i) T(vec[i]);
-      }
+    reserve(vec.size());
+    for (const T& element : vec) {
+      new (data_ + (size_++)) T(element);
     }
   }
 
   SmallVector(std::vector<T>&& vec) : SmallVector() {
-    if (vec.size() > small_size) {
-      large_data_ = MakeUnique<std::vector<T>>(std::move(vec));
-    } else {
-      size_ = vec.size();
-      for (uint32_t i = 0; i < size_; i++) {
-        new (small_data_ + i) T(std::move(vec[i]));
-      }
+    reserve(vec.size());
+    for (T& element : vec) {
+      new (data_ + (size_++)) T(std::move(element));
     }
     vec.clear();
   }
 
   SmallVector(std::initializer_list<T> init_list) : SmallVector() {
-    if (init_list.size() < small_size) {
-      for (auto it = init_list.begin(); it != init_list.end(); ++it) {
-        new (small_data_ + (size_++)) T(std::move(*it));
-      }
-    } else {
-      large_data_ = MakeUnique<std::vector<T>>(std::move(init_list));
+    reserve(init_list.size());
+    for (const T& element : init_list) {
+      new (data_ + (size_++)) T(element);
     }
   }
 
   SmallVector(size_t s, const T& v) : SmallVector() { resize(s, v); }
 
-  virtual ~SmallVector() {
-    for (T* p = small_data_; p < small_data_ + size_; ++p) {
-      p->~T();
-    }
+  ~SmallVector() {
+    DestructElements();
+    ReleaseLargeData();
   }
 
   SmallVector& operator=(const SmallVector& that) {
-    assert(small_data_);
-    if (that.large_data_) {
-      if (large_data_) {
-        *large_data_ = *that.large_data_;
-      } else {
-        large_data_ = MakeUnique<std::vector<T>>(*that.large_data_);
-      }
-    } else {
-      large_data_.reset(nullptr);
-      size_t i = 0;
-      // Do a copy for any element in |this| that is already constructed.
-      for (; i < size_ && i < that.size_; ++i) {
-        small_data_[i] = that.small_data_[i];
-      }
+    if (this == &that) {
+      return *this;
+    }
 
-      if (i >= that.size_) {
-        // If the size of |this| becomes smaller after the assignment, then
-        // destroy any extra elements.
-        for (; i < size_; ++i) {
-          small_data_[i].~T();
-        }
-      } else {
-        // If the size of |this| becomes larger after the assignement, copy
-        // construct the new elements that are needed.
-        for (; i < that.size_; ++i) {
-          new (small_data_ + i) T(that.small_data_[i]);
-        }
-      }
-      size_ = that.size_;
+    clear();
+    reserve(that.size_);
+    for (const T& element : that) {
+      new (data_ + (size_++)) T(element);
     }
     return *this;
   }
 
-  SmallVector& operator=(SmallVector&& that) {
-    if (that.large_data_) {
-      large_data_.reset(that.large_data_.release());
-    } else {
-      large_data_.reset(nullptr);
-      size_t i = 0;
-      // Do a move for any element in |this| that is already constructed.
-      for (; i < size_ && i < that.size_; ++i) {
-        small_data_[i] = std::move(that.small_data_[i]);
-      }
+  SmallVector& operator=(SmallVector&& that) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
+    if (this == &that) {
+      return *this;
+    }
 
-      if (i >= that.size_) {
-        // If the size of |this| becomes smaller after the assignment, then
-        // destroy any extra elements.
-        for (; i < size_; ++i) {
-          small_data_[i].~T();
-        }
-      } else {
-        // If the size of |this| becomes larger after the assignement, move
-        // construct the new elements that are needed.
-        for (; i < that.size_; ++i) {
-          new (small_data_ + i) T(std::move(that.small_data_[i]));
-        }
-      }
+    clear();
+    if (!that.IsSmall()) {
+      // Take the heap buffer of |that|, rather than moving its elements.
+      ReleaseLargeData();
+      data_ = that.data_;
       size_ = that.size_;
+      capacity_ = that.capacity_;
+      that.data_ = that.small_data();
+      that.size_ = 0;
+      that.capacity_ = small_size;
+      return *this;
+    }
+
+    // The elements of |that| fit in |small_size|, so they fit in |this|.
+    for (T& element : that) {
+      new (data_ + (size_++)) T(std::move(element));
     }
 
     // Reset |that| because all of the data has been moved to |this|.
-    that.DestructSmallData();
+    that.DestructElements();
     return *this;
   }
 
@@ -187,63 +168,23 @@ class SmallVector {
     return rhs != lhs;
   }
 
-  T& operator[](size_t i) {
-    if (!large_data_) {
-      return small_data_[i];
-    } else {
-      return (*large_data_)[i];
-    }
-  }
+  T& operator[](size_t i) { return data_[i]; }
 
-  const T& operator[](size_t i) const {
-    if (!large_data_) {
-      return small_data_[i];
-    } else {
-      return (*large_data_)[i];
-    }
-  }
+  const T& operator[](size_t i) const { return data_[i]; }
 
-  size_t size() const {
-    if (!large_data_) {
-      return size_;
-    } else {
-      return large_data_->size();
-    }
-  }
+  size_t size() const { return size_; }
 
-  iterator begin() {
-    if (large_data_) {
-      return large_data_->data();
-    } else {
-      return small_data_;
-    }
-  }
+  size_t capacity() const { return capacity_; }
 
-  const_iterator begin() const {
-    if (large_data_) {
-      return large_data_->data();
-    } else {
-      return small_data_;
-    }
-  }
+  iterator begin() { return data_; }
+
+  const_iterator begin() const { return data_; }
 
   const_iterator cbegin() const { return begin(); }
 
-  iterator end() {
-    if (large_data_) {
-      return large_data_->data() + large_data_->size();
-    } else {
-      return small_data_ + size_;
-    }
-  }
+  iterator end() { return data_ + size_; }
 
-  const_iterator end() const {
-    if (large_data_) {
-      return large_data_->data() + large_data_->size();
-    } else {
-      return small_data_ + size_;
-    }
-  }
+  const_iterator end() const { return data_ + size_; }
 
   const_iterator cend() const { return end(); }
 
@@ -255,17 +196,13 @@ class SmallVector {
 
   const T& front() const { return (*this)[0]; }
 
+  T& back() { return (*this)[size_ - 1]; }
+
+  const T& back() const { return (*this)[size_ - 1]; }
+
   iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
 
   iterator erase(const_iterator first, const_iterator last) {
-    if (large_data_) {
-      size_t start_index = first - large_data_->data();
-      size_t end_index = last - large_data_->data();
-      auto r = large_data_->erase(large_data_->begin() + start_index,
-                                  large_data_->begin() + end_index);
-      return large_data_->data() + (r - large_data_->begin());
-    }
-
     // Since C++11, std::vector has |const_iterator| for the parameters, so I
     // follow that.  However, I need iterators to modify the current container,
     // which is not const.  This is why I cast away the const.
@@ -293,70 +230,41 @@ class SmallVector {
     }
 
     // Update the size.
-    size_ -= num_of_del_elements;
+    size_ -= static_cast<uint32_t>(num_of_del_elements);
     return ret;
   }
 
-  void push_back(const T& value) {
-    if (!large_data_ && size_ == small_size) {
-      MoveToLargeData();
-    }
-
-    if (large_data_) {
-      large_data_->push_back(value);
-      return;
-    }
-
-    new (small_data_ + size_) T(value);
-    ++size_;
-  }
+  void push_back(const T& value) { emplace_back(value); }
 
-  void push_back(T&& value) {
-    if (!large_data_ && size_ == small_size) {
-      MoveToLargeData();
-    }
-
-    if (large_data_) {
-      large_data_->push_back(std::move(value));
-      return;
-    }
-
-    new (small_data_ + size_) T(std::move(value));
-    ++size_;
-  }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
 
   template <class InputIt>
   iterator insert(iterator pos, InputIt first, InputIt last) {
     size_t element_idx = (pos - begin());
     size_t num_of_new_elements = std::distance(first, last);
     size_t new_size = size_ + num_of_new_elements;
-    if (!large_data_ && new_size > small_size) {
-      MoveToLargeData();
-    }
-
-    if (large_data_) {
-      typename std::vector<T>::iterator new_pos =
-          large_data_->begin() + element_idx;
-      large_data_->insert(new_pos, first, last);
-      return begin() + element_idx;
+    if (new_size > capacity_) {
+      Reallocate(std::max(new_size, size_t(2) * capacity_));
+      pos = begin() + element_idx;
     }
 
     // Move |pos| and all of the elements after it over |num_of_new_elements|
     // places.  We start at the end and work backwards, to make sure we do not
     // overwrite data that we have not moved yet.
-    for (iterator i = begin() + new_size - 1, j = end() - 1; j >= pos;
-         --i, --j) {
-      if (i >= begin() + size_) {
-        new (i) T(std::move(*j));
+    for (size_t j = size_; j > element_idx; --j) {
+      iterator from = begin() + j - 1;
+      iterator to = from + num_of_new_elements;
+      if (to >= end()) {
+        new (to) T(std::move(*from));
       } else {
-        *i = std::move(*j);
+        *to = std::move(*from);
       }
     }
 
     // Copy the new elements into position.
     iterator p = pos;
     for (; first != last; ++p, ++first) {
-      if (p >= small_data_ + size_) {
+      if (p >= end()) {
         new (p) T(*first);
       } else {
         *p = *first;
@@ -364,101 +272,125 @@ class SmallVector {
     }
 
     // Upate the size.
-    size_ += num_of_new_elements;
+    size_ = static_cast<uint32_t>(new_size);
     return pos;
   }
 
-  bool empty() const {
-    if (large_data_) {
-      return large_data_->empty();
-    }
-    return size_ == 0;
-  }
+  bool empty() const { return size_ == 0; }
 
-  void clear() {
-    if (large_data_) {
-      large_data_->clear();
-    } else {
-      DestructSmallData();
+  void clear() { DestructElements(); }
+
+  // Makes room for |new_capacity| elements, so that adding elements up to that
+  // number does not reallocate.
+  void reserve(size_t new_capacity) {
+    if (new_capacity > capacity_) {
+      Reallocate(new_capacity);
     }
   }
 
   template <class... Args>
   void emplace_back(Args&&... args) {
-    if (!large_data_ && size_ == small_size) {
-      MoveToLargeData();
-    }
-
-    if (large_data_) {
-      large_data_->emplace_back(std::forward<Args>(args)...);
-    } else {
-      new (small_data_ + size_) T(std::forward<Args>(args)...);
+    if (size_ < capacity_) {
+      new (data_ + size_) T(std::forward<Args>(args)...);
       ++size_;
+      return;
     }
+
+    // Constructs the new element before moving the others, since |args| may
+    // refer to one of them.
+    const size_t new_capacity = std::max(size_t(1), size_t(2) * capacity_);
+    T* new_data = Allocate(new_capacity);
+    new (new_data + size_) T(std::forward<Args>(args)...);
+    MoveElementsTo(new_data, new_capacity);
+    ++size_;
   }
 
   void resize(size_t new_size, const T& v) {
-    if (!large_data_ && new_size > small_size) {
-      MoveToLargeData();
-    }
-
-    if (large_data_) {
-      large_data_->resize(new_size, v);
+    if (new_size > capacity_) {
+      // |v| may refer to an element that is about to move.
+      T value(v);
+      Reallocate(std::max(new_size, size_t(2) * capacity_));
+      resize(new_size, value);
       return;
     }
 
     // If |new_size| < |size_|, then destroy the extra elements.
     for (size_t i = new_size; i < size_; ++i) {
-      small_data_[i].~T();
+      data_[i].~T();
     }
 
     // If |new_size| > |size_|, the copy construct the new elements.
     for (size_t i = size_; i < new_size; ++i) {
-      new (small_data_ + i) T(v);
+      new (data_ + i) T(v);
     }
 
     // Update the size.
-    size_ = new_size;
+    size_ = static_cast<uint32_t>(new_size);
   }
 
  private:
-  // Moves all of the element from |small_data_| into a new std::vector that can
-  // be access through |large_data|.
-  void MoveToLargeData() {
-    assert(!large_data_);
-    large_data_ = MakeUnique<std::vector<T>>();
+  // Returns the buffer inside the object.
+  T* small_data() { return reinterpret_cast<T*>(buffer_); }
+
+  // Returns true if the elements are in the buffer inside the object.
+  bool IsSmall() const { return data_ == reinterpret_cast<const T*>(buffer_); }
+
+  // Returns uninitialized heap memory for |capacity| elements.
+  static T* Allocate(size_t capacity) {
+    assert(capacity <= UINT32_MAX && "SmallVector is too large");
+    return static_cast<T*>(::operator new(capacity * sizeof(T)));
+  }
+
+  // Moves the elements to a new heap buffer that can hold |new_capacity|
+  // elements.
+  void Reallocate(size_t new_capacity) {
+    MoveElementsTo(Allocate(new_capacity), new_capacity);
+  }
+
+  // Moves the elements to |new_data|, which was returned by Allocate for
+  // |new_capacity| elements, and makes it the storage of the vector.
+  void MoveElementsTo(T* new_data, size_t new_capacity) {
     for (size_t i = 0; i < size_; ++i) {
-      large_data_->emplace_back(std::move(small_data_[i]));
+      new (new_data + i) T(std::move(data_[i]));
+      data_[i].~T();
     }
-    DestructSmallData();
+    ReleaseLargeData();
+    data_ = new_data;
+    capacity_ = static_cast<uint32_t>(new_capacity);
   }
 
-  // Destroys all of the elements in |small_data_| that have been constructed.
-  void DestructSmallData() {
+  // Frees the heap buffer, if the elements are there, and goes back to the
+  // buffer inside the object.  The elements must have been destroyed.
+  void ReleaseLargeData() {
+    if (!IsSmall()) {
+      ::operator delete(data_);
+      data_ = small_data();
+      capacity_ = small_size;
+    }
+  }
+
+  // Destroys all of the elements, keeping the storage.
+  void DestructElements() {
     for (size_t i = 0; i < size_; ++i) {
-      small_data_[i].~T();
+      data_[i].~T();
     }
     size_ = 0;
   }
 
-  // The number of elements in |small_data_| that have been constructed.
-  size_t size_;
+  // The elements, either in |buffer_| or in a heap buffer.
+  T* data_;
+
+  // The number of elements that have been constructed.
+  uint32_t size_;
 
-  // The pointed used to access the array of elements when the number of
-  // elements is small.
-  T* small_data_;
+  // The number of elements that |data_| can hold.
+  uint32_t capacity_;
 
-  // The actual data used to store the array elements.  It must never be used
-  // directly, but must only be accesed through |small_data_|.
+  // The storage of the elements when there are at most |small_size| of them.
+  // It must never be used directly, but must only be accessed through |data_|.
   typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type
-      buffer[small_size];
-
-  // A pointer to a vector that is used to store the elements of the vector when
-  // this size exceeds |small_size|.  If |large_data_| is nullptr, then the data
-  // is stored in |small_data_|.  Otherwise, the data is stored in
-  // |large_data_|.
-  std::unique_ptr<std::vector<T>> large_data_;
-};  // namespace utils
+      buffer_[small_size];
+};
 
 }  // namespace utils
 }  // namespace spvtools
@@ -0,0 +1,235 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/util/sparse_bit_vector.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace spvtools {
+namespace utils {
+
+bool SparseBitVector::Block::Empty() const {
+  BitContainer any = 0;
+  for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+    any |= bits[j];
+  }
+  return any == 0;
+}
+
+std::vector<SparseBitVector::Block>::iterator SparseBitVector::LowerBound(
+    uint32_t index) {
+  return std::lower_bound(
+      blocks_.begin(), blocks_.end(), index,
+      [](const Block& block, uint32_t i) { return block.index < i; });
+}
+
+std::vector<SparseBitVector::Block>::const_iterator SparseBitVector::LowerBound(
+    uint32_t index) const {
+  return std::lower_bound(
+      blocks_.begin(), blocks_.end(), index,
+      [](const Block& block, uint32_t i) { return block.index < i; });
+}
+
+bool SparseBitVector::Set(uint32_t i) {
+  const uint32_t block_index = i / kBitsPerBlock;
+  const uint32_t element_index = (i % kBitsPerBlock) / kBitContainerSize;
+  const BitContainer ith_bit = static_cast<BitContainer>(1)
+                               << (i % kBitContainerSize);
+
+  auto it = LowerBound(block_index);
+  if (it == blocks_.end() || it->index != block_index) {
+    Block block = {block_index, {}};
+    block.bits[element_index] = ith_bit;
+    blocks_.insert(it, block);
+    return false;
+  }
+
+  if ((it->bits[element_index] & ith_bit) != 0) {
+    return true;
+  }
+  it->bits[element_index] |= ith_bit;
+  return false;
+}
+
+bool SparseBitVector::Clear(uint32_t i) {
+  const uint32_t block_index = i / kBitsPerBlock;
+  const uint32_t element_index = (i % kBitsPerBlock) / kBitContainerSize;
+  const BitContainer ith_bit = static_cast<BitContainer>(1)
+                               << (i % kBitContainerSize);
+
+  auto it = LowerBound(block_index);
+  if (it == blocks_.end() || it->index != block_index ||
+      (it->bits[element_index] & ith_bit) == 0) {
+    return false;
+  }
+
+  it->bits[element_index] &= ~ith_bit;
+  if (it->Empty()) {
+    blocks_.erase(it);
+  }
+  return true;
+}
+
+bool SparseBitVector::Get(uint32_t i) const {
+  const uint32_t block_index = i / kBitsPerBlock;
+  const uint32_t element_index = (i % kBitsPerBlock) / kBitContainerSize;
+
+  auto it = LowerBound(block_index);
+  if (it == blocks_.end() || it->index != block_index) {
+    return false;
+  }
+  return ((it->bits[element_index] >> (i % kBitContainerSize)) & 1) != 0;
+}
+
+uint32_t SparseBitVector::Count() const {
+  uint32_t count = 0;
+  for (const Block& block : blocks_) {
+    for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+      count += static_cast<uint32_t>(CountSetBits64(block.bits[j]));
+    }
+  }
+  return count;
+}
+
+bool SparseBitVector::Or(const SparseBitVector& other) {
+  std::vector<Block> result;
+  result.reserve(blocks_.size() + other.blocks_.size());
+  bool modified = false;
+
+  auto this_it = blocks_.begin();
+  auto other_it = other.blocks_.begin();
+  while (other_it != other.blocks_.end()) {
+    if (this_it == blocks_.end() || other_it->index < this_it->index) {
+      result.push_back(*other_it++);
+      modified = true;
+    } else if (this_it->index < other_it->index) {
+      result.push_back(*this_it++);
+    } else {
+      Block block = *this_it++;
+      for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+        const BitContainer bits = block.bits[j] | other_it->bits[j];
+        modified |= bits != block.bits[j];
+        block.bits[j] = bits;
+      }
+      result.push_back(block);
+      ++other_it;
+    }
+  }
+  result.insert(result.end(), this_it, blocks_.end());
+
+  blocks_ = std::move(result);
+  return modified;
+}
+
+bool SparseBitVector::And(const SparseBitVector& other) {
+  const size_t original_size = blocks_.size();
+  bool modified = false;
+
+  // The blocks that are kept are compacted at the front of |blocks_|.
+  auto out = blocks_.begin();
+  auto other_it = other.blocks_.begin();
+  for (auto this_it = blocks_.begin(); this_it != blocks_.end(); ++this_it) {
+    while (other_it != other.blocks_.end() &&
+           other_it->index < this_it->index) {
+      ++other_it;
+    }
+    if (other_it == other.blocks_.end() || other_it->index != this_it->index) {
+      continue;
+    }
+    Block block = *this_it;
+    for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+      const BitContainer bits = block.bits[j] & other_it->bits[j];
+      modified |= bits != block.bits[j];
+      block.bits[j] = bits;
+    }
+    if (!block.Empty()) {
+      *out++ = block;
+    } else {
+      modified = true;
+    }
+  }
+  blocks_.erase(out, blocks_.end());
+
+  return modified || blocks_.size() != original_size;
+}
+
+bool SparseBitVector::AndNot(const SparseBitVector& other) {
+  bool modified = false;
+
+  auto out = blocks_.begin();
+  auto other_it = other.blocks_.begin();
+  for (auto this_it = blocks_.begin(); this_it != blocks_.end(); ++this_it) {
+    while (other_it != other.blocks_.end() &&
+           other_it->index < this_it->index) {
+      ++other_it;
+    }
+    Block block = *this_it;
+    if (other_it != other.blocks_.end() && other_it->index == block.index) {
+      for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+        modified |= (block.bits[j] & other_it->bits[j]) != 0;
+        block.bits[j] &= ~other_it->bits[j];
+      }
+    }
+    if (!block.Empty()) {
+      *out++ = block;
+    }
+  }
+  blocks_.erase(out, blocks_.end());
+
+  return modified;
+}
+
+bool SparseBitVector::Intersects(const SparseBitVector& other) const {
+  auto this_it = blocks_.begin();
+  auto other_it = other.blocks_.begin();
+  while (this_it != blocks_.end() && other_it != other.blocks_.end()) {
+    if (this_it->index < other_it->index) {
+      ++this_it;
+    } else if (other_it->index < this_it->index) {
+      ++other_it;
+    } else {
+      for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+        if ((this_it->bits[j] & other_it->bits[j]) != 0) {
+          return true;
+        }
+      }
+      ++this_it;
+      ++other_it;
+    }
+  }
+  return false;
+}
+
+bool SparseBitVector::operator==(const SparseBitVector& other) const {
+  // Blocks are stored only if they have a bit set, so equal sets have the
+  // same blocks.
+  return blocks_.size() == other.blocks_.size() &&
+         std::equal(blocks_.begin(), blocks_.end(), other.blocks_.begin(),
+                    [](const Block& a, const Block& b) {
+                      return a.index == b.index &&
+                             std::equal(a.bits, a.bits + kContainersPerBlock,
+                                        b.bits);
+                    });
+}
+
+std::ostream& operator<<(std::ostream& out, const SparseBitVector& bv) {
+  out << "{";
+  bv.ForEachSetBit([&out](uint32_t i) { out << ' ' << i; });
+  out << "}";
+  return out;
+}
+
+}  // namespace utils
+}  // namespace spvtools
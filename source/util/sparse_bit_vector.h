@@ -0,0 +1,122 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_UTIL_SPARSE_BIT_VECTOR_H_
+#define SOURCE_UTIL_SPARSE_BIT_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "source/util/bitutils.h"
+
+namespace spvtools {
+namespace utils {
+
+// Implements a bit vector class for sets over a large space with few members,
+// such as sets of ids that are far apart.
+//
+// All bits default to zero, and the upper bound is 2^32-1.  Only the blocks of
+// kBitsPerBlock bits that contain a 1 are stored, sorted by their index, so
+// the storage is proportional to the number of such blocks rather than to the
+// largest member.  Set, Clear and Get take time logarithmic in the number of
+// blocks; the bulk operations merge the blocks of both operands.  Use
+// BitVector for dense sets.
+class SparseBitVector {
+ private:
+  using BitContainer = uint64_t;
+  enum { kBitContainerSize = 64 };
+  enum { kContainersPerBlock = 2 };
+  enum { kBitsPerBlock = kBitContainerSize * kContainersPerBlock };
+
+  // A block of kBitsPerBlock bits, starting at bit |index| * kBitsPerBlock.
+  // Blocks that are stored have at least one bit set.
+  struct Block {
+    uint32_t index;
+    BitContainer bits[kContainersPerBlock];
+
+    bool Empty() const;
+  };
+
+ public:
+  // Creates a bit vector containing 0s.
+  SparseBitVector() = default;
+
+  // Sets the |i|th bit to 1.  Returns the |i|th bit before it was set.
+  bool Set(uint32_t i);
+
+  // Sets the |i|th bit to 0.  Return the |i|th bit before it was cleared.
+  bool Clear(uint32_t i);
+
+  // Returns the |i|th bit.
+  bool Get(uint32_t i) const;
+
+  // Returns true if every bit is 0.
+  bool Empty() const { return blocks_.empty(); }
+
+  // Sets every bit to 0.
+  void ClearAll() { blocks_.clear(); }
+
+  // Returns the number of bits that are 1.
+  uint32_t Count() const;
+
+  // Calls |f| on the index of each bit that is 1, in increasing order.
+  template <typename F>
+  void ForEachSetBit(const F& f) const {
+    for (const Block& block : blocks_) {
+      for (uint32_t j = 0; j < kContainersPerBlock; ++j) {
+        for (BitContainer bits = block.bits[j]; bits != 0; bits &= bits - 1) {
+          f(static_cast<uint32_t>(block.index * kBitsPerBlock +
+                                  j * kBitContainerSize +
+                                  LowestSetBitPosition(bits)));
+        }
+      }
+    }
+  }
+
+  friend std::ostream& operator<<(std::ostream&, const SparseBitVector&);
+
+  // Performs a bitwise-or operation on |this| and |that|, storing the result in
+  // |this|.  Return true if |this| changed.
+  bool Or(const SparseBitVector& that);
+
+  // Performs a bitwise-and operation on |this| and |that|, storing the result
+  // in |this|.  Return true if |this| changed.
+  bool And(const SparseBitVector& that);
+
+  // Clears in |this| the bits that are 1 in |that|.  Return true if |this|
+  // changed.
+  bool AndNot(const SparseBitVector& that);
+
+  // Returns true if some bit is 1 in both |this| and |that|.
+  bool Intersects(const SparseBitVector& that) const;
+
+  bool operator==(const SparseBitVector& that) const;
+  bool operator!=(const SparseBitVector& that) const {
+    return !(*this == that);
+  }
+
+ private:
+  // Returns the first block whose index is not less than |index|.
+  std::vector<Block>::iterator LowerBound(uint32_t index);
+  std::vector<Block>::const_iterator LowerBound(uint32_t index) const;
+
+  std::vector<Block> blocks_;
+};
+
+}  // namespace utils
+}  // namespace spvtools
+
+#endif  // SOURCE_UTIL_SPARSE_BIT_VECTOR_H_
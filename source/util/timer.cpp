@@ -16,14 +16,138 @@
 
 #include "source/util/timer.h"
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <locale>
+#include <sstream>
 #include <string>
 
+#include "source/util/allocator.h"
+
 namespace spvtools {
 namespace utils {
+namespace {
+
+// The state of the trace being written. It is changed, and the trace written,
+// only while |trace_lock| is held. |trace_stream| is also read without the lock
+// so that a TraceScope can cheaply skip measuring when there is no trace.
+std::atomic_flag trace_lock = ATOMIC_FLAG_INIT;
+std::atomic<std::ostream*> trace_stream(nullptr);
+std::atomic<bool> trace_hardware_counters(false);
+timespec trace_start;
+bool trace_has_events = false;
+
+// Holds |trace_lock| for the lifetime of the object. Events are short and
+// rare compared to the work they measure, so spinning is cheap enough.
+class TraceLock {
+ public:
+  TraceLock() {
+    while (trace_lock.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+  ~TraceLock() { trace_lock.clear(std::memory_order_release); }
+};
+
+// Returns the time gap between |from| and |to| in microseconds.
+double Microseconds(const timespec& from, const timespec& to) {
+  return static_cast<double>(to.tv_sec - from.tv_sec) * 1000000. +
+         static_cast<double>(to.tv_nsec - from.tv_nsec) * .001;
+}
+
+// Returns a small number identifying the calling thread in the trace.
+uint32_t TraceThreadId() {
+  static std::atomic<uint32_t> next_id(1);
+  thread_local uint32_t id = next_id++;
+  return id;
+}
+
+// Writes |str| to |out| as the contents of a JSON string.
+void WriteJsonString(std::ostream* out, const char* str) {
+  for (; *str; ++str) {
+    const unsigned char c = static_cast<unsigned char>(*str);
+    if (c == '"' || c == '\\') {
+      *out << '\\' << *str;
+    } else if (c < 0x20) {
+      *out << "\\u00" << "0123456789abcdef"[c >> 4]
+           << "0123456789abcdef"[c & 0xf];
+    } else {
+      *out << *str;
+    }
+  }
+}
+
+// The names under which the hardware counters appear in the trace.
+const char* const kCounterNames[TraceScope::kNumCounters] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"};
+
+#if defined(__linux__)
+// The perf events counting the hardware counters of a thread, in the order of
+// kCounterNames. They count only while the thread runs in user space.
+class HardwareCounters {
+ public:
+  HardwareCounters() {
+    const uint64_t configs[TraceScope::kNumCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < TraceScope::kNumCounters; ++i) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1,
+                                         -1, PERF_FLAG_FD_CLOEXEC));
+    }
+  }
+
+  ~HardwareCounters() {
+    for (int fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+  }
+
+  // Reads counter |i| into |*value|. Returns false if the counter could not
+  // be opened or read, which is the case when perf events are not permitted.
+  bool Read(int i, uint64_t* value) const {
+    return fds_[i] >= 0 && read(fds_[i], value, sizeof(*value)) ==
+                               static_cast<ssize_t>(sizeof(*value));
+  }
+
+ private:
+  int fds_[TraceScope::kNumCounters];
+};
+#endif
+
+// Reads the hardware counters of the calling thread into |values|, setting
+// |valid| to whether each could be read. None can be read unless the trace
+// asked for them. The counters are opened by the first call on each thread.
+void ReadHardwareCounters(uint64_t* values, bool* valid) {
+  for (int i = 0; i < TraceScope::kNumCounters; ++i) valid[i] = false;
+#if defined(__linux__)
+  if (!trace_hardware_counters.load(std::memory_order_relaxed)) return;
+  thread_local HardwareCounters counters;
+  for (int i = 0; i < TraceScope::kNumCounters; ++i) {
+    valid[i] = counters.Read(i, &values[i]);
+  }
+#else
+  (void)values;
+#endif
+}
+
+}  // namespace
 
 void PrintTimerDescription(std::ostream* out, bool measure_mem_usage) {
   if (out) {
@@ -96,6 +220,105 @@ void Timer::Report(const char* tag) {
   *report_stream_ << std::endl;
 }
 
+void StartTrace(std::ostream* out, bool hardware_counters) {
+  StopTrace();
+  if (!out) return;
+  TraceLock lock;
+  clock_gettime(CLOCK_MONOTONIC, &trace_start);
+  trace_has_events = false;
+  trace_hardware_counters = hardware_counters;
+  *out << "{\"traceEvents\":[";
+  trace_stream = out;
+}
+
+void StopTrace() {
+  TraceLock lock;
+  std::ostream* out = trace_stream.exchange(nullptr);
+  if (!out) return;
+  *out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+TraceFromEnvironment::TraceFromEnvironment() {
+  const char* name = std::getenv("SPIRV_TOOLS_TRACE_FILE");
+  if (name == nullptr || *name == '\0') return;
+  std::string path(name);
+  const std::string pid = std::to_string(getpid());
+  for (size_t pos = path.find("%p"); pos != std::string::npos;
+       pos = path.find("%p", pos + pid.size())) {
+    path.replace(pos, 2, pid);
+  }
+  file_.open(path.c_str());
+  if (!file_) return;
+  const char* counters = std::getenv("SPIRV_TOOLS_TRACE_COUNTERS");
+  StartTrace(&file_, counters != nullptr && strcmp(counters, "1") == 0);
+}
+
+TraceFromEnvironment::~TraceFromEnvironment() {
+  if (file_.is_open()) StopTrace();
+}
+
+bool IsTracing() {
+  return trace_stream.load(std::memory_order_relaxed) != nullptr;
+}
+
+// As in Timer, the clocks are read closest to the code being measured.
+TraceScope::TraceScope(const char* name) : name_(nullptr) {
+  if (!IsTracing()) return;
+  const AllocationStats allocations = GetThreadAllocationStats();
+  allocations_before_ = allocations.count;
+  allocated_bytes_before_ = allocations.bytes;
+  ReadHardwareCounters(counters_before_, counters_valid_);
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_before_) == -1 ||
+      clock_gettime(CLOCK_MONOTONIC, &wall_before_) == -1) {
+    return;
+  }
+  name_ = name;
+}
+
+TraceScope::~TraceScope() {
+  if (name_ == nullptr) return;
+  timespec wall_after;
+  timespec cpu_after;
+  if (clock_gettime(CLOCK_MONOTONIC, &wall_after) == -1 ||
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_after) == -1) {
+    return;
+  }
+  uint64_t counters_after[kNumCounters];
+  bool counters_valid_after[kNumCounters];
+  ReadHardwareCounters(counters_after, counters_valid_after);
+  const AllocationStats allocations = GetThreadAllocationStats();
+
+  TraceLock lock;
+  std::ostream* out = trace_stream.load(std::memory_order_relaxed);
+  // Drop the scope if the trace was stopped, or restarted, since it began.
+  if (!out || Microseconds(trace_start, wall_before_) < 0) return;
+
+  // Format the event apart from |out|, so that neither its locale nor its
+  // formatting flags affect the JSON.
+  std::ostringstream event;
+  event.imbue(std::locale::classic());
+  event << std::fixed << std::setprecision(3) << (trace_has_events ? "," : "")
+        << "\n{\"name\":\"";
+  WriteJsonString(&event, name_);
+  event << "\",\"cat\":\"spirv\",\"ph\":\"X\",\"ts\":"
+        << Microseconds(trace_start, wall_before_)
+        << ",\"dur\":" << Microseconds(wall_before_, wall_after)
+        << ",\"pid\":" << getpid() << ",\"tid\":" << TraceThreadId()
+        << ",\"args\":{\"cpu_us\":" << Microseconds(cpu_before_, cpu_after)
+        << ",\"allocations\":" << allocations.count - allocations_before_
+        << ",\"allocated_bytes\":"
+        << allocations.bytes - allocated_bytes_before_;
+  for (int i = 0; i < kNumCounters; ++i) {
+    if (counters_valid_[i] && counters_valid_after[i]) {
+      event << ",\"" << kCounterNames[i]
+            << "\":" << counters_after[i] - counters_before_[i];
+    }
+  }
+  event << "}}";
+  *out << event.str();
+  trace_has_events = true;
+}
+
 }  // namespace utils
 }  // namespace spvtools
 
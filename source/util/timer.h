@@ -21,6 +21,9 @@
 
 #include <sys/resource.h>
 #include <cassert>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
 #include <iostream>
 
 // A macro to call spvtools::utils::PrintTimerDescription(std::ostream*, bool).
@@ -52,6 +55,21 @@
   spvtools::utils::ScopedTimer<spvtools::utils::Timer> timer##__LINE__( \
       __VA_ARGS__)
 
+// Creates an object of TraceScope that records the scope surrounding it as an
+// event of the trace started by spvtools::utils::StartTrace(), if any. The
+// argument is the name of the event, and must outlive the scope. The variable
+// it declares has a fixed name, so only one trace scope may be created directly
+// in each scope.
+#define SPIRV_TRACE_SCOPE(name) \
+  spvtools::utils::TraceScope trace_scope##__LINE__(name)
+
+// Creates a static object of TraceFromEnvironment, so that the trace requested
+// by the environment, if any, is written until the process exits. Command line
+// tools place it at the start of main(); the library never reads the
+// environment by itself.
+#define SPIRV_TRACE_FROM_ENVIRONMENT() \
+  static spvtools::utils::TraceFromEnvironment trace_from_environment
+
 namespace spvtools {
 namespace utils {
 
@@ -379,6 +397,76 @@ class CumulativeTimer : public Timer {
   long pgfaults_;
 };
 
+// Starts writing a trace of the TraceScope objects that end on any thread to
+// |out|, in the JSON object form of the Chrome trace event format, which can be
+// loaded by chrome://tracing or Perfetto. If |hardware_counters| is true, the
+// events also carry the cycles, instructions, cache misses and branch misses
+// counted by Linux perf events for the thread, when those can be opened. Any
+// trace already being written is stopped first. |out| must remain valid until
+// StopTrace() is called.
+void StartTrace(std::ostream* out, bool hardware_counters = false);
+
+// Completes the trace being written, if any, and stops writing it.
+void StopTrace();
+
+// Returns true if a trace is being written.
+bool IsTracing();
+
+// TraceFromEnvironment writes a trace for its lifetime to the file named by the
+// environment variable SPIRV_TOOLS_TRACE_FILE, if it is set, with hardware
+// counters if SPIRV_TOOLS_TRACE_COUNTERS is set to 1. Each "%p" in the name is
+// replaced by the process id, so that concurrent processes write separate
+// traces. It should be created through SPIRV_TRACE_FROM_ENVIRONMENT.
+class TraceFromEnvironment {
+ public:
+  TraceFromEnvironment();
+  ~TraceFromEnvironment();
+
+  TraceFromEnvironment(const TraceFromEnvironment&) = delete;
+  TraceFromEnvironment& operator=(const TraceFromEnvironment&) = delete;
+
+ private:
+  // The file the trace is written to, which is not open if there is no trace.
+  std::ofstream file_;
+};
+
+// TraceScope measures the resource utilization of the scope surrounding it and
+// writes it to the trace as a complete event named |name|: the wall time, the
+// CPU time of the thread, the number and size of the allocations made by
+// utils::Allocate() on the thread and, if enabled, the hardware counters.
+// Scopes nest, and the trace shows them nested per thread. If no trace is being
+// written when the scope begins, it measures nothing. It should be created
+// through SPIRV_TRACE_SCOPE.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  // The number of hardware counters a scope can record.
+  static const int kNumCounters = 4;
+
+ private:
+  // The name of the event, or nullptr if the scope measures nothing.
+  const char* name_;
+
+  // The results of clock_gettime(CLOCK_MONOTONIC) and
+  // clock_gettime(CLOCK_THREAD_CPUTIME_ID) when the scope began.
+  timespec wall_before_;
+  timespec cpu_before_;
+
+  // The allocations made by the thread before the scope began.
+  uint64_t allocations_before_;
+  uint64_t allocated_bytes_before_;
+
+  // The hardware counters when the scope began, and whether each of them
+  // could be read.
+  uint64_t counters_before_[kNumCounters];
+  bool counters_valid_[kNumCounters];
+};
+
 }  // namespace utils
 }  // namespace spvtools
 
@@ -386,6 +474,8 @@ class CumulativeTimer : public Timer {
 
 #define SPIRV_TIMER_DESCRIPTION(...)
 #define SPIRV_TIMER_SCOPED(...)
+#define SPIRV_TRACE_SCOPE(...)
+#define SPIRV_TRACE_FROM_ENVIRONMENT()
 
 #endif  // defined(SPIRV_TIMER_ENABLED)
 
@@ -35,6 +35,7 @@
 #include "source/spirv_endian.h"
 #include "source/spirv_target_env.h"
 #include "source/spirv_validator_options.h"
+#include "source/util/timer.h"
 #include "source/val/construct.h"
 #include "source/val/function.h"
 #include "source/val/instruction.h"
@@ -94,6 +95,41 @@ spv_result_t ProcessInstruction(void* user_data,
   return SPV_SUCCESS;
 }
 
+// The state of a parse that validates a module while handing each parsed
+// instruction on to a client, as in ValidateBinaryAndForwardInstructions.
+struct ForwardingParseState {
+  ValidationState_t* vstate;
+  void* user_data;
+  spv_parsed_header_fn_t parsed_header;
+  spv_parsed_instruction_fn_t parsed_instruction;
+  // The first failure reported by the client; nothing more is forwarded to
+  // the client after it has failed.
+  spv_result_t client_status;
+};
+
+spv_result_t ForwardHeader(void* user_data, spv_endianness_t endian,
+                           uint32_t magic, uint32_t version,
+                           uint32_t generator, uint32_t id_bound,
+                           uint32_t reserved) {
+  auto* state = reinterpret_cast<ForwardingParseState*>(user_data);
+  if (state->parsed_header && state->client_status == SPV_SUCCESS) {
+    state->client_status =
+        state->parsed_header(state->user_data, endian, magic, version,
+                             generator, id_bound, reserved);
+  }
+  return SPV_SUCCESS;
+}
+
+spv_result_t ProcessAndForwardInstruction(
+    void* user_data, const spv_parsed_instruction_t* inst) {
+  auto* state = reinterpret_cast<ForwardingParseState*>(user_data);
+  if (auto error = ProcessInstruction(state->vstate, inst)) return error;
+  if (state->parsed_instruction && state->client_status == SPV_SUCCESS) {
+    state->client_status = state->parsed_instruction(state->user_data, inst);
+  }
+  return SPV_SUCCESS;
+}
+
 spv_result_t ValidateForwardDecls(ValidationState_t& _) {
   if (_.unresolved_forward_id_count() == 0) return SPV_SUCCESS;
 
@@ -154,7 +190,9 @@ spv_result_t ValidateEntryPoints(ValidationState_t& _) {
 
 spv_result_t ValidateBinaryUsingContextAndValidationState(
     const spv_context_t& context, const uint32_t* words, const size_t num_words,
-    spv_diagnostic* pDiagnostic, ValidationState_t* vstate) {
+    spv_diagnostic* pDiagnostic, ValidationState_t* vstate,
+    ForwardingParseState* forwarding = nullptr) {
+  SPIRV_TRACE_SCOPE("Validate");
   auto binary = std::unique_ptr<spv_const_binary_t>(
       new spv_const_binary_t{words, num_words});
 
@@ -203,10 +241,20 @@ spv_result_t ValidateBinaryUsingContextAndValidationState(
 
   // Parse the module and perform inline validation checks. These checks do
   // not require the the knowledge of the whole module.
-  if (auto error = spvBinaryParse(&context, vstate, words, num_words,
-                                  /*parsed_header =*/nullptr,
-                                  ProcessInstruction, pDiagnostic)) {
-    return error;
+  {
+    SPIRV_TRACE_SCOPE("Validate: parse");
+    if (forwarding) {
+      forwarding->vstate = vstate;
+      if (auto error = spvBinaryParse(
+              &context, forwarding, words, num_words, ForwardHeader,
+              ProcessAndForwardInstruction, pDiagnostic)) {
+        return error;
+      }
+    } else if (auto error = spvBinaryParse(&context, vstate, words, num_words,
+                                           /*parsed_header =*/nullptr,
+                                           ProcessInstruction, pDiagnostic)) {
+      return error;
+    }
   }
 
   std::vector<Instruction*> visited_entry_points;
@@ -311,64 +359,74 @@ spv_result_t ValidateBinaryUsingContextAndValidationState(
   // It should also live after the forward declaration check, since it will
   // have problems with missing forward declarations, but give less useful error
   // messages.
-  for (size_t i = 0; i < vstate->ordered_instructions().size(); ++i) {
-    auto& instruction = vstate->ordered_instructions()[i];
-    if (auto error = UpdateIdUse(*vstate, &instruction)) return error;
+  {
+    SPIRV_TRACE_SCOPE("Validate: id uses");
+    for (size_t i = 0; i < vstate->ordered_instructions().size(); ++i) {
+      auto& instruction = vstate->ordered_instructions()[i];
+      if (auto error = UpdateIdUse(*vstate, &instruction)) return error;
+    }
   }
 
   // Validate individual opcodes.
-  for (size_t i = 0; i < vstate->ordered_instructions().size(); ++i) {
-    auto& instruction = vstate->ordered_instructions()[i];
-
-    // Keep these passes in the order they appear in the SPIR-V specification
-    // sections to maintain test consistency.
-    if (auto error = MiscPass(*vstate, &instruction)) return error;
-    if (auto error = DebugPass(*vstate, &instruction)) return error;
-    if (auto error = AnnotationPass(*vstate, &instruction)) return error;
-    if (auto error = ExtensionPass(*vstate, &instruction)) return error;
-    if (auto error = ModeSettingPass(*vstate, &instruction)) return error;
-    if (auto error = TypePass(*vstate, &instruction)) return error;
-    if (auto error = ConstantPass(*vstate, &instruction)) return error;
-    if (auto error = MemoryPass(*vstate, &instruction)) return error;
-    if (auto error = FunctionPass(*vstate, &instruction)) return error;
-    if (auto error = ImagePass(*vstate, &instruction)) return error;
-    if (auto error = ConversionPass(*vstate, &instruction)) return error;
-    if (auto error = CompositesPass(*vstate, &instruction)) return error;
-    if (auto error = ArithmeticsPass(*vstate, &instruction)) return error;
-    if (auto error = BitwisePass(*vstate, &instruction)) return error;
-    if (auto error = LogicalsPass(*vstate, &instruction)) return error;
-    if (auto error = ControlFlowPass(*vstate, &instruction)) return error;
-    if (auto error = DerivativesPass(*vstate, &instruction)) return error;
-    if (auto error = AtomicsPass(*vstate, &instruction)) return error;
-    if (auto error = PrimitivesPass(*vstate, &instruction)) return error;
-    if (auto error = BarriersPass(*vstate, &instruction)) return error;
-    // Group
-    // Device-Side Enqueue
-    // Pipe
-    if (auto error = NonUniformPass(*vstate, &instruction)) return error;
-
-    if (auto error = LiteralsPass(*vstate, &instruction)) return error;
+  {
+    SPIRV_TRACE_SCOPE("Validate: opcodes");
+    for (size_t i = 0; i < vstate->ordered_instructions().size(); ++i) {
+      auto& instruction = vstate->ordered_instructions()[i];
+
+      // Keep these passes in the order they appear in the SPIR-V specification
+      // sections to maintain test consistency.
+      if (auto error = MiscPass(*vstate, &instruction)) return error;
+      if (auto error = DebugPass(*vstate, &instruction)) return error;
+      if (auto error = AnnotationPass(*vstate, &instruction)) return error;
+      if (auto error = ExtensionPass(*vstate, &instruction)) return error;
+      if (auto error = ModeSettingPass(*vstate, &instruction)) return error;
+      if (auto error = TypePass(*vstate, &instruction)) return error;
+      if (auto error = ConstantPass(*vstate, &instruction)) return error;
+      if (auto error = MemoryPass(*vstate, &instruction)) return error;
+      if (auto error = FunctionPass(*vstate, &instruction)) return error;
+      if (auto error = ImagePass(*vstate, &instruction)) return error;
+      if (auto error = ConversionPass(*vstate, &instruction)) return error;
+      if (auto error = CompositesPass(*vstate, &instruction)) return error;
+      if (auto error = ArithmeticsPass(*vstate, &instruction)) return error;
+      if (auto error = BitwisePass(*vstate, &instruction)) return error;
+      if (auto error = LogicalsPass(*vstate, &instruction)) return error;
+      if (auto error = ControlFlowPass(*vstate, &instruction)) return error;
+      if (auto error = DerivativesPass(*vstate, &instruction)) return error;
+      if (auto error = AtomicsPass(*vstate, &instruction)) return error;
+      if (auto error = PrimitivesPass(*vstate, &instruction)) return error;
+      if (auto error = BarriersPass(*vstate, &instruction)) return error;
+      // Group
+      // Device-Side Enqueue
+      // Pipe
+      if (auto error = NonUniformPass(*vstate, &instruction)) return error;
+
+      if (auto error = LiteralsPass(*vstate, &instruction)) return error;
+    }
   }
 
-  // Validate the preconditions involving adjacent instructions. e.g. SpvOpPhi
-  // must only be preceeded by SpvOpLabel, SpvOpPhi, or SpvOpLine.
-  if (auto error = ValidateAdjacency(*vstate)) return error;
-
-  if (auto error = ValidateEntryPoints(*vstate)) return error;
-  // CFG checks are performed after the binary has been parsed
-  // and the CFGPass has collected information about the control flow
-  if (auto error = PerformCfgChecks(*vstate)) return error;
-  if (auto error = CheckIdDefinitionDominateUse(*vstate)) return error;
-  if (auto error = ValidateDecorations(*vstate)) return error;
-  if (auto error = ValidateInterfaces(*vstate)) return error;
-  // TODO(dsinclair): Restructure ValidateBuiltins so we can move into the
-  // for() above as it loops over all ordered_instructions internally.
-  if (auto error = ValidateBuiltIns(*vstate)) return error;
-  // These checks must be performed after individual opcode checks because
-  // those checks register the limitation checked here.
-  for (const auto& inst : vstate->ordered_instructions()) {
-    if (auto error = ValidateExecutionLimitations(*vstate, &inst)) return error;
-    if (auto error = ValidateSmallTypeUses(*vstate, &inst)) return error;
+  {
+    SPIRV_TRACE_SCOPE("Validate: module");
+    // Validate the preconditions involving adjacent instructions. e.g. SpvOpPhi
+    // must only be preceeded by SpvOpLabel, SpvOpPhi, or SpvOpLine.
+    if (auto error = ValidateAdjacency(*vstate)) return error;
+
+    if (auto error = ValidateEntryPoints(*vstate)) return error;
+    // CFG checks are performed after the binary has been parsed
+    // and the CFGPass has collected information about the control flow
+    if (auto error = PerformCfgChecks(*vstate)) return error;
+    if (auto error = CheckIdDefinitionDominateUse(*vstate)) return error;
+    if (auto error = ValidateDecorations(*vstate)) return error;
+    if (auto error = ValidateInterfaces(*vstate)) return error;
+    // TODO(dsinclair): Restructure ValidateBuiltins so we can move into the
+    // for() above as it loops over all ordered_instructions internally.
+    if (auto error = ValidateBuiltIns(*vstate)) return error;
+    // These checks must be performed after individual opcode checks because
+    // those checks register the limitation checked here.
+    for (const auto& inst : vstate->ordered_instructions()) {
+      if (auto error = ValidateExecutionLimitations(*vstate, &inst))
+        return error;
+      if (auto error = ValidateSmallTypeUses(*vstate, &inst)) return error;
+    }
   }
 
   return SPV_SUCCESS;
@@ -393,6 +451,29 @@ spv_result_t ValidateBinaryAndKeepValidationState(
       hijack_context, words, num_words, pDiagnostic, vstate->get());
 }
 
+spv_result_t ValidateBinaryAndForwardInstructions(
+    const spv_const_context context, spv_const_validator_options options,
+    const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
+    void* user_data, spv_parsed_header_fn_t parsed_header,
+    spv_parsed_instruction_fn_t parsed_instruction) {
+  spv_context_t hijack_context = *context;
+  if (pDiagnostic) {
+    *pDiagnostic = nullptr;
+    UseDiagnosticAsMessageConsumer(&hijack_context, pDiagnostic);
+  }
+
+  ValidationState_t vstate(&hijack_context, options, words, num_words,
+                           kDefaultMaxNumOfWarnings);
+  ForwardingParseState forwarding = {&vstate, user_data, parsed_header,
+                                     parsed_instruction, SPV_SUCCESS};
+  if (auto error = ValidateBinaryUsingContextAndValidationState(
+          hijack_context, words, num_words, pDiagnostic, &vstate,
+          &forwarding)) {
+    return error;
+  }
+  return forwarding.client_status;
+}
+
 }  // namespace val
 }  // namespace spvtools
 
@@ -236,6 +236,26 @@ spv_result_t ValidateBinaryAndKeepValidationState(
     const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
     std::unique_ptr<ValidationState_t>* vstate);
 
+// Performs validation for the SPIR-V module binary, like
+// spvValidateWithOptions, and also hands the header and each instruction of
+// the binary to |parsed_header| and |parsed_instruction| as the validator
+// parses them, exactly as spvBinaryParse would with |user_data|.  This lets a
+// client build its own representation of the module without parsing the
+// binary a second time.  Apart from this parse, the validator only walks the
+// instruction word counts and prescans the OpCapability and OpExtension
+// prologue; friendly names are collected only if a diagnostic needs one.
+// Either callback may be null.
+//
+// Once a callback returns anything other than SPV_SUCCESS, nothing more is
+// handed to the client, but validation carries on; the client's failure is
+// returned if the binary is otherwise valid.  If the binary is invalid, the
+// client may have seen only part of it.
+spv_result_t ValidateBinaryAndForwardInstructions(
+    const spv_const_context context, spv_const_validator_options options,
+    const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
+    void* user_data, spv_parsed_header_fn_t parsed_header,
+    spv_parsed_instruction_fn_t parsed_instruction);
+
 }  // namespace val
 }  // namespace spvtools
 
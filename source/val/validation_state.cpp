@@ -18,8 +18,10 @@
 #include <stack>
 #include <utility>
 
+#include "source/binary.h"
 #include "source/opcode.h"
 #include "source/spirv_constant.h"
+#include "source/spirv_endian.h"
 #include "source/spirv_target_env.h"
 #include "source/val/basic_block.h"
 #include "source/val/construct.h"
@@ -100,26 +102,32 @@ bool IsInstructionInLayoutSection(ModuleLayoutSection layout, SpvOp op) {
   return layout == InstructionLayoutSection(layout, op);
 }
 
-// Counts the number of instructions and functions in the file.
-spv_result_t CountInstructions(void* user_data,
-                               const spv_parsed_instruction_t* inst) {
-  ValidationState_t& _ = *(reinterpret_cast<ValidationState_t*>(user_data));
-  if (inst->opcode == SpvOpFunction) _.increment_total_functions();
-  _.increment_total_instructions();
-
-  return SPV_SUCCESS;
-}
-
-spv_result_t setHeader(void* user_data, spv_endianness_t, uint32_t,
-                       uint32_t version, uint32_t generator, uint32_t id_bound,
-                       uint32_t) {
-  ValidationState_t& vstate =
-      *(reinterpret_cast<ValidationState_t*>(user_data));
-  vstate.setIdBound(id_bound);
-  vstate.setGenerator(generator);
-  vstate.setVersion(version);
-
-  return SPV_SUCCESS;
+// Reads the module header and counts the instructions and functions in the
+// binary by walking the word counts alone, so no operands are decoded. The
+// walk stops where the parser would reject a word count, so the totals are an
+// upper bound on what the validator will register.
+void CountInstructions(ValidationState_t* vstate, const uint32_t* words,
+                       size_t num_words) {
+  const spv_const_binary_t binary = {words, num_words};
+  spv_endianness_t endian;
+  spv_header_t header;
+  if (spvBinaryEndianness(&binary, &endian) != SPV_SUCCESS ||
+      spvBinaryHeaderGet(&binary, endian, &header) != SPV_SUCCESS) {
+    return;
+  }
+  vstate->setIdBound(header.bound);
+  vstate->setGenerator(header.generator);
+  vstate->setVersion(header.version);
+
+  size_t offset = SPV_INDEX_INSTRUCTION;
+  while (offset < num_words) {
+    const uint32_t word = spvFixWord(words[offset], endian);
+    const uint32_t word_count = word >> 16;
+    if (word_count == 0 || word_count > num_words - offset) break;
+    if ((word & 0xFFFF) == SpvOpFunction) vstate->increment_total_functions();
+    vstate->increment_total_instructions();
+    offset += word_count;
+  }
 }
 
 // Add features based on SPIR-V core version number.
@@ -178,23 +186,10 @@ ValidationState_t::ValidationState_t(const spv_const_context ctx,
   // Only attempt to count if we have words, otherwise let the other validation
   // fail and generate an error.
   if (num_words > 0) {
-    // Count the number of instructions in the binary.
-    // This parse should not produce any error messages. Hijack the context and
-    // replace the message consumer so that we do not pollute any state in input
-    // consumer.
-    spv_context_t hijacked_context = *ctx;
-    hijacked_context.consumer = [](spv_message_level_t, const char*,
-                                   const spv_position_t&, const char*) {};
-    spvBinaryParse(&hijacked_context, this, words, num_words, setHeader,
-                   CountInstructions,
-                   /* diagnostic = */ nullptr);
+    CountInstructions(this, words, num_words);
     preallocateStorage();
   }
   UpdateFeaturesBasedOnSpirvVersion(&features_, version_);
-
-  friendly_mapper_ = spvtools::MakeUnique<spvtools::FriendlyNameMapper>(
-      context_, words_, num_words_);
-  name_mapper_ = friendly_mapper_->GetNameMapper();
 }
 
 void ValidationState_t::preallocateStorage() {
@@ -226,7 +221,13 @@ void ValidationState_t::AssignNameToId(uint32_t id, std::string name) {
 }
 
 std::string ValidationState_t::getIdName(uint32_t id) const {
-  const std::string id_name = name_mapper_(id);
+  // Friendly names are only needed for diagnostics, so the binary is scanned
+  // for them the first time one is requested rather than on every run.
+  if (!friendly_mapper_) {
+    friendly_mapper_ = spvtools::MakeUnique<spvtools::FriendlyNameMapper>(
+        context_, words_, num_words_);
+  }
+  const std::string id_name = friendly_mapper_->NameForId(id);
 
   std::stringstream out;
   out << id << "[%" << id_name << "]";
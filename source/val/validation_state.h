@@ -883,9 +883,8 @@ class ValidationState_t {
   // TypePass.
   std::unordered_set<uint32_t> pointer_to_storage_image_;
 
-  /// Maps ids to friendly names.
-  std::unique_ptr<spvtools::FriendlyNameMapper> friendly_mapper_;
-  spvtools::NameMapper name_mapper_;
+  /// Maps ids to friendly names. Built on the first call to getIdName.
+  mutable std::unique_ptr<spvtools::FriendlyNameMapper> friendly_mapper_;
 
   /// Variables used to reduce the number of diagnostic messages.
   uint32_t num_of_warnings_;
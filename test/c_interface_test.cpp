@@ -295,5 +295,52 @@ TEST(CInterface, SpecifyConsumerSpecifyDiagnosticForValidating) {
   spvContextDestroy(context);
 }
 
+// Counts the allocations and deallocations made through |allocator|.
+struct CountingAllocator {
+  CountingAllocator() : allocator{Allocate, Deallocate, this} {}
+
+  static void* Allocate(void* user_data, size_t size) {
+    static_cast<CountingAllocator*>(user_data)->num_allocations++;
+    return ::operator new(size);
+  }
+
+  static void Deallocate(void* user_data, void* ptr, size_t) {
+    static_cast<CountingAllocator*>(user_data)->num_deallocations++;
+    ::operator delete(ptr);
+  }
+
+  spv_allocator_t allocator;
+  int num_allocations = 0;
+  int num_deallocations = 0;
+};
+
+TEST(CInterface, ReturnsObjectsFromContextAllocator) {
+  const char input_text[] = "OpNop";
+
+  CountingAllocator counter;
+  auto context = spvContextCreate(SPV_ENV_UNIVERSAL_1_1);
+  spvContextSetAllocator(context, &counter.allocator);
+
+  spv_binary binary = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvTextToBinary(context, input_text,
+                                         sizeof(input_text), &binary, nullptr));
+  spv_text text = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvBinaryToText(context, binary->code,
+                                         binary->wordCount, 0, &text, nullptr));
+  spv_diagnostic diagnostic = nullptr;
+  spv_const_binary_t b{binary->code, binary->wordCount};
+  EXPECT_EQ(SPV_ERROR_INVALID_LAYOUT, spvValidate(context, &b, &diagnostic));
+  ASSERT_NE(nullptr, diagnostic);
+  // Each object and its contents are separate allocations.
+  EXPECT_LE(6, counter.num_allocations);
+
+  // The objects go back to the allocator even once the context is gone.
+  spvContextDestroy(context);
+  spvDiagnosticDestroy(diagnostic);
+  spvTextDestroy(text);
+  spvBinaryDestroy(binary);
+  EXPECT_EQ(counter.num_allocations, counter.num_deallocations);
+}
+
 }  // namespace
 }  // namespace spvtools
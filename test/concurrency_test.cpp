@@ -0,0 +1,261 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Stress tests that use the library from many threads at once, sharing
+// contexts, options and tool objects between the threads as the thread-safety
+// rules documented in libspirv.h allow.  Build with
+// -DSPIRV_USE_SANITIZER=thread for data races to be reported.
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "spirv-tools/libspirv.h"
+#include "spirv-tools/libspirv.hpp"
+#include "spirv-tools/linker.hpp"
+#include "spirv-tools/optimizer.hpp"
+
+namespace spvtools {
+namespace {
+
+using ::testing::Eq;
+
+const spv_target_env kEnv = SPV_ENV_UNIVERSAL_1_3;
+
+const uint32_t kNumThreads = 8;
+
+const uint32_t kNumIterations = 20;
+
+// A fragment shader with a loop, so that loop analyses get exercised too.
+const char* const kShader = R"(OpCapability Shader
+OpMemoryModel Logical GLSL450
+OpEntryPoint Fragment %main "main" %color
+OpExecutionMode %main OriginUpperLeft
+OpDecorate %color Location 0
+%void = OpTypeVoid
+%3 = OpTypeFunction %void
+%int = OpTypeInt 32 1
+%float = OpTypeFloat 32
+%bool = OpTypeBool
+%int_0 = OpConstant %int 0
+%int_1 = OpConstant %int 1
+%int_10 = OpConstant %int 10
+%_ptr_Output_float = OpTypePointer Output %float
+%color = OpVariable %_ptr_Output_float Output
+%main = OpFunction %void None %3
+%5 = OpLabel
+OpBranch %10
+%10 = OpLabel
+%i = OpPhi %int %int_0 %5 %next %13
+OpLoopMerge %12 %13 None
+OpBranch %14
+%14 = OpLabel
+%cond = OpSLessThan %bool %i %int_10
+OpBranchConditional %cond %11 %12
+%11 = OpLabel
+%f = OpConvertSToF %float %i
+OpStore %color %f
+OpBranch %13
+%13 = OpLabel
+%next = OpIAdd %int %i %int_1
+OpBranch %10
+%12 = OpLabel
+OpReturn
+OpFunctionEnd
+)";
+
+// A module exporting a function, and one importing it.
+const char* const kExporter = R"(OpCapability Shader
+OpCapability Linkage
+OpMemoryModel Logical GLSL450
+OpDecorate %f LinkageAttributes "f" Export
+%void = OpTypeVoid
+%fn = OpTypeFunction %void
+%f = OpFunction %void None %fn
+%l = OpLabel
+OpReturn
+OpFunctionEnd
+)";
+const char* const kImporter = R"(OpCapability Shader
+OpCapability Linkage
+OpMemoryModel Logical GLSL450
+OpDecorate %f LinkageAttributes "f" Import
+%void = OpTypeVoid
+%fn = OpTypeFunction %void
+%f = OpFunction %void None %fn
+OpFunctionEnd
+)";
+
+// Runs |work| |kNumIterations| times on each of |kNumThreads| threads, all at
+// once.
+void RunConcurrently(const std::function<void()>& work) {
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&work]() {
+      for (uint32_t j = 0; j < kNumIterations; j++) {
+        work();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+spv_result_t CountInstruction(void* user_data,
+                              const spv_parsed_instruction_t*) {
+  ++*reinterpret_cast<uint32_t*>(user_data);
+  return SPV_SUCCESS;
+}
+
+TEST(Concurrency, CInterfaceWithSharedContext) {
+  Context context_wrapper(kEnv);
+  std::atomic<uint32_t> num_messages(0);
+  context_wrapper.SetMessageConsumer(
+      [&num_messages](spv_message_level_t, const char*, const spv_position_t&,
+                      const char*) { num_messages++; });
+  spv_const_context context = context_wrapper.CContext();
+  spv_validator_options options = spvValidatorOptionsCreate();
+
+  RunConcurrently([context, options]() {
+    spv_binary binary = nullptr;
+    ASSERT_EQ(SPV_SUCCESS, spvTextToBinary(context, kShader, strlen(kShader),
+                                           &binary, nullptr));
+    spv_const_binary_t const_binary{binary->code, binary->wordCount};
+    EXPECT_EQ(SPV_SUCCESS,
+              spvValidateWithOptions(context, options, &const_binary, nullptr));
+
+    uint32_t num_instructions = 0;
+    EXPECT_EQ(SPV_SUCCESS,
+              spvBinaryParse(context, &num_instructions, binary->code,
+                             binary->wordCount, nullptr, CountInstruction,
+                             nullptr));
+    EXPECT_EQ(35u, num_instructions);
+
+    spv_text text = nullptr;
+    EXPECT_EQ(SPV_SUCCESS,
+              spvBinaryToText(context, binary->code, binary->wordCount,
+                              SPV_BINARY_TO_TEXT_OPTION_NO_HEADER |
+                                  SPV_BINARY_TO_TEXT_OPTION_FRIENDLY_NAMES,
+                              &text, nullptr));
+    EXPECT_THAT(std::string(text->str, text->length),
+                ::testing::HasSubstr("OpLoopMerge"));
+    spvTextDestroy(text);
+
+    // An invalid binary, reported through the shared consumer.
+    const_binary.wordCount = 3;
+    EXPECT_NE(SPV_SUCCESS, spvValidate(context, &const_binary, nullptr));
+    spvBinaryDestroy(binary);
+  });
+  EXPECT_EQ(kNumThreads * kNumIterations, num_messages);
+
+  spvValidatorOptionsDestroy(options);
+}
+
+TEST(Concurrency, SharedSpirvTools) {
+  SpirvTools tools(kEnv);
+  std::vector<uint32_t> expected_binary;
+  ASSERT_TRUE(tools.Assemble(kShader, &expected_binary));
+  std::string expected_text;
+  ASSERT_TRUE(tools.Disassemble(expected_binary, &expected_text,
+                                SPV_BINARY_TO_TEXT_OPTION_NO_HEADER));
+
+  RunConcurrently([&tools, &expected_binary, &expected_text]() {
+    std::vector<uint32_t> binary;
+    EXPECT_TRUE(tools.Assemble(kShader, &binary));
+    EXPECT_THAT(binary, Eq(expected_binary));
+    EXPECT_TRUE(tools.Validate(binary));
+    std::string text;
+    EXPECT_TRUE(
+        tools.Disassemble(binary, &text, SPV_BINARY_TO_TEXT_OPTION_NO_HEADER));
+    EXPECT_THAT(text, Eq(expected_text));
+  });
+}
+
+TEST(Concurrency, SharedOptimizer) {
+  SpirvTools tools(kEnv);
+  std::vector<uint32_t> binary;
+  ASSERT_TRUE(tools.Assemble(kShader, &binary));
+
+  Optimizer optimizer(kEnv);
+  ASSERT_TRUE(optimizer.RegisterPassesFromFlags(
+      {"--loop-peeling", "--loop-unroll", "-O"}));
+  std::vector<uint32_t> expected_binary;
+  ASSERT_TRUE(optimizer.Run(binary.data(), binary.size(), &expected_binary));
+
+  RunConcurrently([&optimizer, &binary, &expected_binary]() {
+    std::vector<uint32_t> optimized_binary;
+    EXPECT_TRUE(
+        optimizer.Run(binary.data(), binary.size(), &optimized_binary));
+    EXPECT_THAT(optimized_binary, Eq(expected_binary));
+
+    // Setting the process-wide loop peeling threshold, to its default value,
+    // while other threads are peeling loops.
+    Optimizer other_optimizer(kEnv);
+    EXPECT_TRUE(
+        other_optimizer.RegisterPassFromFlag("--loop-peeling-threshold=1000"));
+  });
+}
+
+TEST(Concurrency, LinkWithSharedContext) {
+  SpirvTools tools(kEnv);
+  std::vector<std::vector<uint32_t>> binaries(2);
+  ASSERT_TRUE(tools.Assemble(kExporter, &binaries[0]));
+  ASSERT_TRUE(tools.Assemble(kImporter, &binaries[1]));
+
+  Context context(kEnv);
+  std::vector<uint32_t> expected_binary;
+  ASSERT_EQ(SPV_SUCCESS, Link(context, binaries, &expected_binary));
+
+  RunConcurrently([&context, &binaries, &expected_binary]() {
+    std::vector<uint32_t> linked_binary;
+    EXPECT_EQ(SPV_SUCCESS, Link(context, binaries, &linked_binary));
+    EXPECT_THAT(linked_binary, Eq(expected_binary));
+  });
+}
+
+TEST(Concurrency, InMemoryModulesWithSharedContext) {
+  SpirvTools tools(kEnv);
+  std::vector<uint32_t> binary;
+  ASSERT_TRUE(tools.Assemble(kShader, &binary));
+
+  spv_context context = spvContextCreate(kEnv);
+  spv_validator_options validator_options = spvValidatorOptionsCreate();
+  spv_optimizer_options optimizer_options = spvOptimizerOptionsCreate();
+  const char* flags[] = {"-O"};
+
+  RunConcurrently([context, validator_options, optimizer_options, &binary,
+                   &flags]() {
+    spv_ir_module module = nullptr;
+    ASSERT_EQ(SPV_SUCCESS,
+              spvIRModuleCreate(context, binary.data(), binary.size(),
+                                validator_options, &module, nullptr));
+    EXPECT_EQ(SPV_SUCCESS, spvIRModuleOptimize(context, module, flags, 1,
+                                               optimizer_options, nullptr));
+    EXPECT_EQ(SPV_SUCCESS, spvIRModuleValidate(context, module,
+                                               validator_options, nullptr));
+    spvIRModuleDestroy(module);
+  });
+
+  spvOptimizerOptionsDestroy(optimizer_options);
+  spvValidatorOptionsDestroy(validator_options);
+  spvContextDestroy(context);
+}
+
+}  // namespace
+}  // namespace spvtools
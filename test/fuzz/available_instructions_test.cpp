@@ -323,6 +323,107 @@ TEST(AvailableInstructionsTest, UnreachableBlock) {
 #endif
 }
 
+TEST(AvailableInstructionsTest, KeyedQueriesAndAddedInstructions) {
+  std::string shader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 320
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpTypeFloat 32
+          %8 = OpConstant %6 1
+          %9 = OpConstant %7 1
+         %10 = OpTypeBool
+         %11 = OpConstantTrue %10
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %12 = OpIAdd %6 %8 %8
+               OpSelectionMerge %14 None
+               OpBranchConditional %11 %13 %14
+         %13 = OpLabel
+         %15 = OpFAdd %7 %9 %9
+         %16 = OpIAdd %6 %12 %8
+               OpBranch %14
+         %14 = OpLabel
+         %17 = OpIAdd %6 %12 %12
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, shader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  AvailableInstructions values_by_type(
+      context.get(),
+      [](opt::IRContext*, opt::Instruction* inst) -> bool {
+        return inst->result_id() && inst->type_id();
+      },
+      [](opt::IRContext*, opt::Instruction* inst) -> uint32_t {
+        return inst->type_id();
+      });
+
+  auto* i15 = context->get_def_use_mgr()->GetDef(15);
+  auto* i16 = context->get_def_use_mgr()->GetDef(16);
+  auto* i17 = context->get_def_use_mgr()->GetDef(17);
+
+  ASSERT_EQ(4, values_by_type.GetAvailableBeforeInstruction(i15).size());
+  {
+    auto available = values_by_type.GetAvailableBeforeInstruction(i16, 6);
+    ASSERT_EQ(2, available.size());
+    ASSERT_EQ(8, available[0]->result_id());
+    ASSERT_EQ(12, available[1]->result_id());
+  }
+  {
+    auto available = values_by_type.GetAvailableBeforeInstruction(i16, 7);
+    ASSERT_EQ(2, available.size());
+    ASSERT_EQ(9, available[0]->result_id());
+    ASSERT_EQ(15, available[1]->result_id());
+  }
+  ASSERT_EQ(1, values_by_type.GetAvailableBeforeInstruction(i16, 10).size());
+  ASSERT_TRUE(values_by_type.GetAvailableBeforeInstruction(i16, 100).empty());
+  // %16 does not dominate %17.
+  ASSERT_EQ(2, values_by_type.GetAvailableBeforeInstruction(i17, 6).size());
+
+  // Add an instruction before %17, and a global constant.
+  auto new_inst = MakeUnique<opt::Instruction>(
+      context.get(), SpvOpIAdd, 6, 100,
+      opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {8}},
+                                    {SPV_OPERAND_TYPE_ID, {8}}});
+  auto* i100 = new_inst.get();
+  i17->InsertBefore(std::move(new_inst));
+  auto new_global = MakeUnique<opt::Instruction>(
+      context.get(), SpvOpConstant, 6, 101,
+      opt::Instruction::OperandList{{SPV_OPERAND_TYPE_LITERAL_INTEGER, {2}}});
+  auto* i101 = new_global.get();
+  context->module()->AddGlobalValue(std::move(new_global));
+  fuzzerutil::UpdateModuleIdBound(context.get(), 101);
+  context->InvalidateAnalysesExceptFor(opt::IRContext::kAnalysisNone);
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  values_by_type.AddInstruction(i100);
+  values_by_type.AddInstruction(i101);
+  {
+    auto available = values_by_type.GetAvailableBeforeInstruction(i17, 6);
+    ASSERT_EQ(4, available.size());
+    ASSERT_EQ(8, available[0]->result_id());
+    ASSERT_EQ(101, available[1]->result_id());
+    ASSERT_EQ(12, available[2]->result_id());
+    ASSERT_EQ(100, available[3]->result_id());
+  }
+  ASSERT_EQ(3, values_by_type.GetAvailableBeforeInstruction(i100, 6).size());
+  ASSERT_EQ(3, values_by_type.GetAvailableBeforeInstruction(i16, 6).size());
+  ASSERT_EQ(6, values_by_type.GetAvailableBeforeInstruction(i17).size());
+}
+
 }  // namespace
 }  // namespace fuzz
 }  // namespace spvtools
@@ -0,0 +1,137 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/coverage_guided_corpus.h"
+
+#include "gtest/gtest.h"
+#include "source/fuzz/fuzzer.h"
+#include "source/fuzz/fuzzer_pass_profiler.h"
+#include "source/fuzz/fuzzer_util.h"
+#include "source/fuzz/pseudo_random_generator.h"
+#include "test/fuzz/fuzz_test_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+TEST(CoverageGuidedCorpusTest, RecordCoverageCountsNewBuckets) {
+  CoverageGuidedCorpus corpus;
+  ASSERT_EQ(0, corpus.GetNumEdgesCovered());
+
+  // Edges 0 and 2 are new.
+  ASSERT_EQ(2, corpus.RecordCoverage({1, 0, 5}));
+  ASSERT_EQ(2, corpus.GetNumEdgesCovered());
+
+  // Nothing is new: 6 hits fall in the same bucket as 5.
+  ASSERT_EQ(0, corpus.RecordCoverage({1, 0, 6}));
+  ASSERT_EQ(0, corpus.RecordCoverage({}));
+
+  // Edge 0 reaches a new bucket, and edges 1 and 3 are new.
+  ASSERT_EQ(3, corpus.RecordCoverage({2, 1, 7, 200}));
+  ASSERT_EQ(4, corpus.GetNumEdgesCovered());
+
+  // A bucket that was reached before, and a smaller hit count that was not.
+  ASSERT_EQ(1, corpus.RecordCoverage({1, 1, 3, 255}));
+  ASSERT_EQ(0, corpus.RecordCoverage({1, 1, 3, 128}));
+  ASSERT_EQ(4, corpus.GetNumEdgesCovered());
+}
+
+TEST(CoverageGuidedCorpusTest, ChooseEntryPrefersNewCoverage) {
+  CoverageGuidedCorpus corpus;
+  ASSERT_EQ(0, corpus.AddEntry({1}, {}, {}, 0));
+  ASSERT_EQ(1, corpus.AddEntry({2}, {}, {"PermuteBlocks"}, 100));
+  ASSERT_EQ(2, corpus.size());
+  ASSERT_EQ(std::vector<uint32_t>({2}), corpus.GetEntry(1).binary);
+  ASSERT_EQ(std::vector<std::string>({"PermuteBlocks"}),
+            corpus.GetEntry(1).pass_sequence);
+
+  PseudoRandomGenerator random_generator(0);
+  uint32_t num_choices = 100;
+  for (uint32_t i = 0; i < num_choices; i++) {
+    corpus.ChooseEntry(&random_generator);
+  }
+  ASSERT_EQ(num_choices,
+            corpus.GetEntry(0).times_chosen + corpus.GetEntry(1).times_chosen);
+  ASSERT_GT(corpus.GetEntry(1).times_chosen, corpus.GetEntry(0).times_chosen);
+
+  // Every entry keeps a chance of being chosen.
+  ASSERT_GT(corpus.GetEntry(0).times_chosen, 0);
+}
+
+TEST(CoverageGuidedCorpusTest, FuzzerFollowsPreferredPassSequence) {
+  const std::string shader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpTypePointer Function %6
+          %9 = OpConstant %6 0
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+          %8 = OpVariable %7 Function
+               OpStore %8 %9
+               OpBranch %10
+         %10 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  auto context = BuildModule(env, consumer, shader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  auto fuzzer_context = MakeUnique<FuzzerContext>(
+      MakeUnique<PseudoRandomGenerator>(0),
+      FuzzerContext::GetMinFreshId(context.get()), false);
+  auto transformation_context = MakeUnique<TransformationContext>(
+      MakeUnique<FactManager>(context.get()), validator_options);
+  Fuzzer fuzzer(std::move(context), std::move(transformation_context),
+                std::move(fuzzer_context), kConsoleMessageConsumer,
+                std::vector<fuzzerutil::ModuleSupplier>(), true,
+                RepeatedPassStrategy::kSimple, true, validator_options);
+  fuzzer.SetPreferredPassSequence(
+      std::vector<std::string>(20, "PermuteBlocks"));
+  FuzzerPassProfiler profiler;
+  fuzzer.SetPassProfiler(&profiler);
+  auto result = fuzzer.Run(0);
+  ASSERT_NE(Fuzzer::Status::kFuzzerPassLedToInvalidModule, result.status);
+
+  // Among the repeated passes that the sequence covers, most should be the
+  // preferred one.
+  uint32_t num_repeated_passes = 0;
+  uint32_t num_preferred_passes = 0;
+  for (const auto& invocation : profiler.GetPassInvocations()) {
+    if (invocation.is_final_pass || num_repeated_passes == 20) {
+      continue;
+    }
+    num_repeated_passes++;
+    if (invocation.pass_name == "PermuteBlocks") {
+      num_preferred_passes++;
+    }
+  }
+  ASSERT_LT(0, num_repeated_passes);
+  ASSERT_LE(num_repeated_passes, 2 * num_preferred_passes);
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
@@ -0,0 +1,200 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/donor_module_cache.h"
+
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test/fuzz/fuzz_test_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+// Function %4 calls %6, which calls %8.
+const std::string kDonor = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %10 = OpFunctionCall %2 %6
+               OpReturn
+               OpFunctionEnd
+          %6 = OpFunction %2 None %3
+          %7 = OpLabel
+         %11 = OpFunctionCall %2 %8
+               OpReturn
+               OpFunctionEnd
+          %8 = OpFunction %2 None %3
+          %9 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+// Uses the undeclared id %100.
+const std::string kInvalidDonor = R"(
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %10 = OpCopyObject %2 %100
+               OpReturn
+               OpFunctionEnd
+  )";
+
+TEST(DonorModuleCacheTest, SuppliesEachDonorOnce) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  uint32_t num_supplied = 0;
+  std::vector<fuzzerutil::ModuleSupplier> donor_suppliers = {
+      [env, &num_supplied]() {
+        num_supplied++;
+        return BuildModule(env, nullptr, kDonor, kFuzzAssembleOption);
+      }};
+  spvtools::ValidatorOptions validator_options;
+  DonorModuleCache cache(donor_suppliers, validator_options);
+  ASSERT_EQ(1u, cache.size());
+  ASSERT_EQ(0, num_supplied);
+
+  const auto* donor = cache.GetDonor(0);
+  ASSERT_NE(nullptr, donor);
+  ASSERT_EQ(donor, cache.GetDonor(0));
+  ASSERT_EQ(1, num_supplied);
+
+  ASSERT_EQ(std::vector<SpvCapability>({SpvCapabilityShader}),
+            donor->GetSummary().capabilities);
+  ASSERT_EQ(std::vector<uint32_t>({4, 6, 8}),
+            donor->GetSummary().functions_in_topological_order);
+
+  // Each clone is a separate copy of the donor.
+  auto clone1 = donor->Clone();
+  auto clone2 = donor->Clone();
+  ASSERT_NE(clone1.get(), clone2.get());
+  std::vector<uint32_t> binary1;
+  std::vector<uint32_t> binary2;
+  clone1->module()->ToBinary(&binary1, false);
+  clone2->module()->ToBinary(&binary2, false);
+  ASSERT_EQ(binary1, binary2);
+  clone1->KillInst(clone1->get_def_use_mgr()->GetDef(11));
+  binary1.clear();
+  clone1->module()->ToBinary(&binary1, false);
+  ASSERT_NE(binary1, binary2);
+  ASSERT_TRUE(fuzzerutil::IsValid(donor->Clone().get(), validator_options,
+                                  kConsoleMessageConsumer));
+  ASSERT_EQ(1, num_supplied);
+}
+
+TEST(DonorModuleCacheTest, SummarizesDependencies) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  auto context = BuildModule(env, nullptr, kDonor, kFuzzAssembleOption);
+  auto summary = DonorModuleSummary::Summarize(context.get());
+  ASSERT_EQ(3u, summary.function_positions.size());
+  ASSERT_EQ(0u, summary.function_positions.at(4));
+  ASSERT_EQ(1u, summary.function_positions.at(6));
+  ASSERT_EQ(2u, summary.function_positions.at(8));
+  ASSERT_EQ(std::unordered_set<uint32_t>({5, 7, 9, 10, 11}),
+            summary.ids_defined_in_blocks);
+  ASSERT_TRUE(summary.undonatable_type_and_value_ids.empty());
+
+  // The image type, and everything that depends on it, cannot be donated.
+  const std::string image_donor = R"(
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeFloat 32
+          %7 = OpTypeImage %6 2D 0 0 0 1 Unknown
+          %8 = OpTypePointer UniformConstant %7
+          %9 = OpVariable %8 UniformConstant
+         %10 = OpTypePointer Function %6
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %11 = OpLoad %7 %9
+               OpReturn
+               OpFunctionEnd
+  )";
+  context = BuildModule(env, nullptr, image_donor, kFuzzAssembleOption);
+  summary = DonorModuleSummary::Summarize(context.get());
+  ASSERT_EQ(std::unordered_set<uint32_t>({7, 8, 9}),
+            summary.undonatable_type_and_value_ids);
+  ASSERT_EQ(std::unordered_set<uint32_t>({5, 11}),
+            summary.ids_defined_in_blocks);
+}
+
+TEST(DonorModuleCacheTest, DoesNotSupplyFailedOrInvalidDonors) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  std::vector<fuzzerutil::ModuleSupplier> donor_suppliers = {
+      []() { return std::unique_ptr<opt::IRContext>(); },
+      [env]() {
+        return BuildModule(env, nullptr, kInvalidDonor, kFuzzAssembleOption);
+      },
+      [env]() {
+        return BuildModule(env, nullptr, kDonor, kFuzzAssembleOption);
+      }};
+  spvtools::ValidatorOptions validator_options;
+  DonorModuleCache cache(donor_suppliers, validator_options);
+  ASSERT_EQ(3u, cache.size());
+  ASSERT_EQ(nullptr, cache.GetDonor(0));
+  ASSERT_EQ(nullptr, cache.GetDonor(1));
+  ASSERT_NE(nullptr, cache.GetDonor(2));
+}
+
+TEST(DonorModuleCacheTest, ConcurrentRequests) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  std::atomic<uint32_t> num_supplied(0);
+  std::vector<fuzzerutil::ModuleSupplier> donor_suppliers = {
+      [env, &num_supplied]() {
+        num_supplied++;
+        return BuildModule(env, nullptr, kDonor, kFuzzAssembleOption);
+      }};
+  spvtools::ValidatorOptions validator_options;
+  DonorModuleCache cache(donor_suppliers, validator_options);
+
+  std::vector<std::thread> threads;
+  std::vector<std::vector<uint32_t>> binaries(4);
+  for (uint32_t i = 0; i < binaries.size(); i++) {
+    threads.emplace_back([&cache, &binaries, i]() {
+      for (uint32_t j = 0; j < 10; j++) {
+        binaries[i].clear();
+        cache.GetDonor(0)->Clone()->module()->ToBinary(&binaries[i], false);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(1, num_supplied);
+  for (const auto& binary : binaries) {
+    ASSERT_EQ(binaries[0], binary);
+  }
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
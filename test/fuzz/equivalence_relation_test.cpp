@@ -150,6 +150,67 @@ TEST(EquivalenceRelationTest, DeterministicEquivalenceClassOrder) {
   }
 }
 
+TEST(EquivalenceRelationTest, SmallerClassJoinsLargerClass) {
+  EquivalenceRelation<uint32_t, UInt32Hash, UInt32Equals> relation;
+  for (uint32_t i = 0; i < 10; ++i) {
+    relation.Register(i);
+  }
+  for (uint32_t i = 1; i < 5; ++i) {
+    relation.MakeEquivalent(i, 0);
+  }
+  ASSERT_EQ(5, relation.GetEquivalenceClassSize(3));
+  ASSERT_EQ(1, relation.GetEquivalenceClassSize(9));
+
+  // The class of 0 is larger, so its representative is kept even though 9 is
+  // given second.
+  const uint32_t* representative =
+      relation.Find(relation.GetCanonicalPointer(0));
+  relation.MakeEquivalent(0, 9);
+  ASSERT_EQ(representative, relation.Find(relation.GetCanonicalPointer(9)));
+  ASSERT_EQ(6, relation.GetEquivalenceClassSize(9));
+
+  // Merging two classes adds their sizes.
+  relation.MakeEquivalent(5, 6);
+  relation.MakeEquivalent(7, 8);
+  relation.MakeEquivalent(6, 8);
+  ASSERT_EQ(4, relation.GetEquivalenceClassSize(5));
+  relation.MakeEquivalent(5, 0);
+  ASSERT_EQ(10, relation.GetEquivalenceClassSize(7));
+  ASSERT_EQ(representative, relation.Find(relation.GetCanonicalPointer(7)));
+  ASSERT_EQ(1, relation.GetEquivalenceClassRepresentatives().size());
+  ASSERT_EQ(10, relation.GetEquivalenceClass(4).size());
+}
+
+TEST(EquivalenceRelationTest, CopyIsIdenticalAndIndependent) {
+  EquivalenceRelation<uint32_t, UInt32Hash, UInt32Equals> original;
+  for (uint32_t i = 0; i < 100; ++i) {
+    original.Register(i);
+  }
+  for (uint32_t i = 3; i < 100; ++i) {
+    original.MakeEquivalent(i, i - 3);
+  }
+
+  EquivalenceRelation<uint32_t, UInt32Hash, UInt32Equals> copy(original);
+
+  // The copy should have identical representatives, and identically-ordered
+  // equivalence classes per representative.
+  ASSERT_THAT(ToUIntVector(copy.GetEquivalenceClassRepresentatives()),
+              ToUIntVector(original.GetEquivalenceClassRepresentatives()));
+  for (auto representative : original.GetEquivalenceClassRepresentatives()) {
+    ASSERT_THAT(ToUIntVector(copy.GetEquivalenceClass(*representative)),
+                ToUIntVector(original.GetEquivalenceClass(*representative)));
+  }
+
+  // The copy should not share state with the original.
+  copy.MakeEquivalent(0, 1);
+  copy.Register(100);
+  ASSERT_TRUE(copy.IsEquivalent(0, 1));
+  ASSERT_FALSE(original.IsEquivalent(0, 1));
+  ASSERT_TRUE(copy.Exists(100));
+  ASSERT_FALSE(original.Exists(100));
+  ASSERT_EQ(3, original.GetEquivalenceClassRepresentatives().size());
+}
+
 }  // namespace
 }  // namespace fuzz
 }  // namespace spvtools
@@ -86,6 +86,61 @@ TEST(DataSynonymAndIdEquationFactsTest, RecursiveAdditionOfFacts) {
                                         MakeDataDescriptor(11, {2, 3})));
 }
 
+TEST(DataSynonymAndIdEquationFactsTest, ClosureRespectsPairBudget) {
+  std::string shader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %12 "main"
+               OpExecutionMode %12 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeFloat 32
+          %7 = OpTypeVector %6 4
+          %9 = OpConstant %6 0
+         %14 = OpConstant %6 1
+         %10 = OpConstantComposite %7 %9 %9 %9 %9
+         %20 = OpConstantComposite %7 %14 %14 %14 %14
+         %12 = OpFunction %2 None %3
+         %13 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, shader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  FactManager unbounded_fact_manager(context.get());
+  FactManager bounded_fact_manager(context.get());
+  for (uint32_t i = 0; i < 4; i++) {
+    for (auto* fact_manager :
+         {&unbounded_fact_manager, &bounded_fact_manager}) {
+      fact_manager->AddFactDataSynonym(MakeDataDescriptor(10, {i}),
+                                       MakeDataDescriptor(20, {i}));
+    }
+  }
+
+  unbounded_fact_manager.ComputeClosureOfFacts(100);
+  ASSERT_TRUE(unbounded_fact_manager.IsSynonymous(MakeDataDescriptor(10, {}),
+                                                  MakeDataDescriptor(20, {})));
+
+  // Each of the four classes holds a single pair, so with a budget of one pair
+  // it takes four computations to deduce the synonym.
+  for (uint32_t i = 0; i < 3; i++) {
+    bounded_fact_manager.ComputeClosureOfFacts(100, 1);
+    ASSERT_FALSE(bounded_fact_manager.IsSynonymous(MakeDataDescriptor(10, {}),
+                                                   MakeDataDescriptor(20, {})));
+  }
+  bounded_fact_manager.ComputeClosureOfFacts(100, 1);
+  ASSERT_TRUE(bounded_fact_manager.IsSynonymous(MakeDataDescriptor(10, {}),
+                                                MakeDataDescriptor(20, {})));
+}
+
 TEST(DataSynonymAndIdEquationFactsTest, CorollaryConversionFacts) {
   std::string shader = R"(
                OpCapability Shader
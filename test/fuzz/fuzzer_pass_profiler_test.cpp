@@ -0,0 +1,201 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/fuzzer_pass_profiler.h"
+
+#include "gtest/gtest.h"
+#include "source/fuzz/fuzzer.h"
+#include "source/fuzz/fuzzer_util.h"
+#include "source/fuzz/pseudo_random_generator.h"
+#include "test/fuzz/fuzz_test_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+const std::string kShader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpTypePointer Function %6
+          %9 = OpConstant %6 0
+         %16 = OpConstant %6 10
+         %17 = OpTypeBool
+         %20 = OpConstant %6 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+          %8 = OpVariable %7 Function
+               OpStore %8 %9
+               OpBranch %10
+         %10 = OpLabel
+               OpLoopMerge %12 %13 None
+               OpBranch %14
+         %14 = OpLabel
+         %15 = OpLoad %6 %8
+         %18 = OpSLessThan %17 %15 %16
+               OpBranchConditional %18 %11 %12
+         %11 = OpLabel
+               OpBranch %13
+         %13 = OpLabel
+         %19 = OpLoad %6 %8
+         %21 = OpIAdd %6 %19 %20
+               OpStore %8 %21
+               OpBranch %10
+         %12 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+TEST(FuzzerPassProfilerTest, RecordsEachPassInvocation) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+  const uint32_t initial_id_bound = context->module()->id_bound();
+
+  auto fuzzer_context = MakeUnique<FuzzerContext>(
+      MakeUnique<PseudoRandomGenerator>(0),
+      FuzzerContext::GetMinFreshId(context.get()), false);
+  auto transformation_context = MakeUnique<TransformationContext>(
+      MakeUnique<FactManager>(context.get()), validator_options);
+  Fuzzer fuzzer(std::move(context), std::move(transformation_context),
+                std::move(fuzzer_context), kConsoleMessageConsumer,
+                std::vector<fuzzerutil::ModuleSupplier>(), true,
+                RepeatedPassStrategy::kSimple, true, validator_options);
+
+  FuzzerPassProfiler profiler;
+  fuzzer.SetPassProfiler(&profiler);
+  auto result = fuzzer.Run(0);
+  ASSERT_NE(Fuzzer::Status::kFuzzerPassLedToInvalidModule, result.status);
+
+  ASSERT_EQ(1, profiler.GetNumRuns());
+  const auto& invocations = profiler.GetPassInvocations();
+  ASSERT_FALSE(invocations.empty());
+
+  // Passes are recorded in the order in which they are applied, so that the
+  // module seen by each pass is the one left by its predecessor.  Repeated
+  // passes all precede the final passes.
+  uint32_t num_repeated_passes = 0;
+  uint32_t num_transformations = 0;
+  uint32_t id_bound = initial_id_bound;
+  bool seen_final_pass = false;
+  for (const auto& invocation : invocations) {
+    ASSERT_FALSE(invocation.pass_name.empty());
+    ASSERT_EQ(id_bound, invocation.id_bound_before);
+    ASSERT_LE(invocation.id_bound_before, invocation.id_bound_after);
+    ASSERT_LE(0.0, invocation.seconds);
+    id_bound = invocation.id_bound_after;
+    num_transformations += invocation.transformations_applied;
+    if (invocation.is_final_pass) {
+      seen_final_pass = true;
+    } else {
+      ASSERT_FALSE(seen_final_pass);
+      num_repeated_passes++;
+    }
+  }
+  ASSERT_EQ(fuzzer.GetIRContext()->module()->id_bound(), id_bound);
+  ASSERT_EQ(static_cast<uint32_t>(
+                fuzzer.GetTransformationSequence().transformation_size()),
+            num_transformations);
+  ASSERT_EQ(num_repeated_passes, profiler.GetNumPassSelections());
+  ASSERT_EQ(fuzzerutil::GetNumberOfInstructions(fuzzer.GetIRContext()),
+            invocations.back().instruction_count_after);
+
+  // A further run is added to the existing records.
+  const size_t num_invocations = invocations.size();
+  fuzzer.Run(0);
+  ASSERT_EQ(2, profiler.GetNumRuns());
+  ASSERT_LT(num_invocations, profiler.GetPassInvocations().size());
+
+  profiler.Clear();
+  ASSERT_EQ(0, profiler.GetNumRuns());
+  ASSERT_TRUE(profiler.GetPassInvocations().empty());
+}
+
+TEST(FuzzerPassProfilerTest, JsonReport) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  ASSERT_EQ(36, fuzzerutil::GetNumberOfInstructions(context.get()));
+
+  FuzzerPassProfiler profiler;
+  ASSERT_EQ(
+      "{\n"
+      "  \"runs\": 0,\n"
+      "  \"run_seconds\": 0.000000,\n"
+      "  \"transformations_applied\": 0,\n"
+      "  \"transformations_per_second\": 0.000000,\n"
+      "  \"pass_selections\": 0,\n"
+      "  \"pass_selection_seconds\": 0.000000,\n"
+      "  \"passes\": [],\n"
+      "  \"invocations\": []\n"
+      "}\n",
+      profiler.ToJson(true));
+
+  // Simulate a pass that applies two transformations, each adding an id, and
+  // another that applies none.
+  protobufs::TransformationSequence transformations;
+  profiler.BeginPass(context.get(), transformations);
+  transformations.add_transformation();
+  transformations.add_transformation();
+  context->module()->SetIdBound(context->module()->id_bound() + 2);
+  profiler.EndPass("Foo", false, context.get(), transformations);
+  profiler.BeginPass(context.get(), transformations);
+  profiler.EndPass("Bar", true, context.get(), transformations);
+  profiler.BeginPass(context.get(), transformations);
+  transformations.add_transformation();
+  profiler.EndPass("Foo", false, context.get(), transformations);
+  profiler.RecordPassSelection(0.5);
+  profiler.RecordPassSelection(0.25);
+  profiler.RecordRun(2);
+
+  ASSERT_EQ(3, profiler.GetPassInvocations().size());
+  ASSERT_EQ(2, profiler.GetPassInvocations()[0].transformations_applied);
+  ASSERT_EQ(22, profiler.GetPassInvocations()[0].id_bound_before);
+  ASSERT_EQ(24, profiler.GetPassInvocations()[0].id_bound_after);
+  ASSERT_EQ(0, profiler.GetPassInvocations()[1].transformations_applied);
+  ASSERT_EQ(1, profiler.GetPassInvocations()[2].transformations_applied);
+  ASSERT_EQ(2, profiler.GetNumPassSelections());
+  ASSERT_EQ(0.75, profiler.GetPassSelectionSeconds());
+
+  const auto report = profiler.ToJson(false);
+  ASSERT_NE(std::string::npos, report.find("\"runs\": 1,\n"));
+  ASSERT_NE(std::string::npos, report.find("\"run_seconds\": 2.000000,\n"));
+  ASSERT_NE(std::string::npos,
+            report.find("\"transformations_applied\": 3,\n"));
+  ASSERT_NE(std::string::npos,
+            report.find("\"transformations_per_second\": 1.500000,\n"));
+  ASSERT_NE(std::string::npos, report.find("\"pass_selections\": 2,\n"));
+  ASSERT_NE(std::string::npos, report.find("{\"name\": \"Foo\", \"final\": "
+                                           "false, \"invocations\": 2"));
+  ASSERT_NE(std::string::npos, report.find("\"id_bound_growth\": 2, "
+                                           "\"instruction_count_growth\": 0}"));
+  ASSERT_NE(std::string::npos, report.find("{\"name\": \"Bar\", \"final\": "
+                                           "true, \"invocations\": 1"));
+  ASSERT_EQ(std::string::npos, report.find("\"invocations\": ["));
+  ASSERT_NE(std::string::npos,
+            profiler.ToJson(true).find("\"invocations\": [\n"));
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
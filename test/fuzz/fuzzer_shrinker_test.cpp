@@ -983,6 +983,9 @@ class InterestingThenRandom : public InterestingnessTest {
 //
 // The |validator_options| parameter provides validator options that should be
 // used during shrinking.
+//
+// The |num_threads| parameter controls how many chunk removals the shrinker
+// tries concurrently.
 void RunAndCheckShrinker(
     const spv_target_env& target_env, const std::vector<uint32_t>& binary_in,
     const protobufs::FactSequence& initial_facts,
@@ -990,12 +993,12 @@ void RunAndCheckShrinker(
     const Shrinker::InterestingnessFunction& interestingness_function,
     const std::vector<uint32_t>& expected_binary_out,
     uint32_t expected_transformations_out_size, uint32_t step_limit,
-    spv_validator_options validator_options) {
+    spv_validator_options validator_options, uint32_t num_threads) {
   // Run the shrinker.
   auto shrinker_result =
       Shrinker(target_env, kConsoleMessageConsumer, binary_in, initial_facts,
                transformation_sequence_in, interestingness_function, step_limit,
-               false, validator_options)
+               false, validator_options, num_threads)
           .Run();
 
   ASSERT_TRUE(Shrinker::ShrinkerResultStatus::kComplete ==
@@ -1084,7 +1087,7 @@ void RunFuzzerAndShrinker(const std::string& shader,
   RunAndCheckShrinker(env, binary_in, initial_facts,
                       fuzzer.GetTransformationSequence(),
                       AlwaysInteresting().AsFunction(), binary_in, 0,
-                      kReasonableStepLimit, validator_options);
+                      kReasonableStepLimit, validator_options, 1);
 
   // With the OnlyInterestingFirstTime test, no shrinking should be achieved.
   RunAndCheckShrinker(
@@ -1092,14 +1095,14 @@ void RunFuzzerAndShrinker(const std::string& shader,
       OnlyInterestingFirstTime().AsFunction(), transformed_binary,
       static_cast<uint32_t>(
           fuzzer.GetTransformationSequence().transformation_size()),
-      kReasonableStepLimit, validator_options);
+      kReasonableStepLimit, validator_options, 1);
 
   // The PingPong test is unpredictable; passing an empty expected binary
   // means that we don't check anything beyond that shrinking completes
   // successfully.
   RunAndCheckShrinker(
       env, binary_in, initial_facts, fuzzer.GetTransformationSequence(),
-      PingPong().AsFunction(), {}, 0, kSmallStepLimit, validator_options);
+      PingPong().AsFunction(), {}, 0, kSmallStepLimit, validator_options, 1);
 
   // The InterestingThenRandom test is unpredictable; passing an empty
   // expected binary means that we do not check anything about shrinking
@@ -1107,7 +1110,21 @@ void RunFuzzerAndShrinker(const std::string& shader,
   RunAndCheckShrinker(
       env, binary_in, initial_facts, fuzzer.GetTransformationSequence(),
       InterestingThenRandom(PseudoRandomGenerator(seed)).AsFunction(), {}, 0,
-      kSmallStepLimit, validator_options);
+      kSmallStepLimit, validator_options, 1);
+
+  // Shrinking with several threads should give the same results as serial
+  // shrinking for the predictable interestingness tests.
+  const uint32_t kNumThreads = 4;
+  RunAndCheckShrinker(env, binary_in, initial_facts,
+                      fuzzer.GetTransformationSequence(),
+                      AlwaysInteresting().AsFunction(), binary_in, 0,
+                      kReasonableStepLimit, validator_options, kNumThreads);
+  RunAndCheckShrinker(
+      env, binary_in, initial_facts, fuzzer.GetTransformationSequence(),
+      OnlyInterestingFirstTime().AsFunction(), transformed_binary,
+      static_cast<uint32_t>(
+          fuzzer.GetTransformationSequence().transformation_size()),
+      kReasonableStepLimit, validator_options, kNumThreads);
 }
 
 TEST(FuzzerShrinkerTest, Miscellaneous1) {
@@ -0,0 +1,246 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/incremental_validator.h"
+
+#include "gtest/gtest.h"
+#include "source/fuzz/fuzzer_util.h"
+#include "source/fuzz/instruction_descriptor.h"
+#include "source/fuzz/transformation_add_constant_scalar.h"
+#include "source/fuzz/transformation_add_synonym.h"
+#include "source/opt/eliminate_dead_functions_util.h"
+#include "test/fuzz/fuzz_test_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+// Function %6 is called from the entry point %4, while function %20 is not
+// called at all.
+const std::string kShader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 320
+               OpName %4 "main"
+               OpName %10 "x"
+               OpName %22 "y"
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %8 = OpTypeInt 32 1
+          %9 = OpTypePointer Function %8
+         %11 = OpConstant %8 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %12 = OpFunctionCall %2 %6
+               OpReturn
+               OpFunctionEnd
+          %6 = OpFunction %2 None %3
+          %7 = OpLabel
+         %10 = OpVariable %9 Function
+               OpStore %10 %11
+               OpReturn
+               OpFunctionEnd
+         %20 = OpFunction %2 None %3
+         %21 = OpLabel
+         %22 = OpVariable %9 Function
+               OpStore %22 %11
+               OpReturn
+               OpFunctionEnd
+  )";
+
+// Inserts |new_instruction| before the store to |variable_id|, of which there
+// must be exactly one.
+void InsertBeforeStoreTo(opt::IRContext* ir_context, uint32_t variable_id,
+                         std::unique_ptr<opt::Instruction> new_instruction) {
+  fuzzerutil::UpdateModuleIdBound(ir_context, new_instruction->result_id());
+  opt::Instruction* store = nullptr;
+  ir_context->get_def_use_mgr()->ForEachUser(
+      variable_id, [&store](opt::Instruction* user) {
+        if (user->opcode() == SpvOpStore) {
+          store = user;
+        }
+      });
+  ASSERT_NE(nullptr, store);
+  store->InsertBefore(std::move(new_instruction));
+  ir_context->InvalidateAnalysesExceptFor(opt::IRContext::kAnalysisNone);
+}
+
+TEST(IncrementalValidatorTest, AcceptsValidChanges) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+  TransformationContext transformation_context(
+      MakeUnique<FactManager>(context.get()), validator_options);
+
+  IncrementalValidator validator(validator_options, kConsoleMessageConsumer);
+  ASSERT_FALSE(validator.HasLastValidModule());
+  ASSERT_TRUE(validator.IsValid(context.get()));
+  ASSERT_TRUE(validator.HasLastValidModule());
+
+  // A new global constant.
+  ApplyAndCheckFreshIds(TransformationAddConstantScalar(100, 8, {2}, false),
+                        context.get(), &transformation_context);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // A change to a function that is called from the entry point.
+  ApplyAndCheckFreshIds(
+      TransformationAddSynonym(
+          11,
+          protobufs::TransformationAddSynonym::SynonymType::
+              TransformationAddSynonym_SynonymType_COPY_OBJECT,
+          101, MakeInstructionDescriptor(10, SpvOpStore, 0)),
+      context.get(), &transformation_context);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // A change to a function that is not called.
+  ApplyAndCheckFreshIds(
+      TransformationAddSynonym(
+          100,
+          protobufs::TransformationAddSynonym::SynonymType::
+              TransformationAddSynonym_SynonymType_COPY_OBJECT,
+          102, MakeInstructionDescriptor(22, SpvOpStore, 0)),
+      context.get(), &transformation_context);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // The last valid binary is that of the current module.
+  std::vector<uint32_t> binary;
+  context->module()->ToBinary(&binary, false);
+  ASSERT_EQ(binary, validator.GetLastValidBinary());
+}
+
+TEST(IncrementalValidatorTest, RevalidatesOnlyAffectedFunctions) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  IncrementalValidator validator(validator_options, nullptr);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+  ASSERT_EQ(3u, validator.GetNumFunctionsValidatedByLastCheck());
+
+  // Nothing has changed, so no function needs to be validated.
+  ASSERT_TRUE(validator.IsValid(context.get()));
+  ASSERT_EQ(0u, validator.GetNumFunctionsValidatedByLastCheck());
+
+  // Function %20 is not called, so only it needs to be validated.
+  InsertBeforeStoreTo(
+      context.get(), 22,
+      MakeUnique<opt::Instruction>(
+          context.get(), SpvOpCopyObject, 8, 100,
+          opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {11}}}));
+  ASSERT_TRUE(validator.IsValid(context.get()));
+  ASSERT_EQ(1u, validator.GetNumFunctionsValidatedByLastCheck());
+
+  // Function %6 is called by the entry point %4, so both are validated.
+  InsertBeforeStoreTo(
+      context.get(), 10,
+      MakeUnique<opt::Instruction>(
+          context.get(), SpvOpCopyObject, 8, 101,
+          opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {11}}}));
+  ASSERT_TRUE(validator.IsValid(context.get()));
+  ASSERT_EQ(2u, validator.GetNumFunctionsValidatedByLastCheck());
+
+  // A change to function %20 that uses an id local to function %6 fails
+  // incremental validation, and then the whole module is validated, so that
+  // errors are reported about the module itself.
+  InsertBeforeStoreTo(
+      context.get(), 22,
+      MakeUnique<opt::Instruction>(
+          context.get(), SpvOpCopyObject, 9, 102,
+          opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {10}}}));
+  ASSERT_FALSE(validator.IsValid(context.get()));
+  ASSERT_EQ(4u, validator.GetNumFunctionsValidatedByLastCheck());
+}
+
+TEST(IncrementalValidatorTest, RejectsInvalidChanges) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  IncrementalValidator validator(validator_options, nullptr);
+  validator.SetLastValidModule(context.get());
+  std::vector<uint32_t> initial_binary;
+  context->module()->ToBinary(&initial_binary, false);
+
+  // An addition whose second operand is a pointer, not an integer.
+  InsertBeforeStoreTo(
+      context.get(), 10,
+      MakeUnique<opt::Instruction>(
+          context.get(), SpvOpIAdd, 8, 100,
+          opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {11}},
+                                        {SPV_OPERAND_TYPE_ID, {10}}}));
+  ASSERT_FALSE(validator.IsValid(context.get()));
+  ASSERT_EQ(initial_binary, validator.GetLastValidBinary());
+}
+
+TEST(IncrementalValidatorTest, RejectsUseOfIdFromUnchangedFunction) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  IncrementalValidator validator(validator_options, nullptr);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // %22 is local to function %20, so cannot be used in function %6.
+  InsertBeforeStoreTo(
+      context.get(), 10,
+      MakeUnique<opt::Instruction>(
+          context.get(), SpvOpCopyObject, 9, 100,
+          opt::Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {22}}}));
+  ASSERT_FALSE(validator.IsValid(context.get()));
+}
+
+TEST(IncrementalValidatorTest, AcceptsChangesThatRequireFullValidation) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  ASSERT_TRUE(fuzzerutil::IsValidAndWellFormed(context.get(), validator_options,
+                                               kConsoleMessageConsumer));
+
+  IncrementalValidator validator(validator_options, kConsoleMessageConsumer);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // Changing the value of an existing constant is not a change that can be
+  // confined to functions.
+  context->get_def_use_mgr()->GetDef(11)->SetInOperand(0, {5});
+  ASSERT_TRUE(validator.IsValid(context.get()));
+
+  // Removing a function is not either.
+  auto function_it = context->module()->begin();
+  while (function_it->result_id() != 20) {
+    ++function_it;
+  }
+  opt::eliminatedeadfunctionsutil::EliminateFunction(context.get(),
+                                                     &function_it);
+  ASSERT_TRUE(validator.IsValid(context.get()));
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
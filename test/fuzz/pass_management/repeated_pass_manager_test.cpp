@@ -0,0 +1,131 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/pass_management/repeated_pass_manager.h"
+
+#include <set>
+
+#include "gtest/gtest.h"
+#include "source/fuzz/pass_management/repeated_pass_recommender_standard.h"
+#include "source/fuzz/pseudo_random_generator.h"
+#include "test/fuzz/fuzz_test_util.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+const std::string kShader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+TEST(RepeatedPassManagerTest, FuzzerContextTracksBudget) {
+  FuzzerContext fuzzer_context(MakeUnique<PseudoRandomGenerator>(0), 100,
+                               false);
+  ASSERT_EQ(0, fuzzer_context.GetPercentageOfBudgetUsed());
+  ASSERT_FALSE(fuzzer_context.IsBudgetNearlyExhausted());
+  ASSERT_EQ(100, fuzzer_context.GetChanceOfApplyingPassThatGrowsModule());
+
+  // The budget used is that of the resource closest to its limit.
+  fuzzer_context.RecordModuleSize(
+      fuzzer_context.GetInstructionCountLimit() / 2,
+      fuzzer_context.GetIdBoundLimit() / 4);
+  ASSERT_EQ(50, fuzzer_context.GetPercentageOfBudgetUsed());
+  ASSERT_FALSE(fuzzer_context.IsBudgetNearlyExhausted());
+  ASSERT_EQ(100, fuzzer_context.GetChanceOfApplyingPassThatGrowsModule());
+
+  fuzzer_context.RecordModuleSize(
+      fuzzer_context.GetInstructionCountLimit() / 2,
+      fuzzer_context.GetIdBoundLimit() / 10 * 9);
+  ASSERT_EQ(90, fuzzer_context.GetPercentageOfBudgetUsed());
+  ASSERT_TRUE(fuzzer_context.IsBudgetNearlyExhausted());
+  ASSERT_EQ(50, fuzzer_context.GetChanceOfApplyingPassThatGrowsModule());
+
+  fuzzer_context.RecordModuleSize(fuzzer_context.GetInstructionCountLimit(),
+                                  0);
+  ASSERT_EQ(100, fuzzer_context.GetPercentageOfBudgetUsed());
+  ASSERT_EQ(0, fuzzer_context.GetChanceOfApplyingPassThatGrowsModule());
+
+  // A time limit of 0 means that there is no time limit, and a long time
+  // limit is not reached immediately.
+  fuzzer_context.RecordModuleSize(0, 0);
+  fuzzer_context.SetTimeLimit(0);
+  ASSERT_FALSE(fuzzer_context.IsTimeLimitReached());
+  fuzzer_context.SetTimeLimit(1000000);
+  ASSERT_FALSE(fuzzer_context.IsTimeLimitReached());
+  ASSERT_GT(80, fuzzer_context.GetPercentageOfBudgetUsed());
+}
+
+TEST(RepeatedPassManagerTest, PrefersSizeNeutralPassesNearBudget) {
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  const auto consumer = nullptr;
+  const auto context = BuildModule(env, consumer, kShader, kFuzzAssembleOption);
+  spvtools::ValidatorOptions validator_options;
+  TransformationContext transformation_context(
+      MakeUnique<FactManager>(context.get()), validator_options);
+  FuzzerContext fuzzer_context(MakeUnique<PseudoRandomGenerator>(0), 100,
+                               false);
+  protobufs::TransformationSequence transformations;
+
+  RepeatedPassInstances pass_instances;
+  pass_instances.SetPass(MakeUnique<FuzzerPassAddLoads>(
+      context.get(), &transformation_context, &fuzzer_context,
+      &transformations));
+  pass_instances.SetPass(MakeUnique<FuzzerPassMergeBlocks>(
+      context.get(), &transformation_context, &fuzzer_context,
+      &transformations));
+  ASSERT_EQ(std::vector<FuzzerPass*>({pass_instances.GetMergeBlocks()}),
+            pass_instances.GetSizeNeutralPasses());
+
+  for (auto strategy : {RepeatedPassStrategy::kSimple,
+                        RepeatedPassStrategy::kRandomWithRecommendations,
+                        RepeatedPassStrategy::kLoopedWithRecommendations}) {
+    RepeatedPassRecommenderStandard recommender(&pass_instances,
+                                                &fuzzer_context);
+    auto pass_manager = RepeatedPassManager::Create(
+        strategy, &fuzzer_context, &pass_instances, &recommender);
+
+    // While the budget is plentiful, the strategy alone decides; the simple
+    // strategy chooses uniformly among all passes.
+    fuzzer_context.RecordModuleSize(0, 0);
+    if (strategy == RepeatedPassStrategy::kSimple) {
+      std::set<FuzzerPass*> chosen_passes;
+      for (uint32_t i = 0; i < 100; i++) {
+        chosen_passes.insert(pass_manager->ChoosePass(transformations));
+      }
+      ASSERT_EQ(2, chosen_passes.size());
+    }
+
+    // Once the budget is used up, only size-neutral passes are chosen.
+    fuzzer_context.RecordModuleSize(0, fuzzer_context.GetIdBoundLimit());
+    for (uint32_t i = 0; i < 100; i++) {
+      ASSERT_EQ(pass_instances.GetMergeBlocks(),
+                pass_manager->ChoosePass(transformations));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
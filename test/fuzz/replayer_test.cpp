@@ -18,6 +18,7 @@
 #include "source/fuzz/data_descriptor.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/instruction_descriptor.h"
+#include "source/fuzz/replay_checkpoint_cache.h"
 #include "source/fuzz/transformation_add_constant_scalar.h"
 #include "source/fuzz/transformation_add_global_variable.h"
 #include "source/fuzz/transformation_add_parameter.h"
@@ -470,6 +471,124 @@ TEST(ReplayerTest, ReplayWithOverflowIds) {
   ASSERT_EQ(2, replayer_result.applied_transformations.transformation_size());
 }
 
+TEST(ReplayerTest, ReplayWithCheckpointCache) {
+  const std::string kTestShader = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 320
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %8 = OpTypeInt 32 1
+          %9 = OpTypePointer Function %8
+         %50 = OpTypePointer Private %8
+         %11 = OpConstant %8 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %10 = OpVariable %9 Function
+               OpStore %10 %11
+         %12 = OpFunctionCall %2 %6
+               OpReturn
+               OpFunctionEnd
+          %6 = OpFunction %2 None %3
+          %7 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  const auto env = SPV_ENV_UNIVERSAL_1_3;
+  spvtools::ValidatorOptions validator_options;
+
+  std::vector<uint32_t> binary_in;
+  SpirvTools t(env);
+  t.SetMessageConsumer(kConsoleMessageConsumer);
+  ASSERT_TRUE(t.Assemble(kTestShader, &binary_in, kFuzzAssembleOption));
+  ASSERT_TRUE(t.Validate(binary_in));
+
+  protobufs::TransformationSequence transformations;
+  *transformations.add_transformation() =
+      TransformationAddConstantScalar(100, 8, {42}, true).ToMessage();
+  // Not applicable: id 100 is already used.
+  *transformations.add_transformation() =
+      TransformationAddConstantScalar(100, 8, {43}, false).ToMessage();
+  *transformations.add_transformation() =
+      TransformationAddGlobalVariable(101, 50, SpvStorageClassPrivate, 100,
+                                      true)
+          .ToMessage();
+  *transformations.add_transformation() =
+      TransformationAddParameter(6, 102, 8, {{12, 100}}, 103).ToMessage();
+  *transformations.add_transformation() =
+      TransformationAddSynonym(
+          11,
+          protobufs::TransformationAddSynonym::SynonymType::
+              TransformationAddSynonym_SynonymType_COPY_OBJECT,
+          104, MakeInstructionDescriptor(12, SpvOpFunctionCall, 0))
+          .ToMessage();
+
+  protobufs::FactSequence empty_facts;
+  ReplayCheckpointCache checkpoint_cache(2, 16);
+
+  // Checks that replaying the first |num_transformations| transformations
+  // with the cache gives the same result as replaying them without it.
+  auto check_replay = [&](uint32_t num_transformations) {
+    auto expected_result =
+        Replayer(env, kConsoleMessageConsumer, binary_in, empty_facts,
+                 transformations, num_transformations, true,
+                 validator_options)
+            .Run();
+    auto cached_result =
+        Replayer(env, kConsoleMessageConsumer, binary_in, empty_facts,
+                 transformations, num_transformations, true,
+                 validator_options, &checkpoint_cache)
+            .Run();
+    ASSERT_EQ(Replayer::ReplayerResultStatus::kComplete,
+              expected_result.status);
+    ASSERT_EQ(Replayer::ReplayerResultStatus::kComplete,
+              cached_result.status);
+    ASSERT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
+        expected_result.applied_transformations,
+        cached_result.applied_transformations));
+    std::vector<uint32_t> expected_binary;
+    expected_result.transformed_module->module()->ToBinary(&expected_binary,
+                                                           false);
+    std::vector<uint32_t> cached_binary;
+    cached_result.transformed_module->module()->ToBinary(&cached_binary,
+                                                         false);
+    ASSERT_EQ(expected_binary, cached_binary);
+    ASSERT_EQ(
+        expected_result.transformation_context->GetFactManager()
+            ->IdIsIrrelevant(100),
+        cached_result.transformation_context->GetFactManager()->IdIsIrrelevant(
+            100));
+    ASSERT_EQ(expected_result.transformation_context->GetFactManager()
+                  ->IsSynonymous(MakeDataDescriptor(11, {}),
+                                 MakeDataDescriptor(104, {})),
+              cached_result.transformation_context->GetFactManager()
+                  ->IsSynonymous(MakeDataDescriptor(11, {}),
+                                 MakeDataDescriptor(104, {})));
+  };
+
+  // The first replay populates the cache with checkpoints after 2 and 4
+  // transformations.
+  check_replay(5);
+  ASSERT_EQ(2, checkpoint_cache.GetNumCheckpoints());
+
+  // Later replays of prefixes resume from the cached checkpoints, and should
+  // not need to record further checkpoints.
+  check_replay(4);
+  check_replay(3);
+  check_replay(5);
+  ASSERT_EQ(2, checkpoint_cache.GetNumCheckpoints());
+
+  // A sequence that diverges after the first checkpoint shares only that
+  // checkpoint, and gets a checkpoint of its own for its second interval.
+  transformations.mutable_transformation()->DeleteSubrange(2, 1);
+  check_replay(4);
+  ASSERT_EQ(3, checkpoint_cache.GetNumCheckpoints());
+}
+
 }  // namespace
 }  // namespace fuzz
 }  // namespace spvtools
@@ -199,7 +199,7 @@ TEST(ShrinkerTest, ReduceAddedFunctions) {
 
   auto shrinker_result =
       Shrinker(env, consumer, reference_binary, no_facts, transformations,
-               interestingness_function, 1000, true, validator_options)
+               interestingness_function, 1000, true, validator_options, 1)
           .Run();
   ASSERT_EQ(Shrinker::ShrinkerResultStatus::kComplete, shrinker_result.status);
 
@@ -371,7 +371,7 @@ TEST(ShrinkerTest, HitStepLimitWhenReducingAddedFunctions) {
 
   auto shrinker_result =
       Shrinker(env, consumer, reference_binary, no_facts, transformations,
-               interestingness_function, 30, true, validator_options)
+               interestingness_function, 30, true, validator_options, 1)
           .Run();
   ASSERT_EQ(Shrinker::ShrinkerResultStatus::kStepLimitReached,
             shrinker_result.status);
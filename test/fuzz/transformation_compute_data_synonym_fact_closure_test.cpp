@@ -128,7 +128,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest, DataSynonymFacts) {
                                                kConsoleMessageConsumer));
   TransformationContext transformation_context(
       MakeUnique<FactManager>(context.get()), validator_options);
-  ASSERT_TRUE(TransformationComputeDataSynonymFactClosure(100).IsApplicable(
+  ASSERT_TRUE(TransformationComputeDataSynonymFactClosure(100, 0).IsApplicable(
       context.get(), transformation_context));
 
   ASSERT_FALSE(transformation_context.GetFactManager()->IsSynonymous(
@@ -168,7 +168,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest, DataSynonymFacts) {
   transformation_context.GetFactManager()->AddFactDataSynonym(
       MakeDataDescriptor(27, {1}), MakeDataDescriptor(102, {1}));
 
-  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100),
+  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100, 0),
                         context.get(), &transformation_context);
 
   ASSERT_TRUE(transformation_context.GetFactManager()->IsSynonymous(
@@ -253,7 +253,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest, DataSynonymFacts) {
   transformation_context.GetFactManager()->AddFactDataSynonym(
       MakeDataDescriptor(21, {4}), MakeDataDescriptor(100, {4}));
 
-  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100),
+  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100, 0),
                         context.get(), &transformation_context);
 
   ASSERT_TRUE(transformation_context.GetFactManager()->IsSynonymous(
@@ -289,7 +289,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest, DataSynonymFacts) {
   transformation_context.GetFactManager()->AddFactDataSynonym(
       MakeDataDescriptor(106, {1}), MakeDataDescriptor(37, {}));
 
-  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100),
+  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100, 0),
                         context.get(), &transformation_context);
 
   ASSERT_TRUE(transformation_context.GetFactManager()->IsSynonymous(
@@ -314,7 +314,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest, DataSynonymFacts) {
   transformation_context.GetFactManager()->AddFactDataSynonym(
       MakeDataDescriptor(40, {2}), MakeDataDescriptor(108, {2}));
 
-  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100),
+  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100, 0),
                         context.get(), &transformation_context);
 
   ASSERT_TRUE(transformation_context.GetFactManager()->IsSynonymous(
@@ -466,7 +466,7 @@ TEST(TransformationComputeDataSynonymFactClosureTest,
   context->KillDef(51);
   context->InvalidateAnalysesExceptFor(opt::IRContext::kAnalysisNone);
 
-  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100),
+  ApplyAndCheckFreshIds(TransformationComputeDataSynonymFactClosure(100, 0),
                         context.get(), &transformation_context);
   ASSERT_FALSE(transformation_context.GetFactManager()->IsSynonymous(
       MakeDataDescriptor(19, {}), MakeDataDescriptor(30, {})));
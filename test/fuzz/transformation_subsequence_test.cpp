@@ -0,0 +1,99 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/fuzz/transformation_subsequence.h"
+
+#include "gtest/gtest.h"
+
+namespace spvtools {
+namespace fuzz {
+namespace {
+
+// Returns a sequence of |size| transformations, where transformation i is
+// identified by having i as its maximum equivalence class size.
+std::shared_ptr<const protobufs::TransformationSequence> MakeSequence(
+    uint32_t size) {
+  auto result = std::make_shared<protobufs::TransformationSequence>();
+  for (uint32_t i = 0; i < size; i++) {
+    result->add_transformation()
+        ->mutable_compute_data_synonym_fact_closure()
+        ->set_maximum_equivalence_class_size(i);
+  }
+  return result;
+}
+
+// Returns the identifiers of the transformations of |subsequence|.
+std::vector<uint32_t> GetIdentifiers(
+    const TransformationSubsequence& subsequence) {
+  std::vector<uint32_t> result;
+  for (uint32_t i = 0; i < subsequence.size(); i++) {
+    result.push_back(subsequence[i]
+                         .compute_data_synonym_fact_closure()
+                         .maximum_equivalence_class_size());
+  }
+  return result;
+}
+
+TEST(TransformationSubsequenceTest, EmptySubsequence) {
+  TransformationSubsequence subsequence;
+  ASSERT_TRUE(subsequence.empty());
+  ASSERT_EQ(0, subsequence.size());
+  ASSERT_EQ(0, subsequence.ToMessage().transformation_size());
+}
+
+TEST(TransformationSubsequenceTest, RemoveRanges) {
+  auto sequence = MakeSequence(6);
+  TransformationSubsequence whole(sequence);
+  ASSERT_FALSE(whole.empty());
+  ASSERT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 4, 5}), GetIdentifiers(whole));
+
+  auto without_middle = whole.WithoutRange(1, 3);
+  ASSERT_EQ(std::vector<uint32_t>({0, 3, 4, 5}),
+            GetIdentifiers(without_middle));
+  ASSERT_EQ(3, without_middle.GetIndexInSequence(1));
+  // The sequence is shared rather than copied.
+  ASSERT_EQ(sequence, without_middle.GetSequence());
+
+  // Indices of a subsequence of a subsequence refer to the original sequence.
+  auto without_end = without_middle.WithoutRange(2, 4);
+  ASSERT_EQ(std::vector<uint32_t>({0, 3}), GetIdentifiers(without_end));
+  ASSERT_EQ(3, without_end.GetIndexInSequence(1));
+
+  // Removing an empty range changes nothing.
+  ASSERT_EQ(GetIdentifiers(without_middle),
+            GetIdentifiers(without_middle.WithoutRange(2, 2)));
+
+  // Removing everything leaves an empty subsequence.
+  ASSERT_TRUE(without_end.WithoutRange(0, 2).empty());
+
+  // The original is unaffected by taking subsequences of it.
+  ASSERT_EQ(6, whole.size());
+}
+
+TEST(TransformationSubsequenceTest, ExplicitIndicesAndMessage) {
+  auto sequence = MakeSequence(5);
+  TransformationSubsequence subsequence(sequence, {1, 2, 4});
+  ASSERT_EQ(std::vector<uint32_t>({1, 2, 4}), GetIdentifiers(subsequence));
+
+  auto message = subsequence.ToMessage();
+  ASSERT_EQ(3, message.transformation_size());
+  for (uint32_t i = 0; i < subsequence.size(); i++) {
+    ASSERT_EQ(subsequence[i].SerializeAsString(),
+              message.transformation(static_cast<int>(i)).SerializeAsString());
+  }
+}
+
+}  // namespace
+}  // namespace fuzz
+}  // namespace spvtools
@@ -16,12 +16,13 @@
 #include <vector>
 
 #include "spirv-tools/libspirv.hpp"
+#include "test/fuzzers/spvtools_fuzzer_util.h"
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   if (size < sizeof(spv_target_env) + 1) return 0;
 
-  const spv_context context =
-      spvContextCreate(*reinterpret_cast<const spv_target_env*>(data));
+  const spv_const_context context = spvtools::fuzzers::GetContext(
+      *reinterpret_cast<const spv_target_env*>(data));
   if (context == nullptr) return 0;
 
   data += sizeof(spv_target_env);
@@ -39,6 +40,5 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   spvBinaryParse(context, nullptr, input.data(), input.size(), nullptr, nullptr,
                  nullptr);
 
-  spvContextDestroy(context);
   return 0;
 }
@@ -0,0 +1,42 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TEST_FUZZERS_SPVTOOLS_FUZZER_UTIL_H_
+#define TEST_FUZZERS_SPVTOOLS_FUZZER_UTIL_H_
+
+#include <cstdint>
+
+#include "source/table.h"
+#include "spirv-tools/libspirv.h"
+
+namespace spvtools {
+namespace fuzzers {
+
+// Returns the context for the target environment |env|, or null if |env| is
+// not a valid target environment.  The context is shared by the whole
+// process, so that inputs do not each pay for setting up a context.
+//
+// Harnesses read |env| straight from their input, so it is checked here:
+// GetSharedContext requires a valid target environment.
+inline spv_const_context GetContext(spv_target_env env) {
+  if (static_cast<uint32_t>(env) >= static_cast<uint32_t>(SPV_ENV_MAX)) {
+    return nullptr;
+  }
+  return GetSharedContext(env);
+}
+
+}  // namespace fuzzers
+}  // namespace spvtools
+
+#endif  // TEST_FUZZERS_SPVTOOLS_FUZZER_UTIL_H_
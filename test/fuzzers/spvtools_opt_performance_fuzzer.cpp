@@ -16,12 +16,27 @@
 #include <vector>
 
 #include "spirv-tools/optimizer.hpp"
+#include "test/fuzzers/spvtools_structure_aware_mutator.h"
 
-extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
-  spvtools::Optimizer optimizer(SPV_ENV_UNIVERSAL_1_3);
-  optimizer.SetMessageConsumer([](spv_message_level_t, const char*,
+namespace {
+
+// Returns the optimizer, which is set up once and then run on every input.
+const spvtools::Optimizer& GetOptimizer() {
+  static const spvtools::Optimizer* optimizer = []() {
+    auto* result = new spvtools::Optimizer(SPV_ENV_UNIVERSAL_1_3);
+    result->SetMessageConsumer([](spv_message_level_t, const char*,
                                   const spv_position_t&, const char*) {});
+    result->RegisterPerformancePasses();
+    return result;
+  }();
+  return *optimizer;
+}
 
+}  // namespace
+
+SPVTOOLS_DEFINE_STRUCTURE_AWARE_MUTATOR()
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::vector<uint32_t> input;
   input.resize(size >> 2);
 
@@ -31,8 +46,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
                      (data[i + 3]) << 24;
   }
 
-  optimizer.RegisterPerformancePasses();
-  optimizer.Run(input.data(), input.size(), &input);
+  GetOptimizer().Run(input.data(), input.size(), &input);
 
   return 0;
 }
@@ -0,0 +1,268 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test/fuzzers/spvtools_structure_aware_mutator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "source/operand.h"
+#include "source/table.h"
+#include "spirv-tools/libspirv.h"
+#include "test/fuzzers/spvtools_fuzzer_util.h"
+
+namespace spvtools {
+namespace fuzzers {
+
+namespace {
+
+// The number of words in the header of a SPIR-V module.
+const size_t kHeaderSizeInWords = 5;
+
+// An operand of a parsed instruction.
+struct Operand {
+  // Location of the operand, in words from the start of the instruction.
+  uint16_t offset;
+  uint16_t num_words;
+  spv_operand_type_t type;
+};
+
+// An instruction of a parsed module.
+struct Instruction {
+  std::vector<uint32_t> words;
+  std::vector<Operand> operands;
+};
+
+// The result of parsing a module.
+struct ParsedModule {
+  std::vector<Instruction> instructions;
+
+  // The result ids defined by the module.
+  std::vector<uint32_t> result_ids;
+};
+
+spv_result_t HandleInstruction(void* user_data,
+                               const spv_parsed_instruction_t* parsed) {
+  auto* module = static_cast<ParsedModule*>(user_data);
+  Instruction instruction;
+  instruction.words.assign(parsed->words, parsed->words + parsed->num_words);
+  for (uint16_t i = 0; i < parsed->num_operands; i++) {
+    const auto& operand = parsed->operands[i];
+    instruction.operands.push_back(
+        {operand.offset, operand.num_words, operand.type});
+  }
+  module->instructions.push_back(std::move(instruction));
+  if (parsed->result_id != 0) {
+    module->result_ids.push_back(parsed->result_id);
+  }
+  return SPV_SUCCESS;
+}
+
+// The target environment used to parse binaries.  Its context is the shared
+// one, as creating a context for every mutation would dominate the cost of
+// mutating.
+const spv_target_env kTargetEnv = SPV_ENV_UNIVERSAL_1_5;
+
+// Returns true if the grammar gives |a| and |b| the same logical operands.
+bool HaveSameOperandTypes(const spv_opcode_desc_t& a,
+                          const spv_opcode_desc_t& b) {
+  return a.hasResult == b.hasResult && a.hasType == b.hasType &&
+         a.numTypes == b.numTypes &&
+         std::equal(a.operandTypes, a.operandTypes + a.numTypes,
+                    b.operandTypes);
+}
+
+// Returns the index of an operand of |instruction| satisfying |predicate|,
+// chosen using |random|, or the number of operands if there is none.
+template <typename Predicate>
+size_t ChooseOperand(const Instruction& instruction, std::mt19937* random,
+                     Predicate predicate) {
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < instruction.operands.size(); i++) {
+    if (predicate(instruction.operands[i])) {
+      candidates.push_back(i);
+    }
+  }
+  if (candidates.empty()) {
+    return instruction.operands.size();
+  }
+  return candidates[(*random)() % candidates.size()];
+}
+
+// Makes an id operand of |module|.instructions[|index|] refer to another id of
+// |module|.  Returns false if the instruction has no such operand.
+bool ReplaceIdOperand(ParsedModule* module, size_t index,
+                      std::mt19937* random) {
+  auto& instruction = module->instructions[index];
+  const size_t operand_index =
+      ChooseOperand(instruction, random, [](const Operand& operand) {
+        return spvIsInIdType(operand.type) && operand.num_words == 1;
+      });
+  if (operand_index == instruction.operands.size() ||
+      module->result_ids.empty()) {
+    return false;
+  }
+  instruction.words[instruction.operands[operand_index].offset] =
+      module->result_ids[(*random)() % module->result_ids.size()];
+  return true;
+}
+
+// Changes a literal number operand of |module|.instructions[|index|] to an
+// interesting nearby or boundary value.  Returns false if the instruction has
+// no such operand.
+bool ChangeLiteralOperand(ParsedModule* module, size_t index,
+                          std::mt19937* random) {
+  auto& instruction = module->instructions[index];
+  const size_t operand_index =
+      ChooseOperand(instruction, random, [](const Operand& operand) {
+        return (operand.type == SPV_OPERAND_TYPE_LITERAL_INTEGER ||
+                operand.type == SPV_OPERAND_TYPE_TYPED_LITERAL_NUMBER ||
+                operand.type == SPV_OPERAND_TYPE_SPEC_CONSTANT_OP_NUMBER) &&
+               operand.num_words > 0;
+      });
+  if (operand_index == instruction.operands.size()) {
+    return false;
+  }
+  const auto& operand = instruction.operands[operand_index];
+  const size_t word_offset = operand.offset + (*random)() % operand.num_words;
+  uint32_t& word = instruction.words[word_offset];
+  switch ((*random)() % 6) {
+    case 0:
+      word = 0;
+      break;
+    case 1:
+      word = 1;
+      break;
+    case 2:
+      word = 0xFFFFFFFF;
+      break;
+    case 3:
+      word++;
+      break;
+    case 4:
+      word--;
+      break;
+    default:
+      word ^= 1u << ((*random)() % 32);
+      break;
+  }
+  return true;
+}
+
+// Swaps the opcode of |module|.instructions[|index|] for another opcode whose
+// operands have the same types according to the grammar.  Returns false if
+// there is no such opcode.
+bool ReplaceOpcode(ParsedModule* module, size_t index, std::mt19937* random) {
+  auto& instruction = module->instructions[index];
+  const auto opcode = static_cast<SpvOp>(instruction.words[0] & 0xFFFF);
+  const spv_opcode_table table = GetContext(kTargetEnv)->opcode_table;
+  const spv_opcode_desc_t* current = nullptr;
+  for (uint32_t i = 0; i < table->count; i++) {
+    if (table->entries[i].opcode == opcode) {
+      current = &table->entries[i];
+      break;
+    }
+  }
+  if (current == nullptr) {
+    return false;
+  }
+  std::vector<SpvOp> candidates;
+  for (uint32_t i = 0; i < table->count; i++) {
+    const auto& entry = table->entries[i];
+    if (entry.opcode != opcode && HaveSameOperandTypes(*current, entry)) {
+      candidates.push_back(entry.opcode);
+    }
+  }
+  if (candidates.empty()) {
+    return false;
+  }
+  instruction.words[0] = (instruction.words[0] & 0xFFFF0000) |
+                         candidates[(*random)() % candidates.size()];
+  return true;
+}
+
+}  // namespace
+
+size_t MutateSpirvBinary(uint8_t* data, size_t size, size_t max_size,
+                         unsigned int seed) {
+  if (size % sizeof(uint32_t) != 0 ||
+      size < kHeaderSizeInWords * sizeof(uint32_t)) {
+    return 0;
+  }
+  std::vector<uint32_t> binary(size / sizeof(uint32_t));
+  std::memcpy(binary.data(), data, size);
+
+  ParsedModule module;
+  if (spvBinaryParse(GetContext(kTargetEnv), &module, binary.data(),
+                     binary.size(), nullptr, HandleInstruction,
+                     nullptr) != SPV_SUCCESS ||
+      module.instructions.empty()) {
+    return 0;
+  }
+
+  std::mt19937 random(seed);
+  auto& instructions = module.instructions;
+  const size_t index = random() % instructions.size();
+  bool mutated = false;
+  switch (random() % 6) {
+    case 0:
+      instructions.erase(instructions.begin() + index);
+      mutated = true;
+      break;
+    case 1: {
+      Instruction copy = instructions[index];
+      instructions.insert(
+          instructions.begin() + random() % (instructions.size() + 1),
+          std::move(copy));
+      mutated = true;
+    } break;
+    case 2: {
+      Instruction moved = std::move(instructions[index]);
+      instructions.erase(instructions.begin() + index);
+      instructions.insert(
+          instructions.begin() + random() % (instructions.size() + 1),
+          std::move(moved));
+      mutated = true;
+    } break;
+    case 3:
+      mutated = ReplaceIdOperand(&module, index, &random);
+      break;
+    case 4:
+      mutated = ChangeLiteralOperand(&module, index, &random);
+      break;
+    default:
+      mutated = ReplaceOpcode(&module, index, &random);
+      break;
+  }
+  if (!mutated) {
+    return 0;
+  }
+
+  binary.resize(kHeaderSizeInWords);
+  for (const auto& instruction : instructions) {
+    binary.insert(binary.end(), instruction.words.begin(),
+                  instruction.words.end());
+  }
+  const size_t result_size = binary.size() * sizeof(uint32_t);
+  if (result_size > max_size) {
+    return 0;
+  }
+  std::memcpy(data, binary.data(), result_size);
+  return result_size;
+}
+
+}  // namespace fuzzers
+}  // namespace spvtools
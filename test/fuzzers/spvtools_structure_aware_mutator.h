@@ -0,0 +1,60 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TEST_FUZZERS_SPVTOOLS_STRUCTURE_AWARE_MUTATOR_H_
+#define TEST_FUZZERS_SPVTOOLS_STRUCTURE_AWARE_MUTATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spvtools {
+namespace fuzzers {
+
+// Mutates the SPIR-V binary held in the |size| bytes at |data| at the level of
+// whole instructions, guided by the grammar, so that the result still parses
+// far more often than after a byte-level mutation.  A mutation, chosen using
+// |seed|, either removes, duplicates or moves an instruction, makes an id
+// operand refer to another id defined by the module, changes a literal number
+// operand, or swaps the opcode of an instruction for one whose operands have
+// the same types.  The result is written back to |data| and its size, which
+// is at most |max_size|, is returned.  Returns 0 if |data| does not hold a
+// binary that parses, or if no mutation applies, in which case the caller
+// should fall back to a byte-level mutation.
+size_t MutateSpirvBinary(uint8_t* data, size_t size, size_t max_size,
+                         unsigned int seed);
+
+}  // namespace fuzzers
+}  // namespace spvtools
+
+// Defines the libFuzzer custom mutator hook so that most mutations are made
+// by MutateSpirvBinary, and the rest, as well as those it cannot make, by
+// libFuzzer's own byte-level mutator.  Used by the harnesses whose input is a
+// SPIR-V binary.
+#define SPVTOOLS_DEFINE_STRUCTURE_AWARE_MUTATOR()                           \
+  extern "C" size_t LLVMFuzzerMutate(uint8_t* data, size_t size,            \
+                                     size_t max_size);                      \
+  extern "C" size_t LLVMFuzzerCustomMutator(uint8_t* data, size_t size,     \
+                                            size_t max_size,                \
+                                            unsigned int seed) {            \
+    if (seed % 4 != 0) {                                                    \
+      const size_t result =                                                 \
+          spvtools::fuzzers::MutateSpirvBinary(data, size, max_size, seed); \
+      if (result != 0) {                                                    \
+        return result;                                                      \
+      }                                                                     \
+    }                                                                       \
+    return LLVMFuzzerMutate(data, size, max_size);                          \
+  }
+
+#endif  // TEST_FUZZERS_SPVTOOLS_STRUCTURE_AWARE_MUTATOR_H_
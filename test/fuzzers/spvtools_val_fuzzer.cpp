@@ -16,12 +16,26 @@
 #include <vector>
 
 #include "spirv-tools/libspirv.hpp"
+#include "test/fuzzers/spvtools_structure_aware_mutator.h"
 
-extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
-  spvtools::SpirvTools tools(SPV_ENV_UNIVERSAL_1_3);
-  tools.SetMessageConsumer([](spv_message_level_t, const char*,
-                              const spv_position_t&, const char*) {});
+namespace {
+
+// Returns the tools, which are set up once and then used for every input.
+const spvtools::SpirvTools& GetTools() {
+  static const spvtools::SpirvTools* tools = []() {
+    auto* result = new spvtools::SpirvTools(SPV_ENV_UNIVERSAL_1_3);
+    result->SetMessageConsumer([](spv_message_level_t, const char*,
+                                  const spv_position_t&, const char*) {});
+    return result;
+  }();
+  return *tools;
+}
 
+}  // namespace
+
+SPVTOOLS_DEFINE_STRUCTURE_AWARE_MUTATOR()
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::vector<uint32_t> input;
   input.resize(size >> 2);
 
@@ -31,6 +45,6 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
                      (data[i + 3]) << 24;
   }
 
-  tools.Validate(input);
+  GetTools().Validate(input);
   return 0;
 }
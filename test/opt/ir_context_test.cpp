@@ -1168,6 +1168,210 @@ OpFunctionEnd)";
   EXPECT_EQ(dbg_value->GetSingleWordOperand(kDebugValueOperandValueIndex), 7);
 }
 
+TEST_F(IRContextTest, CloneIsIndependentDeepCopy) {
+  const std::string text = R"(
+OpCapability Shader
+OpMemoryModel Logical GLSL450
+OpEntryPoint Fragment %1 "main"
+OpExecutionMode %1 OriginUpperLeft
+%2 = OpString "test.frag"
+%3 = OpTypeVoid
+%4 = OpTypeFunction %3
+%5 = OpTypeFloat 32
+%6 = OpTypePointer Function %5
+%7 = OpConstant %5 0
+%1 = OpFunction %3 None %4
+%8 = OpLabel
+%9 = OpVariable %6 Function
+OpLine %2 3 0
+OpStore %9 %7
+OpReturn
+OpFunctionEnd)";
+
+  std::unique_ptr<IRContext> ctx =
+      BuildModule(SPV_ENV_UNIVERSAL_1_1, nullptr, text,
+                  SPV_TEXT_TO_BINARY_OPTION_PRESERVE_NUMERIC_IDS);
+  ctx->BuildInvalidAnalyses(IRContext::kAnalysisDefUse |
+                            IRContext::kAnalysisCFG |
+                            IRContext::kAnalysisDecorations);
+
+  std::unique_ptr<IRContext> clone =
+      ctx->Clone(IRContext::kAnalysisDefUse | IRContext::kAnalysisCFG);
+  EXPECT_EQ(clone.get(), clone->module()->context());
+  EXPECT_TRUE(clone->AreAnalysesValid(IRContext::kAnalysisDefUse |
+                                      IRContext::kAnalysisCFG));
+  EXPECT_FALSE(clone->AreAnalysesValid(IRContext::kAnalysisDecorations));
+  EXPECT_EQ(ctx->module()->IdBound(), clone->module()->IdBound());
+
+  std::vector<uint32_t> original_binary;
+  std::vector<uint32_t> clone_binary;
+  ctx->module()->ToBinary(&original_binary, false);
+  clone->module()->ToBinary(&clone_binary, false);
+  EXPECT_EQ(original_binary, clone_binary);
+
+  // Every instruction, including attached OpLine instructions, belongs to the
+  // clone.
+  bool all_in_clone = true;
+  clone->module()->ForEachInst(
+      [&clone, &all_in_clone](Instruction* inst) {
+        all_in_clone &= inst->context() == clone.get();
+      },
+      true);
+  EXPECT_TRUE(all_in_clone);
+  Instruction* store = clone->get_def_use_mgr()->GetDef(9)->NextNode();
+  ASSERT_EQ(SpvOpStore, store->opcode());
+  ASSERT_EQ(1u, store->dbg_line_insts().size());
+  EXPECT_EQ(clone.get(), store->dbg_line_insts()[0].context());
+
+  // Changes to the clone do not affect the original.
+  clone->KillInst(store);
+  EXPECT_EQ(SpvOpReturn,
+            clone->get_def_use_mgr()->GetDef(9)->NextNode()->opcode());
+  EXPECT_EQ(SpvOpStore,
+            ctx->get_def_use_mgr()->GetDef(9)->NextNode()->opcode());
+  std::vector<uint32_t> binary_after;
+  ctx->module()->ToBinary(&binary_after, false);
+  EXPECT_EQ(original_binary, binary_after);
+  clone->module()->ToBinary(&clone_binary, false);
+  EXPECT_NE(original_binary, clone_binary);
+}
+
+const std::string kTransactionTestModule = R"(
+OpCapability Shader
+OpMemoryModel Logical GLSL450
+OpEntryPoint Fragment %1 "main"
+OpExecutionMode %1 OriginUpperLeft
+%2 = OpString "test.frag"
+%3 = OpTypeVoid
+%4 = OpTypeFunction %3
+%5 = OpTypeFloat 32
+%6 = OpTypePointer Function %5
+%7 = OpConstant %5 0
+%1 = OpFunction %3 None %4
+%8 = OpLabel
+%9 = OpVariable %6 Function
+OpLine %2 3 0
+OpStore %9 %7
+OpReturn
+OpFunctionEnd)";
+
+TEST_F(IRContextTest, TransactionRollbackRestoresModule) {
+  std::unique_ptr<IRContext> ctx =
+      BuildModule(SPV_ENV_UNIVERSAL_1_1, nullptr, kTransactionTestModule,
+                  SPV_TEXT_TO_BINARY_OPTION_PRESERVE_NUMERIC_IDS);
+  std::vector<uint32_t> original_binary;
+  ctx->module()->ToBinary(&original_binary, false);
+  const uint32_t original_id_bound = ctx->module()->IdBound();
+  const uint32_t variable_unique_id =
+      ctx->get_def_use_mgr()->GetDef(9)->unique_id();
+
+  ctx->BeginTransaction();
+  EXPECT_TRUE(ctx->HasActiveTransaction());
+
+  // An operand edit, an id allocation and an insertion.
+  ctx->get_def_use_mgr()->GetDef(7)->SetInOperand(0, {0x3f800000});
+  Instruction* store = ctx->get_def_use_mgr()->GetDef(9)->NextNode();
+  ASSERT_EQ(SpvOpStore, store->opcode());
+  const uint32_t new_id = ctx->TakeNextId();
+  store->InsertBefore(MakeUnique<Instruction>(
+      ctx.get(), SpvOpCopyObject, 5, new_id,
+      Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {7}}}));
+  // A removal, of an instruction that has an attached OpLine.
+  ctx->KillInst(store);
+  // An edit through a reference to an operand, followed by a removal.
+  Instruction* execution_mode = &*ctx->module()->execution_mode_begin();
+  execution_mode->GetInOperand(1).words[0] = SpvExecutionModeOriginLowerLeft;
+  ctx->KillInst(execution_mode);
+
+  std::vector<uint32_t> binary;
+  ctx->module()->ToBinary(&binary, false);
+  EXPECT_NE(original_binary, binary);
+  EXPECT_EQ(original_id_bound + 1, ctx->module()->IdBound());
+
+  ctx->RollbackTransaction();
+  EXPECT_FALSE(ctx->HasActiveTransaction());
+  EXPECT_FALSE(ctx->AreAnalysesValid(IRContext::kAnalysisDefUse));
+  EXPECT_EQ(ctx.get(), ctx->module()->context());
+  binary.clear();
+  ctx->module()->ToBinary(&binary, false);
+  EXPECT_EQ(original_binary, binary);
+  EXPECT_EQ(original_id_bound, ctx->module()->IdBound());
+
+  // The restored module can be analysed and changed as usual.
+  Instruction* variable = ctx->get_def_use_mgr()->GetDef(9);
+  EXPECT_EQ(variable_unique_id, variable->unique_id());
+  store = variable->NextNode();
+  ASSERT_EQ(SpvOpStore, store->opcode());
+  ASSERT_EQ(1u, store->dbg_line_insts().size());
+  EXPECT_EQ(ctx.get(), store->dbg_line_insts()[0].context());
+  EXPECT_EQ(ctx->get_instr_block(store), ctx->get_instr_block(variable));
+  EXPECT_EQ(1u, ctx->get_def_use_mgr()->NumUses(7));
+  ctx->KillInst(store);
+  EXPECT_EQ(0u, ctx->get_def_use_mgr()->NumUses(7));
+}
+
+TEST_F(IRContextTest, TransactionCommitKeepsChanges) {
+  std::unique_ptr<IRContext> ctx =
+      BuildModule(SPV_ENV_UNIVERSAL_1_1, nullptr, kTransactionTestModule,
+                  SPV_TEXT_TO_BINARY_OPTION_PRESERVE_NUMERIC_IDS);
+  ctx->BuildInvalidAnalyses(IRContext::kAnalysisDefUse);
+
+  ctx->BeginTransaction();
+  ctx->get_def_use_mgr()->GetDef(7)->SetInOperand(0, {0x3f800000});
+  const uint32_t new_id = ctx->TakeNextId();
+  ctx->CommitTransaction();
+  EXPECT_FALSE(ctx->HasActiveTransaction());
+  EXPECT_TRUE(ctx->AreAnalysesValid(IRContext::kAnalysisDefUse));
+  EXPECT_EQ(new_id + 1, ctx->module()->IdBound());
+  EXPECT_EQ(0x3f800000u,
+            ctx->get_def_use_mgr()->GetDef(7)->GetSingleWordInOperand(0));
+
+  // A later transaction rolls back to the committed state.
+  std::vector<uint32_t> committed_binary;
+  ctx->module()->ToBinary(&committed_binary, false);
+  ctx->BeginTransaction();
+  ctx->get_def_use_mgr()->GetDef(7)->SetInOperand(0, {0x40000000});
+  ctx->TakeNextId();
+  ctx->RollbackTransaction();
+  std::vector<uint32_t> binary;
+  ctx->module()->ToBinary(&binary, false);
+  EXPECT_EQ(committed_binary, binary);
+}
+
+TEST_F(IRContextTest, TransactionCopiesOnlyChangedInstructions) {
+  std::unique_ptr<IRContext> ctx =
+      BuildModule(SPV_ENV_UNIVERSAL_1_1, nullptr, kTransactionTestModule,
+                  SPV_TEXT_TO_BINARY_OPTION_PRESERVE_NUMERIC_IDS);
+
+  ctx->BeginTransaction();
+  ASSERT_NE(nullptr, ctx->journal());
+  // Building analyses and writing the module out change nothing.
+  ctx->BuildInvalidAnalyses(IRContext::kAnalysisDefUse |
+                            IRContext::kAnalysisInstrToBlockMapping);
+  std::vector<uint32_t> binary;
+  ctx->module()->ToBinary(&binary, false);
+  EXPECT_EQ(0u, ctx->journal()->GetNumBeforeImages());
+
+  // Each changed instruction is copied once, however often it changes.
+  Instruction* constant = ctx->get_def_use_mgr()->GetDef(7);
+  constant->SetInOperand(0, {0x3f800000});
+  constant->SetInOperand(0, {0x40000000});
+  EXPECT_EQ(1u, ctx->journal()->GetNumBeforeImages());
+
+  // Instructions added during the transaction are not copied.
+  Instruction* store = ctx->get_def_use_mgr()->GetDef(9)->NextNode();
+  Instruction* copy = store->InsertBefore(MakeUnique<Instruction>(
+      ctx.get(), SpvOpCopyObject, 5, ctx->TakeNextId(),
+      Instruction::OperandList{{SPV_OPERAND_TYPE_ID, {7}}}));
+  copy->SetInOperand(0, {7});
+  copy->RemoveFromList();
+  delete copy;
+  EXPECT_EQ(1u, ctx->journal()->GetNumBeforeImages());
+
+  ctx->RollbackTransaction();
+  EXPECT_EQ(0u, ctx->get_def_use_mgr()->GetDef(7)->GetSingleWordInOperand(0));
+}
+
 }  // namespace
 }  // namespace opt
 }  // namespace spvtools
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -118,6 +119,321 @@ TEST(Optimizer, CanRunTransformingPassWithAliasedVectors) {
   EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
 }
 
+TEST(Optimizer, CanRunRegisteredPassesRepeatedly) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  opt.RegisterPass(CreateStripDebugInfoPass()).RegisterPass(CreateNullPass());
+
+  for (const std::string name : {"foo", "bar", "baz"}) {
+    std::vector<uint32_t> binary;
+    tools.Assemble(
+        Header() + "OpName %" + name + " \"" + name + "\"\n%" + name +
+            " = OpTypeVoid",
+        &binary);
+    ASSERT_TRUE(opt.Run(binary.data(), binary.size(), &binary));
+
+    std::string disassembly;
+    tools.Disassemble(binary.data(), binary.size(), &disassembly);
+    EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
+    ASSERT_EQ(2, opt.GetPassNames().size());
+    EXPECT_STREQ("strip-debug", opt.GetPassNames()[0]);
+    EXPECT_STREQ("null", opt.GetPassNames()[1]);
+  }
+}
+
+TEST(Optimizer, CannotRerunOutOfTreePass) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "%void = OpTypeVoid", &binary);
+
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  opt.RegisterPass(Optimizer::PassToken(MakeUnique<NullPass>()));
+  std::vector<uint32_t> binary_out;
+  EXPECT_TRUE(opt.Run(binary.data(), binary.size(), &binary_out));
+  EXPECT_FALSE(opt.Run(binary.data(), binary.size(), &binary_out));
+}
+
+TEST(Optimizer, ValidatesWhileBuildingModule) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "OpName %foo \"foo\"\n%foo = OpTypeVoid",
+                 &binary);
+
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  opt.RegisterPass(CreateStripDebugInfoPass());
+  std::vector<uint32_t> validated_binary;
+  std::vector<uint32_t> unvalidated_binary;
+  ASSERT_TRUE(opt.Run(binary.data(), binary.size(), &validated_binary,
+                      ValidatorOptions(), /* skip_validation = */ false));
+  ASSERT_TRUE(opt.Run(binary.data(), binary.size(), &unvalidated_binary,
+                      ValidatorOptions(), /* skip_validation = */ true));
+  EXPECT_THAT(validated_binary, Eq(unvalidated_binary));
+
+  std::string disassembly;
+  tools.Disassemble(validated_binary.data(), validated_binary.size(),
+                    &disassembly);
+  EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
+}
+
+TEST(Optimizer, RejectsInvalidModuleWhenValidating) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "%int = OpTypeInt 32 2", &binary);
+
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<std::string> errors;
+  opt.SetMessageConsumer([&errors](spv_message_level_t level, const char*,
+                                   const spv_position_t&, const char* message) {
+    if (level == SPV_MSG_ERROR) errors.push_back(message);
+  });
+  opt.RegisterPass(CreateNullPass());
+  std::vector<uint32_t> binary_out;
+  EXPECT_FALSE(opt.Run(binary.data(), binary.size(), &binary_out));
+  ASSERT_EQ(1, errors.size());
+  EXPECT_THAT(errors[0], ::testing::HasSubstr("signedness"));
+
+  // The module is still loaded and optimized when validation is skipped.
+  errors.clear();
+  EXPECT_TRUE(opt.Run(binary.data(), binary.size(), &binary_out,
+                      ValidatorOptions(), /* skip_validation = */ true));
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST(Optimizer, CanRunOnCallerOwnedContext) {
+  auto context = BuildModule(SPV_ENV_UNIVERSAL_1_0, nullptr,
+                             Header() + "OpName %foo \"foo\"\n"
+                                        "%foo = OpTypeVoid");
+  ASSERT_NE(nullptr, context);
+
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  opt.RegisterPass(CreateStripDebugInfoPass());
+  OptimizerOptions options;
+  ASSERT_TRUE(opt.Run(context.get(), options));
+
+  // The optimized module is still in |context|, ready for further passes.
+  std::vector<uint32_t> binary;
+  context->module()->ToBinary(&binary, /* skip_nop = */ true);
+  std::string disassembly;
+  SpirvTools(SPV_ENV_UNIVERSAL_1_0)
+      .Disassemble(binary.data(), binary.size(), &disassembly);
+  EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
+}
+
+TEST(Optimizer, CanChainToolsOnInMemoryModule) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "OpName %foo \"foo\"\n%foo = OpTypeVoid",
+                 &binary);
+
+  spv_context context = spvContextCreate(SPV_ENV_UNIVERSAL_1_0);
+  spv_validator_options validator_options = spvValidatorOptionsCreate();
+  spv_diagnostic diagnostic = nullptr;
+  spv_ir_module module = nullptr;
+  ASSERT_EQ(SPV_SUCCESS,
+            spvIRModuleCreate(context, binary.data(), binary.size(),
+                              validator_options, &module, &diagnostic));
+  EXPECT_EQ(nullptr, diagnostic);
+
+  const char* flags[] = {"--strip-debug", "--eliminate-dead-code-aggressive"};
+  EXPECT_EQ(SPV_SUCCESS, spvIRModuleOptimize(context, module, flags, 2,
+                                             nullptr, &diagnostic));
+  EXPECT_EQ(SPV_SUCCESS, spvIRModuleValidate(context, module,
+                                             validator_options, &diagnostic));
+  EXPECT_EQ(nullptr, diagnostic);
+
+  const char* bad_flags[] = {"--no-such-pass"};
+  EXPECT_EQ(SPV_ERROR_INVALID_VALUE,
+            spvIRModuleOptimize(context, module, bad_flags, 1, nullptr,
+                                &diagnostic));
+  EXPECT_NE(nullptr, diagnostic);
+  spvDiagnosticDestroy(diagnostic);
+
+  spv_binary optimized = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvIRModuleToBinary(module, &optimized));
+  std::string disassembly;
+  tools.Disassemble(optimized->code, optimized->wordCount, &disassembly);
+  EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
+
+  spvBinaryDestroy(optimized);
+  spvIRModuleDestroy(module);
+  spvValidatorOptionsDestroy(validator_options);
+  spvContextDestroy(context);
+}
+
+TEST(Optimizer, InMemoryModuleOptimizesAgainWithNewFlags) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "OpName %foo \"foo\"\n%foo = OpTypeVoid",
+                 &binary);
+
+  spv_context context = spvContextCreate(SPV_ENV_UNIVERSAL_1_0);
+  spv_ir_module module = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvIRModuleCreate(context, binary.data(),
+                                           binary.size(), nullptr, &module,
+                                           nullptr));
+
+  // The passes kept with the module are set up again whenever the flags
+  // change, and may then be reused.
+  const char* flags[] = {"--strip-debug"};
+  EXPECT_EQ(SPV_SUCCESS,
+            spvIRModuleOptimize(context, module, flags, 0, nullptr, nullptr));
+  EXPECT_EQ(SPV_SUCCESS,
+            spvIRModuleOptimize(context, module, flags, 1, nullptr, nullptr));
+  EXPECT_EQ(SPV_SUCCESS,
+            spvIRModuleOptimize(context, module, flags, 1, nullptr, nullptr));
+  const char* bad_flags[] = {"--no-such-pass"};
+  EXPECT_EQ(SPV_ERROR_INVALID_VALUE,
+            spvIRModuleOptimize(context, module, bad_flags, 1, nullptr,
+                                nullptr));
+  EXPECT_EQ(SPV_SUCCESS,
+            spvIRModuleOptimize(context, module, flags, 1, nullptr, nullptr));
+
+  spv_binary optimized = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvIRModuleToBinary(module, &optimized));
+  std::string disassembly;
+  tools.Disassemble(optimized->code, optimized->wordCount, &disassembly);
+  EXPECT_THAT(disassembly, Eq(Header() + "%void = OpTypeVoid\n"));
+
+  spvBinaryDestroy(optimized);
+  spvIRModuleDestroy(module);
+  spvContextDestroy(context);
+}
+
+// Counts the allocations and deallocations made through |allocator|.
+struct CountingAllocator {
+  CountingAllocator() : allocator{Allocate, Deallocate, this} {}
+
+  static void* Allocate(void* user_data, size_t size) {
+    static_cast<CountingAllocator*>(user_data)->num_allocations++;
+    return ::operator new(size);
+  }
+
+  static void Deallocate(void* user_data, void* ptr, size_t) {
+    static_cast<CountingAllocator*>(user_data)->num_deallocations++;
+    ::operator delete(ptr);
+  }
+
+  spv_allocator_t allocator;
+  int num_allocations = 0;
+  int num_deallocations = 0;
+};
+
+TEST(Optimizer, AllocatesInstructionsWithClientAllocator) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "OpName %foo \"foo\"\n%foo = OpTypeVoid",
+                 &binary);
+
+  CountingAllocator counter;
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
+  opt.RegisterPass(CreateStripDebugInfoPass()).SetAllocator(&counter.allocator);
+  std::vector<uint32_t> optimized;
+  ASSERT_TRUE(opt.Run(binary.data(), binary.size(), &optimized));
+  EXPECT_GT(counter.num_allocations, 0);
+  EXPECT_EQ(counter.num_allocations, counter.num_deallocations);
+
+  // The allocator of a context applies to the modules built with it.
+  CountingAllocator context_counter;
+  spv_context context = spvContextCreate(SPV_ENV_UNIVERSAL_1_0);
+  spvContextSetAllocator(context, &context_counter.allocator);
+  spv_ir_module module = nullptr;
+  ASSERT_EQ(SPV_SUCCESS, spvIRModuleCreate(context, binary.data(),
+                                           binary.size(), nullptr, &module,
+                                           nullptr));
+  const char* flags[] = {"--strip-debug"};
+  EXPECT_EQ(SPV_SUCCESS,
+            spvIRModuleOptimize(context, module, flags, 1, nullptr, nullptr));
+  EXPECT_GT(context_counter.num_allocations, 0);
+
+  // The module keeps its allocator when it is optimized with another context.
+  spv_context plain_context = spvContextCreate(SPV_ENV_UNIVERSAL_1_0);
+  const char* dce_flags[] = {"--eliminate-dead-code-aggressive"};
+  EXPECT_EQ(SPV_SUCCESS, spvIRModuleOptimize(plain_context, module, dce_flags,
+                                             1, nullptr, nullptr));
+  spvContextDestroy(plain_context);
+  spvIRModuleDestroy(module);
+  EXPECT_EQ(context_counter.num_allocations,
+            context_counter.num_deallocations);
+  spvContextDestroy(context);
+}
+
+TEST(Optimizer, InMemoryModuleRejectsInvalidBinary) {
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_0);
+  std::vector<uint32_t> binary;
+  tools.Assemble(Header() + "%int = OpTypeInt 32 2", &binary);
+
+  spv_context context = spvContextCreate(SPV_ENV_UNIVERSAL_1_0);
+  spv_validator_options validator_options = spvValidatorOptionsCreate();
+  spv_diagnostic diagnostic = nullptr;
+  spv_ir_module module = nullptr;
+  EXPECT_NE(SPV_SUCCESS,
+            spvIRModuleCreate(context, binary.data(), binary.size(),
+                              validator_options, &module, &diagnostic));
+  EXPECT_EQ(nullptr, module);
+  ASSERT_NE(nullptr, diagnostic);
+  EXPECT_THAT(diagnostic->error, ::testing::HasSubstr("signedness"));
+  spvDiagnosticDestroy(diagnostic);
+
+  // Without validation, the module is built all the same.
+  diagnostic = nullptr;
+  EXPECT_EQ(SPV_SUCCESS, spvIRModuleCreate(context, binary.data(),
+                                           binary.size(), nullptr, &module,
+                                           &diagnostic));
+  EXPECT_NE(nullptr, module);
+  spvIRModuleDestroy(module);
+  spvValidatorOptionsDestroy(validator_options);
+  spvContextDestroy(context);
+}
+
+TEST(Optimizer, CanRunConcurrently) {
+  const std::string text = R"(OpCapability Shader
+OpMemoryModel Logical GLSL450
+OpEntryPoint Fragment %main "main"
+OpExecutionMode %main OriginUpperLeft
+%void = OpTypeVoid
+%int = OpTypeInt 32 1
+%int_1 = OpConstant %int 1
+%_ptr_Function_int = OpTypePointer Function %int
+%void_fn = OpTypeFunction %void
+%main = OpFunction %void None %void_fn
+%entry = OpLabel
+%x = OpVariable %_ptr_Function_int Function
+OpStore %x %int_1
+%y = OpLoad %int %x
+%z = OpIAdd %int %y %y
+OpReturn
+OpFunctionEnd
+)";
+  SpirvTools tools(SPV_ENV_UNIVERSAL_1_3);
+  std::vector<uint32_t> binary;
+  ASSERT_TRUE(tools.Assemble(text, &binary));
+
+  Optimizer opt(SPV_ENV_UNIVERSAL_1_3);
+  opt.RegisterPerformancePasses();
+  std::vector<uint32_t> expected;
+  ASSERT_TRUE(opt.Run(binary.data(), binary.size(), &expected));
+  ASSERT_LT(expected.size(), binary.size());
+
+  std::vector<std::vector<uint32_t>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&opt, &binary, &result]() {
+      for (uint32_t i = 0; i < 10; i++) {
+        result.clear();
+        if (!opt.Run(binary.data(), binary.size(), &result)) {
+          return;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    EXPECT_EQ(expected, result);
+  }
+}
+
 TEST(Optimizer, CanValidateFlags) {
   Optimizer opt(SPV_ENV_UNIVERSAL_1_0);
   EXPECT_FALSE(opt.FlagHasValidForm("bad-flag"));
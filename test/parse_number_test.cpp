@@ -161,6 +161,32 @@ TEST(ParseWideUnsignedIntegers, Sample) {
   EXPECT_FALSE(ParseNumber("-1", &u64));
 }
 
+TEST(ParseIntegers, Prefixes) {
+  int32_t i32;
+
+  // Leading white space and a sign are allowed; trailing text is not.
+  EXPECT_TRUE(ParseNumber(" \t+12", &i32));
+  EXPECT_EQ(12, i32);
+  EXPECT_FALSE(ParseNumber("12 ", &i32));
+  EXPECT_FALSE(ParseNumber("- 12", &i32));
+  EXPECT_FALSE(ParseNumber("+-12", &i32));
+
+  // A leading zero makes the number octal.
+  EXPECT_TRUE(ParseNumber("010", &i32));
+  EXPECT_EQ(8, i32);
+  EXPECT_FALSE(ParseNumber("08", &i32));
+
+  EXPECT_TRUE(ParseNumber("-0X1F", &i32));
+  EXPECT_EQ(-31, i32);
+  EXPECT_FALSE(ParseNumber("0x", &i32));
+  EXPECT_FALSE(ParseNumber("0x-1", &i32));
+
+  // A negative number does not wrap around for an unsigned type, even after
+  // white space.
+  uint32_t u32;
+  EXPECT_FALSE(ParseNumber(" -5", &u32));
+}
+
 TEST(ParseFloat, Sample) {
   float f;
 
@@ -965,6 +991,27 @@ TEST(ParseAndEncodeNumber, Sample) {
   EXPECT_EQ(EncodeNumberStatus::kSuccess, rc);
 }
 
+TEST(FormatInteger, Sample) {
+  char buffer[kMaxFormattedIntegerSize];
+  auto format = [&buffer](uint64_t value) {
+    return std::string(buffer, FormatInteger(value, buffer));
+  };
+  auto format_signed = [&buffer](int64_t value) {
+    return std::string(buffer, FormatInteger(value, buffer));
+  };
+
+  EXPECT_EQ("0", format(0));
+  EXPECT_EQ("1000", format(1000));
+  EXPECT_EQ("18446744073709551615",
+            format(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ("0", format_signed(0));
+  EXPECT_EQ("-1", format_signed(-1));
+  EXPECT_EQ("9223372036854775807",
+            format_signed(std::numeric_limits<int64_t>::max()));
+  EXPECT_EQ("-9223372036854775808",
+            format_signed(std::numeric_limits<int64_t>::min()));
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace spvtools
@@ -14,10 +14,12 @@
 
 #include "source/reduce/reducer.h"
 
+#include <iterator>
 #include <unordered_map>
 
 #include "source/opt/build_module.h"
 #include "source/reduce/operand_to_const_reduction_opportunity_finder.h"
+#include "source/reduce/remove_function_reduction_opportunity_finder.h"
 #include "source/reduce/remove_unused_instruction_reduction_opportunity_finder.h"
 #include "test/reduce/reduce_test_util.h"
 
@@ -558,6 +560,96 @@ TEST(ReducerTest, ShaderReduceWhileDivReachable) {
   ASSERT_EQ(status, Reducer::ReductionResultStatus::kComplete);
 }
 
+TEST(ReducerTest, FunctionLevelPassesRunBeforeInstructionLevelPasses) {
+  std::string original = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpConstant %6 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+          %8 = OpIAdd %6 %7 %7
+               OpReturn
+               OpFunctionEnd
+         %10 = OpFunction %2 None %3
+         %11 = OpLabel
+         %12 = OpIAdd %6 %7 %7
+         %13 = OpIMul %6 %12 %12
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  std::string expected = R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpConstant %6 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+               OpReturn
+               OpFunctionEnd
+  )";
+
+  // Records, for each reduction step, the number of functions in the module.
+  std::vector<size_t> function_counts;
+
+  Reducer reducer(kEnv);
+  reducer.SetMessageConsumer(kMessageConsumer);
+  reducer.SetInterestingnessFunction(
+      [&function_counts](const std::vector<uint32_t>& binary,
+                         uint32_t) -> bool {
+        std::unique_ptr<opt::IRContext> context = BuildModule(
+            kEnv, kMessageConsumer, binary.data(), binary.size());
+        assert(context != nullptr && "Failed to build module.");
+        function_counts.push_back(static_cast<size_t>(std::distance(
+            context->module()->begin(), context->module()->end())));
+        return true;
+      });
+  // The instruction-level pass is added first, but the function-level pass
+  // should nevertheless be tried first.
+  reducer.AddReductionPass(
+      MakeUnique<RemoveUnusedInstructionReductionOpportunityFinder>(false),
+      Reducer::PassLevel::kInstruction);
+  reducer.AddReductionPass(
+      MakeUnique<RemoveFunctionReductionOpportunityFinder>(),
+      Reducer::PassLevel::kFunction);
+
+  std::vector<uint32_t> binary_in;
+  SpirvTools t(kEnv);
+
+  ASSERT_TRUE(t.Assemble(original, &binary_in, kReduceAssembleOption));
+  std::vector<uint32_t> binary_out;
+  spvtools::ReducerOptions reducer_options;
+  reducer_options.set_step_limit(500);
+  reducer_options.set_fail_on_validation_error(true);
+  spvtools::ValidatorOptions validator_options;
+
+  Reducer::ReductionResultStatus status = reducer.Run(
+      std::move(binary_in), &binary_out, reducer_options, validator_options);
+
+  ASSERT_EQ(status, Reducer::ReductionResultStatus::kComplete);
+
+  // The initial check sees both functions; the first reduction step removes
+  // the unused function, so that its instructions are never considered
+  // individually.
+  ASSERT_LE(2, function_counts.size());
+  ASSERT_EQ(2, function_counts[0]);
+  ASSERT_EQ(1, function_counts[1]);
+
+  CheckEqual(kEnv, expected, binary_out);
+}
+
 // Computes an instruction count for each function in the module represented by
 // |binary|.
 std::unordered_map<uint32_t, uint32_t> GetFunctionInstructionCount(
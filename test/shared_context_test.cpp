@@ -0,0 +1,75 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "source/table.h"
+#include "test/unit_spirv.h"
+
+namespace spvtools {
+namespace {
+
+using SharedContextTest = ::testing::TestWithParam<spv_target_env>;
+using ::testing::ValuesIn;
+
+TEST_P(SharedContextTest, MatchesNewContext) {
+  spv_const_context shared_context = GetSharedContext(GetParam());
+  ASSERT_NE(nullptr, shared_context);
+  EXPECT_EQ(shared_context, GetSharedContext(GetParam()));
+
+  spv_context context = spvContextCreate(GetParam());
+  EXPECT_EQ(context->target_env, shared_context->target_env);
+  EXPECT_EQ(context->opcode_table, shared_context->opcode_table);
+  EXPECT_EQ(context->operand_table, shared_context->operand_table);
+  EXPECT_EQ(context->ext_inst_table, shared_context->ext_inst_table);
+  EXPECT_FALSE(shared_context->consumer);
+  spvContextDestroy(context);
+}
+
+TEST_P(SharedContextTest, ConcurrentRequests) {
+  const spv_target_env env = GetParam();
+  std::vector<spv_const_context> contexts(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < contexts.size(); i++) {
+    threads.emplace_back(
+        [&contexts, env, i]() { contexts[i] = GetSharedContext(env); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto context : contexts) {
+    EXPECT_EQ(GetSharedContext(env), context);
+  }
+}
+
+TEST(SharedContext, UnsupportedEnvironment) {
+  EXPECT_EQ(nullptr, GetSharedContext(SPV_ENV_WEBGPU_0));
+}
+
+TEST(SharedContext, InvalidEnvironment) {
+#ifndef NDEBUG
+  ASSERT_DEATH(GetSharedContext(static_cast<spv_target_env>(1000)),
+               "Invalid target environment value");
+#else
+  EXPECT_EQ(nullptr, GetSharedContext(static_cast<spv_target_env>(1000)));
+#endif
+}
+
+INSTANTIATE_TEST_SUITE_P(SharedContext, SharedContextTest,
+                         ValuesIn(spvtest::AllTargetEnvironments()));
+
+}  // namespace
+}  // namespace spvtools
@@ -137,6 +137,35 @@ TEST(MockCumulativeTimer, DoNothing) {
   if (ctimer) delete ctimer;
 }
 
+// This unit test checks that nested trace scopes are written as complete
+// events of a Chrome trace, and that scopes outside of a trace are not.
+TEST(TraceScope, WritesNestedEvents) {
+  std::ostringstream buf;
+  { SPIRV_TRACE_SCOPE("Untraced"); }
+
+  StartTrace(&buf);
+  EXPECT_TRUE(IsTracing());
+  {
+    SPIRV_TRACE_SCOPE("Outer");
+    { SPIRV_TRACE_SCOPE("Inner \"quoted\""); }
+  }
+  StopTrace();
+  EXPECT_FALSE(IsTracing());
+  { SPIRV_TRACE_SCOPE("AfterTrace"); }
+
+  const std::string trace = buf.str();
+  EXPECT_EQ(0u, trace.find("{\"traceEvents\":[\n{\"name\":\"Inner \\\"quoted"))
+      << trace;
+  EXPECT_NE(std::string::npos, trace.find(",\n{\"name\":\"Outer\",\"cat\":"
+                                          "\"spirv\",\"ph\":\"X\",\"ts\":"))
+      << trace;
+  EXPECT_NE(std::string::npos, trace.find("\"allocations\":0,"));
+  EXPECT_EQ(std::string::npos, trace.find("Untraced"));
+  EXPECT_EQ(std::string::npos, trace.find("AfterTrace"));
+  EXPECT_EQ("\n],\"displayTimeUnit\":\"ms\"}\n",
+            trace.substr(trace.rfind('\n', trace.size() - 2)));
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace spvtools
@@ -0,0 +1,157 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/util/allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "gmock/gmock.h"
+
+namespace spvtools {
+namespace utils {
+namespace {
+
+// Counts the allocations and deallocations made through it.
+struct CountingAllocator {
+  CountingAllocator() : allocator{Allocate, Deallocate, this} {}
+
+  static void* Allocate(void* user_data, size_t size) {
+    auto* counter = static_cast<CountingAllocator*>(user_data);
+    counter->num_allocations++;
+    counter->last_allocated_size = size;
+    return std::malloc(size);
+  }
+
+  static void Deallocate(void* user_data, void* ptr, size_t size) {
+    auto* counter = static_cast<CountingAllocator*>(user_data);
+    counter->num_deallocations++;
+    counter->last_deallocated_size = size;
+    std::free(ptr);
+  }
+
+  spv_allocator_t allocator;
+  int num_allocations = 0;
+  int num_deallocations = 0;
+  size_t last_allocated_size = 0;
+  size_t last_deallocated_size = 0;
+};
+
+TEST(AllocatorTest, UsesGlobalNewWithoutAllocator) {
+  void* ptr = utils::Allocate(16);
+  ASSERT_NE(nullptr, ptr);
+  utils::Deallocate(ptr, 16);
+  utils::Deallocate(nullptr, 0);
+
+  ptr = utils::AllocateTagged(16);
+  ASSERT_NE(nullptr, ptr);
+  utils::DeallocateTagged(ptr);
+  utils::DeallocateTagged(nullptr);
+}
+
+TEST(AllocatorTest, UsesCurrentAllocator) {
+  CountingAllocator counter;
+  ScopedAllocator scoped_allocator(&counter.allocator);
+  void* ptr = utils::Allocate(24);
+  EXPECT_EQ(1, counter.num_allocations);
+  EXPECT_EQ(0, counter.num_deallocations);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % alignof(std::max_align_t));
+
+  utils::Deallocate(ptr, 24);
+  EXPECT_EQ(1, counter.num_allocations);
+  EXPECT_EQ(1, counter.num_deallocations);
+
+  // The client sees exactly the size that was requested.
+  EXPECT_EQ(24u, counter.last_allocated_size);
+  EXPECT_EQ(24u, counter.last_deallocated_size);
+}
+
+TEST(AllocatorTest, TaggedMemoryGoesBackToItsAllocator) {
+  CountingAllocator counter;
+  void* client_ptr = nullptr;
+  {
+    ScopedAllocator scoped_allocator(&counter.allocator);
+    client_ptr = utils::AllocateTagged(24);
+  }
+  EXPECT_EQ(1, counter.num_allocations);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(client_ptr) %
+                    alignof(std::max_align_t));
+
+  // Global memory is freed as such while client memory is live, and client
+  // memory is freed through its allocator with none in scope.
+  utils::DeallocateTagged(utils::AllocateTagged(8));
+  EXPECT_EQ(0, counter.num_deallocations);
+  utils::DeallocateTagged(client_ptr);
+  EXPECT_EQ(1, counter.num_deallocations);
+
+  // The client is asked for the header too, and given the same size back.
+  EXPECT_GT(counter.last_allocated_size, 24u);
+  EXPECT_EQ(counter.last_allocated_size, counter.last_deallocated_size);
+}
+
+TEST(AllocatorTest, RestoresPreviousAllocator) {
+  CountingAllocator outer;
+  CountingAllocator inner;
+  ScopedAllocator scoped_outer(&outer.allocator);
+  {
+    ScopedAllocator scoped_inner(&inner.allocator);
+    utils::Deallocate(utils::Allocate(8), 8);
+    {
+      ScopedAllocator scoped_global(nullptr);
+      utils::Deallocate(utils::Allocate(8), 8);
+    }
+  }
+  utils::Deallocate(utils::Allocate(8), 8);
+  EXPECT_EQ(1, outer.num_allocations);
+  EXPECT_EQ(1, inner.num_allocations);
+  EXPECT_EQ(1, outer.num_deallocations);
+  EXPECT_EQ(1, inner.num_deallocations);
+}
+
+TEST(AllocatorTest, AllowsAllocatorWithoutDeallocate) {
+  alignas(std::max_align_t) static char arena[256];
+  static size_t used = 0;
+  spv_allocator_t bump = {[](void*, size_t size) -> void* {
+                            void* ptr = arena + used;
+                            const size_t align = alignof(std::max_align_t);
+                            used += (size + align - 1) / align * align;
+                            return ptr;
+                          },
+                          nullptr, nullptr};
+  ScopedAllocator scoped_allocator(&bump);
+  void* ptr = utils::Allocate(8);
+  EXPECT_GT(used, 0u);
+  utils::Deallocate(ptr, 8);
+  utils::DeallocateTagged(utils::AllocateTagged(8));
+}
+
+TEST(AllocatorTest, CountsAllocationsOfThread) {
+  const AllocationStats before = GetThreadAllocationStats();
+  void* ptr1 = utils::Allocate(16);
+  CountingAllocator counter;
+  {
+    ScopedAllocator scoped_allocator(&counter.allocator);
+    utils::Deallocate(utils::Allocate(24), 24);
+    utils::DeallocateTagged(utils::AllocateTagged(8));
+  }
+  utils::Deallocate(ptr1, 16);
+  const AllocationStats after = GetThreadAllocationStats();
+  EXPECT_EQ(3u, after.count - before.count);
+  EXPECT_EQ(48u, after.bytes - before.bytes);
+}
+
+}  // namespace
+}  // namespace utils
+}  // namespace spvtools
@@ -159,6 +159,85 @@ TEST(BitVectorTest, SubsetOrTest) {
   EXPECT_FALSE(bvec1.Or(bvec2));
 }
 
+TEST(BitVectorTest, AndTest) {
+  BitVector bvec1;
+  bvec1.Set(3);
+  bvec1.Set(4);
+  bvec1.Set(10000);
+
+  BitVector bvec2;
+  bvec2.Set(2);
+  bvec2.Set(4);
+
+  // The bits past the end of |bvec2| are cleared.
+  EXPECT_TRUE(bvec1.And(bvec2));
+  EXPECT_FALSE(bvec1.Get(2));
+  EXPECT_FALSE(bvec1.Get(3));
+  EXPECT_TRUE(bvec1.Get(4));
+  EXPECT_FALSE(bvec1.Get(10000));
+
+  // |And| returns false if |bvec1| does not change.
+  EXPECT_FALSE(bvec1.And(bvec2));
+}
+
+TEST(BitVectorTest, AndNotTest) {
+  BitVector bvec1;
+  bvec1.Set(3);
+  bvec1.Set(4);
+  bvec1.Set(10000);
+
+  BitVector bvec2;
+  bvec2.Set(4);
+  bvec2.Set(5);
+
+  EXPECT_TRUE(bvec1.AndNot(bvec2));
+  EXPECT_TRUE(bvec1.Get(3));
+  EXPECT_FALSE(bvec1.Get(4));
+  EXPECT_FALSE(bvec1.Get(5));
+  EXPECT_TRUE(bvec1.Get(10000));
+  EXPECT_FALSE(bvec1.AndNot(bvec2));
+  EXPECT_FALSE(bvec1.Intersects(bvec2));
+  bvec2.Set(10000);
+  EXPECT_TRUE(bvec1.Intersects(bvec2));
+}
+
+TEST(BitVectorTest, CountAndIterate) {
+  BitVector bvec;
+  std::vector<uint32_t> expected = {0, 3, 63, 64, 200, 4095};
+  for (uint32_t i : expected) {
+    bvec.Set(i);
+  }
+  EXPECT_EQ(expected.size(), bvec.Count());
+
+  std::vector<uint32_t> visited;
+  bvec.ForEachSetBit([&visited](uint32_t i) { visited.push_back(i); });
+  EXPECT_EQ(expected, visited);
+
+  visited.clear();
+  for (uint32_t i = 0; bvec.FindNextSet(i, &i); ++i) {
+    visited.push_back(i);
+  }
+  EXPECT_EQ(expected, visited);
+  uint32_t next = 0;
+  EXPECT_FALSE(bvec.FindNextSet(4096, &next));
+
+  bvec.ClearAll();
+  EXPECT_TRUE(bvec.Empty());
+  EXPECT_EQ(0u, bvec.Count());
+}
+
+TEST(BitVectorTest, EqualityIgnoresStorageSize) {
+  BitVector bvec1(64);
+  BitVector bvec2(10000);
+  EXPECT_TRUE(bvec1 == bvec2);
+  bvec1.Set(5);
+  EXPECT_TRUE(bvec1 != bvec2);
+  bvec2.Set(5);
+  EXPECT_TRUE(bvec1 == bvec2);
+  bvec2.Set(9000);
+  EXPECT_TRUE(bvec1 != bvec2);
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace spvtools
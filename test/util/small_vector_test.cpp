@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -593,6 +594,69 @@ TEST(SmallVectorTest, Resize6) {
   EXPECT_EQ(vec, result);
 }
 
+TEST(SmallVectorTest, MoveTakesLargeData) {
+  SmallVector<uint32_t, 2> vec1 = {0, 1, 2, 3};
+  const uint32_t* data = vec1.data();
+
+  SmallVector<uint32_t, 2> vec2(std::move(vec1));
+  EXPECT_EQ(data, vec2.data());
+  EXPECT_TRUE(vec1.empty());
+
+  SmallVector<uint32_t, 2> vec3 = {5};
+  vec3 = std::move(vec2);
+  EXPECT_EQ(data, vec3.data());
+  EXPECT_TRUE(vec2.empty());
+  EXPECT_EQ(vec3, std::vector<uint32_t>({0, 1, 2, 3}));
+
+  // The moved-from vectors can be used again.
+  vec1.push_back(7);
+  vec2.push_back(8);
+  EXPECT_EQ(vec1, std::vector<uint32_t>({7}));
+  EXPECT_EQ(vec2, std::vector<uint32_t>({8}));
+}
+
+TEST(SmallVectorTest, PushBackOwnElement) {
+  SmallVector<uint32_t, 2> vec = {1, 2};
+  vec.push_back(vec[0]);
+  vec.push_back(vec[2]);
+  vec.push_back(vec.back());
+  EXPECT_EQ(vec, std::vector<uint32_t>({1, 2, 1, 1, 1}));
+}
+
+TEST(SmallVectorTest, Reserve) {
+  SmallVector<uint32_t, 2> vec = {1};
+  EXPECT_EQ(vec.capacity(), 2);
+  vec.reserve(10);
+  EXPECT_EQ(vec.capacity(), 10);
+  const uint32_t* data = vec.data();
+  for (uint32_t i = 2; i <= 10; ++i) {
+    vec.push_back(i);
+  }
+  EXPECT_EQ(data, vec.data());
+  EXPECT_EQ(vec.size(), 10);
+  EXPECT_EQ(vec.back(), 10);
+}
+
+TEST(SmallVectorTest, SizeOfOperandWords) {
+  // The words of each operand are a SmallVector<uint32_t, 2>: a pointer, the
+  // size and capacity, and the two inline words.
+  EXPECT_EQ(sizeof(SmallVector<uint32_t, 2>),
+            sizeof(uint32_t*) + 4 * sizeof(uint32_t));
+}
+
+TEST(SmallVectorTest, MoveDoesNotThrow) {
+  // A std::vector of SmallVectors moves them when it grows only if moving
+  // cannot throw; otherwise it copies them, along with their heap buffers.
+  using OperandWords = SmallVector<uint32_t, 2>;
+  EXPECT_TRUE(std::is_nothrow_move_constructible<OperandWords>::value);
+  EXPECT_TRUE(std::is_nothrow_move_assignable<OperandWords>::value);
+
+  std::vector<OperandWords> vecs(1, {1, 2, 3});
+  const uint32_t* data = vecs[0].data();
+  vecs.reserve(vecs.capacity() + 1);
+  EXPECT_EQ(data, vecs[0].data());
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace spvtools
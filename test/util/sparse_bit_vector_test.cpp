@@ -0,0 +1,104 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/util/sparse_bit_vector.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+
+namespace spvtools {
+namespace utils {
+namespace {
+
+TEST(SparseBitVectorTest, SetGetClear) {
+  SparseBitVector bvec;
+  EXPECT_TRUE(bvec.Empty());
+
+  EXPECT_FALSE(bvec.Set(5));
+  EXPECT_FALSE(bvec.Set(1000000));
+  EXPECT_FALSE(bvec.Set(0xFFFFFFFF));
+  EXPECT_TRUE(bvec.Set(5));
+  EXPECT_FALSE(bvec.Empty());
+
+  EXPECT_TRUE(bvec.Get(5));
+  EXPECT_TRUE(bvec.Get(1000000));
+  EXPECT_TRUE(bvec.Get(0xFFFFFFFF));
+  EXPECT_FALSE(bvec.Get(6));
+  EXPECT_FALSE(bvec.Get(999999));
+  EXPECT_EQ(3u, bvec.Count());
+
+  EXPECT_TRUE(bvec.Clear(1000000));
+  EXPECT_FALSE(bvec.Clear(1000000));
+  EXPECT_FALSE(bvec.Get(1000000));
+  EXPECT_EQ(2u, bvec.Count());
+
+  bvec.ClearAll();
+  EXPECT_TRUE(bvec.Empty());
+}
+
+TEST(SparseBitVectorTest, IteratesInOrder) {
+  SparseBitVector bvec;
+  std::vector<uint32_t> expected = {1, 64, 127, 128, 70000, 4000000000u};
+  for (auto it = expected.rbegin(); it != expected.rend(); ++it) {
+    bvec.Set(*it);
+  }
+
+  std::vector<uint32_t> visited;
+  bvec.ForEachSetBit([&visited](uint32_t i) { visited.push_back(i); });
+  EXPECT_EQ(expected, visited);
+}
+
+TEST(SparseBitVectorTest, SetOperations) {
+  SparseBitVector bvec1;
+  bvec1.Set(3);
+  bvec1.Set(500);
+  bvec1.Set(100000);
+
+  SparseBitVector bvec2;
+  bvec2.Set(3);
+  bvec2.Set(501);
+  bvec2.Set(200000);
+
+  SparseBitVector union_vec = bvec1;
+  EXPECT_TRUE(union_vec.Or(bvec2));
+  EXPECT_FALSE(union_vec.Or(bvec2));
+  EXPECT_EQ(5u, union_vec.Count());
+
+  SparseBitVector intersection = bvec1;
+  EXPECT_TRUE(intersection.And(bvec2));
+  EXPECT_FALSE(intersection.And(bvec2));
+  EXPECT_EQ(1u, intersection.Count());
+  EXPECT_TRUE(intersection.Get(3));
+
+  SparseBitVector difference = bvec1;
+  EXPECT_TRUE(difference.AndNot(bvec2));
+  EXPECT_FALSE(difference.AndNot(bvec2));
+  EXPECT_EQ(2u, difference.Count());
+  EXPECT_TRUE(difference.Get(500));
+  EXPECT_TRUE(difference.Get(100000));
+
+  EXPECT_TRUE(bvec1.Intersects(bvec2));
+  EXPECT_FALSE(difference.Intersects(bvec2));
+
+  // Clearing the bits that were added gives back the original set.
+  EXPECT_TRUE(union_vec.Clear(501));
+  EXPECT_TRUE(union_vec.Clear(200000));
+  EXPECT_TRUE(union_vec == bvec1);
+  EXPECT_TRUE(union_vec != bvec2);
+}
+
+}  // namespace
+}  // namespace utils
+}  // namespace spvtools
@@ -17,6 +17,7 @@
 #include <vector>
 
 #include "source/spirv_target_env.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.h"
 #include "tools/io.h"
 
@@ -51,6 +52,7 @@ Options:
 static const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_5;
 
 int main(int argc, char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   const char* inFile = nullptr;
   const char* outFile = nullptr;
   uint32_t options = 0;
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of setting up the contexts that the library needs before
+// it can process a module, which is significant when many tiny modules are
+// processed.  Each operation is repeated a fixed number of times, and the
+// average time it takes is printed.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "source/opt/build_module.h"
+#include "source/opt/ir_context.h"
+#include "source/table.h"
+#include "spirv-tools/libspirv.hpp"
+
+namespace {
+
+const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_3;
+
+const uint32_t kDefaultNumIterations = 100000;
+
+// A tiny module, representative of the smallest shaders.
+const char* const kShader = R"(
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+               OpReturn
+               OpFunctionEnd
+)";
+
+void PrintUsage(const char* program) {
+  printf(
+      R"(%s - Measures the cost of setting up contexts.
+
+USAGE: %s [options]
+
+Each operation is repeated, and the average time it takes is printed.
+
+  -h, --help
+               Print this help.
+  --iterations=
+               Unsigned 32-bit integer specifying the number of times each
+               operation is repeated.  The default is %u.
+)",
+      program, program, kDefaultNumIterations);
+}
+
+// Runs |operation| |num_iterations| times and prints the average time it
+// takes, labelled with |name|.
+void Measure(const char* name, uint32_t num_iterations,
+             const std::function<void()>& operation) {
+  const auto start_time = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    operation();
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start_time;
+  printf("%-40s %12.1f ns\n", name, elapsed.count() / num_iterations);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  uint32_t num_iterations = kDefaultNumIterations;
+  for (int argi = 1; argi < argc; ++argi) {
+    const char* cur_arg = argv[argi];
+    if (0 == strcmp(cur_arg, "--help") || 0 == strcmp(cur_arg, "-h")) {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if (0 == strncmp(cur_arg, "--iterations=",
+                            sizeof("--iterations=") - 1)) {
+      num_iterations = static_cast<uint32_t>(
+          strtoul(cur_arg + sizeof("--iterations=") - 1, nullptr, 10));
+    } else {
+      fprintf(stderr, "error: unrecognized argument: %s\n", cur_arg);
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (num_iterations == 0) {
+    fprintf(stderr, "error: the number of iterations must be positive\n");
+    return 1;
+  }
+
+  const auto env = kDefaultEnvironment;
+  std::vector<uint32_t> binary;
+  if (!spvtools::SpirvTools(env).Assemble(kShader, &binary)) {
+    fprintf(stderr, "error: invalid shader in the benchmark\n");
+    return 1;
+  }
+
+  Measure("spvContextCreate/spvContextDestroy", num_iterations,
+          [env]() { spvContextDestroy(spvContextCreate(env)); });
+  Measure("GetSharedContext", num_iterations, [env]() {
+    if (spvtools::GetSharedContext(env) == nullptr) abort();
+  });
+  Measure("SpirvTools construction", num_iterations,
+          [env]() { spvtools::SpirvTools tools(env); });
+  Measure("IRContext construction", num_iterations,
+          [env]() { spvtools::opt::IRContext context(env, nullptr); });
+  Measure("SpirvTools construction and Validate", num_iterations,
+          [env, &binary]() {
+            if (!spvtools::SpirvTools(env).Validate(binary)) abort();
+          });
+  Measure("BuildModule", num_iterations, [env, &binary]() {
+    if (!spvtools::BuildModule(env, nullptr, binary.data(), binary.size())) {
+      abort();
+    }
+  });
+  return 0;
+}
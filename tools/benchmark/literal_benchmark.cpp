@@ -0,0 +1,184 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of handling numeric literals, by assembling and
+// disassembling a module made of a large table of constants, and by parsing
+// and formatting the literals on their own.  Each operation is repeated a
+// fixed number of times, and the average time it takes is printed.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "source/util/parse_number.h"
+#include "spirv-tools/libspirv.hpp"
+
+namespace {
+
+const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_3;
+
+const uint32_t kDefaultNumIterations = 20;
+
+const uint32_t kDefaultNumConstants = 10000;
+
+void PrintUsage(const char* program) {
+  printf(
+      R"(%s - Measures the cost of handling numeric literals.
+
+USAGE: %s [options]
+
+Each operation is repeated, and the average time it takes is printed.
+
+  -h, --help
+               Print this help.
+  --constants=
+               Unsigned 32-bit integer specifying the number of constants of
+               each type in the module.  The default is %u.
+  --iterations=
+               Unsigned 32-bit integer specifying the number of times each
+               operation is repeated.  The default is %u.
+)",
+      program, program, kDefaultNumConstants, kDefaultNumIterations);
+}
+
+// Runs |operation| |num_iterations| times and prints the average time it
+// takes, labelled with |name|.
+void Measure(const char* name, uint32_t num_iterations,
+             const std::function<void()>& operation) {
+  const auto start_time = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    operation();
+  }
+  const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start_time;
+  printf("%-40s %12.1f us\n", name, elapsed.count() / num_iterations);
+}
+
+// Returns the literals of |num_constants| constants of each of the types
+// declared by kTypes, in the order of the types.
+std::vector<std::string> MakeLiterals(uint32_t num_constants) {
+  std::vector<std::string> literals;
+  for (uint32_t i = 0; i < num_constants; i++) {
+    literals.push_back(std::to_string(int32_t(i * 2654435761u)));
+    literals.push_back(std::to_string(i * 40503u));
+    literals.push_back(std::to_string(int64_t(i) * -6700417));
+    literals.push_back(std::to_string(i) + ".5");
+    literals.push_back("0x1.8p" + std::to_string(i % 64));
+  }
+  return literals;
+}
+
+// The types of the constants, by the name of their id.
+const char* const kTypes[] = {"int", "uint", "long", "float", "double"};
+
+// Returns a module declaring a constant for each of |literals|.
+std::string MakeModule(const std::vector<std::string>& literals) {
+  std::string text =
+      "OpCapability Shader\n"
+      "OpCapability Int64\n"
+      "OpCapability Float64\n"
+      "OpMemoryModel Logical GLSL450\n"
+      "%int = OpTypeInt 32 1\n"
+      "%uint = OpTypeInt 32 0\n"
+      "%long = OpTypeInt 64 1\n"
+      "%float = OpTypeFloat 32\n"
+      "%double = OpTypeFloat 64\n";
+  const size_t num_types = sizeof(kTypes) / sizeof(kTypes[0]);
+  for (size_t i = 0; i < literals.size(); i++) {
+    text += "%c" + std::to_string(i) + " = OpConstant %" +
+            kTypes[i % num_types] + " " + literals[i] + "\n";
+  }
+  return text;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  uint32_t num_iterations = kDefaultNumIterations;
+  uint32_t num_constants = kDefaultNumConstants;
+  for (int argi = 1; argi < argc; ++argi) {
+    const char* cur_arg = argv[argi];
+    if (0 == strcmp(cur_arg, "--help") || 0 == strcmp(cur_arg, "-h")) {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if (0 == strncmp(cur_arg, "--constants=",
+                            sizeof("--constants=") - 1)) {
+      num_constants = static_cast<uint32_t>(
+          strtoul(cur_arg + sizeof("--constants=") - 1, nullptr, 10));
+    } else if (0 == strncmp(cur_arg, "--iterations=",
+                            sizeof("--iterations=") - 1)) {
+      num_iterations = static_cast<uint32_t>(
+          strtoul(cur_arg + sizeof("--iterations=") - 1, nullptr, 10));
+    } else {
+      fprintf(stderr, "error: unrecognized argument: %s\n", cur_arg);
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (num_iterations == 0) {
+    fprintf(stderr, "error: the number of iterations must be positive\n");
+    return 1;
+  }
+
+  const auto env = kDefaultEnvironment;
+  const std::vector<std::string> literals = MakeLiterals(num_constants);
+  const std::string text = MakeModule(literals);
+  spvtools::SpirvTools tools(env);
+  std::vector<uint32_t> binary;
+  if (!tools.Assemble(text, &binary)) {
+    fprintf(stderr, "error: invalid module in the benchmark\n");
+    return 1;
+  }
+
+  Measure("Assemble", num_iterations, [&tools, &text]() {
+    std::vector<uint32_t> assembled;
+    if (!tools.Assemble(text, &assembled)) abort();
+  });
+  Measure("Disassemble", num_iterations, [&tools, &binary]() {
+    std::string disassembled;
+    if (!tools.Disassemble(binary, &disassembled)) abort();
+  });
+
+  const size_t num_types = sizeof(kTypes) / sizeof(kTypes[0]);
+  const spvtools::utils::NumberType number_types[] = {
+      {32, SPV_NUMBER_SIGNED_INT},
+      {32, SPV_NUMBER_UNSIGNED_INT},
+      {64, SPV_NUMBER_SIGNED_INT},
+      {32, SPV_NUMBER_FLOATING},
+      {64, SPV_NUMBER_FLOATING}};
+  Measure("ParseAndEncodeNumber", num_iterations,
+          [&literals, &number_types, num_types]() {
+            for (size_t i = 0; i < literals.size(); i++) {
+              if (spvtools::utils::ParseAndEncodeNumber(
+                      literals[i].c_str(), number_types[i % num_types],
+                      [](uint32_t) {}, nullptr) !=
+                  spvtools::utils::EncodeNumberStatus::kSuccess) {
+                abort();
+              }
+            }
+          });
+  Measure("FormatInteger", num_iterations, [&binary]() {
+    char buffer[spvtools::utils::kMaxFormattedIntegerSize];
+    size_t total_size = 0;
+    for (uint32_t word : binary) {
+      total_size += spvtools::utils::FormatInteger(uint64_t(word), buffer);
+    }
+    if (total_size == 0) abort();
+  });
+  return 0;
+}
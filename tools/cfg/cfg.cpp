@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.h"
 #include "tools/cfg/bin_to_dot.h"
 #include "tools/io.h"
@@ -47,6 +48,7 @@ Options:
 static const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_5;
 
 int main(int argc, char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   const char* inFile = nullptr;
   const char* outFile = nullptr;  // Stays nullptr if printing to stdout.
 
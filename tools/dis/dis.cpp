@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.h"
 #include "tools/io.h"
 
@@ -65,6 +66,7 @@ Options:
 static const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_5;
 
 int main(int argc, char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   const char* inFile = nullptr;
   const char* outFile = nullptr;
 
@@ -12,17 +12,30 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "source/fuzz/coverage_guided_corpus.h"
+#include "source/fuzz/donor_module_cache.h"
 #include "source/fuzz/force_render_red.h"
 #include "source/fuzz/fuzzer.h"
+#include "source/fuzz/fuzzer_pass_profiler.h"
 #include "source/fuzz/fuzzer_util.h"
 #include "source/fuzz/protobufs/spirvfuzz_protobufs.h"
 #include "source/fuzz/pseudo_random_generator.h"
@@ -34,6 +47,7 @@
 #include "source/spirv_fuzzer_options.h"
 #include "source/util/make_unique.h"
 #include "source/util/string_utils.h"
+#include "source/util/timer.h"
 #include "tools/io.h"
 #include "tools/util/cli_consumer.h"
 
@@ -61,9 +75,13 @@ bool ExecuteCommand(const std::string& command) {
 
 // Status and actions to perform after parsing command-line arguments.
 enum class FuzzActions {
+  CAMPAIGN,  // Run many independent fuzzer instances on a corpus of shaders
+             // concurrently.
   FORCE_RENDER_RED,  // Turn the shader into a form such that it is guaranteed
                      // to render a red image.
   FUZZ,    // Run the fuzzer to apply transformations in a randomized fashion.
+  GUIDED,  // Repeatedly fuzz a shader, guided by the coverage that the
+           // variants achieve in a target.
   REPLAY,  // Replay an existing sequence of transformations.
   SHRINK,  // Shrink an existing sequence of transformations with respect to an
            // interestingness function.
@@ -75,6 +93,32 @@ struct FuzzStatus {
   int code;
 };
 
+// Options that control campaign mode.
+struct CampaignOptions {
+  // File specifying the reference shaders to be fuzzed, one per line.  Campaign
+  // mode is used if and only if this is not empty.
+  std::string shaders_file;
+
+  // The number of fuzzer instances to run concurrently.
+  uint32_t num_threads = 1;
+
+  // No new fuzzer runs are started once this number of seconds has elapsed.
+  uint32_t time_budget_seconds = 60;
+};
+
+// Options that control guided mode.
+struct GuidedOptions {
+  // Command that runs the target on a variant, whose path is appended as a
+  // final argument.  Guided mode is used if and only if this is not empty.
+  std::string target_command;
+
+  // File to which the target writes its coverage bitmap.
+  std::string coverage_map_file;
+
+  // No new fuzzer runs are started once this number of seconds has elapsed.
+  uint32_t time_budget_seconds = 60;
+};
+
 void PrintUsage(const char* program) {
   // NOTE: Please maintain flags in lexicographical order.
   printf(
@@ -84,6 +128,10 @@ USAGE: %s [options] <input.spv> -o <output.spv> \
   --donors=<donors.txt>
 USAGE: %s [options] <input.spv> -o <output.spv> \
   --shrink=<input.transformations> -- <interestingness_test> [args...]
+USAGE: %s [options] --campaign=<shaders.txt> -o <output_prefix> \
+  --donors=<donors.txt>
+USAGE: %s [options] <input.spv> -o <output_prefix> --donors=<donors.txt> \
+  --guided-target=<command> --coverage-map=<coverage.map>
 
 The SPIR-V binary is read from <input.spv>.  If <input.facts> is also present,
 facts about the SPIR-V binary are read from this file.
@@ -100,12 +148,58 @@ the script as an argument after any other provided arguments [args...].  The
 positional arguments and thus will be forwarded to the interestingness script,
 and not parsed by %s.
 
+When passing --campaign=<shaders.txt>, no input binary is given.  Instead, the
+reference shaders listed in <shaders.txt> (each with an optional facts file)
+are fuzzed repeatedly by independent fuzzer instances running on multiple
+threads, each with a distinct seed, until the time budget is exhausted.
+Distinct variants are written to <output_prefix>_<n>.spv, together with their
+transformations; duplicate variants are discarded.  A line recording the
+reference shader and seed of each variant is printed, followed by a summary
+of the throughput of the campaign.
+
+When passing --guided-target=<command>, <input.spv> is fuzzed repeatedly, in
+the manner of a coverage-guided fuzzer such as AFL, until the time budget is
+exhausted.  Each variant is written to <output_prefix>_current.spv and the
+target <command> is run with the path of the variant appended as its final
+argument.  The target must write a coverage bitmap to <coverage.map>: one byte
+per edge of the target, giving the number of times the edge was hit.  Variants
+that reach new edges, or hit known edges a new number of times, are kept in a
+queue, written to <output_prefix>_queue_<n>.spv together with their
+transformations relative to <input.spv>, and are themselves fuzzed further;
+the variants that found the most new coverage are fuzzed most often, and the
+fuzzer passes that produced a variant are favoured when fuzzing it.  Variants
+for which the target exits with a non-zero status are written to
+<output_prefix>_crash_<n>.spv.
+
+Whenever a module is fuzzed, fuzzing stops once it reaches 100000 instructions
+or an id bound of 50000.  As the module approaches either limit, fuzzer passes
+that grow it are applied less and less often.
+
 NOTE: The fuzzer is a work in progress.
 
 Options (in lexicographical order):
 
   -h, --help
                Print this help.
+  --campaign=
+               File specifying a series of reference shaders, one per line, to
+               be fuzzed in campaign mode.  Requires -o, which gives the prefix
+               of the output files, and --donors.  Incompatible with
+               --force-render-red, replay and shrink modes.
+  --campaign-threads=
+               Unsigned 32-bit integer specifying the number of fuzzer
+               instances that run concurrently in campaign mode.  The default
+               is the number of hardware threads.  Ignored unless --campaign is
+               used.
+  --campaign-time-budget=
+               Unsigned 32-bit integer specifying the number of seconds after
+               which no new fuzzer runs are started in campaign mode; runs in
+               progress are allowed to complete.  The default is 60.  Ignored
+               unless --campaign is used.
+  --coverage-map=
+               File to which the target writes its coverage bitmap in guided
+               mode.  Required by, and ignored unless, --guided-target is
+               used.
   --donors=
                File specifying a series of donor files, one per line.  Must be
                provided if the tool is invoked in fuzzing mode; incompatible
@@ -126,10 +220,26 @@ Options (in lexicographical order):
                facts to make the guard non-obviously false.  This option is a
                helper for massaging crash-inducing tests into a runnable
                format; it does not perform any fuzzing.
+  --fuzzer-pass-profile=
+               File to which a JSON report of the cost of each fuzzer pass is
+               written: the time it took, the number of transformations it
+               applied and how much it grew the module, both per invocation
+               and aggregated per pass.  Ignored unless a single binary is
+               being fuzzed.
   --fuzzer-pass-validation
                Run the validator after applying each fuzzer pass during
                fuzzing.  Aborts fuzzing early if an invalid binary is created.
                Useful for debugging spirv-fuzz.
+  --guided-target=
+               Command that runs an instrumented target on a variant, for
+               coverage-guided fuzzing of the input binary.  Requires -o,
+               which gives the prefix of the output files, --coverage-map and
+               --donors.  Incompatible with --force-render-red, replay and
+               shrink modes.
+  --guided-time-budget=
+               Unsigned 32-bit integer specifying the number of seconds after
+               which no new fuzzer runs are started in guided mode.  The
+               default is 60.  Ignored unless --guided-target is used.
   --repeated-pass-strategy=
                Available strategies are:
                - looped (the default): a sequence of fuzzer passes is chosen at
@@ -174,6 +284,12 @@ Options (in lexicographical order):
                Unsigned 32-bit integer specifying maximum number of steps the
                shrinker will take before giving up.  Ignored unless --shrink
                is used.
+  --shrinker-threads=
+               Unsigned 32-bit integer specifying the number of threads the
+               shrinker uses to try removing chunks of transformations
+               concurrently; each thread runs its own replay and its own
+               instance of the interestingness test.  The default is 1.
+               Ignored unless --shrink is used.
   --shrinker-temp-file-prefix=
                Specifies a temporary file prefix that will be used to output
                temporary shader files during shrinking.  A number and .spv
@@ -191,7 +307,7 @@ Supported validator options are as follows. See `spirv-val --help` for details.
   --scalar-block-layout
   --skip-block-layout
 )",
-      program, program, program, program);
+      program, program, program, program, program, program);
 }
 
 // Message consumer for this tool.  Used to emit diagnostics during
@@ -211,9 +327,10 @@ FuzzStatus ParseFlags(
     std::string* replay_transformations_file,
     std::vector<std::string>* interestingness_test,
     std::string* shrink_transformations_file,
-    std::string* shrink_temp_file_prefix,
+    std::string* shrink_temp_file_prefix, std::string* fuzzer_pass_profile_file,
     spvtools::fuzz::RepeatedPassStrategy* repeated_pass_strategy,
-    FuzzingTarget* fuzzing_target, spvtools::FuzzerOptions* fuzzer_options,
+    FuzzingTarget* fuzzing_target, CampaignOptions* campaign_options,
+    GuidedOptions* guided_options, spvtools::FuzzerOptions* fuzzer_options,
     spvtools::ValidatorOptions* validator_options) {
   uint32_t positional_arg_index = 0;
   bool only_positional_arguments_remain = false;
@@ -239,6 +356,32 @@ FuzzStatus ParseFlags(
           PrintUsage(argv[0]);
           return {FuzzActions::STOP, 1};
         }
+      } else if (0 == strncmp(cur_arg, "--campaign=",
+                              sizeof("--campaign=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        campaign_options->shaders_file = std::string(split_flag.second);
+      } else if (0 == strncmp(cur_arg, "--campaign-threads=",
+                              sizeof("--campaign-threads=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        char* end = nullptr;
+        errno = 0;
+        const auto num_threads =
+            static_cast<uint32_t>(strtol(split_flag.second.c_str(), &end, 10));
+        assert(end != split_flag.second.c_str() && errno == 0);
+        campaign_options->num_threads = std::max(1u, num_threads);
+      } else if (0 == strncmp(cur_arg, "--campaign-time-budget=",
+                              sizeof("--campaign-time-budget=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        char* end = nullptr;
+        errno = 0;
+        const auto time_budget =
+            static_cast<uint32_t>(strtol(split_flag.second.c_str(), &end, 10));
+        assert(end != split_flag.second.c_str() && errno == 0);
+        campaign_options->time_budget_seconds = time_budget;
+      } else if (0 == strncmp(cur_arg, "--coverage-map=",
+                              sizeof("--coverage-map=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        guided_options->coverage_map_file = std::string(split_flag.second);
       } else if (0 == strncmp(cur_arg, "--donors=", sizeof("--donors=") - 1)) {
         const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
         *donors_file = std::string(split_flag.second);
@@ -248,9 +391,26 @@ FuzzStatus ParseFlags(
       } else if (0 == strncmp(cur_arg, "--force-render-red",
                               sizeof("--force-render-red") - 1)) {
         force_render_red = true;
+      } else if (0 == strncmp(cur_arg, "--fuzzer-pass-profile=",
+                              sizeof("--fuzzer-pass-profile=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        *fuzzer_pass_profile_file = std::string(split_flag.second);
       } else if (0 == strncmp(cur_arg, "--fuzzer-pass-validation",
                               sizeof("--fuzzer-pass-validation") - 1)) {
         fuzzer_options->enable_fuzzer_pass_validation();
+      } else if (0 == strncmp(cur_arg, "--guided-target=",
+                              sizeof("--guided-target=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        guided_options->target_command = std::string(split_flag.second);
+      } else if (0 == strncmp(cur_arg, "--guided-time-budget=",
+                              sizeof("--guided-time-budget=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        char* end = nullptr;
+        errno = 0;
+        const auto time_budget =
+            static_cast<uint32_t>(strtol(split_flag.second.c_str(), &end, 10));
+        assert(end != split_flag.second.c_str() && errno == 0);
+        guided_options->time_budget_seconds = time_budget;
       } else if (0 == strncmp(cur_arg, "--replay=", sizeof("--replay=") - 1)) {
         const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
         *replay_transformations_file = std::string(split_flag.second);
@@ -320,6 +480,15 @@ FuzzStatus ParseFlags(
             static_cast<uint32_t>(strtol(split_flag.second.c_str(), &end, 10));
         assert(end != split_flag.second.c_str() && errno == 0);
         fuzzer_options->set_shrinker_step_limit(step_limit);
+      } else if (0 == strncmp(cur_arg, "--shrinker-threads=",
+                              sizeof("--shrinker-threads=") - 1)) {
+        const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
+        char* end = nullptr;
+        errno = 0;
+        const auto num_threads =
+            static_cast<uint32_t>(strtol(split_flag.second.c_str(), &end, 10));
+        assert(end != split_flag.second.c_str() && errno == 0);
+        fuzzer_options->set_shrinker_num_threads(num_threads);
       } else if (0 == strncmp(cur_arg, "--shrinker-temp-file-prefix=",
                               sizeof("--shrinker-temp-file-prefix=") - 1)) {
         const auto split_flag = spvtools::utils::SplitFlagArgs(cur_arg);
@@ -355,6 +524,37 @@ FuzzStatus ParseFlags(
     }
   }
 
+  if (!campaign_options->shaders_file.empty()) {
+    // The tool is being invoked in campaign mode.
+    if (!in_binary_file->empty() || !interestingness_test->empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "No positional arguments can be used with --campaign; "
+                      "the reference shaders are specified by the campaign "
+                      "file.");
+      return {FuzzActions::STOP, 1};
+    }
+    if (force_render_red || !replay_transformations_file->empty() ||
+        !shrink_transformations_file->empty() ||
+        static_cast<spv_const_fuzzer_options>(*fuzzer_options)
+            ->replay_validation_enabled) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "The --campaign argument is not compatible with "
+                      "--force-render-red, --replay, --replay-validation nor "
+                      "--shrink.");
+      return {FuzzActions::STOP, 1};
+    }
+    if (out_binary_file->empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {}, "-o required");
+      return {FuzzActions::STOP, 1};
+    }
+    if (donors_file->empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "Fuzzing requires that the --donors option is used.");
+      return {FuzzActions::STOP, 1};
+    }
+    return {FuzzActions::CAMPAIGN, 0};
+  }
+
   if (in_binary_file->empty()) {
     spvtools::Error(FuzzDiagnostic, nullptr, {}, "No input file specified");
     return {FuzzActions::STOP, 1};
@@ -367,6 +567,32 @@ FuzzStatus ParseFlags(
 
   auto const_fuzzer_options =
       static_cast<spv_const_fuzzer_options>(*fuzzer_options);
+  if (!guided_options->target_command.empty()) {
+    // The tool is being invoked in guided mode.
+    if (force_render_red || !replay_transformations_file->empty() ||
+        !shrink_transformations_file->empty() ||
+        const_fuzzer_options->replay_validation_enabled ||
+        !interestingness_test->empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "The --guided-target argument is not compatible with "
+                      "--force-render-red, --replay, --replay-validation, "
+                      "--shrink nor an interestingness test.");
+      return {FuzzActions::STOP, 1};
+    }
+    if (guided_options->coverage_map_file.empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "The --guided-target argument requires that the "
+                      "--coverage-map option is used.");
+      return {FuzzActions::STOP, 1};
+    }
+    if (donors_file->empty()) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "Fuzzing requires that the --donors option is used.");
+      return {FuzzActions::STOP, 1};
+    }
+    return {FuzzActions::GUIDED, 0};
+  }
+
   if (force_render_red) {
     if (!replay_transformations_file->empty() ||
         !shrink_transformations_file->empty() ||
@@ -499,7 +725,8 @@ bool Replay(const spv_target_env& target_env,
   auto replay_result =
       spvtools::fuzz::Replayer(
           target_env, spvtools::utils::CLIMessageConsumer, binary_in,
-          initial_facts, transformation_sequence, num_transformations_to_apply,
+          initial_facts, std::move(transformation_sequence),
+          num_transformations_to_apply,
           fuzzer_options->replay_validation_enabled, validator_options)
           .Run();
   replay_result.transformed_module->module()->ToBinary(binary_out, false);
@@ -554,7 +781,8 @@ bool Shrink(const spv_target_env& target_env,
           target_env, spvtools::utils::CLIMessageConsumer, binary_in,
           initial_facts, transformation_sequence, interestingness_function,
           fuzzer_options->shrinker_step_limit,
-          fuzzer_options->replay_validation_enabled, validator_options)
+          fuzzer_options->replay_validation_enabled, validator_options,
+          fuzzer_options->shrinker_num_threads)
           .Run();
 
   *binary_out = std::move(shrink_result.transformed_binary);
@@ -565,20 +793,14 @@ bool Shrink(const spv_target_env& target_env,
              shrink_result.status;
 }
 
-bool Fuzz(const spv_target_env& target_env,
-          spv_const_fuzzer_options fuzzer_options,
-          spv_validator_options validator_options,
-          const std::vector<uint32_t>& binary_in,
-          const spvtools::fuzz::protobufs::FactSequence& initial_facts,
-          const std::string& donors,
-          spvtools::fuzz::RepeatedPassStrategy repeated_pass_strategy,
-          FuzzingTarget fuzzing_target, std::vector<uint32_t>* binary_out,
-          spvtools::fuzz::protobufs::TransformationSequence*
-              transformations_applied) {
+// Reads the names of donor files from |donors|, one per line, and adds a
+// supplier for each donor to |donor_suppliers|.  Returns false if |donors|
+// cannot be opened.
+bool GetDonorSuppliers(
+    const spv_target_env& target_env, const std::string& donors,
+    std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier>* donor_suppliers) {
   auto message_consumer = spvtools::utils::CLIMessageConsumer;
 
-  std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier> donor_suppliers;
-
   std::ifstream donors_file(donors);
   if (!donors_file) {
     spvtools::Error(FuzzDiagnostic, nullptr, {}, "Error opening donors file");
@@ -586,7 +808,7 @@ bool Fuzz(const spv_target_env& target_env,
   }
   std::string donor_filename;
   while (std::getline(donors_file, donor_filename)) {
-    donor_suppliers.emplace_back(
+    donor_suppliers->emplace_back(
         [donor_filename, message_consumer,
          target_env]() -> std::unique_ptr<spvtools::opt::IRContext> {
           std::vector<uint32_t> donor_binary;
@@ -599,6 +821,25 @@ bool Fuzz(const spv_target_env& target_env,
                                        donor_binary.size());
         });
   }
+  return true;
+}
+
+bool Fuzz(const spv_target_env& target_env,
+          spv_const_fuzzer_options fuzzer_options,
+          spv_validator_options validator_options,
+          const std::vector<uint32_t>& binary_in,
+          const spvtools::fuzz::protobufs::FactSequence& initial_facts,
+          const std::shared_ptr<spvtools::fuzz::DonorModuleCache>&
+              donor_module_cache,
+          uint32_t seed,
+          spvtools::fuzz::RepeatedPassStrategy repeated_pass_strategy,
+          FuzzingTarget fuzzing_target,
+          spvtools::fuzz::FuzzerPassProfiler* pass_profiler,
+          const std::vector<std::string>& preferred_pass_sequence,
+          std::vector<uint32_t>* binary_out,
+          spvtools::fuzz::protobufs::TransformationSequence*
+              transformations_applied) {
+  auto message_consumer = spvtools::utils::CLIMessageConsumer;
 
   std::unique_ptr<spvtools::opt::IRContext> ir_context;
   if (!spvtools::fuzz::fuzzerutil::BuildIRContext(target_env, message_consumer,
@@ -612,10 +853,7 @@ bool Fuzz(const spv_target_env& target_env,
           fuzzing_target == FuzzingTarget::kSpirv) &&
          "Not all fuzzing targets are handled");
   auto fuzzer_context = spvtools::MakeUnique<spvtools::fuzz::FuzzerContext>(
-      spvtools::MakeUnique<spvtools::fuzz::PseudoRandomGenerator>(
-          fuzzer_options->has_random_seed
-              ? fuzzer_options->random_seed
-              : static_cast<uint32_t>(std::random_device()())),
+      spvtools::MakeUnique<spvtools::fuzz::PseudoRandomGenerator>(seed),
       spvtools::fuzz::FuzzerContext::GetMinFreshId(ir_context.get()),
       fuzzing_target == FuzzingTarget::kWgsl);
 
@@ -628,9 +866,11 @@ bool Fuzz(const spv_target_env& target_env,
 
   spvtools::fuzz::Fuzzer fuzzer(
       std::move(ir_context), std::move(transformation_context),
-      std::move(fuzzer_context), message_consumer, donor_suppliers,
+      std::move(fuzzer_context), message_consumer, donor_module_cache,
       fuzzer_options->all_passes_enabled, repeated_pass_strategy,
       fuzzer_options->fuzzer_pass_validation_enabled, validator_options);
+  fuzzer.SetPassProfiler(pass_profiler);
+  fuzzer.SetPreferredPassSequence(preferred_pass_sequence);
   auto fuzz_result = fuzzer.Run(0);
   if (fuzz_result.status ==
       spvtools::fuzz::Fuzzer::Status::kFuzzerPassLedToInvalidModule) {
@@ -643,6 +883,403 @@ bool Fuzz(const spv_target_env& target_env,
   return true;
 }
 
+// Reads facts about the binary in |binary_file| into |facts|, from the file
+// with the same name but a .facts extension, if such a file exists.  Returns
+// false if the facts file exists but cannot be parsed.
+bool ReadFacts(const std::string& binary_file,
+               spvtools::fuzz::protobufs::FactSequence* facts) {
+  // If not found, dot_pos will be std::string::npos, which can be used in
+  // substr to mean "the end of the string"; there is no need to check the
+  // result.
+  size_t dot_pos = binary_file.rfind('.');
+  std::string facts_file = binary_file.substr(0, dot_pos) + ".facts";
+  std::ifstream facts_input(facts_file);
+  if (facts_input) {
+    std::string facts_json_string((std::istreambuf_iterator<char>(facts_input)),
+                                  std::istreambuf_iterator<char>());
+    facts_input.close();
+    if (google::protobuf::util::Status::OK !=
+        google::protobuf::util::JsonStringToMessage(facts_json_string, facts)) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {}, "Error reading facts data");
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes |transformations| in binary and JSON formats to files named after
+// |output_file_prefix|, with .transformations and .transformations_json
+// extensions respectively.  Returns false if an error occurs.
+bool WriteTransformations(
+    const std::string& output_file_prefix,
+    const spvtools::fuzz::protobufs::TransformationSequence& transformations) {
+  std::ofstream transformations_file;
+  transformations_file.open(output_file_prefix + ".transformations",
+                            std::ios::out | std::ios::binary);
+  bool success = transformations.SerializeToOstream(&transformations_file);
+  transformations_file.close();
+  if (!success) {
+    spvtools::Error(FuzzDiagnostic, nullptr, {},
+                    "Error writing out transformations binary");
+    return false;
+  }
+
+  std::string json_string;
+  auto json_options = google::protobuf::util::JsonOptions();
+  json_options.add_whitespace = true;
+  auto json_generation_status = google::protobuf::util::MessageToJsonString(
+      transformations, &json_string, json_options);
+  if (json_generation_status != google::protobuf::util::Status::OK) {
+    spvtools::Error(FuzzDiagnostic, nullptr, {},
+                    "Error writing out transformations in JSON format");
+    return false;
+  }
+
+  std::ofstream transformations_json_file(output_file_prefix +
+                                          ".transformations_json");
+  transformations_json_file << json_string;
+  transformations_json_file.close();
+  return true;
+}
+
+// Returns a 64-bit FNV-1a hash of the words of |binary|.
+uint64_t HashBinary(const std::vector<uint32_t>& binary) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto word : binary) {
+    for (uint32_t byte_index = 0; byte_index < 4; byte_index++) {
+      hash ^= (word >> (8 * byte_index)) & 0xFF;
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+// Runs a fuzzing campaign: worker threads repeatedly fuzz the reference
+// shaders listed in the campaign file of |campaign_options|, in round-robin
+// order, until the time budget is exhausted.  Run i uses seed |base_seed| + i.
+// Variants whose hash has not been seen before are written, together with
+// their transformations, to files named <output_prefix>_<n>.
+bool RunCampaign(const spv_target_env& target_env,
+                 spv_const_fuzzer_options fuzzer_options,
+                 spv_validator_options validator_options,
+                 const CampaignOptions& campaign_options,
+                 const std::string& donors,
+                 spvtools::fuzz::RepeatedPassStrategy repeated_pass_strategy,
+                 FuzzingTarget fuzzing_target,
+                 const std::string& output_prefix) {
+  struct ReferenceShader {
+    std::string filename;
+    std::vector<uint32_t> binary;
+    spvtools::fuzz::protobufs::FactSequence facts;
+  };
+
+  std::vector<ReferenceShader> reference_shaders;
+  std::ifstream shaders_file(campaign_options.shaders_file);
+  if (!shaders_file) {
+    spvtools::Error(FuzzDiagnostic, nullptr, {},
+                    "Error opening campaign file");
+    return false;
+  }
+  std::string shader_filename;
+  while (std::getline(shaders_file, shader_filename)) {
+    if (shader_filename.empty()) {
+      continue;
+    }
+    ReferenceShader reference_shader;
+    reference_shader.filename = shader_filename;
+    if (!ReadBinaryFile<uint32_t>(shader_filename.c_str(),
+                                  &reference_shader.binary) ||
+        !ReadFacts(shader_filename, &reference_shader.facts)) {
+      return false;
+    }
+    reference_shaders.push_back(std::move(reference_shader));
+  }
+  if (reference_shaders.empty()) {
+    spvtools::Error(FuzzDiagnostic, nullptr, {},
+                    "The campaign file does not list any shaders");
+    return false;
+  }
+
+  std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier> donor_suppliers;
+  if (!GetDonorSuppliers(target_env, donors, &donor_suppliers)) {
+    return false;
+  }
+  // Every worker draws donors from the same cache, so that each donor is only
+  // read, validated and summarized once for the whole campaign.
+  auto donor_module_cache =
+      std::make_shared<spvtools::fuzz::DonorModuleCache>(donor_suppliers,
+                                                         validator_options);
+
+  const uint32_t base_seed =
+      fuzzer_options->has_random_seed
+          ? fuzzer_options->random_seed
+          : static_cast<uint32_t>(std::random_device()());
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto deadline =
+      start_time + std::chrono::seconds(campaign_options.time_budget_seconds);
+
+  std::atomic<uint32_t> next_run(0);
+  std::atomic<bool> write_failed(false);
+
+  // Guards the following variables, and the printing of progress.
+  std::mutex mutex;
+  std::unordered_set<uint64_t> variant_hashes;
+  uint32_t num_variants = 0;
+  uint32_t num_duplicates = 0;
+  uint32_t num_failed_runs = 0;
+
+  auto worker = [&]() {
+    while (!write_failed && std::chrono::steady_clock::now() < deadline) {
+      const uint32_t run = next_run++;
+      const auto& reference_shader =
+          reference_shaders[run % reference_shaders.size()];
+      const uint32_t seed = base_seed + run;
+
+      std::vector<uint32_t> binary_out;
+      spvtools::fuzz::protobufs::TransformationSequence transformations_applied;
+      if (!Fuzz(target_env, fuzzer_options, validator_options,
+                reference_shader.binary, reference_shader.facts,
+                donor_module_cache, seed, repeated_pass_strategy,
+                fuzzing_target, nullptr, {}, &binary_out,
+                &transformations_applied)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_failed_runs++;
+        continue;
+      }
+
+      uint32_t variant_index;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!variant_hashes.insert(HashBinary(binary_out)).second) {
+          num_duplicates++;
+          continue;
+        }
+        variant_index = num_variants++;
+      }
+
+      std::stringstream ss;
+      ss << output_prefix << "_" << std::setw(4) << std::setfill('0')
+         << variant_index;
+      const std::string variant_prefix = ss.str();
+      if (!WriteFile<uint32_t>((variant_prefix + ".spv").c_str(), "wb",
+                               binary_out.data(), binary_out.size()) ||
+          !WriteTransformations(variant_prefix, transformations_applied)) {
+        spvtools::Error(FuzzDiagnostic, nullptr, {},
+                        "Error writing out variant");
+        write_failed = true;
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      printf("%s.spv: %s, seed %u\n", variant_prefix.c_str(),
+             reference_shader.filename.c_str(), seed);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < campaign_options.num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const double elapsed_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                    start_time)
+          .count();
+  printf(
+      "Campaign: %u runs (%u failed), %u variants, %u duplicates in %.1f "
+      "seconds on %u threads; %.2f variants/sec\n",
+      next_run.load(), num_failed_runs, num_variants, num_duplicates,
+      elapsed_seconds, campaign_options.num_threads,
+      elapsed_seconds > 0 ? num_variants / elapsed_seconds : 0.0);
+  return !write_failed;
+}
+
+// Reads the coverage bitmap that the target wrote to |coverage_map_file| into
+// |coverage_bitmap|.  A missing file yields an empty bitmap.
+void ReadCoverageBitmap(const std::string& coverage_map_file,
+                        std::vector<uint8_t>* coverage_bitmap) {
+  std::ifstream coverage_map(coverage_map_file, std::ios::binary);
+  coverage_bitmap->assign(std::istreambuf_iterator<char>(coverage_map),
+                          std::istreambuf_iterator<char>());
+}
+
+// Runs a coverage-guided fuzzing session on |binary_in| until the time budget
+// of |guided_options| is exhausted.  Run i uses seed |base_seed| + i.  Every
+// variant is run through the target; variants that achieve new coverage are
+// added to the corpus and written to files named <output_prefix>_queue_<n>,
+// and variants on which the target fails are written to files named
+// <output_prefix>_crash_<n>.
+bool RunGuided(const spv_target_env& target_env,
+               spv_const_fuzzer_options fuzzer_options,
+               spv_validator_options validator_options,
+               const std::vector<uint32_t>& binary_in,
+               const spvtools::fuzz::protobufs::FactSequence& initial_facts,
+               const GuidedOptions& guided_options, const std::string& donors,
+               spvtools::fuzz::RepeatedPassStrategy repeated_pass_strategy,
+               FuzzingTarget fuzzing_target,
+               const std::string& output_prefix) {
+  if (!CheckExecuteCommand()) {
+    spvtools::Error(FuzzDiagnostic, nullptr, {},
+                    "Could not find shell interpreter for executing a command");
+    return false;
+  }
+
+  std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier> donor_suppliers;
+  if (!GetDonorSuppliers(target_env, donors, &donor_suppliers)) {
+    return false;
+  }
+  auto donor_module_cache =
+      std::make_shared<spvtools::fuzz::DonorModuleCache>(donor_suppliers,
+                                                         validator_options);
+
+  const std::string current_variant_file = output_prefix + "_current.spv";
+
+  spvtools::fuzz::CoverageGuidedCorpus corpus;
+
+  // The outcomes of running the target on a variant.
+  enum class TargetResult { kPassed, kFailed, kWriteError };
+
+  // Runs the target on |binary|.  If the target passes, records its coverage
+  // and returns the number of edges with new coverage in |new_coverage|.  A
+  // failure to write the variant for the target is reported, and is not a
+  // failure of the target.
+  auto run_target = [&corpus, &guided_options, &current_variant_file](
+                        const std::vector<uint32_t>& binary,
+                        uint32_t* new_coverage) -> TargetResult {
+    if (!WriteFile<uint32_t>(current_variant_file.c_str(), "wb", binary.data(),
+                             binary.size())) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "Error writing out the variant for the target");
+      return TargetResult::kWriteError;
+    }
+    std::remove(guided_options.coverage_map_file.c_str());
+    if (!ExecuteCommand(guided_options.target_command + " " +
+                        current_variant_file)) {
+      return TargetResult::kFailed;
+    }
+    std::vector<uint8_t> coverage_bitmap;
+    ReadCoverageBitmap(guided_options.coverage_map_file, &coverage_bitmap);
+    *new_coverage = corpus.RecordCoverage(coverage_bitmap);
+    return TargetResult::kPassed;
+  };
+
+  // Writes |binary| and |transformations| to files named after
+  // <output_prefix>_<kind>_<index>.
+  auto write_variant =
+      [&output_prefix](
+          const std::string& kind, uint32_t index,
+          const std::vector<uint32_t>& binary,
+          const spvtools::fuzz::protobufs::TransformationSequence&
+              transformations) -> bool {
+    std::stringstream ss;
+    ss << output_prefix << "_" << kind << "_" << std::setw(4)
+       << std::setfill('0') << index;
+    const std::string variant_prefix = ss.str();
+    if (!WriteFile<uint32_t>((variant_prefix + ".spv").c_str(), "wb",
+                             binary.data(), binary.size()) ||
+        !WriteTransformations(variant_prefix, transformations)) {
+      spvtools::Error(FuzzDiagnostic, nullptr, {}, "Error writing out variant");
+      return false;
+    }
+    printf("%s.spv\n", variant_prefix.c_str());
+    return true;
+  };
+
+  // The input binary seeds the corpus, and must not make the target fail.
+  uint32_t initial_coverage = 0;
+  switch (run_target(binary_in, &initial_coverage)) {
+    case TargetResult::kPassed:
+      break;
+    case TargetResult::kFailed:
+      spvtools::Error(FuzzDiagnostic, nullptr, {},
+                      "The target fails on the input binary");
+      return false;
+    case TargetResult::kWriteError:
+      return false;
+  }
+  corpus.AddEntry(binary_in, {}, {}, initial_coverage);
+
+  const uint32_t base_seed =
+      fuzzer_options->has_random_seed
+          ? fuzzer_options->random_seed
+          : static_cast<uint32_t>(std::random_device()());
+  spvtools::fuzz::PseudoRandomGenerator random_generator(base_seed);
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto deadline =
+      start_time + std::chrono::seconds(guided_options.time_budget_seconds);
+
+  uint32_t num_runs = 0;
+  uint32_t num_failed_runs = 0;
+  uint32_t num_crashes = 0;
+  spvtools::fuzz::FuzzerPassProfiler pass_profiler;
+  while (std::chrono::steady_clock::now() < deadline) {
+    const auto& entry = corpus.GetEntry(corpus.ChooseEntry(&random_generator));
+    const uint32_t seed = base_seed + num_runs++;
+
+    // The profiler records the repeated passes that are applied, so that the
+    // sequence can be favoured when the variant is fuzzed in turn.
+    pass_profiler.Clear();
+    std::vector<uint32_t> binary_out;
+    spvtools::fuzz::protobufs::TransformationSequence transformations_applied;
+    if (!Fuzz(target_env, fuzzer_options, validator_options, entry.binary,
+              initial_facts, donor_module_cache, seed, repeated_pass_strategy,
+              fuzzing_target, &pass_profiler, entry.pass_sequence,
+              &binary_out, &transformations_applied)) {
+      num_failed_runs++;
+      continue;
+    }
+
+    // The transformations of the variant are relative to the input binary.
+    spvtools::fuzz::protobufs::TransformationSequence transformations =
+        entry.transformations;
+    transformations.MergeFrom(transformations_applied);
+
+    uint32_t new_coverage = 0;
+    const auto target_result = run_target(binary_out, &new_coverage);
+    if (target_result == TargetResult::kWriteError) {
+      return false;
+    }
+    if (target_result == TargetResult::kFailed) {
+      if (!write_variant("crash", num_crashes++, binary_out,
+                         transformations)) {
+        return false;
+      }
+      continue;
+    }
+    if (new_coverage == 0) {
+      continue;
+    }
+    std::vector<std::string> pass_sequence;
+    for (const auto& invocation : pass_profiler.GetPassInvocations()) {
+      if (!invocation.is_final_pass) {
+        pass_sequence.push_back(invocation.pass_name);
+      }
+    }
+    const auto index =
+        corpus.AddEntry(std::move(binary_out), std::move(transformations),
+                        std::move(pass_sequence), new_coverage);
+    const auto& new_entry = corpus.GetEntry(index);
+    if (!write_variant("queue", static_cast<uint32_t>(index),
+                       new_entry.binary, new_entry.transformations)) {
+      return false;
+    }
+  }
+
+  const double elapsed_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                    start_time)
+          .count();
+  printf(
+      "Guided: %u runs (%u failed), %zu queued variants, %u crashes, %u "
+      "edges covered in %.1f seconds\n",
+      num_runs, num_failed_runs, corpus.size(), num_crashes,
+      corpus.GetNumEdgesCovered(), elapsed_seconds);
+  return true;
+}
+
 }  // namespace
 
 // Dumps |binary| to file |filename|. Useful for interactive debugging.
@@ -693,6 +1330,7 @@ void DumpTransformationsJson(
 const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_3;
 
 int main(int argc, const char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   std::string in_binary_file;
   std::string out_binary_file;
   std::string donors_file;
@@ -700,8 +1338,13 @@ int main(int argc, const char** argv) {
   std::vector<std::string> interestingness_test;
   std::string shrink_transformations_file;
   std::string shrink_temp_file_prefix = "temp_";
+  std::string fuzzer_pass_profile_file;
   spvtools::fuzz::RepeatedPassStrategy repeated_pass_strategy;
   auto fuzzing_target = FuzzingTarget::kSpirv;
+  CampaignOptions campaign_options;
+  campaign_options.num_threads =
+      std::max(1u, std::thread::hardware_concurrency());
+  GuidedOptions guided_options;
 
   spvtools::FuzzerOptions fuzzer_options;
   spvtools::ValidatorOptions validator_options;
@@ -710,43 +1353,45 @@ int main(int argc, const char** argv) {
       ParseFlags(argc, argv, &in_binary_file, &out_binary_file, &donors_file,
                  &replay_transformations_file, &interestingness_test,
                  &shrink_transformations_file, &shrink_temp_file_prefix,
-                 &repeated_pass_strategy, &fuzzing_target, &fuzzer_options,
-                 &validator_options);
+                 &fuzzer_pass_profile_file, &repeated_pass_strategy,
+                 &fuzzing_target, &campaign_options, &guided_options,
+                 &fuzzer_options, &validator_options);
 
   if (status.action == FuzzActions::STOP) {
     return status.code;
   }
 
+  spv_target_env target_env = kDefaultEnvironment;
+
+  if (status.action == FuzzActions::CAMPAIGN) {
+    return RunCampaign(target_env, fuzzer_options, validator_options,
+                       campaign_options, donors_file, repeated_pass_strategy,
+                       fuzzing_target, out_binary_file)
+               ? 0
+               : 1;
+  }
+
   std::vector<uint32_t> binary_in;
   if (!ReadBinaryFile<uint32_t>(in_binary_file.c_str(), &binary_in)) {
     return 1;
   }
 
   spvtools::fuzz::protobufs::FactSequence initial_facts;
+  if (!ReadFacts(in_binary_file, &initial_facts)) {
+    return 1;
+  }
 
-  // If not found, dot_pos will be std::string::npos, which can be used in
-  // substr to mean "the end of the string"; there is no need to check the
-  // result.
-  size_t dot_pos = in_binary_file.rfind('.');
-  std::string in_facts_file = in_binary_file.substr(0, dot_pos) + ".facts";
-  std::ifstream facts_input(in_facts_file);
-  if (facts_input) {
-    std::string facts_json_string((std::istreambuf_iterator<char>(facts_input)),
-                                  std::istreambuf_iterator<char>());
-    facts_input.close();
-    if (google::protobuf::util::Status::OK !=
-        google::protobuf::util::JsonStringToMessage(facts_json_string,
-                                                    &initial_facts)) {
-      spvtools::Error(FuzzDiagnostic, nullptr, {}, "Error reading facts data");
-      return 1;
-    }
+  if (status.action == FuzzActions::GUIDED) {
+    return RunGuided(target_env, fuzzer_options, validator_options, binary_in,
+                     initial_facts, guided_options, donors_file,
+                     repeated_pass_strategy, fuzzing_target, out_binary_file)
+               ? 0
+               : 1;
   }
 
   std::vector<uint32_t> binary_out;
   spvtools::fuzz::protobufs::TransformationSequence transformations_applied;
 
-  spv_target_env target_env = kDefaultEnvironment;
-
   switch (status.action) {
     case FuzzActions::FORCE_RENDER_RED:
       if (!spvtools::fuzz::ForceRenderRed(
@@ -755,13 +1400,37 @@ int main(int argc, const char** argv) {
         return 1;
       }
       break;
-    case FuzzActions::FUZZ:
+    case FuzzActions::FUZZ: {
+      std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier> donor_suppliers;
+      if (!GetDonorSuppliers(target_env, donors_file, &donor_suppliers)) {
+        return 1;
+      }
+      auto const_fuzzer_options =
+          static_cast<spv_const_fuzzer_options>(fuzzer_options);
+      const uint32_t seed =
+          const_fuzzer_options->has_random_seed
+              ? const_fuzzer_options->random_seed
+              : static_cast<uint32_t>(std::random_device()());
+      spvtools::fuzz::FuzzerPassProfiler pass_profiler;
       if (!Fuzz(target_env, fuzzer_options, validator_options, binary_in,
-                initial_facts, donors_file, repeated_pass_strategy,
-                fuzzing_target, &binary_out, &transformations_applied)) {
+                initial_facts,
+                std::make_shared<spvtools::fuzz::DonorModuleCache>(
+                    donor_suppliers, validator_options),
+                seed, repeated_pass_strategy, fuzzing_target,
+                fuzzer_pass_profile_file.empty() ? nullptr : &pass_profiler,
+                {}, &binary_out, &transformations_applied)) {
         return 1;
       }
-      break;
+      if (!fuzzer_pass_profile_file.empty()) {
+        std::ofstream profile_file(fuzzer_pass_profile_file);
+        profile_file << pass_profiler.ToJson(true);
+        if (!profile_file) {
+          spvtools::Error(FuzzDiagnostic, nullptr, {},
+                          "Error writing fuzzer pass profile");
+          return 1;
+        }
+      }
+    } break;
     case FuzzActions::REPLAY:
       if (!Replay(target_env, fuzzer_options, validator_options, binary_in,
                   initial_facts, replay_transformations_file, &binary_out,
@@ -797,35 +1466,11 @@ int main(int argc, const char** argv) {
     // If not found, dot_pos will be std::string::npos, which can be used in
     // substr to mean "the end of the string"; there is no need to check the
     // result.
-    dot_pos = out_binary_file.rfind('.');
-    std::string output_file_prefix = out_binary_file.substr(0, dot_pos);
-    std::ofstream transformations_file;
-    transformations_file.open(output_file_prefix + ".transformations",
-                              std::ios::out | std::ios::binary);
-    bool success =
-        transformations_applied.SerializeToOstream(&transformations_file);
-    transformations_file.close();
-    if (!success) {
-      spvtools::Error(FuzzDiagnostic, nullptr, {},
-                      "Error writing out transformations binary");
+    size_t dot_pos = out_binary_file.rfind('.');
+    if (!WriteTransformations(out_binary_file.substr(0, dot_pos),
+                              transformations_applied)) {
       return 1;
     }
-
-    std::string json_string;
-    auto json_options = google::protobuf::util::JsonOptions();
-    json_options.add_whitespace = true;
-    auto json_generation_status = google::protobuf::util::MessageToJsonString(
-        transformations_applied, &json_string, json_options);
-    if (json_generation_status != google::protobuf::util::Status::OK) {
-      spvtools::Error(FuzzDiagnostic, nullptr, {},
-                      "Error writing out transformations in JSON format");
-      return 1;
-    }
-
-    std::ofstream transformations_json_file(output_file_prefix +
-                                            ".transformations_json");
-    transformations_json_file << json_string;
-    transformations_json_file.close();
   }
 
   return 0;
@@ -0,0 +1,294 @@
+// Copyright (c) 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the throughput of spirv-fuzz.  A fixed corpus of shaders is fuzzed
+// with fixed seeds, so that successive runs of the benchmark do the same work
+// and can be compared, e.g. to evaluate a change to the probabilities in
+// FuzzerContext.  A summary of the throughput is printed, and a JSON report of
+// the cost of each fuzzer pass can be written to a file.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "source/fuzz/donor_module_cache.h"
+#include "source/fuzz/fuzzer.h"
+#include "source/fuzz/fuzzer_pass_profiler.h"
+#include "source/fuzz/fuzzer_util.h"
+#include "source/fuzz/pseudo_random_generator.h"
+#include "source/opt/build_module.h"
+#include "source/util/make_unique.h"
+#include "spirv-tools/libspirv.hpp"
+#include "tools/util/cli_consumer.h"
+
+namespace {
+
+const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_3;
+
+// The number of seeds with which each shader of the corpus is fuzzed.
+const uint32_t kDefaultNumSeeds = 10;
+
+// The corpus.  Each shader also serves as a donor.
+const char* const kCorpus[] = {
+    // A fragment shader that writes a constant colour.
+    R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main" %9
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+               OpDecorate %9 Location 0
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeFloat 32
+          %7 = OpTypeVector %6 4
+          %8 = OpTypePointer Output %7
+          %9 = OpVariable %8 Output
+         %10 = OpConstant %6 1
+         %11 = OpConstant %6 0
+         %12 = OpConstantComposite %7 %10 %11 %11 %10
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+               OpStore %9 %12
+               OpReturn
+               OpFunctionEnd
+    )",
+    // A loop that sums the integers below 10.
+    R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main"
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeInt 32 1
+          %7 = OpTypePointer Function %6
+          %9 = OpConstant %6 0
+         %16 = OpConstant %6 10
+         %17 = OpTypeBool
+         %20 = OpConstant %6 1
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+          %8 = OpVariable %7 Function
+         %22 = OpVariable %7 Function
+               OpStore %8 %9
+               OpStore %22 %9
+               OpBranch %10
+         %10 = OpLabel
+               OpLoopMerge %12 %13 None
+               OpBranch %14
+         %14 = OpLabel
+         %15 = OpLoad %6 %8
+         %18 = OpSLessThan %17 %15 %16
+               OpBranchConditional %18 %11 %12
+         %11 = OpLabel
+         %23 = OpLoad %6 %22
+         %24 = OpIAdd %6 %23 %15
+               OpStore %22 %24
+               OpBranch %13
+         %13 = OpLabel
+         %19 = OpLoad %6 %8
+         %21 = OpIAdd %6 %19 %20
+               OpStore %8 %21
+               OpBranch %10
+         %12 = OpLabel
+               OpReturn
+               OpFunctionEnd
+    )",
+    // A function with a parameter, called under a selection.
+    R"(
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %4 "main" %30
+               OpExecutionMode %4 OriginUpperLeft
+               OpSource ESSL 310
+               OpDecorate %30 Location 0
+          %2 = OpTypeVoid
+          %3 = OpTypeFunction %2
+          %6 = OpTypeFloat 32
+          %7 = OpTypeVector %6 2
+          %8 = OpTypeFunction %6 %7
+         %10 = OpTypeBool
+         %11 = OpConstant %6 0.5
+         %12 = OpConstant %6 2
+         %13 = OpConstantComposite %7 %11 %12
+         %29 = OpTypePointer Output %6
+         %30 = OpVariable %29 Output
+          %4 = OpFunction %2 None %3
+          %5 = OpLabel
+         %14 = OpFunctionCall %6 %20 %13
+         %15 = OpFOrdLessThan %10 %14 %12
+               OpSelectionMerge %17 None
+               OpBranchConditional %15 %16 %17
+         %16 = OpLabel
+         %18 = OpFMul %6 %14 %14
+               OpStore %30 %18
+               OpBranch %17
+         %17 = OpLabel
+               OpReturn
+               OpFunctionEnd
+         %20 = OpFunction %6 None %8
+         %21 = OpFunctionParameter %7
+         %22 = OpLabel
+         %23 = OpCompositeExtract %6 %21 0
+         %24 = OpCompositeExtract %6 %21 1
+         %25 = OpFAdd %6 %23 %24
+               OpReturnValue %25
+               OpFunctionEnd
+    )"};
+
+void PrintUsage(const char* program) {
+  printf(
+      R"(%s - Measures the throughput of spirv-fuzz on a fixed corpus.
+
+USAGE: %s [options]
+
+Each shader of a built-in corpus is fuzzed with a fixed sequence of seeds,
+cycling through the repeated pass strategies.  The time taken and the number
+of transformations applied are printed.
+
+Options (in lexicographical order):
+
+  -h, --help
+               Print this help.
+  --num-seeds=
+               Unsigned 32-bit integer specifying the number of seeds with
+               which each shader is fuzzed.  The default is %u.
+  --profile=
+               File to which a JSON report of the cost of each fuzzer pass,
+               aggregated over all fuzzer runs, is written.
+)",
+      program, program, kDefaultNumSeeds);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  uint32_t num_seeds = kDefaultNumSeeds;
+  std::string profile_file;
+  for (int argi = 1; argi < argc; ++argi) {
+    const char* cur_arg = argv[argi];
+    if (0 == strcmp(cur_arg, "--help") || 0 == strcmp(cur_arg, "-h")) {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if (0 == strncmp(cur_arg, "--num-seeds=",
+                            sizeof("--num-seeds=") - 1)) {
+      num_seeds = static_cast<uint32_t>(
+          strtoul(cur_arg + sizeof("--num-seeds=") - 1, nullptr, 10));
+    } else if (0 == strncmp(cur_arg, "--profile=", sizeof("--profile=") - 1)) {
+      profile_file = std::string(cur_arg + sizeof("--profile=") - 1);
+    } else {
+      fprintf(stderr, "error: unrecognized argument: %s\n", cur_arg);
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  const auto env = kDefaultEnvironment;
+  auto message_consumer = spvtools::utils::CLIMessageConsumer;
+  spvtools::SpirvTools tools(env);
+  tools.SetMessageConsumer(message_consumer);
+  spvtools::ValidatorOptions validator_options;
+
+  std::vector<std::vector<uint32_t>> binaries;
+  std::vector<spvtools::fuzz::fuzzerutil::ModuleSupplier> donor_suppliers;
+  for (const char* shader : kCorpus) {
+    binaries.emplace_back();
+    if (!tools.Assemble(shader, &binaries.back(),
+                        SPV_TEXT_TO_BINARY_OPTION_PRESERVE_NUMERIC_IDS) ||
+        !tools.Validate(binaries.back())) {
+      fprintf(stderr, "error: invalid shader in the benchmark corpus\n");
+      return 1;
+    }
+    const auto& binary = binaries.back();
+    donor_suppliers.emplace_back([env, message_consumer, binary]() {
+      return spvtools::BuildModule(env, message_consumer, binary.data(),
+                                   binary.size());
+    });
+  }
+  // Donors are prepared up front, so that their cost is not attributed to
+  // the module donation pass.
+  auto donor_module_cache =
+      std::make_shared<spvtools::fuzz::DonorModuleCache>(donor_suppliers,
+                                                         validator_options);
+  for (size_t i = 0; i < donor_module_cache->size(); i++) {
+    donor_module_cache->GetDonor(i);
+  }
+
+  const spvtools::fuzz::RepeatedPassStrategy strategies[] = {
+      spvtools::fuzz::RepeatedPassStrategy::kSimple,
+      spvtools::fuzz::RepeatedPassStrategy::kLoopedWithRecommendations,
+      spvtools::fuzz::RepeatedPassStrategy::kRandomWithRecommendations};
+
+  spvtools::fuzz::FuzzerPassProfiler profiler;
+  uint64_t num_transformations = 0;
+  uint32_t num_runs = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (const auto& binary : binaries) {
+    for (uint32_t seed = 0; seed < num_seeds; seed++) {
+      std::unique_ptr<spvtools::opt::IRContext> ir_context;
+      if (!spvtools::fuzz::fuzzerutil::BuildIRContext(
+              env, message_consumer, binary, validator_options, &ir_context)) {
+        return 1;
+      }
+      auto fuzzer_context = spvtools::MakeUnique<spvtools::fuzz::FuzzerContext>(
+          spvtools::MakeUnique<spvtools::fuzz::PseudoRandomGenerator>(seed),
+          spvtools::fuzz::FuzzerContext::GetMinFreshId(ir_context.get()),
+          false);
+      auto transformation_context =
+          spvtools::MakeUnique<spvtools::fuzz::TransformationContext>(
+              spvtools::MakeUnique<spvtools::fuzz::FactManager>(
+                  ir_context.get()),
+              validator_options);
+      spvtools::fuzz::Fuzzer fuzzer(
+          std::move(ir_context), std::move(transformation_context),
+          std::move(fuzzer_context), message_consumer, donor_module_cache,
+          false, strategies[seed % 3], false, validator_options);
+      fuzzer.SetPassProfiler(profile_file.empty() ? nullptr : &profiler);
+      fuzzer.Run(0);
+      num_transformations += static_cast<uint64_t>(
+          fuzzer.GetTransformationSequence().transformation_size());
+      num_runs++;
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_time;
+
+  printf("runs: %u\n", num_runs);
+  printf("seconds: %f\n", elapsed.count());
+  printf("transformations: %llu\n",
+         static_cast<unsigned long long>(num_transformations));
+  printf("transformations per second: %f\n",
+         elapsed.count() > 0 ? num_transformations / elapsed.count() : 0);
+  if (!profile_file.empty()) {
+    // Measuring the module after every pass slows fuzzing down, so the times
+    // above are only comparable between runs that both, or neither, profile.
+    std::ofstream profile(profile_file);
+    profile << profiler.ToJson(false);
+    if (!profile) {
+      fprintf(stderr, "error: could not write %s\n", profile_file.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -20,6 +20,7 @@
 
 #include "source/spirv_target_env.h"
 #include "source/table.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.hpp"
 #include "tools/io.h"
 
@@ -65,6 +66,7 @@ Options (in lexicographical order):
 }  // namespace
 
 int main(int argc, char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   std::vector<const char*> inFiles;
   const char* outFile = nullptr;
   spv_target_env target_env = kDefaultEnvironment;
@@ -25,6 +25,7 @@
 #include "source/opt/log.h"
 #include "source/spirv_target_env.h"
 #include "source/util/string_utils.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.hpp"
 #include "spirv-tools/optimizer.hpp"
 #include "tools/io.h"
@@ -789,6 +790,7 @@ OptStatus ParseFlags(int argc, const char** argv,
 }  // namespace
 
 int main(int argc, const char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   const char* in_file = nullptr;
   const char* out_file = nullptr;
 
@@ -24,6 +24,7 @@
 #include "source/reduce/reducer.h"
 #include "source/spirv_reducer_options.h"
 #include "source/util/string_utils.h"
+#include "source/util/timer.h"
 #include "tools/io.h"
 #include "tools/util/cli_consumer.h"
 
@@ -265,6 +266,7 @@ void DumpShader(spvtools::opt::IRContext* context, const char* filename) {
 const auto kDefaultEnvironment = SPV_ENV_UNIVERSAL_1_5;
 
 int main(int argc, const char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   std::string in_binary_file;
   std::string out_binary_file;
   std::vector<std::string> interestingness_test;
@@ -20,6 +20,7 @@
 
 #include "source/spirv_target_env.h"
 #include "source/spirv_validator_options.h"
+#include "source/util/timer.h"
 #include "spirv-tools/libspirv.hpp"
 #include "tools/io.h"
 #include "tools/util/cli_consumer.h"
@@ -74,6 +75,7 @@ Options:
 }
 
 int main(int argc, char** argv) {
+  SPIRV_TRACE_FROM_ENVIRONMENT();
   const char* inFile = nullptr;
   spv_target_env target_env = SPV_ENV_UNIVERSAL_1_5;
   spvtools::ValidatorOptions options;